@@ -26,24 +26,89 @@
 #include <stdbool.h>
 #include <stdint.h>
 
+// Feature selection and fixed configuration, see Kconfig. A feature left out
+// turns its state flag into a constant, so its per-frame branches fold away.
+#ifdef ESP_PLATFORM
+#include "sdkconfig.h"
+#else
+// Outside ESP-IDF: every feature in, nothing fixed, unless the build
+// says otherwise
+#ifndef CONFIG_ROBOEYES_MOODS
+#define CONFIG_ROBOEYES_MOODS 1
+#endif
+#ifndef CONFIG_ROBOEYES_CURIOUS
+#define CONFIG_ROBOEYES_CURIOUS 1
+#endif
+#ifndef CONFIG_ROBOEYES_CYCLOPS
+#define CONFIG_ROBOEYES_CYCLOPS 1
+#endif
+#ifndef CONFIG_ROBOEYES_SWEAT
+#define CONFIG_ROBOEYES_SWEAT 1
+#endif
+#ifndef CONFIG_ROBOEYES_FLICKER
+#define CONFIG_ROBOEYES_FLICKER 1
+#endif
+#ifndef CONFIG_ROBOEYES_LAUGH
+#define CONFIG_ROBOEYES_LAUGH 1
+#endif
+#ifndef CONFIG_ROBOEYES_CONFUSED
+#define CONFIG_ROBOEYES_CONFUSED 1
+#endif
+#ifndef CONFIG_ROBOEYES_NATURAL_GAZE
+#define CONFIG_ROBOEYES_NATURAL_GAZE 1
+#endif
+#ifndef CONFIG_ROBOEYES_EYE_WIDTH
+#define CONFIG_ROBOEYES_EYE_WIDTH 36
+#endif
+#ifndef CONFIG_ROBOEYES_EYE_HEIGHT
+#define CONFIG_ROBOEYES_EYE_HEIGHT 36
+#endif
+#ifndef CONFIG_ROBOEYES_EYE_RADIUS
+#define CONFIG_ROBOEYES_EYE_RADIUS 8
+#endif
+#ifndef CONFIG_ROBOEYES_EYE_SPACE
+#define CONFIG_ROBOEYES_EYE_SPACE 10
+#endif
+#endif
+
 // Display colors
+#if CONFIG_ROBOEYES_FIXED_COLORS
+static const uint8_t BGCOLOR = CONFIG_ROBOEYES_BG_COLOR;
+static const uint8_t MAINCOLOR = CONFIG_ROBOEYES_MAIN_COLOR;
+#else
 static uint8_t BGCOLOR = 0;   // background and overlays
 static uint8_t MAINCOLOR = 1; // drawings
+#endif
 
 // For general setup - screen size and max. frame rate
+#if CONFIG_ROBOEYES_FIXED_SCREEN
+static const int screenWidth = CONFIG_ROBOEYES_SCREEN_WIDTH;
+static const int screenHeight = CONFIG_ROBOEYES_SCREEN_HEIGHT;
+#else
 static int screenWidth = 240;  // OLED display width, in pixels
 static int screenHeight = 135; // OLED display height, in pixels
+#endif
 static int frameInterval =
     20; // default value for 50 frames per second (1000/50 = 20 milliseconds)
 static unsigned long fpsTimer = 0; // for timing the frames per second
 
 // For controlling mood types and expressions
+#if CONFIG_ROBOEYES_MOODS
 static bool tired = 0;
 static bool angry = 0;
 static bool happy = 0;
+#endif
+#if CONFIG_ROBOEYES_CURIOUS
 static bool curious =
     0; // if true, draw the outer eye larger when looking left or right
-static bool cyclops = 0;   // if true, draw only one eye
+#else
+static const bool curious = 0;
+#endif
+#if CONFIG_ROBOEYES_CYCLOPS
+static bool cyclops = 0; // if true, draw only one eye
+#else
+static const bool cyclops = 0;
+#endif
 static bool eyeL_open = 0; // left eye opened or closed?
 static bool eyeR_open = 0; // right eye opened or closed?
 
@@ -52,23 +117,43 @@ static DrawRoundedRectangleFunc drawRoundedRectanglePtr;
 static ClearDisplayFunc clearDisplayPtr;
 static UpdateDisplayFunc updateDisplayPtr;
 static DrawTriangleFunc drawTrianglePtr;
+static DrawEyeFunc drawEyePtr;
 static MillisFunc millisPtr;
 static RandomFunc randomPtr;
+static TraceFunc tracePtr;
+
+// Latency tracing - every public command gets a sequence number
+static uint32_t commandSeq = 0; // last command issued
+static uint32_t appliedSeq = 0; // last command reflected in a drawn frame
+static bool drawing = 0; // commands issued by drawEyes() itself are not traced
+
+// Culling - primitives that draw nothing are dropped before the backend and
+// the rest shrunk towards the screen
+static bool culling = 1;
+static RoboEyesCullStats cullStats;
+// How far outside its box a MAINCOLOR primitive may paint, e.g. a glow
+static int cullMargin = 0;
+// Bounding box of MAINCOLOR drawn since the last clear, inkX2 < inkX1 if
+// none: BGCOLOR primitives outside it paint over background only
+static int inkX1 = 0;
+static int inkY1 = 0;
+static int inkX2 = -1;
+static int inkY2 = -1;
 
 //*********************************************************************************************
 //  Eyes Geometry
 //*********************************************************************************************
 
 // EYE LEFT - size and border radius
-static int eyeLwidthDefault = 36;
-static int eyeLheightDefault = 36;
+static int eyeLwidthDefault = CONFIG_ROBOEYES_EYE_WIDTH;
+static int eyeLheightDefault = CONFIG_ROBOEYES_EYE_HEIGHT;
 static int eyeLwidthCurrent = 0;
 static int eyeLheightCurrent = 0;
 static int eyeLwidthNext = 0;
 static int eyeLheightNext = 0;
 static int eyeLheightOffset = 0;
 // Border Radius
-static uint8_t eyeLborderRadiusDefault = 8;
+static uint8_t eyeLborderRadiusDefault = CONFIG_ROBOEYES_EYE_RADIUS;
 static uint8_t eyeLborderRadiusCurrent = 0;
 static uint8_t eyeLborderRadiusNext = 0;
 
@@ -82,7 +167,7 @@ static int eyeRwidthNext = 0;
 static int eyeRheightNext = 0;
 static int eyeRheightOffset = 0;
 // Border Radius
-static uint8_t eyeRborderRadiusDefault = 8;
+static uint8_t eyeRborderRadiusDefault = CONFIG_ROBOEYES_EYE_RADIUS;
 static uint8_t eyeRborderRadiusCurrent = 0;
 static uint8_t eyeRborderRadiusNext = 0;
 
@@ -103,6 +188,7 @@ static int eyeRxNext = 0;
 static int eyeRyNext = 0;
 
 // BOTH EYES
+#if CONFIG_ROBOEYES_MOODS
 // Eyelid top size
 static uint8_t eyelidsHeightMax = 0; // top eyelids max height
 static uint8_t eyelidsTiredHeight = 0;
@@ -113,25 +199,40 @@ static uint8_t eyelidsAngryHeightNext = 0;
 static uint8_t eyelidsHappyBottomOffsetMax = 0;
 static uint8_t eyelidsHappyBottomOffset = 0;
 static uint8_t eyelidsHappyBottomOffsetNext = 0;
+#endif
 // Space between eyes
-static int spaceBetweenDefault = 10;
+static int spaceBetweenDefault = CONFIG_ROBOEYES_EYE_SPACE;
 static int spaceBetweenCurrent = 0;
-static int spaceBetweenNext = 10;
+static int spaceBetweenNext = CONFIG_ROBOEYES_EYE_SPACE;
 
 //*********************************************************************************************
 //  Macro Animations
 //*********************************************************************************************
 
 // Animation - horizontal flicker/shiver
+#if CONFIG_ROBOEYES_FLICKER
 static bool hFlicker = 0;
+#else
+static const bool hFlicker = 0;
+#endif
 static bool hFlickerAlternate = 0;
 static uint8_t hFlickerAmplitude = 2;
 
 // Animation - vertical flicker/shiver
+#if CONFIG_ROBOEYES_FLICKER
 static bool vFlicker = 0;
+#else
+static const bool vFlicker = 0;
+#endif
 static bool vFlickerAlternate = 0;
 static uint8_t vFlickerAmplitude = 10;
 
+// Animation - external modulation, e.g. a speech envelope
+static volatile uint8_t modulation = 0; // written by other tasks at any rate
+static uint8_t modulationMode = ROBOEYES_MOD_OFF;
+static uint8_t modulationDepth = 12; // pixels at full modulation
+static bool modulationAlternate = 0;
+
 // Animation - auto blinking
 static bool autoblinker = 0; // activate auto blink animation
 static int blinkInterval =
@@ -151,21 +252,65 @@ static int idleIntervalVariation =
        // range will be add to the basic idleInterval, set to 0 for no variation
 static unsigned long idleAnimationTimer = 0; // for organising eyeblink timing
 
+// Gaze - where the left eye is heading (eyeLxNext / eyeLyNext). With natural
+// gaze, moves are saccades eased along a minimum jerk profile and fixations
+// jitter with micro-saccades; otherwise the eyes are sent straight there.
+#if CONFIG_ROBOEYES_NATURAL_GAZE
+static bool naturalGaze = 0;
+#else
+static const bool naturalGaze = 0;
+#endif
+static int gazeFromX = 0; // saccade start
+static int gazeFromY = 0;
+static int gazeToX = 0; // saccade end, then the fixation point
+static int gazeToY = 0;
+static bool saccade = 0; // moving from gazeFrom to gazeTo
+static unsigned long saccadeStart = 0;
+static int saccadeDuration = 0;      // ms, grows with amplitude
+static unsigned long microTimer = 0; // next micro-saccade
+static uint8_t noisePos = 0;
+#define SACCADE_MIN_MS 40
+#define SACCADE_MAX_MS 160
+
+// 10t^3 - 15t^4 + 6t^5 in 32 steps, 0..65535
+static const uint16_t gazeEase[33] = {
+    0,     19,    145,   467,   1052,  1951,  3196,  4806,  6784,
+    9121,  11797, 14781, 18036, 21515, 25167, 28938, 32768, 36597,
+    40368, 44020, 47499, 50754, 53738, 56414, 58751, 60729, 62339,
+    63584, 64483, 65068, 65390, 65516, 65535};
+
+// Fixed random sequence for micro-saccade offsets and timing
+static const int8_t gazeNoise[64] = {
+    37,  -51, 74,  -104, -91, -80, 59,  -99, -19, -109, -84, 94,  86,
+    -93, -5,  -82, 89,   -98, -65, -14, -97, 75,  -103, -15, -105, -60,
+    20,  86,  -55, -68,  29,  -36, -76, -32, 62,  -79,  -96, -98, -23,
+    126, 90,  32,  110,  104, 57,  25,  -1,  -36, -4,   -87, 25,  125,
+    47,  101, 19,  -91,  -68, 86,  -44, 47,  -51, 122,  87,  -108};
+
 // Animation - eyes confused: eyes shaking left and right
+#if CONFIG_ROBOEYES_CONFUSED
 static bool confused = 0;
 static unsigned long confusedAnimationTimer = 0;
 static int confusedAnimationDuration = 500;
 static bool confusedToggle = 1;
+#endif
 
 // Animation - eyes laughing: eyes shaking up and down
+#if CONFIG_ROBOEYES_LAUGH
 static bool laugh = 0;
 static unsigned long laughAnimationTimer = 0;
 static int laughAnimationDuration = 500;
 static bool laughToggle = 1;
+#endif
 
 // Animation - sweat on the forehead
+#if CONFIG_ROBOEYES_SWEAT
 static bool sweat = 0;
+#else
+static const bool sweat = 0;
+#endif
 static uint8_t sweatBorderradius = 3;
+static bool lowDetail = 0; // sweat drops kept but not drawn
 
 // Sweat drop 1
 static int sweat1XPosInitial = 2;
@@ -195,14 +340,121 @@ static float sweat3Width = 1;
 //  GENERAL METHODS
 //*********************************************************************************************
 
+static int min(int a, int b) { return a < b ? a : b; }
+static int max(int a, int b) { return a > b ? a : b; }
+
+// Area of the box x1,y1 - x2,y2 (exclusive) inside the screen
+static uint32_t onScreenArea(int x1, int y1, int x2, int y2) {
+  int w = min(x2, screenWidth) - max(x1, 0);
+  int h = min(y2, screenHeight) - max(y1, 0);
+  return w > 0 && h > 0 ? (uint32_t)w * h : 0;
+}
+
+// True if a primitive with this bounding box and color changes no pixel.
+// Relies on clearDisplay() filling the screen with BGCOLOR.
+static bool invisible(int x1, int y1, int x2, int y2, uint8_t color) {
+  if (color != BGCOLOR) {
+    x1 -= cullMargin;
+    y1 -= cullMargin;
+    x2 += cullMargin;
+    y2 += cullMargin;
+  }
+  if (x2 <= 0 || y2 <= 0 || x1 >= screenWidth || y1 >= screenHeight) {
+    return 1;
+  }
+  if (color == BGCOLOR) {
+    return x2 <= inkX1 || x1 > inkX2 || y2 <= inkY1 || y1 > inkY2;
+  }
+  return 0;
+}
+
+static void addInk(int x1, int y1, int x2, int y2, uint8_t color) {
+  if (color == BGCOLOR) {
+    return;
+  }
+  x1 = max(x1 - cullMargin, 0);
+  y1 = max(y1 - cullMargin, 0);
+  x2 = min(x2 + cullMargin, screenWidth) - 1;
+  y2 = min(y2 + cullMargin, screenHeight) - 1;
+  if (inkX2 < inkX1) {
+    inkX1 = x1;
+    inkY1 = y1;
+    inkX2 = x2;
+    inkY2 = y2;
+  } else {
+    inkX1 = min(inkX1, x1);
+    inkY1 = min(inkY1, y1);
+    inkX2 = max(inkX2, x2);
+    inkY2 = max(inkY2, y2);
+  }
+}
+
+// Clip one axis of a rounded rectangle to -r .. size + r, which keeps its
+// corners off-screen so the visible pixels stay the same. Left alone if
+// the result would get too short for the radius.
+static void clipSpan(int *pos, int *len, int r, int size) {
+  int a = max(*pos, -r);
+  int b = min(*pos + *len, size + r);
+  if (b - a >= 2 * r) {
+    *pos = a;
+    *len = b - a;
+  }
+}
+
 static void drawRoundedRectangle(int x, int y, int width, int height,
                                  int borderRadius, uint8_t color) {
-  if (drawRoundedRectanglePtr) {
-    drawRoundedRectanglePtr(x, y, width, height, borderRadius, color);
+  if (!drawRoundedRectanglePtr) {
+    return;
+  }
+  cullStats.submitted++;
+  if (culling) {
+    if (width <= 0 || height <= 0 ||
+        invisible(x, y, x + width, y + height, color)) {
+      cullStats.culled++;
+      cullStats.pixelsSaved += onScreenArea(x, y, x + width, y + height);
+      return;
+    }
+    // The radius a backend would use, so clipping cannot change it
+    borderRadius = min(borderRadius, min(width, height) / 2);
+    uint32_t area = (uint32_t)width * height;
+    clipSpan(&x, &width, borderRadius, screenWidth);
+    // A backend may shade MAINCOLOR by row of the shape, e.g. a gradient
+    if (color == BGCOLOR) {
+      clipSpan(&y, &height, borderRadius, screenHeight);
+    }
+    if ((uint32_t)width * height < area) {
+      cullStats.clipped++;
+      cullStats.pixelsSaved += area - (uint32_t)width * height;
+    }
+    addInk(x, y, x + width, y + height, color);
+  }
+  drawRoundedRectanglePtr(x, y, width, height, borderRadius, color);
+}
+
+// Eye body: the eye hook if one is installed, else a rounded rectangle.
+// Culled like one; the hook draws inside the box so it bounds the ink.
+static void drawEye(uint8_t eye, int x, int y, int width, int height,
+                    int borderRadius) {
+  if (!drawEyePtr) {
+    drawRoundedRectangle(x, y, width, height, borderRadius, MAINCOLOR);
+    return;
   }
+  cullStats.submitted++;
+  if (culling) {
+    if (width <= 0 || height <= 0 ||
+        invisible(x, y, x + width, y + height, MAINCOLOR)) {
+      cullStats.culled++;
+      cullStats.pixelsSaved += onScreenArea(x, y, x + width, y + height);
+      return;
+    }
+    addInk(x, y, x + width, y + height, MAINCOLOR);
+  }
+  drawEyePtr(eye, x, y, width, height, borderRadius, MAINCOLOR);
 }
 
 static void clearDisplay() {
+  inkX1 = 0;
+  inkX2 = -1;
   if (clearDisplayPtr) {
     clearDisplayPtr();
   }
@@ -214,12 +466,32 @@ static void updateDisplay() {
   }
 }
 
+#if CONFIG_ROBOEYES_MOODS // only eyelids use triangles
+// Triangles are culled but never clipped: a clipped triangle is a polygon
+// the backend cannot take, and it clips to its canvas anyway
 static void drawTriangle(int x0, int y0, int x1, int y1, int x2, int y2,
                          uint8_t color) {
-  if (drawTrianglePtr) {
-    drawTrianglePtr(x0, y0, x1, y1, x2, y2, color);
+  if (!drawTrianglePtr) {
+    return;
+  }
+  cullStats.submitted++;
+  if (culling) {
+    int area2 = (x1 - x0) * (y2 - y0) - (x2 - x0) * (y1 - y0);
+    int bx1 = min(x0, min(x1, x2));
+    int by1 = min(y0, min(y1, y2));
+    int bx2 = max(x0, max(x1, x2)) + 1;
+    int by2 = max(y0, max(y1, y2)) + 1;
+    // Zero area covers no pixel centre, e.g. eyelids at height 0
+    if (!area2 || invisible(bx1, by1, bx2, by2, color)) {
+      cullStats.culled++;
+      cullStats.pixelsSaved += (area2 < 0 ? -area2 : area2) / 2;
+      return;
+    }
+    addInk(bx1, by1, bx2, by2, color);
   }
+  drawTrianglePtr(x0, y0, x1, y1, x2, y2, color);
 }
+#endif
 
 static uint32_t millis() {
   if (millisPtr) {
@@ -235,12 +507,105 @@ static uint32_t random(uint32_t limit) {
   return 0;
 }
 
+static void traceCommand() {
+  if (drawing) {
+    return;
+  }
+  commandSeq++;
+  if (tracePtr) {
+    tracePtr(ROBOEYES_TRACE_COMMAND, commandSeq);
+  }
+}
+
+//*********************************************************************************************
+//  GAZE
+//*********************************************************************************************
+
+static int clamp(int v, int lo, int hi) { return v < lo ? lo : min(v, hi); }
+
+static int nextNoise() { return gazeNoise[noisePos++ & 63]; }
+
+// Send the left eye to x, y: a saccade with natural gaze, straight there
+// otherwise
+static void gazeTo(int x, int y) {
+  gazeToX = clamp(x, 0, max(RoboEyes_getScreenConstraint_X(), 0));
+  gazeToY = clamp(y, 0, max(RoboEyes_getScreenConstraint_Y(), 0));
+  if (!naturalGaze) {
+    eyeLxNext = gazeToX;
+    eyeLyNext = gazeToY;
+    saccade = 0;
+    return;
+  }
+  gazeFromX = eyeLxNext;
+  gazeFromY = eyeLyNext;
+  // Larger jumps take longer, like the saccadic main sequence
+  int dx = gazeToX - gazeFromX;
+  int dy = gazeToY - gazeFromY;
+  int amplitude = max(max(dx, -dx), max(dy, -dy));
+  saccadeDuration = min(SACCADE_MIN_MS + amplitude / 2, SACCADE_MAX_MS);
+  saccadeStart = millis();
+  saccade = 1;
+}
+
+// Idle target: with natural gaze mostly a short hop from the current
+// fixation, now and then anywhere
+static void gazeIdle() {
+  int cx = max(RoboEyes_getScreenConstraint_X(), 0);
+  int cy = max(RoboEyes_getScreenConstraint_Y(), 0);
+  int x, y;
+  if (naturalGaze && random(4)) {
+    x = gazeToX + (int)random(cx / 2 + 1) - cx / 4;
+    y = gazeToY + (int)random(cy / 2 + 1) - cy / 4;
+  } else {
+    x = random(cx);
+    y = random(cy);
+  }
+  gazeTo(x, y);
+}
+
+// Advance the saccade or fixation by one frame and keep the gaze on screen
+static void gazeUpdate() {
+  unsigned long now = millis();
+  if (saccade) {
+    uint32_t t = now - saccadeStart;
+    if (t >= (uint32_t)saccadeDuration) {
+      eyeLxNext = gazeToX;
+      eyeLyNext = gazeToY;
+      saccade = 0;
+      microTimer = now + 250 + (nextNoise() + 128) * 2;
+    } else {
+      // Table lookup with 11 bits of interpolation between entries
+      uint32_t p = (t << 16) / saccadeDuration;
+      int i = p >> 11;
+      int32_t e = gazeEase[i] +
+                  (((gazeEase[i + 1] - gazeEase[i]) * (int32_t)(p & 0x7ff)) >>
+                   11);
+      eyeLxNext = gazeFromX + (((gazeToX - gazeFromX) * e) >> 16);
+      eyeLyNext = gazeFromY + (((gazeToY - gazeFromY) * e) >> 16);
+    }
+  } else if (naturalGaze && now >= microTimer) {
+    // Micro-saccade: a pixel or two off the fixation point, 250..760 ms apart
+    eyeLxNext = gazeToX + (nextNoise() >> 6);
+    eyeLyNext = gazeToY + (nextNoise() >> 6);
+    microTimer = now + 250 + (nextNoise() + 128) * 2;
+  }
+  eyeLxNext = clamp(eyeLxNext, 0, max(RoboEyes_getScreenConstraint_X(), 0));
+  eyeLyNext = clamp(eyeLyNext, 0, max(RoboEyes_getScreenConstraint_Y(), 0));
+}
+
 //*********************************************************************************************
 //  PRE-CALCULATIONS AND ACTUAL DRAWINGS
 //*********************************************************************************************
 
 static void drawEyes() {
 
+  // All commands issued up to here are reflected by this frame
+  uint32_t frameSeq = commandSeq;
+  drawing = 1;
+  if (tracePtr && frameSeq != appliedSeq) {
+    tracePtr(ROBOEYES_TRACE_APPLIED, frameSeq);
+  }
+
   //// PRE-CALCULATIONS - EYE SIZES AND VALUES FOR ANIMATION TWEENINGS ////
 
   // Vertical size offset for larger eyes when looking left or right (curious
@@ -264,6 +629,13 @@ static void drawEyes() {
     eyeRheightOffset = 0; // reset height offset for right eye
   }
 
+  // External modulation, sampled once per frame
+  int modOffset = (modulation * modulationDepth) >> 8;
+  if (modulationMode == ROBOEYES_MOD_HEIGHT) {
+    eyeLheightOffset += modOffset; // eyes swell with the input
+    eyeRheightOffset += modOffset;
+  }
+
   // Left eye height
   eyeLheightCurrent =
       (eyeLheightCurrent + eyeLheightNext + eyeLheightOffset) / 2;
@@ -329,6 +701,7 @@ static void drawEyes() {
 
   // Laughing - eyes shaking up and down for the duration defined by
   // laughAnimationDuration (default = 500ms)
+#if CONFIG_ROBOEYES_LAUGH
   if (laugh) {
     if (laughToggle) {
       RoboEyes_setVFlicker2(1, 5);
@@ -340,9 +713,11 @@ static void drawEyes() {
       laugh = 0;
     }
   }
+#endif
 
   // Confused - eyes shaking left and right for the duration defined by
   // confusedAnimationDuration (default = 500ms)
+#if CONFIG_ROBOEYES_CONFUSED
   if (confused) {
     if (confusedToggle) {
       RoboEyes_setHFlicker2(1, 20);
@@ -354,17 +729,18 @@ static void drawEyes() {
       confused = 0;
     }
   }
+#endif
 
   // Idle - eyes moving to random positions on screen
   if (idle) {
     if (millis() >= idleAnimationTimer) {
-      eyeLxNext = random(RoboEyes_getScreenConstraint_X());
-      eyeLyNext = random(RoboEyes_getScreenConstraint_Y());
+      gazeIdle();
       idleAnimationTimer = millis() + (idleInterval * 1000) +
                            (random(idleIntervalVariation) *
                             1000); // calculate next time for eyes repositioning
     }
   }
+  gazeUpdate();
 
   // Adding offsets for horizontal flickering/shivering
   if (hFlicker) {
@@ -390,6 +766,18 @@ static void drawEyes() {
     vFlickerAlternate = !vFlickerAlternate;
   }
 
+  // Adding offsets for modulation driven vertical pulsing
+  if (modulationMode == ROBOEYES_MOD_VFLICKER && modOffset) {
+    if (modulationAlternate) {
+      eyeLy += modOffset;
+      eyeRy += modOffset;
+    } else {
+      eyeLy -= modOffset;
+      eyeRy -= modOffset;
+    }
+    modulationAlternate = !modulationAlternate;
+  }
+
   // Cyclops mode, set second eye's size and space between to 0
   if (cyclops) {
     eyeRwidthCurrent = 0;
@@ -402,13 +790,14 @@ static void drawEyes() {
   clearDisplay();
 
   // Draw basic eye rectangles
-  drawRoundedRectangle(eyeLx, eyeLy, eyeLwidthCurrent, eyeLheightCurrent,
-                       eyeLborderRadiusCurrent, MAINCOLOR); // left eye
+  drawEye(0, eyeLx, eyeLy, eyeLwidthCurrent, eyeLheightCurrent,
+          eyeLborderRadiusCurrent); // left eye
   if (!cyclops) {
-    drawRoundedRectangle(eyeRx, eyeRy, eyeRwidthCurrent, eyeRheightCurrent,
-                         eyeRborderRadiusCurrent, MAINCOLOR); // right eye
+    drawEye(1, eyeRx, eyeRy, eyeRwidthCurrent, eyeRheightCurrent,
+            eyeRborderRadiusCurrent); // right eye
   }
 
+#if CONFIG_ROBOEYES_MOODS
   // Prepare mood type transitions
   if (tired) {
     eyelidsTiredHeightNext = eyeLheightCurrent / 2;
@@ -478,9 +867,10 @@ static void drawEyes() {
         eyeRwidthCurrent + 2, eyeRheightDefault, eyeRborderRadiusCurrent,
         BGCOLOR); // right eye
   }
+#endif
 
   // Add sweat drops
-  if (sweat) {
+  if (sweat && !lowDetail) {
     // Sweat drop 1 -> left corner
     if (sweat1YPos <= sweat1YPosMax) {
       sweat1YPos += 0.5;
@@ -557,7 +947,13 @@ static void drawEyes() {
                          sweatBorderradius, MAINCOLOR); // draw sweat drop
   }
 
+  if (tracePtr && frameSeq != appliedSeq) {
+    tracePtr(ROBOEYES_TRACE_FRAME, frameSeq);
+  }
+  appliedSeq = frameSeq;
+
   updateDisplay();
+  drawing = 0;
 
 } // end of drawEyes method
 
@@ -605,6 +1001,9 @@ void RoboEyes_init(DrawRoundedRectangleFunc drawRoundedRectangle,
   eyeLxNext = eyeLxDefault;
   eyeLyNext = eyeLyDefault;
 
+  gazeToX = eyeLxDefault;
+  gazeToY = eyeLyDefault;
+
   eyeRxDefault = eyeLx + eyeLwidthCurrent + spaceBetweenDefault;
   eyeRyDefault = eyeLy;
   eyeRx = eyeRxDefault;
@@ -613,11 +1012,21 @@ void RoboEyes_init(DrawRoundedRectangleFunc drawRoundedRectangle,
   eyeRyNext = eyeRy;
 }
 
+// Install a hook that follows each public command through state application
+// and the first frame reflecting it, see ROBOEYES_TRACE_*
+void RoboEyes_setTraceHook(TraceFunc trace) { tracePtr = trace; }
+
+// Install a function that draws the eye bodies instead of the rounded
+// rectangles, e.g. other shapes fitted to the same box; NULL restores them
+void RoboEyes_setEyeHook(DrawEyeFunc drawEye) { drawEyePtr = drawEye; }
+
 // Startup RoboEyes with defined screen-width, screen-height and max. frames per
 // second
 void RoboEyes_begin(int width, int height, uint8_t frameRate) {
+#if !CONFIG_ROBOEYES_FIXED_SCREEN
   screenWidth = width;   // OLED display width, in pixels
   screenHeight = height; // OLED display height, in pixels
+#endif
   clearDisplay();        // clear the display buffer
   updateDisplay();       // show empty screen
   eyeLheightCurrent = 1; // start with closed eyes
@@ -639,15 +1048,22 @@ void RoboEyes_update() {
 //*********************************************************************************************
 
 // Calculate frame interval based on defined frameRate
-void RoboEyes_setFramerate(uint8_t fps) { frameInterval = 1000 / fps; }
+void RoboEyes_setFramerate(uint8_t fps) {
+  traceCommand();
+  frameInterval = 1000 / fps;
+}
 
 // Set color values
 void RoboEyes_setDisplayColors(uint8_t background, uint8_t main) {
+  traceCommand();
+#if !CONFIG_ROBOEYES_FIXED_COLORS
   BGCOLOR = background;
   MAINCOLOR = main;
+#endif
 }
 
 void RoboEyes_setWidth(uint8_t leftEye, uint8_t rightEye) {
+  traceCommand();
   eyeLwidthNext = leftEye;
   eyeRwidthNext = rightEye;
   eyeLwidthDefault = leftEye;
@@ -655,6 +1071,7 @@ void RoboEyes_setWidth(uint8_t leftEye, uint8_t rightEye) {
 }
 
 void RoboEyes_setHeight(uint8_t leftEye, uint8_t rightEye) {
+  traceCommand();
   eyeLheightNext = leftEye;
   eyeRheightNext = rightEye;
   eyeLheightDefault = leftEye;
@@ -663,6 +1080,7 @@ void RoboEyes_setHeight(uint8_t leftEye, uint8_t rightEye) {
 
 // Set border radius for left and right eye
 void RoboEyes_setBorderradius(uint8_t leftEye, uint8_t rightEye) {
+  traceCommand();
   eyeLborderRadiusNext = leftEye;
   eyeRborderRadiusNext = rightEye;
   eyeLborderRadiusDefault = leftEye;
@@ -671,12 +1089,15 @@ void RoboEyes_setBorderradius(uint8_t leftEye, uint8_t rightEye) {
 
 // Set space between the eyes, can also be negative
 void RoboEyes_setSpacebetween(int space) {
+  traceCommand();
   spaceBetweenNext = space;
   spaceBetweenDefault = space;
 }
 
 // Set mood expression
 void RoboEyes_setMood(unsigned char mood) {
+  traceCommand();
+#if CONFIG_ROBOEYES_MOODS
   switch (mood) {
   case TIRED:
     tired = 1;
@@ -699,116 +1120,420 @@ void RoboEyes_setMood(unsigned char mood) {
     happy = 0;
     break;
   }
+#endif
 }
 
 // Set predefined position
 void RoboEyes_setPosition(unsigned char position) {
+  traceCommand();
+  int x, y;
   switch (position) {
   case N:
     // North, top center
-    eyeLxNext = RoboEyes_getScreenConstraint_X() / 2;
-    eyeLyNext = 0;
+    x = RoboEyes_getScreenConstraint_X() / 2;
+    y = 0;
     break;
   case NE:
     // North-east, top right
-    eyeLxNext = RoboEyes_getScreenConstraint_X();
-    eyeLyNext = 0;
+    x = RoboEyes_getScreenConstraint_X();
+    y = 0;
     break;
   case E:
     // East, middle right
-    eyeLxNext = RoboEyes_getScreenConstraint_X();
-    eyeLyNext = RoboEyes_getScreenConstraint_Y() / 2;
+    x = RoboEyes_getScreenConstraint_X();
+    y = RoboEyes_getScreenConstraint_Y() / 2;
     break;
   case SE:
     // South-east, bottom right
-    eyeLxNext = RoboEyes_getScreenConstraint_X();
-    eyeLyNext = RoboEyes_getScreenConstraint_Y();
+    x = RoboEyes_getScreenConstraint_X();
+    y = RoboEyes_getScreenConstraint_Y();
     break;
   case S:
     // South, bottom center
-    eyeLxNext = RoboEyes_getScreenConstraint_X() / 2;
-    eyeLyNext = RoboEyes_getScreenConstraint_Y();
+    x = RoboEyes_getScreenConstraint_X() / 2;
+    y = RoboEyes_getScreenConstraint_Y();
     break;
   case SW:
     // South-west, bottom left
-    eyeLxNext = 0;
-    eyeLyNext = RoboEyes_getScreenConstraint_Y();
+    x = 0;
+    y = RoboEyes_getScreenConstraint_Y();
     break;
   case W:
     // West, middle left
-    eyeLxNext = 0;
-    eyeLyNext = RoboEyes_getScreenConstraint_Y() / 2;
+    x = 0;
+    y = RoboEyes_getScreenConstraint_Y() / 2;
     break;
   case NW:
     // North-west, top left
-    eyeLxNext = 0;
-    eyeLyNext = 0;
+    x = 0;
+    y = 0;
     break;
   default:
     // Middle center
-    eyeLxNext = RoboEyes_getScreenConstraint_X() / 2;
-    eyeLyNext = RoboEyes_getScreenConstraint_Y() / 2;
+    x = RoboEyes_getScreenConstraint_X() / 2;
+    y = RoboEyes_getScreenConstraint_Y() / 2;
     break;
   }
+  gazeTo(x, y);
 }
 
 // Set automated eye blinking, minimal blink interval in full seconds and blink
 // interval variation range in full seconds
 void RoboEyes_setAutoblinker2(bool active, int interval, int variation) {
+  traceCommand();
   autoblinker = active;
   blinkInterval = interval;
   blinkIntervalVariation = variation;
 }
-void RoboEyes_setAutoblinker(bool active) { autoblinker = active; }
+void RoboEyes_setAutoblinker(bool active) {
+  traceCommand();
+  autoblinker = active;
+}
 
 // Set idle mode - automated eye repositioning, minimal time interval in full
 // seconds and time interval variation range in full seconds
 void RoboEyes_setIdleMode2(bool active, int interval, int variation) {
+  traceCommand();
   idle = active;
   idleInterval = interval;
   idleIntervalVariation = variation;
 }
-void RoboEyes_setIdleMode(bool active) { idle = active; }
+void RoboEyes_setIdleMode(bool active) {
+  traceCommand();
+  idle = active;
+}
 
 // Set curious mode - the respectively outer eye gets larger when looking left
 // or right
-void RoboEyes_setCuriosity(bool curiousBit) { curious = curiousBit; }
+void RoboEyes_setCuriosity(bool curiousBit) {
+  traceCommand();
+#if CONFIG_ROBOEYES_CURIOUS
+  curious = curiousBit;
+#endif
+}
 
 // Set cyclops mode - show only one eye
-void RoboEyes_setCyclops(bool cyclopsBit) { cyclops = cyclopsBit; }
+void RoboEyes_setCyclops(bool cyclopsBit) {
+  traceCommand();
+#if CONFIG_ROBOEYES_CYCLOPS
+  cyclops = cyclopsBit;
+#endif
+}
 
 // Set horizontal flickering (displacing eyes left/right)
 void RoboEyes_setHFlicker2(bool flickerBit, uint8_t Amplitude) {
+  traceCommand();
+#if CONFIG_ROBOEYES_FLICKER
   hFlicker = flickerBit;         // turn flicker on or off
+#endif
   hFlickerAmplitude = Amplitude; // define amplitude of flickering in pixels
 }
 void RoboEyes_setHFlicker(bool flickerBit) {
+  traceCommand();
+#if CONFIG_ROBOEYES_FLICKER
   hFlicker = flickerBit; // turn flicker on or off
+#endif
 }
 
 // Set vertical flickering (displacing eyes up/down)
 void RoboEyes_setVFlicker2(bool flickerBit, uint8_t Amplitude) {
+  traceCommand();
+#if CONFIG_ROBOEYES_FLICKER
   vFlicker = flickerBit;         // turn flicker on or off
+#endif
   vFlickerAmplitude = Amplitude; // define amplitude of flickering in pixels
 }
 void RoboEyes_setVFlicker(bool flickerBit) {
+  traceCommand();
+#if CONFIG_ROBOEYES_FLICKER
   vFlicker = flickerBit; // turn flicker on or off
+#endif
 }
 
 void RoboEyes_setSweat(bool sweatBit) {
+  traceCommand();
+#if CONFIG_ROBOEYES_SWEAT
   sweat = sweatBit; // turn sweat on or off
+#endif
+}
+
+// Skip decorations that are not part of an expression (the sweat drops) to
+// save render time; their on/off state is kept for when it is turned off
+void RoboEyes_setLowDetail(bool low) { lowDetail = low; }
+
+// Set what the modulation input drives (ROBOEYES_MOD_*) and its full scale
+// effect in pixels
+void RoboEyes_setModulationMode(uint8_t mode, uint8_t depth) {
+  traceCommand();
+  modulationMode = mode;
+  modulationDepth = depth;
+}
+
+// Feed the modulation input, 0..255. Meant to be called continuously from
+// any task, so it is not traced as a command.
+void RoboEyes_setModulation(uint8_t amount) { modulation = amount; }
+
+// Look at a point on screen: the eyes centre on it as far as they can
+void RoboEyes_lookAt(int x, int y) {
+  traceCommand();
+  gazeTo(x - (eyeLwidthCurrent + spaceBetweenCurrent + eyeRwidthCurrent) / 2,
+         y - eyeLheightDefault / 2);
+}
+
+// Natural gaze - eased saccades, idle hops near the last fixation and
+// micro-saccades while fixating, instead of jumps to the target
+void RoboEyes_setNaturalGaze(bool natural) {
+  traceCommand();
+#if CONFIG_ROBOEYES_NATURAL_GAZE
+  naturalGaze = natural;
+  gazeToX = eyeLxNext;
+  gazeToY = eyeLyNext;
+  saccade = 0;
+#endif
+}
+
+// Drop primitives that draw nothing and clip the rest before they reach the
+// backend (on by default); the rendered pixels are the same either way
+void RoboEyes_setCulling(bool cull) {
+  traceCommand();
+  culling = cull;
+}
+
+// Let culling know MAINCOLOR primitives paint up to pixels outside their
+// box, e.g. the backend's glow, so what they light is kept. Not a command.
+void RoboEyes_setCullMargin(uint8_t pixels) { cullMargin = pixels; }
+
+//*********************************************************************************************
+//  STATE SNAPSHOT
+//*********************************************************************************************
+
+#define SNAP_LEFT_OPEN 0x0001
+#define SNAP_RIGHT_OPEN 0x0002
+#define SNAP_AUTOBLINK 0x0004
+#define SNAP_IDLE 0x0008
+#define SNAP_NATURAL_GAZE 0x0010
+#define SNAP_CURIOUS 0x0020
+#define SNAP_CYCLOPS 0x0040
+#define SNAP_SWEAT 0x0080
+#define SNAP_HFLICKER 0x0100
+#define SNAP_VFLICKER 0x0200
+
+// Time left until an absolute millis() deadline, saturated to 16 bits
+static uint16_t timeLeft(unsigned long deadline, unsigned long now) {
+  if (deadline <= now) {
+    return 0;
+  }
+  return deadline - now > 0xffff ? 0xffff : deadline - now;
+}
+
+static void saveEye(RoboEyesSnapshotEye *e, int x, int y, int width,
+                    int height, uint8_t radius, int widthNext, int heightNext,
+                    uint8_t radiusNext, int widthDefault, int heightDefault,
+                    uint8_t radiusDefault) {
+  e->x = x;
+  e->y = y;
+  e->width = width;
+  e->height = height;
+  e->radius = radius;
+  e->widthNext = widthNext;
+  e->heightNext = heightNext;
+  e->radiusNext = radiusNext;
+  e->widthDefault = widthDefault;
+  e->heightDefault = heightDefault;
+  e->radiusDefault = radiusDefault;
+}
+
+// Copy the state that makes up the current expression into snapshot
+void RoboEyes_saveState(RoboEyesSnapshot *snapshot) {
+  RoboEyesSnapshot s = {0};
+  unsigned long now = millis();
+  s.version = ROBOEYES_SNAPSHOT_VERSION;
+  s.mood = DEFAULT;
+#if CONFIG_ROBOEYES_MOODS
+  s.mood = tired ? TIRED : angry ? ANGRY : happy ? HAPPY : DEFAULT;
+  s.eyelidsTired = eyelidsTiredHeight;
+  s.eyelidsAngry = eyelidsAngryHeight;
+  s.eyelidsHappy = eyelidsHappyBottomOffset;
+#endif
+  // Flicker a one-shot animation turned on ends with it
+  bool hShaking = hFlicker, vShaking = vFlicker;
+#if CONFIG_ROBOEYES_CONFUSED
+  hShaking = hShaking && !(confused && !confusedToggle);
+#endif
+#if CONFIG_ROBOEYES_LAUGH
+  vShaking = vShaking && !(laugh && !laughToggle);
+#endif
+  s.flags = (eyeL_open ? SNAP_LEFT_OPEN : 0) |
+            (eyeR_open ? SNAP_RIGHT_OPEN : 0) |
+            (autoblinker ? SNAP_AUTOBLINK : 0) | (idle ? SNAP_IDLE : 0) |
+            (naturalGaze ? SNAP_NATURAL_GAZE : 0) |
+            (curious ? SNAP_CURIOUS : 0) | (cyclops ? SNAP_CYCLOPS : 0) |
+            (sweat ? SNAP_SWEAT : 0) | (hShaking ? SNAP_HFLICKER : 0) |
+            (vShaking ? SNAP_VFLICKER : 0);
+  s.screenWidth = screenWidth;
+  s.screenHeight = screenHeight;
+  s.frameInterval = frameInterval;
+  s.gazeX = eyeLxNext;
+  s.gazeY = eyeLyNext;
+  s.fixateX = gazeToX;
+  s.fixateY = gazeToY;
+  if (saccade) {
+    s.saccadeFromX = gazeFromX;
+    s.saccadeFromY = gazeFromY;
+    s.saccadeElapsed = min(now - saccadeStart, 0xffff);
+    s.saccadeDuration = saccadeDuration;
+  }
+  s.noisePos = noisePos;
+  s.space = spaceBetweenCurrent;
+  s.spaceNext = spaceBetweenNext;
+  s.spaceDefault = spaceBetweenDefault;
+  s.hFlickerAmplitude = hFlickerAmplitude;
+  s.vFlickerAmplitude = vFlickerAmplitude;
+  s.blinkInterval = blinkInterval;
+  s.blinkVariation = blinkIntervalVariation;
+  s.idleInterval = idleInterval;
+  s.idleVariation = idleIntervalVariation;
+  s.blinkLeft = timeLeft(blinktimer, now);
+  s.idleLeft = timeLeft(idleAnimationTimer, now);
+  s.microLeft = timeLeft(microTimer, now);
+  saveEye(&s.eye[0], eyeLx, eyeLy, eyeLwidthCurrent, eyeLheightCurrent,
+          eyeLborderRadiusCurrent, eyeLwidthNext, eyeLheightNext,
+          eyeLborderRadiusNext, eyeLwidthDefault, eyeLheightDefault,
+          eyeLborderRadiusDefault);
+  saveEye(&s.eye[1], eyeRx, eyeRy, eyeRwidthCurrent, eyeRheightCurrent,
+          eyeRborderRadiusCurrent, eyeRwidthNext, eyeRheightNext,
+          eyeRborderRadiusNext, eyeRwidthDefault, eyeRheightDefault,
+          eyeRborderRadiusDefault);
+  *snapshot = s;
+}
+
+// Take over a saved state, after begin(); the next frame then looks like
+// the last one before saving. Returns false, changing nothing, if the
+// snapshot is from another version or screen size.
+bool RoboEyes_restoreState(const RoboEyesSnapshot *snapshot) {
+  const RoboEyesSnapshot *s = snapshot;
+  if (s->version != ROBOEYES_SNAPSHOT_VERSION ||
+      s->screenWidth != screenWidth || s->screenHeight != screenHeight) {
+    return 0;
+  }
+  traceCommand();
+  unsigned long now = millis();
+  RoboEyes_setMood(s->mood);
+#if CONFIG_ROBOEYES_MOODS
+  eyelidsTiredHeight = s->eyelidsTired;
+  eyelidsAngryHeight = s->eyelidsAngry;
+  eyelidsHappyBottomOffset = s->eyelidsHappy;
+#endif
+  eyeL_open = (s->flags & SNAP_LEFT_OPEN) != 0;
+  eyeR_open = (s->flags & SNAP_RIGHT_OPEN) != 0;
+  autoblinker = (s->flags & SNAP_AUTOBLINK) != 0;
+  idle = (s->flags & SNAP_IDLE) != 0;
+#if CONFIG_ROBOEYES_NATURAL_GAZE
+  naturalGaze = (s->flags & SNAP_NATURAL_GAZE) != 0;
+#endif
+#if CONFIG_ROBOEYES_CURIOUS
+  curious = (s->flags & SNAP_CURIOUS) != 0;
+#endif
+#if CONFIG_ROBOEYES_CYCLOPS
+  cyclops = (s->flags & SNAP_CYCLOPS) != 0;
+#endif
+#if CONFIG_ROBOEYES_SWEAT
+  sweat = (s->flags & SNAP_SWEAT) != 0;
+#endif
+#if CONFIG_ROBOEYES_FLICKER
+  hFlicker = (s->flags & SNAP_HFLICKER) != 0;
+  vFlicker = (s->flags & SNAP_VFLICKER) != 0;
+#endif
+  frameInterval = s->frameInterval;
+  eyeLxNext = s->gazeX;
+  eyeLyNext = s->gazeY;
+  gazeToX = s->fixateX;
+  gazeToY = s->fixateY;
+  saccade = s->saccadeDuration != 0;
+  gazeFromX = s->saccadeFromX;
+  gazeFromY = s->saccadeFromY;
+  saccadeStart = now - s->saccadeElapsed;
+  saccadeDuration = s->saccadeDuration;
+  noisePos = s->noisePos;
+  spaceBetweenCurrent = s->space;
+  spaceBetweenNext = s->spaceNext;
+  spaceBetweenDefault = s->spaceDefault;
+  hFlickerAmplitude = s->hFlickerAmplitude;
+  vFlickerAmplitude = s->vFlickerAmplitude;
+  blinkInterval = s->blinkInterval;
+  blinkIntervalVariation = s->blinkVariation;
+  idleInterval = s->idleInterval;
+  idleIntervalVariation = s->idleVariation;
+  blinktimer = now + s->blinkLeft;
+  idleAnimationTimer = now + s->idleLeft;
+  microTimer = now + s->microLeft;
+
+  const RoboEyesSnapshotEye *l = &s->eye[0];
+  eyeLx = l->x;
+  eyeLy = l->y;
+  eyeLwidthCurrent = l->width;
+  eyeLheightCurrent = l->height;
+  eyeLborderRadiusCurrent = l->radius;
+  eyeLwidthNext = l->widthNext;
+  eyeLheightNext = l->heightNext;
+  eyeLborderRadiusNext = l->radiusNext;
+  eyeLwidthDefault = l->widthDefault;
+  eyeLheightDefault = l->heightDefault;
+  eyeLborderRadiusDefault = l->radiusDefault;
+  const RoboEyesSnapshotEye *r = &s->eye[1];
+  eyeRx = r->x;
+  eyeRy = r->y;
+  eyeRwidthCurrent = r->width;
+  eyeRheightCurrent = r->height;
+  eyeRborderRadiusCurrent = r->radius;
+  eyeRwidthNext = r->widthNext;
+  eyeRheightNext = r->heightNext;
+  eyeRborderRadiusNext = r->radiusNext;
+  eyeRwidthDefault = r->widthDefault;
+  eyeRheightDefault = r->heightDefault;
+  eyeRborderRadiusDefault = r->radiusDefault;
+  return 1;
 }
 
 //*********************************************************************************************
 //  GETTERS METHODS
 //*********************************************************************************************
 
+// Primitive culling counters since start or the last reset
+void RoboEyes_getCullStats(RoboEyesCullStats *stats) { *stats = cullStats; }
+
+void RoboEyes_resetCullStats() {
+  RoboEyesCullStats zero = {0};
+  cullStats = zero;
+}
+
+// Where the left eye is heading, between 0 and the screen constraints
+void RoboEyes_getGaze(int *x, int *y) {
+  *x = eyeLxNext;
+  *y = eyeLyNext;
+}
+
 // Returns the max x position for left eye
 int RoboEyes_getScreenConstraint_X() {
   return screenWidth - eyeLwidthCurrent - spaceBetweenCurrent -
          eyeRwidthCurrent;
 }
 
+// Returns the time budget of one frame in milliseconds
+int RoboEyes_getFrameInterval() { return frameInterval; }
+
+// Returns the mood set last, DEFAULT when moods are compiled out
+uint8_t RoboEyes_getMood() {
+#if CONFIG_ROBOEYES_MOODS
+  return tired ? TIRED : angry ? ANGRY : happy ? HAPPY : DEFAULT;
+#else
+  return DEFAULT;
+#endif
+}
+
+// Returns whether idle mode repositions the eyes
+bool RoboEyes_getIdleMode() { return idle; }
+
 // Returns the max y position for left eye
 int RoboEyes_getScreenConstraint_Y() {
   return screenHeight -
@@ -823,6 +1548,7 @@ int RoboEyes_getScreenConstraint_Y() {
 // BLINKING FOR BOTH EYES AT ONCE
 // Close both eyes
 void RoboEyes_close() {
+  traceCommand();
   eyeLheightNext = 1; // closing left eye
   eyeRheightNext = 1; // closing right eye
   eyeL_open = 0;      // left eye not opened (=closed)
@@ -831,6 +1557,7 @@ void RoboEyes_close() {
 
 // Open both eyes
 void RoboEyes_open() {
+  traceCommand();
   eyeL_open = 1; // left eye opened - if true, drawEyes() will take care of
                  // opening eyes again
   eyeR_open = 1; // right eye opened
@@ -845,6 +1572,7 @@ void RoboEyes_blink() {
 // BLINKING FOR SINGLE EYES, CONTROL EACH EYE SEPARATELY
 // Close eye(s)
 void RoboEyes_close2(bool left, bool right) {
+  traceCommand();
   if (left) {
     eyeLheightNext = 1; // blinking left eye
     eyeL_open = 0;      // left eye not opened (=closed)
@@ -857,6 +1585,7 @@ void RoboEyes_close2(bool left, bool right) {
 
 // Open eye(s)
 void RoboEyes_open2(bool left, bool right) {
+  traceCommand();
   if (left) {
     eyeL_open = 1; // left eye opened - if true, drawEyes() will take care of
                    // opening eyes again
@@ -877,7 +1606,17 @@ void RoboEyes_blink2(bool left, bool right) {
 //*********************************************************************************************
 
 // Play confused animation - one shot animation of eyes shaking left and right
-void RoboEyes_anim_confused() { confused = 1; }
+void RoboEyes_anim_confused() {
+  traceCommand();
+#if CONFIG_ROBOEYES_CONFUSED
+  confused = 1;
+#endif
+}
 
 // Play laugh animation - one shot animation of eyes shaking up and down
-void RoboEyes_anim_laugh() { laugh = 1; }
+void RoboEyes_anim_laugh() {
+  traceCommand();
+#if CONFIG_ROBOEYES_LAUGH
+  laugh = 1;
+#endif
+}
@@ -37,6 +37,11 @@
 #define ON 1
 #define OFF 0
 
+// Constants for modulation modes
+#define ROBOEYES_MOD_OFF 0
+#define ROBOEYES_MOD_HEIGHT 1   // modulation grows eye height
+#define ROBOEYES_MOD_VFLICKER 2 // modulation sets vertical flicker amplitude
+
 // Constants for predefined positions
 #define N 1  // North, top center
 #define NE 2 // North-east, top right
@@ -51,9 +56,59 @@ typedef void (*DrawRoundedRectangleFunc)(int x, int y, int width, int height, in
 typedef void (*ClearDisplayFunc)();
 typedef void (*UpdateDisplayFunc)();
 typedef void (*DrawTriangleFunc)(int x0, int y0, int x1, int y1, int x2, int y2, uint8_t color);
+// Draws an eye body (eye 0 left, 1 right) in place of its rounded rectangle
+typedef void (*DrawEyeFunc)(uint8_t eye, int x, int y, int width, int height, int borderRadius, uint8_t color);
 typedef uint32_t (*MillisFunc)();
 typedef uint32_t (*RandomFunc)(uint32_t limit);
 
+// Stages reported to the trace hook, seq numbers every public command
+#define ROBOEYES_TRACE_COMMAND 0 // a public command was issued
+#define ROBOEYES_TRACE_APPLIED 1 // frame update picked up commands up to seq
+#define ROBOEYES_TRACE_FRAME 2   // frame reflecting commands up to seq drawn
+typedef void (*TraceFunc)(uint8_t stage, uint32_t seq);
+
+// Counters of the culling stage between drawEyes() and the backend
+typedef struct {
+    uint32_t submitted;   // primitives drawEyes() emitted
+    uint32_t culled;      // dropped: empty, off-screen or background only
+    uint32_t clipped;     // shrunk towards the screen before drawing
+    uint32_t pixelsSaved; // culled on-screen area plus area clipped off
+} RoboEyesCullStats;
+
+// Compact copy of the eye state to keep across a reset, e.g. in RTC memory
+// over deep sleep. Only lasting state is kept: one-shot animations end and
+// the sweat drops start over. Timers hold the time left, a running saccade
+// how far it has got.
+#define ROBOEYES_SNAPSHOT_VERSION 2
+typedef struct {
+    int16_t x, y; // current position
+    uint8_t width, height, radius;
+    uint8_t widthNext, heightNext, radiusNext;
+    uint8_t widthDefault, heightDefault, radiusDefault;
+} RoboEyesSnapshotEye;
+
+typedef struct {
+    uint8_t version; // ROBOEYES_SNAPSHOT_VERSION
+    uint8_t mood;
+    uint16_t flags;  // switched on features and open eyes
+    int16_t screenWidth;
+    int16_t screenHeight;
+    uint16_t frameInterval;
+    int16_t gazeX, gazeY;     // where the left eye is heading
+    int16_t fixateX, fixateY; // fixation point
+    int16_t space, spaceNext, spaceDefault;
+    uint8_t eyelidsTired, eyelidsAngry, eyelidsHappy;
+    uint8_t hFlickerAmplitude, vFlickerAmplitude;
+    uint8_t blinkInterval, blinkVariation; // seconds
+    uint8_t idleInterval, idleVariation;
+    uint16_t blinkLeft, idleLeft, microLeft; // ms to the next one
+    int16_t saccadeFromX, saccadeFromY;
+    uint16_t saccadeElapsed; // ms
+    uint8_t saccadeDuration; // ms, 0 when no saccade is running
+    uint8_t noisePos;        // micro-saccade noise sequence
+    RoboEyesSnapshotEye eye[2]; // left, right
+} RoboEyesSnapshot;
+
 // Function declarations
 void RoboEyes_init(DrawRoundedRectangleFunc DrawRoundedRectangle,
     DrawTriangleFunc DrawTriangle,
@@ -62,6 +117,8 @@ void RoboEyes_init(DrawRoundedRectangleFunc DrawRoundedRectangle,
     MillisFunc Millis,
     RandomFunc Random
 );
+void RoboEyes_setTraceHook(TraceFunc trace);
+void RoboEyes_setEyeHook(DrawEyeFunc drawEye);
 void RoboEyes_begin(int width, int height, uint8_t frameRate);
 void RoboEyes_update();
 void RoboEyes_setFramerate(uint8_t fps);
@@ -71,14 +128,18 @@ void RoboEyes_setHeight(uint8_t leftEye, uint8_t rightEye);
 void RoboEyes_setBorderradius(uint8_t leftEye, uint8_t rightEye);
 void RoboEyes_setSpacebetween(int space);
 void RoboEyes_setMood(uint8_t mood);
+uint8_t RoboEyes_getMood();
 void RoboEyes_setPosition(uint8_t position);
 
+void RoboEyes_getGaze(int *x, int *y);
 int RoboEyes_getScreenConstraint_X();
 int RoboEyes_getScreenConstraint_Y();
+int RoboEyes_getFrameInterval();
 void RoboEyes_setAutoblinker2(bool active, int interval, int variation);
 void RoboEyes_setAutoblinker(bool active);
 void RoboEyes_setIdleMode2(bool active, int interval, int variation);
 void RoboEyes_setIdleMode(bool active);
+bool RoboEyes_getIdleMode();
 void RoboEyes_setCuriosity(bool curiousBit);
 void RoboEyes_setCyclops(bool cyclopsBit);
 void RoboEyes_setHFlicker2(bool flickerBit, uint8_t Amplitude);
@@ -86,6 +147,17 @@ void RoboEyes_setHFlicker(bool flickerBit);
 void RoboEyes_setVFlicker2(bool flickerBit, uint8_t Amplitude);
 void RoboEyes_setVFlicker(bool flickerBit);
 void RoboEyes_setSweat(bool sweatBit);
+void RoboEyes_setLowDetail(bool low);
+void RoboEyes_setModulationMode(uint8_t mode, uint8_t depth);
+void RoboEyes_setModulation(uint8_t amount);
+void RoboEyes_setCulling(bool cull);
+void RoboEyes_setCullMargin(uint8_t pixels);
+void RoboEyes_lookAt(int x, int y);
+void RoboEyes_setNaturalGaze(bool natural);
+void RoboEyes_getCullStats(RoboEyesCullStats *stats);
+void RoboEyes_saveState(RoboEyesSnapshot *snapshot);
+bool RoboEyes_restoreState(const RoboEyesSnapshot *snapshot);
+void RoboEyes_resetCullStats();
 void RoboEyes_close();
 void RoboEyes_open();
 void RoboEyes_blink();
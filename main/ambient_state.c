@@ -0,0 +1,84 @@
+#include "ambient_state.h"
+
+#include <string.h>
+
+void ambient_sm_init(ambient_sm_t *sm, const ambient_config_t *cfg) {
+  memset(sm, 0, sizeof(*sm));
+  sm->cfg = *cfg;
+  sm->shown_x2 = -1;
+}
+
+static void send(ambient_cmd_t cmd, void *ctx, uint8_t c) {
+  cmd(ctx, c, NULL, 0);
+}
+
+// Scan the columns around x1..x2
+static void set_band(ambient_sm_t *sm, int x1, int x2, ambient_cmd_t cmd,
+                     void *ctx) {
+  const ambient_config_t *cfg = &sm->cfg;
+  x1 -= cfg->margin;
+  x2 += cfg->margin;
+  sm->x1 = x1 < 0 ? 0 : x1;
+  sm->x2 = x2 >= cfg->panel.width ? cfg->panel.width - 1 : x2;
+  int start = panel_line(&cfg->panel, sm->x1);
+  int end = panel_line(&cfg->panel, sm->x2);
+  if (start > end) {
+    int s = end;
+    end = start;
+    start = s;
+  }
+  uint8_t area[4] = {start >> 8, start & 0xff, end >> 8, end & 0xff};
+  cmd(ctx, ST7789_PTLAR, area, sizeof(area));
+}
+
+void ambient_sm_show(ambient_sm_t *sm, int x1, int x2, ambient_cmd_t cmd,
+                     void *ctx) {
+  if (sm->phase == AMBIENT_ON && x2 >= x1 && (x1 < sm->x1 || x2 > sm->x2)) {
+    // Until its pixels land the panel still shows the last frame: scan
+    // both. Memory under the new lines is current, so they show it right.
+    set_band(sm, x1 < sm->shown_x1 ? x1 : sm->shown_x1,
+             x2 > sm->shown_x2 ? x2 : sm->shown_x2, cmd, ctx);
+    sm->band_moves++;
+  }
+  sm->shown_x1 = x1;
+  sm->shown_x2 = x2;
+}
+
+bool ambient_sm_frame(ambient_sm_t *sm, bool slow, ambient_cmd_t cmd,
+                      void *ctx) {
+  // Nothing on screen has no band to scan
+  bool want = slow && sm->shown_x2 >= sm->shown_x1;
+  switch (sm->phase) {
+  case AMBIENT_OFF:
+    if (!want) {
+      return false;
+    }
+    sm->phase = AMBIENT_PALETTE;
+    return true;
+  case AMBIENT_PALETTE:
+    if (!want) {
+      sm->phase = AMBIENT_OFF;
+      return true;
+    }
+    // This frame is in ambient colours: it survives idle mode
+    set_band(sm, sm->shown_x1, sm->shown_x2, cmd, ctx);
+    send(cmd, ctx, ST7789_PTLON);
+    send(cmd, ctx, ST7789_IDMON);
+    sm->phase = AMBIENT_ON;
+    sm->entries++;
+    return false;
+  case AMBIENT_ON:
+    if (!want) {
+      send(cmd, ctx, ST7789_IDMOFF);
+      send(cmd, ctx, ST7789_NORON);
+      sm->phase = AMBIENT_OFF;
+      return true;
+    }
+    return false;
+  }
+  return false;
+}
+
+bool ambient_sm_palette(const ambient_sm_t *sm) {
+  return sm->phase != AMBIENT_OFF;
+}
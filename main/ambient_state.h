@@ -0,0 +1,71 @@
+#ifndef AMBIENT_STATE_H
+#define AMBIENT_STATE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "panel_geometry.h"
+
+// ST7789 ambient mode. While the eyes are in a slow state the panel only
+// scans the gate lines of a band around them (partial mode) and drops to 8
+// colours (idle mode), which is all a two colour scene needs. Everything is
+// still drawn into the panel's memory, so leaving is just the mode commands.
+//
+// Steps are taken between frames, once the last one is on the panel:
+//   entering: the ambient palette (colours that keep the top bit of a
+//     channel) is drawn first, then PTLAR, PTLON and IDMON
+//   leaving: IDMOFF first, so the ambient colours stay lit, then NORON with
+//     memory already current outside the band, then the normal palette
+// The band follows the eyes ahead of each frame, covering it and the one it
+// replaces. Frames and the commands come in as parameters so the sequence
+// runs the same against a mock panel.
+#define ST7789_PTLON 0x12
+#define ST7789_NORON 0x13
+#define ST7789_PTLAR 0x30
+#define ST7789_IDMOFF 0x38
+#define ST7789_IDMON 0x39
+
+typedef struct {
+  panel_geometry_t panel;
+  uint8_t margin; // columns scanned either side of the eyes
+} ambient_config_t;
+
+#define AMBIENT_DEFAULT_CONFIG()                                               \
+  {                                                                            \
+    .panel = PANEL_GEOMETRY_CARDPUTER(), .margin = 24,                         \
+  }
+
+typedef enum {
+  AMBIENT_OFF,
+  AMBIENT_PALETTE, // ambient colours being drawn, panel in normal mode
+  AMBIENT_ON,      // partial and idle mode
+} ambient_phase_t;
+
+typedef void (*ambient_cmd_t)(void *ctx, uint8_t cmd, const uint8_t *data,
+                              size_t len);
+
+typedef struct {
+  ambient_config_t cfg;
+  ambient_phase_t phase;
+  int x1, x2;             // screen columns scanned while on
+  int shown_x1, shown_x2; // what the last frame covers
+  uint32_t entries;
+  uint32_t band_moves; // PTLAR updates to follow the eyes
+} ambient_sm_t;
+
+void ambient_sm_init(ambient_sm_t *sm, const ambient_config_t *cfg);
+// A frame covering screen columns x1..x2, x2 < x1 for none, is about to go
+// to the panel; while on, the band is moved over it first
+void ambient_sm_show(ambient_sm_t *sm, int x1, int x2, ambient_cmd_t cmd,
+                     void *ctx);
+// Between frames, the last one on the panel: slow is whether the eyes are
+// in a slow state. Sends the panel commands of the next step through cmd;
+// returns true when the palette to draw the next frame in changed, see
+// ambient_sm_palette().
+bool ambient_sm_frame(ambient_sm_t *sm, bool slow, ambient_cmd_t cmd,
+                      void *ctx);
+// Whether frames are drawn in the ambient palette
+bool ambient_sm_palette(const ambient_sm_t *sm);
+
+#endif // AMBIENT_STATE_H
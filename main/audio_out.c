@@ -0,0 +1,261 @@
+#include "audio_out.h"
+#include "mic.h"
+#include "mixer.h"
+
+#include "FluxGarage_RoboEyes.h"
+
+#include <assert.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+
+#include "driver/i2s_std.h"
+
+#include "esp_log.h"
+#include "esp_timer.h"
+
+static const char *TAG = "audio_out";
+
+// Cardputer NS4168 amplifier
+#define SPK_BCLK 41
+#define SPK_WS 43 // shared with the microphone clock
+#define SPK_DOUT 42
+
+#define AUDIO_SAMPLE_RATE 16000
+#define AUDIO_BLOCK_SAMPLES 256 // 16 ms, one envelope value per block
+#define AUDIO_BLOCK_US (AUDIO_BLOCK_SAMPLES * 1000000LL / AUDIO_SAMPLE_RATE)
+#define AUDIO_SOUND_DIR "/sdcard/sounds" // card mounted by clip_player_init()
+
+static i2s_chan_handle_t g_tx;
+static TaskHandle_t g_audio_task;
+// A mutex, not a spinlock: the whole block is mixed while holding it
+static SemaphoreHandle_t g_mixer_lock;
+static mixer_t g_mixer;
+static int16_t *g_owned[MIXER_STREAMS]; // loaded sounds, freed when done
+
+static portMUX_TYPE g_say_lock = portMUX_INITIALIZER_UNLOCKED;
+static char g_say[AUDIO_NAME_MAX + 1]; // sound waiting to load, "" = none
+
+static audio_out_stats_t g_stats;
+static uint64_t g_mix_sum_us;
+
+static void audio_tx_start(void) {
+  mic_stop();
+
+  // Two DMA buffers: one block plays while the next is mixed
+  i2s_chan_config_t chan_cfg =
+      I2S_CHANNEL_DEFAULT_CONFIG(I2S_NUM_1, I2S_ROLE_MASTER);
+  chan_cfg.dma_desc_num = 2;
+  chan_cfg.dma_frame_num = AUDIO_BLOCK_SAMPLES;
+  chan_cfg.auto_clear = true; // underruns play silence, not stale blocks
+  ESP_ERROR_CHECK(i2s_new_channel(&chan_cfg, &g_tx, NULL));
+
+  i2s_std_config_t std_cfg = {
+      .clk_cfg = I2S_STD_CLK_DEFAULT_CONFIG(AUDIO_SAMPLE_RATE),
+      .slot_cfg = I2S_STD_PHILIPS_SLOT_DEFAULT_CONFIG(I2S_DATA_BIT_WIDTH_16BIT,
+                                                      I2S_SLOT_MODE_MONO),
+      .gpio_cfg =
+          {
+              .mclk = I2S_GPIO_UNUSED,
+              .bclk = SPK_BCLK,
+              .ws = SPK_WS,
+              .dout = SPK_DOUT,
+              .din = I2S_GPIO_UNUSED,
+          },
+  };
+  ESP_ERROR_CHECK(i2s_channel_init_std_mode(g_tx, &std_cfg));
+  ESP_ERROR_CHECK(i2s_channel_enable(g_tx));
+}
+
+static void audio_tx_stop(void) {
+  ESP_ERROR_CHECK(i2s_channel_disable(g_tx));
+  ESP_ERROR_CHECK(i2s_del_channel(g_tx));
+  g_tx = NULL;
+  mic_start();
+}
+
+static uint16_t le16(const uint8_t *p) { return p[0] | p[1] << 8; }
+
+static uint32_t le32(const uint8_t *p) {
+  return p[0] | p[1] << 8 | p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+// Read a sound's samples into the heap; NULL if missing or the wrong format
+static int16_t *audio_load(const char *name, uint32_t *samples) {
+  char path[sizeof(AUDIO_SOUND_DIR) + 1 + AUDIO_NAME_MAX + 4];
+  snprintf(path, sizeof(path), AUDIO_SOUND_DIR "/%s.wav", name);
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    ESP_LOGW(TAG, "cannot open %s", path);
+    return NULL;
+  }
+  int16_t *pcm = NULL;
+  uint8_t head[12];
+  bool fmt_ok = false;
+  if (read(fd, head, 12) != 12 || memcmp(head, "RIFF", 4) ||
+      memcmp(head + 8, "WAVE", 4)) {
+    goto done;
+  }
+  // Chunks up to data; fmt must come first
+  while (read(fd, head, 8) == 8) {
+    uint32_t size = le32(head + 4);
+    if (!memcmp(head, "fmt ", 4) && size >= 16) {
+      uint8_t fmt[16];
+      if (read(fd, fmt, 16) != 16) {
+        goto done;
+      }
+      fmt_ok = le16(fmt) == 1 && le16(fmt + 2) == 1 &&
+               le32(fmt + 4) == AUDIO_SAMPLE_RATE && le16(fmt + 14) == 16;
+      lseek(fd, size - 16 + (size & 1), SEEK_CUR);
+    } else if (!memcmp(head, "data", 4)) {
+      uint32_t max = AUDIO_SOUND_MAX_MS * (AUDIO_SAMPLE_RATE / 1000);
+      *samples = size / 2 < max ? size / 2 : max;
+      if (!fmt_ok || !*samples) {
+        goto done;
+      }
+      pcm = malloc(*samples * sizeof(*pcm));
+      if (pcm && read(fd, pcm, *samples * sizeof(*pcm)) !=
+                     (ssize_t)(*samples * sizeof(*pcm))) {
+        free(pcm);
+        pcm = NULL;
+      }
+      goto done;
+    } else {
+      lseek(fd, size + (size & 1), SEEK_CUR);
+    }
+  }
+done:
+  close(fd);
+  if (!pcm) {
+    ESP_LOGW(TAG, "%s is not 16 kHz mono 16-bit PCM", path);
+  }
+  return pcm;
+}
+
+// Load the sound audio_out_say() asked for, if any, into a stream
+static void audio_take_say(void) {
+  char name[AUDIO_NAME_MAX + 1];
+  portENTER_CRITICAL(&g_say_lock);
+  memcpy(name, g_say, sizeof(name));
+  g_say[0] = '\0';
+  portEXIT_CRITICAL(&g_say_lock);
+  if (!name[0]) {
+    return;
+  }
+  uint32_t samples;
+  int16_t *pcm = audio_load(name, &samples);
+  if (!pcm) {
+    return;
+  }
+  xSemaphoreTake(g_mixer_lock, portMAX_DELAY);
+  int slot = mixer_add(&g_mixer, pcm, samples, MIXER_GAIN_UNITY);
+  if (slot >= 0) {
+    g_owned[slot] = pcm;
+  }
+  xSemaphoreGive(g_mixer_lock);
+  if (slot < 0) {
+    ESP_LOGW(TAG, "all %d streams busy", MIXER_STREAMS);
+    free(pcm);
+  }
+}
+
+// Free loaded sounds whose streams ended; called with the mixer locked
+static void audio_free_done(void) {
+  for (int i = 0; i < MIXER_STREAMS; i++) {
+    if (g_owned[i] && !g_mixer.streams[i].active) {
+      free(g_owned[i]);
+      g_owned[i] = NULL;
+    }
+  }
+}
+
+static void audio_task(void *arg) {
+  static int16_t block[AUDIO_BLOCK_SAMPLES];
+
+  while (1) {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    audio_take_say();
+    if (!mixer_active(&g_mixer)) {
+      continue;
+    }
+    audio_tx_start();
+
+    bool active = true;
+    while (active || g_mixer.envelope) {
+      // A sound asked for meanwhile; the card read may cost a block of
+      // silence, the mixer keeps its place
+      if (ulTaskNotifyTake(pdTRUE, 0)) {
+        audio_take_say();
+      }
+      int64_t start = esp_timer_get_time();
+      xSemaphoreTake(g_mixer_lock, portMAX_DELAY);
+      mixer_render(&g_mixer, block, AUDIO_BLOCK_SAMPLES);
+      audio_free_done();
+      active = mixer_active(&g_mixer);
+      uint8_t envelope = g_mixer.envelope;
+      xSemaphoreGive(g_mixer_lock);
+      uint32_t spent = esp_timer_get_time() - start;
+
+      // Blocks until the other DMA buffer is free, i.e. about one block
+      // before this one is heard; close enough for the eyes
+      size_t written;
+      i2s_channel_write(g_tx, block, sizeof(block), &written, portMAX_DELAY);
+      RoboEyes_setModulation(envelope);
+
+      g_stats.blocks++;
+      g_stats.envelope = envelope;
+      g_mix_sum_us += spent;
+      if (spent > g_stats.mix_max_us) {
+        g_stats.mix_max_us = spent;
+      }
+    }
+
+    RoboEyes_setModulation(0);
+    audio_tx_stop();
+  }
+}
+
+void audio_out_init(void) {
+  g_mixer_lock = xSemaphoreCreateMutex();
+  assert(g_mixer_lock);
+  mixer_init(&g_mixer);
+  RoboEyes_setModulationMode(ROBOEYES_MOD_HEIGHT, 12);
+  xTaskCreatePinnedToCore(audio_task, "audio_out", 3072, NULL, 6,
+                          &g_audio_task, 1);
+}
+
+esp_err_t audio_out_play(const int16_t *pcm, uint32_t samples, uint16_t gain) {
+  xSemaphoreTake(g_mixer_lock, portMAX_DELAY);
+  int slot = mixer_add(&g_mixer, pcm, samples, gain);
+  xSemaphoreGive(g_mixer_lock);
+  if (slot < 0) {
+    ESP_LOGW(TAG, "all %d streams busy", MIXER_STREAMS);
+    return ESP_ERR_NO_MEM;
+  }
+  xTaskNotifyGive(g_audio_task);
+  return ESP_OK;
+}
+
+esp_err_t audio_out_say(const char *name) {
+  size_t n = strlen(name);
+  if (!n || n > AUDIO_NAME_MAX) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  portENTER_CRITICAL(&g_say_lock);
+  memcpy(g_say, name, n + 1);
+  portEXIT_CRITICAL(&g_say_lock);
+  xTaskNotifyGive(g_audio_task);
+  return ESP_OK;
+}
+
+void audio_out_get_stats(audio_out_stats_t *stats) {
+  *stats = g_stats;
+  uint64_t audio_us = (uint64_t)g_stats.blocks * AUDIO_BLOCK_US;
+  stats->cpu_permille = audio_us ? g_mix_sum_us * 1000 / audio_us : 0;
+}
@@ -0,0 +1,29 @@
+#ifndef AUDIO_OUT_H
+#define AUDIO_OUT_H
+
+#include <stdint.h>
+
+#include "esp_err.h"
+
+typedef struct {
+  uint32_t blocks;       // mixed and written
+  uint32_t mix_max_us;   // worst single block
+  uint32_t cpu_permille; // mixing time per unit of audio time
+  uint8_t envelope;      // last published, 0..255
+} audio_out_stats_t;
+
+// Start the playback task. The I2S channel is only held while something is
+// playing, because the speaker shares its clock pin with the microphone.
+void audio_out_init(void);
+// Play 16 kHz mono PCM at gain/256; pcm must stay valid until played.
+// Eyes pulse with the output while it plays.
+esp_err_t audio_out_play(const int16_t *pcm, uint32_t samples, uint16_t gain);
+// Play /sdcard/sounds/<name>.wav, 16 kHz mono 16-bit PCM of up to
+// AUDIO_SOUND_MAX_MS. The playback task loads it and frees it when done;
+// safe from any task, a name still waiting to load is replaced.
+#define AUDIO_NAME_MAX 16
+#define AUDIO_SOUND_MAX_MS 2000
+esp_err_t audio_out_say(const char *name);
+void audio_out_get_stats(audio_out_stats_t *stats);
+
+#endif // AUDIO_OUT_H
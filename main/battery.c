@@ -0,0 +1,150 @@
+#include "battery.h"
+#include "power.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "esp_adc/adc_cali.h"
+#include "esp_adc/adc_cali_scheme.h"
+#include "esp_adc/adc_continuous.h"
+#include "esp_err.h"
+#include "esp_idf_version.h"
+#include "esp_log.h"
+
+static const char *TAG = "battery";
+
+// Cardputer: the cell through a 1:2 divider on GPIO10, ADC1 channel 9
+#define BATTERY_ADC_UNIT ADC_UNIT_1
+#define BATTERY_ADC_CHANNEL ADC_CHANNEL_9
+#define BATTERY_DIVIDER 2
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 2, 0)
+#define BATTERY_ATTEN ADC_ATTEN_DB_12
+#else
+#define BATTERY_ATTEN ADC_ATTEN_DB_11
+#endif
+
+#define BATTERY_PERIOD_MS 10000 // between bursts
+#define BATTERY_SAMPLE_HZ 20000
+#define BATTERY_BURST_SAMPLES 256 // 12.8 ms of sampling per burst
+#define BATTERY_BURST_BYTES                                                    \
+  (BATTERY_BURST_SAMPLES * SOC_ADC_DIGI_RESULT_BYTES)
+#define BATTERY_BURST_TIMEOUT_MS 100
+
+static adc_continuous_handle_t g_adc;
+static adc_cali_handle_t g_cali;
+static TaskHandle_t g_task;
+static battery_sm_t g_sm;
+static battery_stats_t g_stats;
+static uint8_t g_burst[BATTERY_BURST_BYTES];
+
+// DMA filled a burst: one wake for all of its samples
+static bool battery_on_conv_done(adc_continuous_handle_t handle,
+                                 const adc_continuous_evt_data_t *edata,
+                                 void *user_data) {
+  BaseType_t woken = pdFALSE;
+  vTaskNotifyGiveFromISR(g_task, &woken);
+  return woken == pdTRUE;
+}
+
+// Mean raw reading of a burst, or -1 if it holds none of our channel
+static int battery_burst_mean(uint32_t len) {
+  uint32_t sum = 0;
+  uint32_t count = 0;
+  for (uint32_t i = 0; i + SOC_ADC_DIGI_RESULT_BYTES <= len;
+       i += SOC_ADC_DIGI_RESULT_BYTES) {
+    const adc_digi_output_data_t *p = (const void *)&g_burst[i];
+    if (p->type2.unit == BATTERY_ADC_UNIT &&
+        p->type2.channel == BATTERY_ADC_CHANNEL) {
+      sum += p->type2.data;
+      count++;
+    }
+  }
+  return count ? (int)(sum / count) : -1;
+}
+
+// Run the ADC for one burst; it holds a power management lock while it
+// runs, so it is stopped in between
+static int battery_burst(void) {
+  // Drop what the DMA stored after the last burst was read
+  uint32_t len = 0;
+  while (adc_continuous_read(g_adc, g_burst, sizeof(g_burst), &len, 0) ==
+         ESP_OK) {
+  }
+  ulTaskNotifyTake(pdTRUE, 0);
+  ESP_ERROR_CHECK(adc_continuous_start(g_adc));
+  bool done = ulTaskNotifyTake(pdTRUE,
+                               pdMS_TO_TICKS(BATTERY_BURST_TIMEOUT_MS)) != 0;
+  esp_err_t err = done ? adc_continuous_read(g_adc, g_burst, sizeof(g_burst),
+                                             &len, 0)
+                       : ESP_ERR_TIMEOUT;
+  ESP_ERROR_CHECK(adc_continuous_stop(g_adc));
+  return err == ESP_OK ? battery_burst_mean(len) : -1;
+}
+
+static void battery_task(void *arg) {
+  static const char *names[] = {"ok", "low", "critical"};
+  while (1) {
+    int raw = battery_burst();
+    int mv = 0;
+    if (raw < 0 || adc_cali_raw_to_voltage(g_cali, raw, &mv) != ESP_OK) {
+      g_stats.errors++;
+    } else {
+      // Debug logs of these make traces for test/host/test_battery_state
+      ESP_LOGD(TAG, "reading %d mV", mv * BATTERY_DIVIDER);
+      bool changed = battery_sm_reading(&g_sm, mv * BATTERY_DIVIDER);
+      if (g_sm.present != g_stats.present) {
+        ESP_LOGI(TAG, "%s", g_sm.present ? "battery in" : "no battery");
+      }
+      g_stats.present = g_sm.present;
+      g_stats.level = g_sm.level;
+      g_stats.mv = battery_sm_mv(&g_sm);
+      g_stats.percent = battery_sm_percent(&g_sm);
+      g_stats.readings = g_sm.readings;
+      if (changed) {
+        ESP_LOGI(TAG, "%s, %u mV, %u%%", names[g_sm.level], g_stats.mv,
+                 g_stats.percent);
+        power_set_battery(g_sm.level);
+      }
+    }
+    vTaskDelay(pdMS_TO_TICKS(BATTERY_PERIOD_MS));
+  }
+}
+
+void battery_init(void) {
+  battery_config_t cfg = BATTERY_DEFAULT_CONFIG();
+  battery_sm_init(&g_sm, &cfg);
+
+  adc_continuous_handle_cfg_t handle_cfg = {
+      .max_store_buf_size = BATTERY_BURST_BYTES * 2,
+      .conv_frame_size = BATTERY_BURST_BYTES,
+  };
+  ESP_ERROR_CHECK(adc_continuous_new_handle(&handle_cfg, &g_adc));
+  adc_digi_pattern_config_t pattern = {
+      .atten = BATTERY_ATTEN,
+      .channel = BATTERY_ADC_CHANNEL,
+      .unit = BATTERY_ADC_UNIT,
+      .bit_width = SOC_ADC_DIGI_MAX_BITWIDTH,
+  };
+  adc_continuous_config_t adc_cfg = {
+      .pattern_num = 1,
+      .adc_pattern = &pattern,
+      .sample_freq_hz = BATTERY_SAMPLE_HZ,
+      .conv_mode = ADC_CONV_SINGLE_UNIT_1,
+      .format = ADC_DIGI_OUTPUT_FORMAT_TYPE2,
+  };
+  ESP_ERROR_CHECK(adc_continuous_config(g_adc, &adc_cfg));
+  adc_continuous_evt_cbs_t cbs = {.on_conv_done = battery_on_conv_done};
+  ESP_ERROR_CHECK(adc_continuous_register_event_callbacks(g_adc, &cbs, NULL));
+
+  adc_cali_curve_fitting_config_t cali = {
+      .unit_id = BATTERY_ADC_UNIT,
+      .chan = BATTERY_ADC_CHANNEL,
+      .atten = BATTERY_ATTEN,
+      .bitwidth = SOC_ADC_DIGI_MAX_BITWIDTH,
+  };
+  ESP_ERROR_CHECK(adc_cali_create_scheme_curve_fitting(&cali, &g_cali));
+
+  xTaskCreatePinnedToCore(battery_task, "battery", 3072, NULL, 2, &g_task, 1);
+}
+
+void battery_get_stats(battery_stats_t *stats) { *stats = g_stats; }
@@ -0,0 +1,24 @@
+#ifndef BATTERY_H
+#define BATTERY_H
+
+#include <stdint.h>
+
+#include "battery_state.h"
+
+typedef struct {
+  battery_level_t level;
+  bool present;      // a cell on the divider, not just USB power
+  uint16_t mv;       // filtered cell voltage
+  uint8_t percent;   // estimated state of charge
+  uint32_t readings; // bursts averaged
+  uint32_t errors;   // bursts lost to ADC overruns or timeouts
+} battery_stats_t;
+
+// Measure the cell on the Cardputer's divider with the continuous ADC: a
+// short DMA burst every BATTERY_PERIOD_MS, so the CPU is woken once per
+// burst rather than per sample and light sleep is not held off between
+// them. Levels go to the power manager.
+void battery_init(void);
+void battery_get_stats(battery_stats_t *stats);
+
+#endif // BATTERY_H
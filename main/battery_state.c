@@ -0,0 +1,120 @@
+#include "battery_state.h"
+
+#include <stddef.h>
+
+// Resting voltage against state of charge for a 1S LiPo
+static const struct {
+  uint16_t mv;
+  uint8_t pct;
+} soc_curve[] = {
+    {3300, 0},  {3500, 3},  {3600, 8},  {3700, 20}, {3750, 33},
+    {3800, 45}, {3900, 62}, {4000, 78}, {4100, 90}, {4200, 100},
+};
+#define SOC_POINTS (sizeof(soc_curve) / sizeof(soc_curve[0]))
+
+void battery_sm_init(battery_sm_t *sm, const battery_config_t *cfg) {
+  sm->cfg = *cfg;
+  sm->filtered = 0;
+  sm->level = BATTERY_OK;
+  sm->present = false;
+  sm->pending = 0;
+  sm->pending_level = BATTERY_OK;
+  sm->readings = 0;
+}
+
+static battery_level_t level_for(const battery_sm_t *sm, uint16_t mv) {
+  const battery_config_t *c = &sm->cfg;
+  // Going down needs the threshold, coming back up the threshold plus
+  // recover_mv
+  uint16_t critical = c->critical_mv;
+  uint16_t low = c->low_mv;
+  if (sm->level >= BATTERY_CRITICAL) {
+    critical += c->recover_mv;
+  }
+  if (sm->level >= BATTERY_LOW) {
+    low += c->recover_mv;
+  }
+  if (mv < critical) {
+    return BATTERY_CRITICAL;
+  }
+  return mv < low ? BATTERY_LOW : BATTERY_OK;
+}
+
+// The level the reading and the filtered voltage agree on: the one of the
+// two closer to the current level, or the current level if they disagree
+// on the direction
+static battery_level_t level_agreed(const battery_sm_t *sm, uint16_t mv) {
+  battery_level_t raw = level_for(sm, mv);
+  battery_level_t filtered = level_for(sm, battery_sm_mv(sm));
+  if (raw > sm->level && filtered > sm->level) {
+    return raw < filtered ? raw : filtered;
+  }
+  if (raw < sm->level && filtered < sm->level) {
+    return raw > filtered ? raw : filtered;
+  }
+  return sm->level;
+}
+
+static bool battery_sm_set(battery_sm_t *sm, battery_level_t level) {
+  sm->pending = 0;
+  if (level == sm->level) {
+    return false;
+  }
+  sm->level = level;
+  return true;
+}
+
+bool battery_sm_reading(battery_sm_t *sm, uint16_t mv) {
+  sm->readings++;
+  if (mv < sm->cfg.absent_mv) {
+    // Nothing to protect; a cell put in later primes the filter again
+    sm->present = false;
+    sm->filtered = 0;
+    return battery_sm_set(sm, BATTERY_OK);
+  }
+  int32_t x = (int32_t)mv << 4;
+  if (!sm->present) {
+    sm->present = true;
+    sm->filtered = x;
+  } else {
+    sm->filtered += (x - sm->filtered) >> sm->cfg.shift;
+  }
+
+  // A run of readings all past the current level the same way goes as far
+  // as the least of them
+  battery_level_t level = level_agreed(sm, mv);
+  bool down = level > sm->level;
+  if (level == sm->level) {
+    sm->pending = 0;
+    return false;
+  }
+  if (!sm->pending || down != (sm->pending_level > sm->level)) {
+    sm->pending_level = level;
+    sm->pending = 0;
+  } else if (down ? level < sm->pending_level : level > sm->pending_level) {
+    sm->pending_level = level;
+  }
+  if (++sm->pending < sm->cfg.confirm) {
+    return false;
+  }
+  return battery_sm_set(sm, sm->pending_level);
+}
+
+uint16_t battery_sm_mv(const battery_sm_t *sm) {
+  return (sm->filtered + 8) >> 4;
+}
+
+uint8_t battery_sm_percent(const battery_sm_t *sm) {
+  uint16_t mv = battery_sm_mv(sm);
+  if (mv <= soc_curve[0].mv) {
+    return 0;
+  }
+  for (size_t i = 1; i < SOC_POINTS; i++) {
+    if (mv < soc_curve[i].mv) {
+      int span = soc_curve[i].mv - soc_curve[i - 1].mv;
+      int rise = soc_curve[i].pct - soc_curve[i - 1].pct;
+      return soc_curve[i - 1].pct + (mv - soc_curve[i - 1].mv) * rise / span;
+    }
+  }
+  return 100;
+}
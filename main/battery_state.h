@@ -0,0 +1,55 @@
+#ifndef BATTERY_STATE_H
+#define BATTERY_STATE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Battery level from averaged voltage readings. Readings go through a
+// fixed point IIR low-pass, so load dips (backlight, speaker) and ADC noise
+// do not trip the thresholds; leaving a level needs recover_mv on top, so a
+// battery resting back up after load does not flap. A level changes only
+// after confirm readings in a row, each with the reading itself and the
+// filtered voltage both past the threshold, so neither a stray first
+// reading nor a single deep dip can send the eyes to deep sleep. Readings
+// under absent_mv mean no cell on the divider (running from USB). Readings
+// come in as parameters so it runs the same against recorded traces.
+typedef enum {
+  BATTERY_OK,
+  BATTERY_LOW,      // TIRED eyes, dimmed backlight and a lower frame rate
+  BATTERY_CRITICAL, // deep sleep before the cell is run flat
+} battery_level_t;
+
+typedef struct {
+  uint16_t low_mv;
+  uint16_t critical_mv;
+  uint16_t recover_mv; // hysteresis above a threshold to leave its level
+  uint16_t absent_mv;  // below: no battery, the level goes back to OK
+  uint8_t shift;       // filter: each reading moves it 1 / 2^shift of the way
+  uint8_t confirm;     // readings in a row that change the level
+} battery_config_t;
+
+#define BATTERY_DEFAULT_CONFIG()                                               \
+  {                                                                            \
+    .low_mv = 3550, .critical_mv = 3350, .recover_mv = 100,                    \
+    .absent_mv = 2500, .shift = 2, .confirm = 3,                               \
+  }
+
+typedef struct {
+  battery_config_t cfg;
+  int32_t filtered; // mV << 4, 0 until the first reading
+  battery_level_t level;
+  bool present;    // the last reading found a cell
+  uint8_t pending; // readings in a row for pending_level
+  battery_level_t pending_level;
+  uint32_t readings;
+} battery_sm_t;
+
+void battery_sm_init(battery_sm_t *sm, const battery_config_t *cfg);
+// A reading in mV; returns true if the level changed. The first reading of
+// a cell primes the filter.
+bool battery_sm_reading(battery_sm_t *sm, uint16_t mv);
+uint16_t battery_sm_mv(const battery_sm_t *sm);
+// State of charge of a 1S LiPo at rest, 0..100, from the filtered voltage
+uint8_t battery_sm_percent(const battery_sm_t *sm);
+
+#endif // BATTERY_STATE_H
@@ -0,0 +1,199 @@
+#include "behaviour.h"
+#include "eye_actions.h"
+
+#include <string.h>
+
+#include "FluxGarage_RoboEyes.h"
+
+static const uint8_t op_sizes[] = {
+    [BEHAVIOUR_OP_END] = 1,  [BEHAVIOUR_OP_WAIT] = 3,
+    [BEHAVIOUR_OP_MOOD] = 2, [BEHAVIOUR_OP_CLIP] = 2,
+    [BEHAVIOUR_OP_LOOK] = 3, [BEHAVIOUR_OP_RANDOM] = 4,
+    [BEHAVIOUR_OP_LOOP] = 4, [BEHAVIOUR_OP_ACTION] = 3,
+};
+
+const uint8_t behaviour_default_script[] = {
+    BS_HEADER(34),
+    BS_MOOD(DEFAULT),
+    BS_WAIT(5000),
+    BS_CLIP(BEHAVIOUR_CLIP_CONFUSED),
+    BS_WAIT(5000),
+    BS_CLIP(BEHAVIOUR_CLIP_LAUGH),
+    BS_WAIT(5000),
+    BS_MOOD(TIRED),
+    BS_WAIT(5000),
+    BS_MOOD(ANGRY),
+    BS_WAIT(5000),
+    BS_MOOD(HAPPY),
+    BS_WAIT(5000),
+    BS_LOOP(0, -34),
+};
+const size_t behaviour_default_script_size = sizeof(behaviour_default_script);
+
+static uint16_t rd16(const uint8_t *p) { return p[0] | (p[1] << 8); }
+
+bool behaviour_validate(const uint8_t *script, size_t len) {
+  if (len < BEHAVIOUR_HEADER_SIZE || len > BEHAVIOUR_MAX_SIZE ||
+      script[0] != BEHAVIOUR_MAGIC0 || script[1] != BEHAVIOUR_MAGIC1 ||
+      script[2] != BEHAVIOUR_VERSION ||
+      rd16(script + 4) != len - BEHAVIOUR_HEADER_SIZE) {
+    return false;
+  }
+  const uint8_t *code = script + BEHAVIOUR_HEADER_SIZE;
+  size_t code_len = len - BEHAVIOUR_HEADER_SIZE;
+
+  // Mark instruction starts so jumps can be checked against them
+  uint8_t starts[BEHAVIOUR_MAX_SIZE / 8] = {0};
+  for (size_t pc = 0; pc < code_len;) {
+    uint8_t op = code[pc];
+    if (op >= sizeof(op_sizes) || pc + op_sizes[op] > code_len) {
+      return false;
+    }
+    starts[pc / 8] |= 1 << (pc % 8);
+    pc += op_sizes[op];
+  }
+  for (size_t pc = 0; pc < code_len; pc += op_sizes[code[pc]]) {
+    uint8_t op = code[pc];
+    if (op != BEHAVIOUR_OP_RANDOM && op != BEHAVIOUR_OP_LOOP) {
+      continue;
+    }
+    long target = (long)pc + op_sizes[op] + (int16_t)rd16(code + pc + 2);
+    if (target < 0 || target >= (long)code_len ||
+        !(starts[target / 8] & (1 << (target % 8)))) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void behaviour_start(behaviour_vm_t *vm, const uint8_t *script,
+                     uint32_t (*random)(uint32_t limit)) {
+  memset(vm, 0, sizeof(*vm));
+  vm->code = script + BEHAVIOUR_HEADER_SIZE;
+  vm->len = rd16(script + 4);
+  vm->random = random;
+}
+
+// Maps the 0..255 gaze operands onto the compass positions RoboEyes knows
+static uint8_t look_position(uint8_t x, uint8_t y) {
+  static const uint8_t grid[3][3] = {
+      {NW, N, NE},
+      {W, 0, E},
+      {SW, S, SE},
+  };
+  return grid[y * 3 / 256][x * 3 / 256];
+}
+
+static void play_clip(uint8_t clip) {
+  switch (clip) {
+  case BEHAVIOUR_CLIP_BLINK:
+    RoboEyes_blink();
+    break;
+  case BEHAVIOUR_CLIP_CONFUSED:
+    RoboEyes_anim_confused();
+    break;
+  case BEHAVIOUR_CLIP_LAUGH:
+    RoboEyes_anim_laugh();
+    break;
+  default:
+    break;
+  }
+}
+
+// LOOP at pc: returns true if the loop body should run again
+static bool loop_again(behaviour_vm_t *vm, uint16_t pc, uint8_t count) {
+  if (count == 0) {
+    return true;
+  }
+  int i = vm->loop_depth - 1;
+  while (i >= 0 && vm->loops[i].pc != pc) {
+    i--;
+  }
+  if (i < 0) {
+    if (vm->loop_depth == BEHAVIOUR_LOOP_DEPTH) {
+      return false; // nested too deep, run the body once
+    }
+    i = vm->loop_depth;
+    vm->loops[i].pc = pc;
+    vm->loops[i].remaining = count;
+  }
+  vm->loop_depth = i + 1; // drop frames of loops jumped out of
+  if (--vm->loops[i].remaining == 0) {
+    vm->loop_depth = i;
+    return false;
+  }
+  return true;
+}
+
+int32_t behaviour_run(behaviour_vm_t *vm) {
+  for (int budget = BEHAVIOUR_STEP_BUDGET; budget > 0; budget--) {
+    if (!vm->code || vm->pc >= vm->len) {
+      return BEHAVIOUR_DONE;
+    }
+    const uint8_t *ins = vm->code + vm->pc;
+    uint16_t pc = vm->pc;
+    vm->pc += op_sizes[ins[0]];
+    vm->instructions++;
+
+    switch (ins[0]) {
+    case BEHAVIOUR_OP_WAIT:
+      return rd16(ins + 1);
+    case BEHAVIOUR_OP_MOOD:
+      RoboEyes_setMood(ins[1]);
+      break;
+    case BEHAVIOUR_OP_CLIP:
+      play_clip(ins[1]);
+      break;
+    case BEHAVIOUR_OP_LOOK:
+      RoboEyes_setPosition(look_position(ins[1], ins[2]));
+      break;
+    case BEHAVIOUR_OP_RANDOM:
+      if (vm->random && vm->random(256) < ins[1]) {
+        vm->pc += (int16_t)rd16(ins + 2);
+      }
+      break;
+    case BEHAVIOUR_OP_LOOP:
+      if (loop_again(vm, pc, ins[1])) {
+        vm->pc += (int16_t)rd16(ins + 2);
+      }
+      break;
+    case BEHAVIOUR_OP_ACTION: {
+      eye_action_t action = {.type = ins[1], .arg = ins[2]};
+      eye_action_apply(&action);
+      break;
+    }
+    default: // BEHAVIOUR_OP_END
+      vm->pc = vm->len;
+      return BEHAVIOUR_DONE;
+    }
+  }
+  // No wait within the budget: yield for a tick rather than spin
+  return 0;
+}
+
+static void step_cb(void *arg) {
+  behaviour_player_t *player = arg;
+  int32_t wait = behaviour_run(&player->vm);
+  player->runs++;
+  if (wait != BEHAVIOUR_DONE) {
+    tw_schedule(&player->wheel, &player->step, player->now_ms + wait,
+                step_cb, player);
+  }
+}
+
+void behaviour_player_init(behaviour_player_t *player, uint32_t now_ms) {
+  memset(player, 0, sizeof(*player));
+  player->now_ms = now_ms;
+  tw_init(&player->wheel, now_ms);
+}
+
+void behaviour_play(behaviour_player_t *player, const uint8_t *script,
+                    uint32_t (*random)(uint32_t limit)) {
+  behaviour_start(&player->vm, script, random);
+  tw_schedule(&player->wheel, &player->step, player->now_ms, step_cb, player);
+}
+
+void behaviour_tick(behaviour_player_t *player, uint32_t now_ms) {
+  player->now_ms = now_ms;
+  tw_advance(&player->wheel, now_ms);
+}
@@ -0,0 +1,100 @@
+#ifndef BEHAVIOUR_H
+#define BEHAVIOUR_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "timer_wheel.h"
+
+// Behaviour script bytecode. A script is a 6 byte header followed by code:
+//   'R' 'B' version flags len_lo len_hi
+// Multi-byte operands are little endian; jump offsets are signed and
+// relative to the end of the instruction.
+#define BEHAVIOUR_MAGIC0 'R'
+#define BEHAVIOUR_MAGIC1 'B'
+#define BEHAVIOUR_VERSION 1
+#define BEHAVIOUR_HEADER_SIZE 6
+#define BEHAVIOUR_MAX_SIZE 1024
+
+enum {
+  BEHAVIOUR_OP_END = 0x00,    // stop the script
+  BEHAVIOUR_OP_WAIT = 0x01,   // u16 ms
+  BEHAVIOUR_OP_MOOD = 0x02,   // u8 mood
+  BEHAVIOUR_OP_CLIP = 0x03,   // u8 clip id, see BEHAVIOUR_CLIP_*
+  BEHAVIOUR_OP_LOOK = 0x04,   // u8 x, u8 y, 0..255 across the screen
+  BEHAVIOUR_OP_RANDOM = 0x05, // u8 chance/256, i16 offset: branch if taken
+  BEHAVIOUR_OP_LOOP = 0x06,   // u8 count (0 = forever), i16 offset back
+  BEHAVIOUR_OP_ACTION = 0x07, // u8 eye_action_type_t, u8 arg
+};
+
+// Clips available to BEHAVIOUR_OP_CLIP
+enum {
+  BEHAVIOUR_CLIP_BLINK = 0,
+  BEHAVIOUR_CLIP_CONFUSED = 1,
+  BEHAVIOUR_CLIP_LAUGH = 2,
+};
+
+// Helpers to write scripts as C arrays
+#define BS_U16(v) ((v) & 0xff), (((v) >> 8) & 0xff)
+#define BS_HEADER(len)                                                         \
+  BEHAVIOUR_MAGIC0, BEHAVIOUR_MAGIC1, BEHAVIOUR_VERSION, 0, BS_U16(len)
+#define BS_END BEHAVIOUR_OP_END
+#define BS_WAIT(ms) BEHAVIOUR_OP_WAIT, BS_U16(ms)
+#define BS_MOOD(m) BEHAVIOUR_OP_MOOD, (m)
+#define BS_CLIP(c) BEHAVIOUR_OP_CLIP, (c)
+#define BS_LOOK(x, y) BEHAVIOUR_OP_LOOK, (x), (y)
+#define BS_RANDOM(chance, off) BEHAVIOUR_OP_RANDOM, (chance), BS_U16(off)
+#define BS_LOOP(count, off) BEHAVIOUR_OP_LOOP, (count), BS_U16(off)
+#define BS_ACTION(type, arg) BEHAVIOUR_OP_ACTION, (type), (arg)
+
+#define BEHAVIOUR_LOOP_DEPTH 4
+#define BEHAVIOUR_STEP_BUDGET 64 // instructions per run without a wait
+#define BEHAVIOUR_DONE (-1)
+
+typedef struct {
+  uint16_t pc; // of the LOOP instruction
+  uint8_t remaining;
+} behaviour_loop_t;
+
+typedef struct {
+  const uint8_t *code;
+  uint16_t len;
+  uint16_t pc;
+  behaviour_loop_t loops[BEHAVIOUR_LOOP_DEPTH];
+  uint8_t loop_depth;
+  uint32_t (*random)(uint32_t limit);
+  uint32_t instructions; // executed since load
+} behaviour_vm_t;
+
+// Check header, opcodes and jump targets. Returns false for a bad script.
+bool behaviour_validate(const uint8_t *script, size_t len);
+// Attach a validated script and rewind it
+void behaviour_start(behaviour_vm_t *vm, const uint8_t *script,
+                     uint32_t (*random)(uint32_t limit));
+// Execute until the script waits or ends. Returns the wait in ms, or
+// BEHAVIOUR_DONE once the script has finished.
+int32_t behaviour_run(behaviour_vm_t *vm);
+
+// A script resumed from a timer wheel whenever its wait runs out. Owns no
+// clock: whoever drives it passes the time in.
+typedef struct {
+  tw_wheel_t wheel;
+  tw_timer_t step;
+  behaviour_vm_t vm;
+  uint32_t now_ms;
+  uint32_t runs; // script resumptions
+} behaviour_player_t;
+
+// The cycle blink_task used to hard-code: a new expression every 5 s
+extern const uint8_t behaviour_default_script[];
+extern const size_t behaviour_default_script_size;
+
+void behaviour_player_init(behaviour_player_t *player, uint32_t now_ms);
+// Start a validated script on the next tick; it is not copied
+void behaviour_play(behaviour_player_t *player, const uint8_t *script,
+                    uint32_t (*random)(uint32_t limit));
+// Advance the wheel to now_ms, running the script if its wait is over
+void behaviour_tick(behaviour_player_t *player, uint32_t now_ms);
+
+#endif // BEHAVIOUR_H
@@ -0,0 +1,90 @@
+#include "behaviour_runner.h"
+#include "behaviour.h"
+
+#include <string.h>
+
+#include "esp_log.h"
+#include "esp_partition.h"
+#include "esp_random.h"
+#include "esp_timer.h"
+
+static const char *TAG = "behaviour";
+
+static behaviour_player_t g_player;
+static uint8_t g_script[BEHAVIOUR_MAX_SIZE];
+
+static behaviour_stats_t g_stats;
+static uint64_t g_tick_sum_us;
+
+static uint32_t script_random(uint32_t limit) {
+  return esp_random() % limit;
+}
+
+static void start_script(const uint8_t *script, size_t len) {
+  if (script != g_script) {
+    memcpy(g_script, script, len);
+  }
+  behaviour_play(&g_player, g_script, script_random);
+}
+
+esp_err_t behaviour_runner_load(const uint8_t *script, size_t len) {
+  if (!behaviour_validate(script, len)) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  start_script(script, len);
+  return ESP_OK;
+}
+
+static esp_err_t load_from_partition(void) {
+  const esp_partition_t *part = esp_partition_find_first(
+      ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, "behaviour");
+  if (!part) {
+    return ESP_ERR_NOT_FOUND;
+  }
+  uint8_t header[BEHAVIOUR_HEADER_SIZE];
+  esp_err_t err = esp_partition_read(part, 0, header, sizeof(header));
+  if (err != ESP_OK) {
+    return err;
+  }
+  size_t len = BEHAVIOUR_HEADER_SIZE + (header[4] | (header[5] << 8));
+  if (len > sizeof(g_script) || len > part->size) {
+    return ESP_ERR_INVALID_SIZE;
+  }
+  // Read straight into the live buffer; nothing is running yet
+  err = esp_partition_read(part, 0, g_script, len);
+  if (err != ESP_OK) {
+    return err;
+  }
+  return behaviour_runner_load(g_script, len);
+}
+
+void behaviour_runner_init(uint32_t now_ms) {
+  behaviour_player_init(&g_player, now_ms);
+
+  esp_err_t err = load_from_partition();
+  if (err != ESP_OK) {
+    ESP_LOGI(TAG, "no script in flash (%s), using built-in",
+             esp_err_to_name(err));
+    ESP_ERROR_CHECK(behaviour_runner_load(behaviour_default_script,
+                                          behaviour_default_script_size));
+  }
+}
+
+void behaviour_runner_tick(uint32_t now_ms) {
+  int64_t start = esp_timer_get_time();
+  behaviour_tick(&g_player, now_ms);
+
+  uint32_t spent = esp_timer_get_time() - start;
+  if (spent > g_stats.tick_max_us) {
+    g_stats.tick_max_us = spent;
+  }
+  g_tick_sum_us += spent;
+  g_stats.ticks++;
+}
+
+void behaviour_runner_get_stats(behaviour_stats_t *stats) {
+  *stats = g_stats;
+  stats->runs = g_player.runs;
+  stats->instructions = g_player.vm.instructions;
+  stats->tick_avg_us = g_stats.ticks ? g_tick_sum_us / g_stats.ticks : 0;
+}
@@ -0,0 +1,27 @@
+#ifndef BEHAVIOUR_RUNNER_H
+#define BEHAVIOUR_RUNNER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+
+typedef struct {
+  uint32_t ticks;        // wheel advances
+  uint32_t runs;         // script resumptions
+  uint32_t instructions; // executed by the current script
+  uint32_t tick_max_us;  // worst wheel advance, script included
+  uint32_t tick_avg_us;
+} behaviour_stats_t;
+
+// Load the script from the "behaviour" data partition, or fall back to the
+// built-in one, and start it
+void behaviour_runner_init(uint32_t now_ms);
+// Replace the running script (e.g. received over serial). The script is
+// copied; call from the task that calls behaviour_runner_tick().
+esp_err_t behaviour_runner_load(const uint8_t *script, size_t len);
+// Advance the timer wheel; call once per render loop iteration
+void behaviour_runner_tick(uint32_t now_ms);
+void behaviour_runner_get_stats(behaviour_stats_t *stats);
+
+#endif // BEHAVIOUR_RUNNER_H
@@ -0,0 +1,132 @@
+#include "clip_codec.h"
+
+#include <string.h>
+
+static uint16_t get_u16(const uint8_t *p) { return p[0] | (p[1] << 8); }
+
+bool clip_parse_header(const uint8_t *p, clip_header_t *header) {
+  if (p[0] != CLIP_MAGIC0 || p[1] != CLIP_MAGIC1 || p[2] != CLIP_VERSION) {
+    return false;
+  }
+  header->flags = p[3];
+  header->w = get_u16(p + 4);
+  header->h = get_u16(p + 6);
+  header->frames = get_u16(p + 8);
+  header->frame_ms = get_u16(p + 10);
+  return header->w && header->h && header->frames;
+}
+
+bool clip_parse_frame(const uint8_t *p, const clip_header_t *header,
+                      clip_frame_t *frame) {
+  frame->x = get_u16(p);
+  frame->y = get_u16(p + 2);
+  frame->w = get_u16(p + 4);
+  frame->h = get_u16(p + 6);
+  frame->size = get_u16(p + 8) | ((uint32_t)get_u16(p + 10) << 16);
+  return frame->x + frame->w <= header->w && frame->y + frame->h <= header->h;
+}
+
+void clip_stream_init(clip_stream_t *s, clip_read_fn read, void *ctx) {
+  memset(s, 0, sizeof(*s));
+  s->read = read;
+  s->ctx = ctx;
+}
+
+static bool refill(clip_stream_t *s) {
+  while (s->p == s->end) {
+    if (s->eof) {
+      return false;
+    }
+    size_t len = 0;
+    s->p = s->read(s->ctx, &len);
+    if (!s->p) {
+      s->p = s->end = NULL;
+      s->eof = true;
+      return false;
+    }
+    s->end = s->p + len;
+  }
+  return true;
+}
+
+static inline bool next_byte(clip_stream_t *s, uint8_t *b) {
+  if (s->p == s->end && !refill(s)) {
+    return false;
+  }
+  *b = *s->p++;
+  s->consumed++;
+  return true;
+}
+
+bool clip_stream_bytes(clip_stream_t *s, uint8_t *out, size_t n) {
+  while (n) {
+    if (s->p == s->end && !refill(s)) {
+      return false;
+    }
+    size_t k = s->end - s->p;
+    if (k > n) {
+      k = n;
+    }
+    memcpy(out, s->p, k);
+    s->p += k;
+    s->consumed += k;
+    out += k;
+    n -= k;
+  }
+  return true;
+}
+
+void clip_decode_begin(clip_stream_t *s) {
+  s->prev = 0;
+  s->run = 0;
+  memset(s->cache, 0, sizeof(s->cache));
+}
+
+bool clip_decode_pixels(clip_stream_t *s, uint16_t *out, int w) {
+  int x = 0;
+  while (x < w) {
+    if (s->run) {
+      // Runs carry on across rows
+      int n = w - x < s->run ? w - x : s->run;
+      uint16_t c = s->prev;
+      for (int i = 0; i < n; i++) {
+        out[x + i] = c;
+      }
+      x += n;
+      s->run -= n;
+      continue;
+    }
+    uint8_t op;
+    if (!next_byte(s, &op)) {
+      return false;
+    }
+    switch (op >> 6) {
+    case 0:
+      s->run = (op & 0x3f) + 1;
+      break;
+    case 1:
+      s->prev = s->cache[op & 0x3f];
+      out[x++] = s->prev;
+      break;
+    case 2: {
+      uint8_t lo;
+      if (!next_byte(s, &lo)) {
+        return false;
+      }
+      s->run = (((op & 0x3f) << 8) | lo) + 1;
+      break;
+    }
+    default: {
+      uint8_t lo, hi;
+      if (!next_byte(s, &lo) || !next_byte(s, &hi)) {
+        return false;
+      }
+      s->prev = lo | (hi << 8);
+      s->cache[MIRROR_CACHE_INDEX(s->prev)] = s->prev;
+      out[x++] = s->prev;
+      break;
+    }
+    }
+  }
+  return true;
+}
@@ -0,0 +1,73 @@
+#ifndef CLIP_CODEC_H
+#define CLIP_CODEC_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "mirror_codec.h"
+
+// Pre-rendered animation clips. A clip file is a header followed by frames;
+// each frame redraws one rectangle of the clip with the run-length / colour
+// cache code of mirror_codec.h, starting with previous colour 0 and an empty
+// cache. Pixels outside a frame's rectangle keep what the panel shows, so a
+// frame only carries the part that changed since the one before it.
+//   header: 'R' 'C' version flags, w h frames frame_ms (u16 LE)
+//   frame:  x y w h (u16 LE, inside the clip), size (u32 LE), size bytes
+// A frame with an empty rectangle changes nothing and just takes its time.
+#define CLIP_MAGIC0 'R'
+#define CLIP_MAGIC1 'C'
+#define CLIP_VERSION 1
+#define CLIP_HEADER_SIZE 12
+#define CLIP_FRAME_HEADER_SIZE 12
+#define CLIP_FLAG_LOOP 0x01 // play again from the first frame at the end
+
+typedef struct {
+  uint8_t flags;
+  uint16_t w;
+  uint16_t h;
+  uint16_t frames;
+  uint16_t frame_ms;
+} clip_header_t;
+
+typedef struct {
+  uint16_t x;
+  uint16_t y;
+  uint16_t w;
+  uint16_t h;
+  uint32_t size; // coded bytes that follow
+} clip_frame_t;
+
+// False unless the magic and version match and the clip has a size
+bool clip_parse_header(const uint8_t *p, clip_header_t *header);
+// False if the rectangle does not fit inside the clip
+bool clip_parse_frame(const uint8_t *p, const clip_header_t *header,
+                      clip_frame_t *frame);
+
+// Supplies the file in chunks; returns NULL at its end. A chunk stays valid
+// until the next call.
+typedef const uint8_t *(*clip_read_fn)(void *ctx, size_t *len);
+
+typedef struct {
+  clip_read_fn read;
+  void *ctx;
+  const uint8_t *p;
+  const uint8_t *end;
+  uint32_t consumed; // bytes taken since clip_stream_init()
+  bool eof;
+  // Pixel decoder, reset for every frame
+  uint16_t prev;
+  uint16_t run; // pixels of prev still to write
+  uint16_t cache[MIRROR_CACHE_SIZE];
+} clip_stream_t;
+
+void clip_stream_init(clip_stream_t *s, clip_read_fn read, void *ctx);
+// Copy the next n bytes, reading on as needed; false at the end of the file
+bool clip_stream_bytes(clip_stream_t *s, uint8_t *out, size_t n);
+// Reset the pixel decoder for a frame's coded data
+void clip_decode_begin(clip_stream_t *s);
+// Decode the next w pixels of the frame in raster order; false if the file
+// ends first
+bool clip_decode_pixels(clip_stream_t *s, uint16_t *out, int w);
+
+#endif // CLIP_CODEC_H
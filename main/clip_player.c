@@ -0,0 +1,362 @@
+#include "clip_player.h"
+#include "clip_codec.h"
+
+#include <assert.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+
+#include "driver/sdspi_host.h"
+#include "driver/spi_master.h"
+
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_vfs_fat.h"
+
+static const char *TAG = "clip";
+
+// Cardputer microSD slot, on its own SPI bus
+#define CLIP_SD_HOST SPI3_HOST
+#define CLIP_SD_MOSI 14
+#define CLIP_SD_MISO 39
+#define CLIP_SD_SCLK 40
+#define CLIP_SD_CS 12
+#define CLIP_MOUNT "/sdcard"
+
+#define CLIP_IO_CHUNK 2048 // per read buffer, two of them
+#define CLIP_IO_TIMEOUT_MS 500
+#define CLIP_MAX_WIDTH 320
+
+typedef enum {
+  CLIP_IDLE,
+  CLIP_PLAYING,
+} clip_state_t;
+
+static bool g_mounted;
+static clip_player_stats_t g_stats;
+
+// Requests from other tasks, taken by the render task
+static portMUX_TYPE g_request_lock = portMUX_INITIALIZER_UNLOCKED;
+static bool g_request;
+static char g_request_name[CLIP_NAME_MAX + 1]; // empty = stop
+
+// Playing clip, render task only
+static clip_state_t g_state;
+static int g_fd = -1;
+static clip_header_t g_header;
+static int g_x, g_y; // clip origin on the screen
+static uint16_t g_frame_no;
+static uint32_t g_next_ms;
+static clip_stream_t g_stream;
+
+// Frame being decoded by the flush path
+static bool g_decoding;
+static clip_frame_t g_frame;
+static uint16_t g_rows_done;
+static bool g_band_error;
+static uint32_t g_decode_us;
+static uint16_t g_row[CLIP_MAX_WIDTH];
+
+// Double buffered reads: the reader task fills one buffer while the decoder
+// works through the other
+static uint8_t g_io_buf[2][CLIP_IO_CHUNK];
+static size_t g_io_len[2];
+static QueueHandle_t g_io_free;   // buffer indices to fill
+static QueueHandle_t g_io_filled; // buffer indices to decode
+static SemaphoreHandle_t g_io_exit;
+static volatile bool g_io_stop;
+static bool g_io_loop;
+static int g_io_held = -1; // buffer the decoder is reading
+
+static void clip_io_task(void *arg) {
+  uint8_t idx;
+  while (xQueueReceive(g_io_free, &idx, portMAX_DELAY) == pdTRUE &&
+         !g_io_stop) {
+    ssize_t n = read(g_fd, g_io_buf[idx], CLIP_IO_CHUNK);
+    if (n == 0 && g_io_loop) {
+      // Looping clips stream on from the first frame
+      lseek(g_fd, CLIP_HEADER_SIZE, SEEK_SET);
+      n = read(g_fd, g_io_buf[idx], CLIP_IO_CHUNK);
+    }
+    g_io_len[idx] = n > 0 ? n : 0;
+    xQueueSend(g_io_filled, &idx, portMAX_DELAY);
+    if (n <= 0) {
+      break;
+    }
+  }
+  xSemaphoreGive(g_io_exit);
+  vTaskDelete(NULL);
+}
+
+static const uint8_t *clip_io_next(void *ctx, size_t *len) {
+  if (g_io_held >= 0) {
+    uint8_t idx = g_io_held;
+    xQueueSend(g_io_free, &idx, 0);
+    g_io_held = -1;
+  }
+  if (!uxQueueMessagesWaiting(g_io_filled)) {
+    g_stats.stalls++;
+  }
+  uint8_t idx;
+  if (xQueueReceive(g_io_filled, &idx, pdMS_TO_TICKS(CLIP_IO_TIMEOUT_MS)) !=
+      pdTRUE) {
+    ESP_LOGW(TAG, "SD read timed out");
+    return NULL;
+  }
+  g_io_held = idx;
+  *len = g_io_len[idx];
+  return *len ? g_io_buf[idx] : NULL;
+}
+
+void clip_player_init(void) {
+  g_io_free = xQueueCreate(2, sizeof(uint8_t));
+  g_io_filled = xQueueCreate(2, sizeof(uint8_t));
+  g_io_exit = xSemaphoreCreateBinary();
+  assert(g_io_free && g_io_filled && g_io_exit);
+
+  spi_bus_config_t bus = {
+      .mosi_io_num = CLIP_SD_MOSI,
+      .miso_io_num = CLIP_SD_MISO,
+      .sclk_io_num = CLIP_SD_SCLK,
+      .quadwp_io_num = -1,
+      .quadhd_io_num = -1,
+      .max_transfer_sz = 4096,
+  };
+  esp_err_t err = spi_bus_initialize(CLIP_SD_HOST, &bus, SPI_DMA_CH_AUTO);
+  if (err != ESP_OK) {
+    ESP_LOGW(TAG, "SD bus: %s", esp_err_to_name(err));
+    return;
+  }
+  sdmmc_host_t host = SDSPI_HOST_DEFAULT();
+  host.slot = CLIP_SD_HOST;
+  sdspi_device_config_t slot = SDSPI_DEVICE_CONFIG_DEFAULT();
+  slot.gpio_cs = CLIP_SD_CS;
+  slot.host_id = CLIP_SD_HOST;
+  esp_vfs_fat_mount_config_t mount = {
+      .format_if_mount_failed = false,
+      .max_files = 2,
+      .allocation_unit_size = 16 * 1024,
+  };
+  sdmmc_card_t *card;
+  err = esp_vfs_fat_sdspi_mount(CLIP_MOUNT, &host, &slot, &mount, &card);
+  if (err != ESP_OK) {
+    ESP_LOGI(TAG, "no SD card (%s), clips disabled", esp_err_to_name(err));
+    return;
+  }
+  g_mounted = true;
+}
+
+static esp_err_t clip_request(const char *name) {
+  size_t len = strlen(name);
+  if (len > CLIP_NAME_MAX || strchr(name, '/')) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  portENTER_CRITICAL_SAFE(&g_request_lock);
+  memcpy(g_request_name, name, len + 1);
+  g_request = true;
+  portEXIT_CRITICAL_SAFE(&g_request_lock);
+  return ESP_OK;
+}
+
+esp_err_t clip_player_play(const char *name) {
+  if (!g_mounted) {
+    return ESP_ERR_NOT_FOUND;
+  }
+  return *name ? clip_request(name) : ESP_ERR_INVALID_ARG;
+}
+
+void clip_player_stop(void) { clip_request(""); }
+
+static void clip_close(void) {
+  g_io_stop = true;
+  if (g_io_held >= 0) {
+    uint8_t idx = g_io_held;
+    xQueueSend(g_io_free, &idx, 0);
+    g_io_held = -1;
+  }
+  // Wakes the reader if it is waiting for a buffer
+  uint8_t idx = 0;
+  xQueueSend(g_io_free, &idx, 0);
+  xSemaphoreTake(g_io_exit, portMAX_DELAY);
+  xQueueReset(g_io_free);
+  xQueueReset(g_io_filled);
+  close(g_fd);
+  g_fd = -1;
+  g_state = CLIP_IDLE;
+  ESP_LOGI(TAG,
+           "%lu clips: %lu frames, %lu bytes, decode max %lu us, %lu stalls",
+           g_stats.clips, g_stats.frames, g_stats.bytes, g_stats.decode_max_us,
+           g_stats.stalls);
+}
+
+static bool clip_open(const char *name) {
+  char path[sizeof(CLIP_MOUNT) + 8 + CLIP_NAME_MAX + 4];
+  snprintf(path, sizeof(path), CLIP_MOUNT "/clips/%s.clp", name);
+  g_fd = open(path, O_RDONLY);
+  if (g_fd < 0) {
+    ESP_LOGW(TAG, "cannot open %s", path);
+    return false;
+  }
+  uint8_t raw[CLIP_HEADER_SIZE];
+  if (read(g_fd, raw, sizeof(raw)) != sizeof(raw) ||
+      !clip_parse_header(raw, &g_header) || g_header.w > CLIP_MAX_WIDTH ||
+      g_header.w > LV_HOR_RES || g_header.h > LV_VER_RES) {
+    ESP_LOGW(TAG, "%s is not a clip for this screen", path);
+    close(g_fd);
+    g_fd = -1;
+    return false;
+  }
+  g_x = (LV_HOR_RES - g_header.w) / 2;
+  g_y = (LV_VER_RES - g_header.h) / 2;
+
+  g_io_stop = false;
+  g_io_loop = g_header.flags & CLIP_FLAG_LOOP;
+  for (uint8_t i = 0; i < 2; i++) {
+    xQueueSend(g_io_free, &i, 0);
+  }
+  // Reads overlap rendering on the other core
+  xTaskCreatePinnedToCore(clip_io_task, "clip_io", 3072, NULL, 3, NULL, 1);
+  clip_stream_init(&g_stream, clip_io_next, NULL);
+  g_frame_no = 0;
+  g_state = CLIP_PLAYING;
+  g_stats.clips++;
+  ESP_LOGI(TAG, "%s: %ux%u, %u frames at %u ms", name, g_header.w,
+           g_header.h, g_header.frames, g_header.frame_ms);
+  return true;
+}
+
+// Decode one frame through LVGL. Its rectangle is refreshed on its own so
+// the flush path gets exactly those rows in order; pixels around it must
+// not be redrawn, they hold earlier frames.
+static bool clip_frame(void) {
+  uint8_t raw[CLIP_FRAME_HEADER_SIZE];
+  if (!clip_stream_bytes(&g_stream, raw, sizeof(raw)) ||
+      !clip_parse_frame(raw, &g_header, &g_frame)) {
+    return false;
+  }
+  uint32_t start = g_stream.consumed;
+  if (g_frame.w && g_frame.h) {
+    lv_refr_now(NULL); // whatever else is pending goes out first
+    clip_decode_begin(&g_stream);
+    g_rows_done = 0;
+    g_band_error = false;
+    g_decode_us = 0;
+    g_decoding = true;
+    lv_area_t area = {.x1 = g_x + g_frame.x,
+                      .y1 = g_y + g_frame.y,
+                      .x2 = g_x + g_frame.x + g_frame.w - 1,
+                      .y2 = g_y + g_frame.y + g_frame.h - 1};
+    lv_obj_invalidate_area(lv_scr_act(), &area);
+    lv_refr_now(NULL);
+    g_decoding = false;
+    if (g_band_error || g_rows_done != g_frame.h) {
+      return false;
+    }
+    if (g_decode_us > g_stats.decode_max_us) {
+      g_stats.decode_max_us = g_decode_us;
+    }
+  }
+  // The coded size must match what the pixels took
+  if (g_stream.consumed - start != g_frame.size) {
+    return false;
+  }
+  g_stats.bytes += g_frame.size;
+  g_stats.frames++;
+  return true;
+}
+
+bool clip_player_tick(uint32_t now_ms) {
+  bool request = false;
+  char name[CLIP_NAME_MAX + 1];
+  portENTER_CRITICAL(&g_request_lock);
+  if (g_request) {
+    request = true;
+    memcpy(name, g_request_name, sizeof(name));
+    g_request = false;
+  }
+  portEXIT_CRITICAL(&g_request_lock);
+
+  if (request) {
+    if (g_state != CLIP_IDLE) {
+      clip_close();
+    }
+    if (*name && clip_open(name)) {
+      // First frame on the next tick, after the eyes are cleared
+      g_next_ms = now_ms + 1;
+      return true;
+    }
+  }
+  if (g_state == CLIP_IDLE) {
+    return false;
+  }
+
+  if ((int32_t)(now_ms - g_next_ms) < 0) {
+    return true;
+  }
+  if (!clip_frame()) {
+    ESP_LOGW(TAG, "bad clip data in frame %u", g_frame_no);
+    g_stats.errors++;
+    clip_close();
+    return false;
+  }
+  // Keep the pace, but do not rush to catch up after a slow frame
+  g_next_ms += g_header.frame_ms;
+  if ((int32_t)(now_ms - g_next_ms) > 0) {
+    g_next_ms = now_ms;
+  }
+  if (++g_frame_no == g_header.frames) {
+    if (!g_io_loop) {
+      clip_close();
+      return false;
+    }
+    g_frame_no = 0;
+  }
+  return true;
+}
+
+void clip_player_band(const lv_area_t *area, uint16_t *px_map) {
+  if (!g_decoding || g_band_error) {
+    return;
+  }
+  int64_t start = esp_timer_get_time();
+  int w = lv_area_get_width(area);
+  int rx1 = g_x + g_frame.x;
+  int rx2 = rx1 + g_frame.w - 1;
+  int ry1 = g_y + g_frame.y;
+  int y1 = area->y1 > ry1 ? area->y1 : ry1;
+  int y2 = area->y2 < ry1 + g_frame.h - 1 ? area->y2 : ry1 + g_frame.h - 1;
+  // Rows arrive top to bottom; anything else means LVGL split the refresh
+  // in a way the stream cannot follow
+  if (y1 <= y2 && y1 != ry1 + g_rows_done) {
+    g_band_error = true;
+    return;
+  }
+  bool exact = area->x1 == rx1 && area->x2 == rx2;
+  for (int y = y1; y <= y2; y++) {
+    uint16_t *dst = px_map + (y - area->y1) * w;
+    if (exact) {
+      g_band_error = !clip_decode_pixels(&g_stream, dst, g_frame.w);
+    } else {
+      g_band_error = !clip_decode_pixels(&g_stream, g_row, g_frame.w);
+      int x1 = area->x1 > rx1 ? area->x1 : rx1;
+      int x2 = area->x2 < rx2 ? area->x2 : rx2;
+      if (x1 <= x2) {
+        memcpy(dst + (x1 - area->x1), g_row + (x1 - rx1),
+               (x2 - x1 + 1) * sizeof(uint16_t));
+      }
+    }
+    if (g_band_error) {
+      break;
+    }
+    g_rows_done++;
+  }
+  g_decode_us += esp_timer_get_time() - start;
+}
+
+void clip_player_get_stats(clip_player_stats_t *stats) { *stats = g_stats; }
@@ -0,0 +1,37 @@
+#ifndef CLIP_PLAYER_H
+#define CLIP_PLAYER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "lvgl/lvgl.h"
+
+#include "esp_err.h"
+
+#define CLIP_NAME_MAX 16
+
+typedef struct {
+  uint32_t clips;
+  uint32_t frames;
+  uint32_t bytes;         // coded frame data decoded
+  uint32_t decode_max_us; // worst frame, waits for the card included
+  uint32_t stalls;        // decoder waited for the SD card
+  uint32_t errors;        // clips cut short by a bad or unreadable file
+} clip_player_stats_t;
+
+// Mount the microSD card; clips are /sdcard/clips/<name>.clp. Without a
+// card everything else still works and clips fail to start.
+void clip_player_init(void);
+// Play a clip in place of the eyes, replacing any playing one; safe from
+// any task, it starts on the next tick
+esp_err_t clip_player_play(const char *name);
+void clip_player_stop(void);
+// Render task: start, advance and end clips. Returns true while a clip owns
+// the screen; the eyes should be cleared when this changes.
+bool clip_player_tick(uint32_t now_ms);
+// Flush path: decode the rows of the current clip frame inside area into
+// px_map, a band of area's width
+void clip_player_band(const lv_area_t *area, uint16_t *px_map);
+void clip_player_get_stats(clip_player_stats_t *stats);
+
+#endif // CLIP_PLAYER_H
@@ -0,0 +1,330 @@
+#include "control.h"
+#include "audio_out.h"
+#include "behaviour_runner.h"
+#include "clip_player.h"
+#include "control_proto.h"
+#include "eye_actions.h"
+#include "frame_mem.h"
+#include "latency.h"
+#include "mic.h"
+#include "mirror.h"
+#include "power.h"
+#include "qos.h"
+#include "text_overlay.h"
+
+#include <assert.h>
+#include <stdatomic.h>
+#include <string.h>
+
+#include "FluxGarage_RoboEyes.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+
+#include "driver/usb_serial_jtag.h"
+
+#include "esp_log.h"
+
+static const char *TAG = "control";
+
+#define CONTROL_RX_SIZE (2 * (CONTROL_MAX_PAYLOAD + CONTROL_OVERHEAD))
+#define CONTROL_REPLY_MAX 64
+#define CONTROL_APPLY_TIMEOUT_MS 200
+
+static TaskHandle_t g_control_task;
+static SemaphoreHandle_t g_tx_lock;
+
+// The receive task parses in place and hands the render task a view into
+// g_rx; it does not touch the buffer again until the batch was applied.
+static uint8_t g_rx[CONTROL_RX_SIZE];
+static control_frame_t g_batch;
+static _Atomic(control_frame_t *) g_pending;
+static uint8_t g_reply[CONTROL_REPLY_MAX];
+static uint16_t g_reply_len;
+
+static control_stats_t g_stats;
+
+esp_err_t control_send(uint8_t seq, const uint8_t *payload, uint16_t len) {
+  static uint8_t frame[CONTROL_MAX_PAYLOAD + CONTROL_OVERHEAD];
+  xSemaphoreTake(g_tx_lock, portMAX_DELAY);
+  size_t n = control_encode(frame, sizeof(frame), seq, payload, len);
+  if (n) {
+    usb_serial_jtag_write_bytes(frame, n, portMAX_DELAY);
+  }
+  xSemaphoreGive(g_tx_lock);
+  return n ? ESP_OK : ESP_ERR_INVALID_SIZE;
+}
+
+static void put_u32(uint8_t *p, uint32_t v) {
+  p[0] = v;
+  p[1] = v >> 8;
+  p[2] = v >> 16;
+  p[3] = v >> 24;
+}
+
+static bool control_apply(const control_cmd_t *cmd) {
+  const uint8_t *a = cmd->args;
+  switch (cmd->op) {
+  case CONTROL_CMD_PING:
+    break;
+  case CONTROL_CMD_MOOD:
+    RoboEyes_setMood(a[0]);
+    break;
+  case CONTROL_CMD_POSITION:
+    RoboEyes_setPosition(a[0]);
+    break;
+  case CONTROL_CMD_ACTION: {
+    eye_action_t action = {.type = a[0], .arg = a[1]};
+    eye_action_apply(&action);
+    break;
+  }
+  case CONTROL_CMD_SIZE:
+    RoboEyes_setWidth(a[0], a[1]);
+    RoboEyes_setHeight(a[2], a[3]);
+    break;
+  case CONTROL_CMD_RADIUS:
+    RoboEyes_setBorderradius(a[0], a[1]);
+    break;
+  case CONTROL_CMD_SPACE:
+    RoboEyes_setSpacebetween((int16_t)(a[0] | (a[1] << 8)));
+    break;
+  case CONTROL_CMD_FRAMERATE:
+    if (!a[0]) {
+      return false;
+    }
+    RoboEyes_setFramerate(a[0]);
+    break;
+  case CONTROL_CMD_AUTOBLINK:
+    RoboEyes_setAutoblinker2(a[0], a[1], a[2]);
+    break;
+  case CONTROL_CMD_IDLE:
+    RoboEyes_setIdleMode2(a[0], a[1], a[2]);
+    break;
+  case CONTROL_CMD_HFLICKER:
+    RoboEyes_setHFlicker2(a[0], a[1]);
+    break;
+  case CONTROL_CMD_VFLICKER:
+    RoboEyes_setVFlicker2(a[0], a[1]);
+    break;
+  case CONTROL_CMD_MODULATION:
+    RoboEyes_setModulationMode(a[0], a[1]);
+    break;
+  case CONTROL_CMD_TEXT: {
+    char text[TEXT_OVERLAY_MAX_LEN + 1];
+    size_t n = cmd->len - 1;
+    if (a[0] >= GLYPH_SIZE_COUNT || n > TEXT_OVERLAY_MAX_LEN) {
+      return false;
+    }
+    memcpy(text, a + 1, n);
+    text[n] = '\0';
+    text_overlay_set(text, a[0]);
+    break;
+  }
+  case CONTROL_CMD_SCRIPT:
+    return behaviour_runner_load(a, cmd->len) == ESP_OK;
+  case CONTROL_CMD_GET_LATENCY: {
+    uint8_t *p = g_reply + g_reply_len;
+    if (g_reply_len + 1 + LATENCY_STAGE_COUNT * 20 > CONTROL_REPLY_MAX) {
+      return false;
+    }
+    *p++ = CONTROL_REPLY_LATENCY;
+    for (int i = 0; i < LATENCY_STAGE_COUNT; i++) {
+      latency_stats_t s;
+      latency_get_stats(i, &s);
+      put_u32(p, s.count);
+      put_u32(p + 4, s.p50_us);
+      put_u32(p + 8, s.p90_us);
+      put_u32(p + 12, s.p99_us);
+      put_u32(p + 16, s.max_us);
+      p += 20;
+    }
+    g_reply_len = p - g_reply;
+    break;
+  }
+  case CONTROL_CMD_MIRROR:
+    mirror_set_rate(a[0]);
+    break;
+  case CONTROL_CMD_LOOK:
+    RoboEyes_lookAt((int16_t)(a[0] | (a[1] << 8)),
+                    (int16_t)(a[2] | (a[3] << 8)));
+    break;
+  case CONTROL_CMD_CLIP: {
+    char name[CLIP_NAME_MAX + 1];
+    size_t n = cmd->len;
+    if (n > CLIP_NAME_MAX) {
+      return false;
+    }
+    memcpy(name, a, n);
+    name[n] = '\0';
+    if (!n) {
+      clip_player_stop();
+      break;
+    }
+    return clip_player_play(name) == ESP_OK;
+  }
+  case CONTROL_CMD_SAY: {
+    char name[AUDIO_NAME_MAX + 1];
+    size_t n = cmd->len;
+    if (n > AUDIO_NAME_MAX) {
+      return false;
+    }
+    memcpy(name, a, n);
+    name[n] = '\0';
+    return audio_out_say(name) == ESP_OK;
+  }
+  case CONTROL_CMD_GET_QOS: {
+    uint8_t *p = g_reply + g_reply_len;
+    if (g_reply_len + 18 > CONTROL_REPLY_MAX) {
+      return false;
+    }
+    qos_stats_t s;
+    qos_get_stats(&s);
+    p[0] = CONTROL_REPLY_QOS;
+    p[1] = s.level;
+    put_u32(p + 2, s.transitions);
+    put_u32(p + 6, s.frames);
+    put_u32(p + 10, s.misses);
+    put_u32(p + 14, s.frame_max_us);
+    g_reply_len += 18;
+    break;
+  }
+  case CONTROL_CMD_GET_MEM: {
+    uint8_t *p = g_reply + g_reply_len;
+    if (g_reply_len + 37 > CONTROL_REPLY_MAX) {
+      return false;
+    }
+    frame_mem_stats_t s;
+    frame_mem_get_stats(&s);
+    p[0] = CONTROL_REPLY_MEM;
+    put_u32(p + 1, s.arena_size);
+    put_u32(p + 5, s.arena_high_water);
+    put_u32(p + 9, s.arena_allocs);
+    put_u32(p + 13, s.heap_allocs);
+    put_u32(p + 17, s.overflows);
+    put_u32(p + 21, s.pinned_frames);
+    put_u32(p + 25, s.heap_free);
+    put_u32(p + 29, s.heap_min_free);
+    put_u32(p + 33, s.heap_largest);
+    g_reply_len += 37;
+    break;
+  }
+  case CONTROL_CMD_GET_MIC: {
+    uint8_t *p = g_reply + g_reply_len;
+    if (g_reply_len + 26 > CONTROL_REPLY_MAX) {
+      return false;
+    }
+    mic_stats_t s;
+    mic_get_stats(&s);
+    p[0] = CONTROL_REPLY_MIC;
+    put_u32(p + 1, s.blocks);
+    put_u32(p + 5, s.overruns);
+    put_u32(p + 9, s.cpu_permille);
+    put_u32(p + 13, s.process_max_us);
+    put_u32(p + 17, s.energy);
+    put_u32(p + 21, s.noise_floor);
+    p[25] = s.listening;
+    g_reply_len += 26;
+    break;
+  }
+  default:
+    return false;
+  }
+  return true;
+}
+
+void control_dispatch(void) {
+  control_frame_t *batch = atomic_load(&g_pending);
+  if (!batch) {
+    return;
+  }
+
+  // Ack first, optional data (e.g. latency) after it
+  g_reply_len = 3;
+  uint8_t status = CONTROL_STATUS_OK;
+  uint8_t applied = 0;
+  size_t pos = 0;
+  control_cmd_t cmd;
+  while (control_next_cmd(batch, &pos, &cmd)) {
+    if (!control_apply(&cmd)) {
+      status = CONTROL_STATUS_FAILED;
+    }
+    applied++;
+  }
+  g_reply[0] = CONTROL_REPLY_ACK;
+  g_reply[1] = status;
+  g_reply[2] = applied;
+  g_stats.commands += applied;
+
+  atomic_store(&g_pending, NULL);
+  xTaskNotifyGive(g_control_task);
+}
+
+static void control_handle_frame(const control_frame_t *frame) {
+  g_stats.frames++;
+  if (!control_batch_valid(frame)) {
+    g_stats.rejected++;
+    uint8_t nak[3] = {CONTROL_REPLY_ACK, CONTROL_STATUS_BAD_BATCH, 0};
+    control_send(frame->seq, nak, sizeof(nak));
+    return;
+  }
+
+  g_batch = *frame;
+  atomic_store(&g_pending, &g_batch);
+  power_notify_input(); // also gets a sleepy render loop to it promptly
+  if (!ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(CONTROL_APPLY_TIMEOUT_MS))) {
+    // Render loop stalled; it will still apply the batch, so wait for it
+    // rather than let g_rx be reused underneath it
+    ESP_LOGW(TAG, "batch %u not applied after %d ms", frame->seq,
+             CONTROL_APPLY_TIMEOUT_MS);
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+  }
+  control_send(frame->seq, g_reply, g_reply_len);
+}
+
+static void control_task(void *arg) {
+  size_t len = 0;
+  while (1) {
+    int n = usb_serial_jtag_read_bytes(g_rx + len, sizeof(g_rx) - len,
+                                       portMAX_DELAY);
+    if (n <= 0) {
+      continue;
+    }
+    len += n;
+
+    size_t off = 0;
+    while (off < len) {
+      control_frame_t frame;
+      size_t consumed;
+      control_parse_t r =
+          control_parse(g_rx + off, len - off, &frame, &consumed);
+      if (r == CONTROL_PARSE_NEED_MORE) {
+        break;
+      }
+      if (r == CONTROL_PARSE_FRAME) {
+        control_handle_frame(&frame);
+      } else {
+        g_stats.rejected++;
+      }
+      off += consumed;
+    }
+    // Keep only the partial frame, at the front
+    memmove(g_rx, g_rx + off, len - off);
+    len -= off;
+  }
+}
+
+void control_init(void) {
+  g_tx_lock = xSemaphoreCreateMutex();
+  assert(g_tx_lock);
+
+  usb_serial_jtag_driver_config_t cfg = USB_SERIAL_JTAG_DRIVER_CONFIG_DEFAULT();
+  cfg.rx_buffer_size = 2048;
+  cfg.tx_buffer_size = 2048;
+  ESP_ERROR_CHECK(usb_serial_jtag_driver_install(&cfg));
+
+  xTaskCreatePinnedToCore(control_task, "control", 4096, NULL, 4,
+                          &g_control_task, 1);
+}
+
+void control_get_stats(control_stats_t *stats) { *stats = g_stats; }
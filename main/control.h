@@ -0,0 +1,22 @@
+#ifndef CONTROL_H
+#define CONTROL_H
+
+#include <stdint.h>
+
+#include "esp_err.h"
+
+typedef struct {
+  uint32_t frames;   // valid frames received
+  uint32_t commands; // commands applied
+  uint32_t rejected; // bad batches plus CRC / framing drops
+} control_stats_t;
+
+// Install the USB-Serial-JTAG driver and start the receive task
+void control_init(void);
+// Apply a pending command batch; call from the render task between frames
+void control_dispatch(void);
+// Send a device-to-host frame (thread safe)
+esp_err_t control_send(uint8_t seq, const uint8_t *payload, uint16_t len);
+void control_get_stats(control_stats_t *stats);
+
+#endif // CONTROL_H
@@ -0,0 +1,145 @@
+#include "control_proto.h"
+
+#include <string.h>
+
+#define ARGS_VARIABLE 0x80 // flag: size is a minimum
+
+static const uint8_t cmd_arg_sizes[CONTROL_CMD_COUNT] = {
+    [CONTROL_CMD_PING] = 0,
+    [CONTROL_CMD_MOOD] = 1,
+    [CONTROL_CMD_POSITION] = 1,
+    [CONTROL_CMD_ACTION] = 2,
+    [CONTROL_CMD_SIZE] = 4,
+    [CONTROL_CMD_RADIUS] = 2,
+    [CONTROL_CMD_SPACE] = 2,
+    [CONTROL_CMD_FRAMERATE] = 1,
+    [CONTROL_CMD_AUTOBLINK] = 3,
+    [CONTROL_CMD_IDLE] = 3,
+    [CONTROL_CMD_HFLICKER] = 2,
+    [CONTROL_CMD_VFLICKER] = 2,
+    [CONTROL_CMD_MODULATION] = 2,
+    [CONTROL_CMD_TEXT] = ARGS_VARIABLE | 1,
+    [CONTROL_CMD_SCRIPT] = ARGS_VARIABLE | 6,
+    [CONTROL_CMD_GET_LATENCY] = 0,
+    [CONTROL_CMD_MIRROR] = 1,
+    [CONTROL_CMD_LOOK] = 4,
+    [CONTROL_CMD_GET_QOS] = 0,
+    [CONTROL_CMD_CLIP] = ARGS_VARIABLE | 0,
+    [CONTROL_CMD_GET_MEM] = 0,
+    [CONTROL_CMD_GET_MIC] = 0,
+    [CONTROL_CMD_SAY] = ARGS_VARIABLE | 1,
+};
+
+// CRC-16/CCITT-FALSE, a nibble at a time
+static const uint16_t crc_nibble[16] = {
+    0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50a5, 0x60c6, 0x70e7,
+    0x8108, 0x9129, 0xa14a, 0xb16b, 0xc18c, 0xd1ad, 0xe1ce, 0xf1ef,
+};
+
+uint16_t control_crc16(const uint8_t *data, size_t len, uint16_t crc) {
+  for (size_t i = 0; i < len; i++) {
+    crc = (crc << 4) ^ crc_nibble[(crc >> 12) ^ (data[i] >> 4)];
+    crc = (crc << 4) ^ crc_nibble[(crc >> 12) ^ (data[i] & 0x0f)];
+  }
+  return crc;
+}
+
+control_parse_t control_parse(const uint8_t *buf, size_t len,
+                              control_frame_t *frame, size_t *consumed) {
+  // Resynchronise on the start-of-frame marker
+  size_t start = 0;
+  while (start < len && buf[start] != CONTROL_SOF0) {
+    start++;
+  }
+  if (start) {
+    *consumed = start;
+    return CONTROL_PARSE_SKIP;
+  }
+  if (len < 2) {
+    *consumed = 0;
+    return CONTROL_PARSE_NEED_MORE;
+  }
+  if (buf[1] != CONTROL_SOF1) {
+    *consumed = 1;
+    return CONTROL_PARSE_SKIP;
+  }
+  if (len < CONTROL_HEADER_SIZE) {
+    *consumed = 0;
+    return CONTROL_PARSE_NEED_MORE;
+  }
+
+  uint16_t payload_len = buf[2] | (buf[3] << 8);
+  if (payload_len > CONTROL_MAX_PAYLOAD) {
+    *consumed = 1;
+    return CONTROL_PARSE_SKIP;
+  }
+  size_t total = payload_len + CONTROL_OVERHEAD;
+  if (len < total) {
+    *consumed = 0;
+    return CONTROL_PARSE_NEED_MORE;
+  }
+
+  const uint8_t *crc_at = buf + CONTROL_HEADER_SIZE + payload_len;
+  uint16_t crc = control_crc16(buf + 2, CONTROL_HEADER_SIZE - 2 + payload_len,
+                               0xffff);
+  if (crc != (crc_at[0] | (crc_at[1] << 8))) {
+    *consumed = 1; // the marker may have been payload; rescan after it
+    return CONTROL_PARSE_SKIP;
+  }
+
+  frame->seq = buf[4];
+  frame->len = payload_len;
+  frame->payload = buf + CONTROL_HEADER_SIZE;
+  *consumed = total;
+  return CONTROL_PARSE_FRAME;
+}
+
+bool control_next_cmd(const control_frame_t *frame, size_t *pos,
+                      control_cmd_t *cmd) {
+  if (*pos + CONTROL_CMD_HEADER_SIZE > frame->len) {
+    return false;
+  }
+  const uint8_t *p = frame->payload + *pos;
+  cmd->op = p[0];
+  cmd->len = p[1] | (p[2] << 8);
+  cmd->args = p + CONTROL_CMD_HEADER_SIZE;
+  if (*pos + CONTROL_CMD_HEADER_SIZE + cmd->len > frame->len) {
+    return false;
+  }
+  *pos += CONTROL_CMD_HEADER_SIZE + cmd->len;
+  return true;
+}
+
+bool control_batch_valid(const control_frame_t *frame) {
+  size_t pos = 0;
+  control_cmd_t cmd;
+  while (control_next_cmd(frame, &pos, &cmd)) {
+    if (cmd.op >= CONTROL_CMD_COUNT) {
+      return false;
+    }
+    uint8_t size = cmd_arg_sizes[cmd.op];
+    if (size & ARGS_VARIABLE ? cmd.len < (size & ~ARGS_VARIABLE)
+                             : cmd.len != size) {
+      return false;
+    }
+  }
+  return pos == frame->len; // no trailing partial command
+}
+
+size_t control_encode(uint8_t *out, size_t cap, uint8_t seq,
+                      const uint8_t *payload, uint16_t len) {
+  size_t total = len + CONTROL_OVERHEAD;
+  if (total > cap) {
+    return 0;
+  }
+  out[0] = CONTROL_SOF0;
+  out[1] = CONTROL_SOF1;
+  out[2] = len & 0xff;
+  out[3] = len >> 8;
+  out[4] = seq;
+  memcpy(out + CONTROL_HEADER_SIZE, payload, len);
+  uint16_t crc = control_crc16(out + 2, CONTROL_HEADER_SIZE - 2 + len, 0xffff);
+  out[CONTROL_HEADER_SIZE + len] = crc & 0xff;
+  out[CONTROL_HEADER_SIZE + len + 1] = crc >> 8;
+  return total;
+}
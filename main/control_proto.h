@@ -0,0 +1,104 @@
+#ifndef CONTROL_PROTO_H
+#define CONTROL_PROTO_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Serial control protocol. A frame is
+//   0xA5 0x5A len_lo len_hi seq payload[len] crc_lo crc_hi
+// with CRC-16/CCITT-FALSE over len, seq and payload. Host to device payloads
+// are a batch of commands, each op len_lo len_hi args[len], applied together
+// between two rendered frames. Device replies reuse the framing with the
+// request's seq.
+#define CONTROL_SOF0 0xa5
+#define CONTROL_SOF1 0x5a
+#define CONTROL_HEADER_SIZE 5
+#define CONTROL_CRC_SIZE 2
+#define CONTROL_OVERHEAD (CONTROL_HEADER_SIZE + CONTROL_CRC_SIZE)
+#define CONTROL_MAX_PAYLOAD 1280
+#define CONTROL_CMD_HEADER_SIZE 3
+
+// Commands, fixed argument sizes noted
+enum {
+  CONTROL_CMD_PING = 0x00,        // 0
+  CONTROL_CMD_MOOD = 0x01,        // 1: mood
+  CONTROL_CMD_POSITION = 0x02,    // 1: N..NW, 0 = center
+  CONTROL_CMD_ACTION = 0x03,      // 2: eye_action_type_t, arg
+  CONTROL_CMD_SIZE = 0x04,        // 4: width L, R, height L, R
+  CONTROL_CMD_RADIUS = 0x05,      // 2: border radius L, R
+  CONTROL_CMD_SPACE = 0x06,       // 2: i16 space between
+  CONTROL_CMD_FRAMERATE = 0x07,   // 1: fps
+  CONTROL_CMD_AUTOBLINK = 0x08,   // 3: on, interval s, variation s
+  CONTROL_CMD_IDLE = 0x09,        // 3: on, interval s, variation s
+  CONTROL_CMD_HFLICKER = 0x0a,    // 2: on, amplitude
+  CONTROL_CMD_VFLICKER = 0x0b,    // 2: on, amplitude
+  CONTROL_CMD_MODULATION = 0x0c,  // 2: mode, depth
+  CONTROL_CMD_TEXT = 0x0d,        // 1+: glyph size, text (empty hides)
+  CONTROL_CMD_SCRIPT = 0x0e,      // 6+: behaviour script
+  CONTROL_CMD_GET_LATENCY = 0x0f, // 0: reply carries latency stats
+  CONTROL_CMD_MIRROR = 0x10,      // 1: max mirrored fps, 0 = off
+  CONTROL_CMD_LOOK = 0x11,        // 4: i16 x, y of a screen point
+  CONTROL_CMD_GET_QOS = 0x12,     // 0: reply carries frame QoS stats
+  CONTROL_CMD_CLIP = 0x13,        // 0+: clip name on the SD card, empty stops
+  CONTROL_CMD_GET_MEM = 0x14,     // 0: reply carries frame arena/heap stats
+  CONTROL_CMD_GET_MIC = 0x15,     // 0: reply carries microphone/VAD stats
+  CONTROL_CMD_SAY = 0x16,         // 1+: sound name on the SD card
+  CONTROL_CMD_COUNT,
+};
+
+// Device to host payload types
+enum {
+  CONTROL_REPLY_ACK = 0x80,     // status, commands applied
+  CONTROL_REPLY_LATENCY = 0x81, // per stage: count p50 p90 p99 max, u32 LE
+  CONTROL_REPLY_MIRROR = 0x82,  // unsolicited screen mirror chunk, seq 0
+  CONTROL_REPLY_QOS = 0x83,     // level, transitions frames misses max_us u32
+  CONTROL_REPLY_MEM = 0x84,     // frame_mem_stats_t fields in order, u32 LE
+  CONTROL_REPLY_MIC = 0x85,     // mic_stats_t u32 fields in order, listening
+};
+
+// Mirror chunk: type flags frame_no(u16) x y w h (u16) cost_us(u32), then
+// the rectangle coded as in mirror_codec.h. A frame ends with an empty
+// chunk flagged CONTROL_MIRROR_LAST whose cost_us is the frame's total.
+#define CONTROL_MIRROR_HEADER_SIZE 16
+#define CONTROL_MIRROR_LAST 0x01
+
+enum {
+  CONTROL_STATUS_OK = 0,
+  CONTROL_STATUS_BAD_BATCH = 1, // malformed command list, nothing applied
+  CONTROL_STATUS_FAILED = 2,    // a command was rejected, others applied
+};
+
+typedef struct {
+  uint8_t seq;
+  uint16_t len;
+  const uint8_t *payload; // points into the receive buffer
+} control_frame_t;
+
+typedef struct {
+  uint8_t op;
+  uint16_t len;
+  const uint8_t *args;
+} control_cmd_t;
+
+typedef enum {
+  CONTROL_PARSE_NEED_MORE, // partial frame, keep the bytes
+  CONTROL_PARSE_FRAME,     // *frame is valid
+  CONTROL_PARSE_SKIP,      // garbage or a bad frame was dropped
+} control_parse_t;
+
+uint16_t control_crc16(const uint8_t *data, size_t len, uint16_t crc);
+// Parse the frame at the start of buf without copying. *consumed is how
+// many bytes to drop before the next call.
+control_parse_t control_parse(const uint8_t *buf, size_t len,
+                              control_frame_t *frame, size_t *consumed);
+// Check every command in the batch is known and has the right size
+bool control_batch_valid(const control_frame_t *frame);
+// Iterate a validated batch; pos starts at 0
+bool control_next_cmd(const control_frame_t *frame, size_t *pos,
+                      control_cmd_t *cmd);
+// Write a complete frame into out; returns its size or 0 if it won't fit
+size_t control_encode(uint8_t *out, size_t cap, uint8_t seq,
+                      const uint8_t *payload, uint16_t len);
+
+#endif // CONTROL_PROTO_H
@@ -0,0 +1,73 @@
+#include "eye_actions.h"
+#include "audio_out.h"
+#include "clip_player.h"
+#include "eye_shape.h"
+#include "eye_style.h"
+
+#include <stdio.h>
+
+#include "FluxGarage_RoboEyes.h"
+
+void eye_action_apply(const eye_action_t *action) {
+  switch (action->type) {
+  case EYE_ACTION_MOOD:
+    RoboEyes_setMood(action->arg);
+    break;
+  case EYE_ACTION_POSITION:
+    RoboEyes_setPosition(action->arg);
+    break;
+  case EYE_ACTION_BLINK:
+    RoboEyes_blink();
+    break;
+  case EYE_ACTION_OPEN:
+    RoboEyes_open();
+    break;
+  case EYE_ACTION_CLOSE:
+    RoboEyes_close();
+    break;
+  case EYE_ACTION_CONFUSED:
+    RoboEyes_anim_confused();
+    break;
+  case EYE_ACTION_LAUGH:
+    RoboEyes_anim_laugh();
+    break;
+  case EYE_ACTION_CURIOUS:
+    RoboEyes_setCuriosity(action->arg);
+    break;
+  case EYE_ACTION_CYCLOPS:
+    RoboEyes_setCyclops(action->arg);
+    break;
+  case EYE_ACTION_SWEAT:
+    RoboEyes_setSweat(action->arg);
+    break;
+  case EYE_ACTION_IDLE:
+    RoboEyes_setIdleMode(action->arg);
+    break;
+  case EYE_ACTION_AUTOBLINK:
+    RoboEyes_setAutoblinker(action->arg);
+    break;
+  case EYE_ACTION_STYLE:
+    eye_style_set(action->arg);
+    break;
+  case EYE_ACTION_GAZE:
+    RoboEyes_setNaturalGaze(action->arg);
+    break;
+  case EYE_ACTION_SHAPE:
+    eye_shape_select(action->arg, 300);
+    break;
+  case EYE_ACTION_CLIP: {
+    char name[4];
+    snprintf(name, sizeof(name), "%u", action->arg);
+    clip_player_play(name);
+    break;
+  }
+  case EYE_ACTION_SOUND: {
+    char name[4];
+    snprintf(name, sizeof(name), "%u", action->arg);
+    audio_out_say(name);
+    break;
+  }
+  default:
+    break;
+  }
+}
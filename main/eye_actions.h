@@ -0,0 +1,37 @@
+#ifndef EYE_ACTIONS_H
+#define EYE_ACTIONS_H
+
+#include <stdint.h>
+
+// Small, serialisable description of a RoboEyes call. Input sources
+// (keyboard, scripts, serial) produce these and the render task applies
+// them between frames, so RoboEyes state is only touched from one place.
+typedef enum {
+  EYE_ACTION_NONE = 0,
+  EYE_ACTION_MOOD,      // arg: DEFAULT, TIRED, ANGRY, HAPPY
+  EYE_ACTION_POSITION,  // arg: N..NW, 0 = center
+  EYE_ACTION_BLINK,
+  EYE_ACTION_OPEN,
+  EYE_ACTION_CLOSE,
+  EYE_ACTION_CONFUSED,
+  EYE_ACTION_LAUGH,
+  EYE_ACTION_CURIOUS,   // arg: ON/OFF
+  EYE_ACTION_CYCLOPS,   // arg: ON/OFF
+  EYE_ACTION_SWEAT,     // arg: ON/OFF
+  EYE_ACTION_IDLE,      // arg: ON/OFF
+  EYE_ACTION_AUTOBLINK, // arg: ON/OFF
+  EYE_ACTION_STYLE,     // arg: eye_style_t
+  EYE_ACTION_GAZE,      // arg: ON/OFF natural gaze
+  EYE_ACTION_SHAPE,     // arg: eye_shape_t, morphed to
+  EYE_ACTION_CLIP,      // arg: n, plays clips/<n>.clp from the SD card
+  EYE_ACTION_SOUND,     // arg: n, plays sounds/<n>.wav from the SD card
+} eye_action_type_t;
+
+typedef struct {
+  uint8_t type; // eye_action_type_t
+  uint8_t arg;
+} eye_action_t;
+
+void eye_action_apply(const eye_action_t *action);
+
+#endif // EYE_ACTIONS_H
@@ -0,0 +1,197 @@
+#include "eye_list.h"
+
+#include <stddef.h>
+
+static void grow_bounds(eye_list_t *list, int x1, int y1, int x2, int y2) {
+  if (list->x2 < list->x1) {
+    list->x1 = x1, list->y1 = y1, list->x2 = x2, list->y2 = y2;
+    return;
+  }
+  list->x1 = x1 < list->x1 ? x1 : list->x1;
+  list->y1 = y1 < list->y1 ? y1 : list->y1;
+  list->x2 = x2 > list->x2 ? x2 : list->x2;
+  list->y2 = y2 > list->y2 ? y2 : list->y2;
+}
+
+static eye_prim_t *push(eye_list_t *list, uint8_t kind, uint8_t color) {
+  if (list->count >= EYE_LIST_MAX) {
+    list->dropped++;
+    return NULL;
+  }
+  eye_prim_t *p = &list->prims[list->count++];
+  p->kind = kind;
+  p->color = color;
+  return p;
+}
+
+void eye_list_reset(eye_list_t *list) {
+  list->count = 0;
+  list->x1 = list->y1 = 0;
+  list->x2 = list->y2 = -1;
+}
+
+void eye_list_rect(eye_list_t *list, int x, int y, int w, int h, int r,
+                   uint8_t color) {
+  if (w <= 0 || h <= 0) {
+    return;
+  }
+  eye_prim_t *p = push(list, EYE_PRIM_RECT, color);
+  if (!p) {
+    return;
+  }
+  p->v[0] = x, p->v[1] = y, p->v[2] = w, p->v[3] = h, p->v[4] = r;
+  grow_bounds(list, x, y, x + w - 1, y + h - 1);
+}
+
+void eye_list_triangle(eye_list_t *list, int x0, int y0, int x1, int y1,
+                       int x2, int y2, uint8_t color) {
+  eye_prim_t *p = push(list, EYE_PRIM_TRIANGLE, color);
+  if (!p) {
+    return;
+  }
+  p->v[0] = x0, p->v[1] = y0, p->v[2] = x1;
+  p->v[3] = y1, p->v[4] = x2, p->v[5] = y2;
+  int bx1 = x0 < x1 ? (x0 < x2 ? x0 : x2) : (x1 < x2 ? x1 : x2);
+  int bx2 = x0 > x1 ? (x0 > x2 ? x0 : x2) : (x1 > x2 ? x1 : x2);
+  int by1 = y0 < y1 ? (y0 < y2 ? y0 : y2) : (y1 < y2 ? y1 : y2);
+  int by2 = y0 > y1 ? (y0 > y2 ? y0 : y2) : (y1 > y2 ? y1 : y2);
+  grow_bounds(list, bx1, by1, bx2, by2);
+}
+
+void eye_list_shape(eye_list_t *list, int x, int y, int w, int h,
+                    eye_shape_key_t key, uint8_t color) {
+  if (w <= 0 || h <= 0) {
+    return;
+  }
+  eye_prim_t *p = push(list, EYE_PRIM_SHAPE, color);
+  if (!p) {
+    return;
+  }
+  p->v[0] = x, p->v[1] = y, p->v[2] = w, p->v[3] = h;
+  p->v[4] = key.from | key.to << 8;
+  p->v[5] = key.morph;
+  grow_bounds(list, x, y, x + w - 1, y + h - 1);
+}
+
+bool eye_list_moved_x(const eye_list_t *from, const eye_list_t *to,
+                      int *dx) {
+  if (from->count != to->count || !to->count) {
+    return false;
+  }
+  *dx = to->x1 - from->x1;
+  for (int i = 0; i < to->count; i++) {
+    const eye_prim_t *a = &from->prims[i];
+    const eye_prim_t *b = &to->prims[i];
+    if (a->kind != b->kind || a->color != b->color) {
+      return false;
+    }
+    // x coordinates are v[0] and, for triangles, v[2] and v[4]; a
+    // rectangle leaves v[5] unset
+    int n = a->kind == EYE_PRIM_RECT ? 5 : 6;
+    for (int k = 0; k < n; k++) {
+      bool x = k == 0 || (a->kind == EYE_PRIM_TRIANGLE && !(k & 1));
+      if (b->v[k] - a->v[k] != (x ? *dx : 0)) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+// Inclusive screen box of a primitive as the rasterizer will touch it
+static void prim_box(const eye_prim_t *p, const raster_target_t *t, int *x1,
+                     int *y1, int *x2, int *y2) {
+  const int16_t *v = p->v;
+  if (p->kind != EYE_PRIM_TRIANGLE) {
+    int g = p->kind == EYE_PRIM_RECT && p->color ? t->glow_size : 0;
+    *x1 = v[0] - g;
+    *y1 = v[1] - g;
+    *x2 = v[0] + v[2] - 1 + g;
+    *y2 = v[1] + v[3] - 1 + g;
+    return;
+  }
+  *x1 = *x2 = v[0];
+  *y1 = *y2 = v[1];
+  for (int i = 2; i < 6; i += 2) {
+    *x1 = v[i] < *x1 ? v[i] : *x1;
+    *x2 = v[i] > *x2 ? v[i] : *x2;
+    *y1 = v[i + 1] < *y1 ? v[i + 1] : *y1;
+    *y2 = v[i + 1] > *y2 ? v[i + 1] : *y2;
+  }
+}
+
+// Halve a primitive's screen coordinates, rounding to the nearest half
+// resolution pixel edge so widths are kept on average. A shape is at least
+// one pixel across, or a closing eye would vanish before it is shut.
+static void halve_prim(eye_prim_t *p) {
+  int16_t *v = p->v;
+  if (p->kind == EYE_PRIM_TRIANGLE) {
+    for (int i = 0; i < 6; i++) {
+      v[i] = (v[i] + 1) >> 1;
+    }
+    return;
+  }
+  int x2 = (v[0] + v[2] + 1) >> 1;
+  int y2 = (v[1] + v[3] + 1) >> 1;
+  v[0] = (v[0] + 1) >> 1;
+  v[1] = (v[1] + 1) >> 1;
+  v[2] = x2 > v[0] ? x2 - v[0] : 1;
+  v[3] = y2 > v[1] ? y2 - v[1] : 1;
+  if (p->kind == EYE_PRIM_RECT) {
+    v[4] = (v[4] + 1) >> 1;
+  }
+}
+
+static int draw_prims(const eye_list_t *list, raster_target_t *t, bool half) {
+  int drawn = 0;
+  for (int i = 0; i < list->count; i++) {
+    eye_prim_t q = list->prims[i];
+    const eye_prim_t *p = &q;
+    if (half) {
+      halve_prim(&q);
+    }
+    int x1, y1, x2, y2;
+    prim_box(p, t, &x1, &y1, &x2, &y2);
+    if (x2 < t->x0 || x1 >= t->x0 + t->w || y2 < t->y0 ||
+        y1 >= t->y0 + t->h) {
+      continue;
+    }
+    uint16_t color = p->color ? t->fg : t->bg;
+    const int16_t *v = p->v;
+    if (p->kind == EYE_PRIM_RECT) {
+      raster_round_rect(t, v[0], v[1], v[2], v[3], v[4], color);
+    } else if (p->kind == EYE_PRIM_SHAPE) {
+      eye_shape_key_t key = {.from = v[4] & 0xff, .to = v[4] >> 8,
+                             .morph = v[5]};
+      eye_shape_draw(t, v[0], v[1], v[2], v[3], key, color);
+    } else {
+      raster_triangle(t, v[0], v[1], v[2], v[3], v[4], v[5], color);
+    }
+    drawn++;
+  }
+  return drawn;
+}
+
+int eye_list_render(const eye_list_t *list, raster_target_t *t) {
+  raster_fill(t, t->bg);
+  return draw_prims(list, t, false);
+}
+
+int eye_list_render_half(const eye_list_t *list, raster_target_t *t,
+                         uint16_t *scratch, int scratch_px) {
+  if (!scratch || scratch_px < EYE_LIST_HALF_PX(t->w, t->h)) {
+    return eye_list_render(list, t);
+  }
+  // The half resolution pixels under the window, whatever its parity
+  int x0 = t->x0 >> 1;
+  int y0 = t->y0 >> 1;
+  int w = ((t->x0 + t->w - 1) >> 1) - x0 + 1;
+  int h = ((t->y0 + t->h - 1) >> 1) - y0 + 1;
+  raster_target_t half;
+  raster_set_window(&half, scratch, w, x0, y0, w, h);
+  raster_copy_half(&half, t);
+  raster_fill(&half, half.bg);
+  int drawn = draw_prims(list, &half, true);
+  raster_upscale2x(t, &half);
+  return drawn;
+}
@@ -0,0 +1,60 @@
+#ifndef EYE_LIST_H
+#define EYE_LIST_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "eye_shape.h"
+#include "raster.h"
+
+// Display list of one RoboEyes frame. Recording the primitives instead of
+// drawing them lets the frame be rasterized later, any number of times, into
+// any window of the screen: whole into a frame buffer, or band by band
+// straight into the display driver's draw buffer.
+#define EYE_LIST_MAX 32
+
+typedef enum {
+  EYE_PRIM_RECT,     // v = x, y, w, h, r
+  EYE_PRIM_TRIANGLE, // v = x0, y0, x1, y1, x2, y2
+  EYE_PRIM_SHAPE,    // v = x, y, w, h, from | to << 8, morph
+} eye_prim_kind_t;
+
+typedef struct {
+  uint8_t kind;
+  uint8_t color; // RoboEyes colour: 0 background, else main
+  int16_t v[6];
+} eye_prim_t;
+
+typedef struct {
+  eye_prim_t prims[EYE_LIST_MAX];
+  uint8_t count;
+  uint16_t dropped; // primitives that did not fit, ever
+  // Bounding box of everything recorded, glow excluded; x2 < x1 when empty
+  int16_t x1, y1, x2, y2;
+} eye_list_t;
+
+// Start a frame; the background fill is implied
+void eye_list_reset(eye_list_t *list);
+void eye_list_rect(eye_list_t *list, int x, int y, int w, int h, int r,
+                   uint8_t color);
+void eye_list_triangle(eye_list_t *list, int x0, int y0, int x1, int y1,
+                       int x2, int y2, uint8_t color);
+// Eye shape stretched over a rectangle; shapes are not glowed
+void eye_list_shape(eye_list_t *list, int x, int y, int w, int h,
+                    eye_shape_key_t key, uint8_t color);
+// Fill the target's window with its background, then draw the primitives
+// that touch the window, glow included, in the target's colours and style.
+// Returns the number drawn.
+int eye_list_render(const eye_list_t *list, raster_target_t *t);
+// Whether to holds the same primitives as from, all moved dx along x
+bool eye_list_moved_x(const eye_list_t *from, const eye_list_t *to, int *dx);
+// Pixels of scratch eye_list_render_half() needs for a w x h window
+#define EYE_LIST_HALF_PX(w, h) (((w) / 2 + 2) * ((h) / 2 + 2))
+// eye_list_render() at half resolution, for frames in fast motion: the
+// primitives are halved and drawn into scratch, then every pixel is doubled
+// into the target's window. A scratch smaller than EYE_LIST_HALF_PX() of
+// the window falls back to full resolution.
+int eye_list_render_half(const eye_list_t *list, raster_target_t *t,
+                         uint16_t *scratch, int scratch_px);
+
+#endif // EYE_LIST_H
@@ -0,0 +1,326 @@
+#include "eye_shape.h"
+
+#include <math.h>
+#include <string.h>
+
+#define SDF_MAX_OPS 24
+#define SDF_STACK 8
+
+enum { TILE_EMPTY, TILE_FULL, TILE_EDGE };
+
+typedef struct {
+  eye_shape_key_t key;
+  bool valid;
+  uint32_t last_use;
+  uint8_t kind[EYE_SHAPE_TILES * EYE_SHAPE_TILES];
+  uint64_t bits[EYE_SHAPE_TILES * EYE_SHAPE_TILES]; // edge tiles, row major
+} eye_mask_t;
+
+// Decoded program: parameters as floats, plane normals unit length
+typedef struct {
+  uint8_t op;
+  float p[5];
+} sdf_node_t;
+
+#define OP(op, ...)                                                            \
+  { EYE_SDF_##op, {__VA_ARGS__} }
+
+// Stand-in for RoboEyes' rectangle when morphing from or to it
+static const eye_sdf_op_t shape_round[] = {
+    OP(BOX, 0, 0, 64, 64, 28),
+    OP(END),
+};
+
+static const eye_sdf_op_t shape_heart[] = {
+    OP(CIRCLE, -28, -22, 36), OP(CIRCLE, 28, -22, 36), OP(UNION),
+    OP(PLANE, -70, 61, 40),   OP(PLANE, 70, 61, 40),   OP(INTERSECT),
+    OP(PLANE, 0, -64, 10),    OP(INTERSECT),           OP(UNION),
+    OP(END),
+};
+
+// Four pointed sparkle: two rhombi
+static const eye_sdf_op_t shape_star[] = {
+    OP(PLANE, 64, 24, 26),   OP(PLANE, -64, 24, 26),  OP(INTERSECT),
+    OP(PLANE, 64, -24, 26),  OP(INTERSECT),           OP(PLANE, -64, -24, 26),
+    OP(INTERSECT),           OP(PLANE, 24, 64, 26),   OP(PLANE, -24, 64, 26),
+    OP(INTERSECT),           OP(PLANE, 24, -64, 26),  OP(INTERSECT),
+    OP(PLANE, -24, -64, 26), OP(INTERSECT),           OP(UNION),
+    OP(END),
+};
+
+static const eye_sdf_op_t shape_crescent[] = {
+    OP(CIRCLE, 0, 0, 62),
+    OP(CIRCLE, 24, -22, 50),
+    OP(SUBTRACT),
+    OP(END),
+};
+
+static const eye_sdf_op_t shape_cross[] = {
+    OP(SEGMENT, -44, -44, 44, 44, 14),
+    OP(SEGMENT, -44, 44, 44, -44, 14),
+    OP(UNION),
+    OP(END),
+};
+
+static const eye_sdf_op_t *const shape_programs[EYE_SHAPE_COUNT] = {
+    [EYE_SHAPE_NONE] = shape_round,     [EYE_SHAPE_HEART] = shape_heart,
+    [EYE_SHAPE_STAR] = shape_star,      [EYE_SHAPE_CRESCENT] = shape_crescent,
+    [EYE_SHAPE_CROSS] = shape_cross,
+};
+
+static eye_mask_t masks[EYE_SHAPE_SLOTS];
+static uint32_t use_clock;
+static eye_shape_stats_t stats;
+
+// Morph in progress, or settled when from == to
+static uint8_t shape_from = EYE_SHAPE_NONE;
+static uint8_t shape_to = EYE_SHAPE_NONE;
+static uint32_t morph_start;
+static uint32_t morph_duration;
+static bool morph_pending; // starts on the next eye_shape_current()
+static uint8_t morph_last; // step drawn last
+
+static int decode(const eye_sdf_op_t *prog, sdf_node_t *out) {
+  int n = 0;
+  for (; prog[n].op != EYE_SDF_END && n < SDF_MAX_OPS; n++) {
+    out[n].op = prog[n].op;
+    for (int i = 0; i < 5; i++) {
+      out[n].p[i] = prog[n].p[i] / 64.0f;
+    }
+    if (out[n].op == EYE_SDF_PLANE) {
+      float l = sqrtf(out[n].p[0] * out[n].p[0] + out[n].p[1] * out[n].p[1]);
+      out[n].p[0] /= l;
+      out[n].p[1] /= l;
+    }
+  }
+  return n;
+}
+
+static float eval(const sdf_node_t *prog, int n, float u, float v) {
+  float st[SDF_STACK];
+  int sp = 0;
+  for (int i = 0; i < n; i++) {
+    const float *p = prog[i].p;
+    float d;
+    switch (prog[i].op) {
+    case EYE_SDF_CIRCLE:
+      d = sqrtf((u - p[0]) * (u - p[0]) + (v - p[1]) * (v - p[1])) - p[2];
+      break;
+    case EYE_SDF_BOX: {
+      float qx = fabsf(u - p[0]) - (p[2] - p[4]);
+      float qy = fabsf(v - p[1]) - (p[3] - p[4]);
+      float ox = fmaxf(qx, 0), oy = fmaxf(qy, 0);
+      d = sqrtf(ox * ox + oy * oy) + fminf(fmaxf(qx, qy), 0) - p[4];
+      break;
+    }
+    case EYE_SDF_SEGMENT: {
+      float px = u - p[0], py = v - p[1];
+      float dx = p[2] - p[0], dy = p[3] - p[1];
+      float h = (px * dx + py * dy) / (dx * dx + dy * dy);
+      h = fminf(fmaxf(h, 0), 1);
+      px -= dx * h;
+      py -= dy * h;
+      d = sqrtf(px * px + py * py) - p[4];
+      break;
+    }
+    case EYE_SDF_PLANE:
+      d = u * p[0] + v * p[1] - p[2];
+      break;
+    default: // combiners
+      if (sp < 2) {
+        return 1.0f;
+      }
+      sp--;
+      if (prog[i].op == EYE_SDF_UNION) {
+        st[sp - 1] = fminf(st[sp - 1], st[sp]);
+      } else if (prog[i].op == EYE_SDF_SUBTRACT) {
+        st[sp - 1] = fmaxf(st[sp - 1], -st[sp]);
+      } else {
+        st[sp - 1] = fmaxf(st[sp - 1], st[sp]);
+      }
+      continue;
+    }
+    if (sp == SDF_STACK) {
+      return 1.0f;
+    }
+    st[sp++] = d;
+  }
+  return sp ? st[0] : 1.0f;
+}
+
+typedef struct {
+  sdf_node_t a[SDF_MAX_OPS];
+  sdf_node_t b[SDF_MAX_OPS];
+  int na, nb;
+  float m; // weight of b
+} morph_t;
+
+static float eval_morph(const morph_t *s, float u, float v) {
+  float d = eval(s->a, s->na, u, v);
+  if (s->m > 0) {
+    d += (eval(s->b, s->nb, u, v) - d) * s->m;
+  }
+  return d;
+}
+
+// Pixel centre to -1..1
+static float mask_coord(float px) {
+  return (px + 0.5f) * (2.0f / EYE_SHAPE_RES) - 1.0f;
+}
+
+static void rasterize(eye_mask_t *mask, eye_shape_key_t key) {
+  static morph_t s; // large for the stack; only used from the render task
+  s.na = decode(shape_programs[key.from], s.a);
+  s.nb = decode(shape_programs[key.to], s.b);
+  s.m = (float)key.morph / EYE_SHAPE_MORPH_STEPS;
+
+  // Blends and combinations of distance fields change by at most the
+  // distance moved, so a centre further from the edge than the farthest
+  // pixel centre of its tile settles the whole tile
+  const float reach =
+      (EYE_SHAPE_TILE - 1) * 0.5f * 1.4143f * (2.0f / EYE_SHAPE_RES);
+  for (int ty = 0; ty < EYE_SHAPE_TILES; ty++) {
+    for (int tx = 0; tx < EYE_SHAPE_TILES; tx++) {
+      int i = ty * EYE_SHAPE_TILES + tx;
+      float c = (EYE_SHAPE_TILE - 1) * 0.5f;
+      float d = eval_morph(&s, mask_coord(tx * EYE_SHAPE_TILE + c),
+                           mask_coord(ty * EYE_SHAPE_TILE + c));
+      if (d > reach || d < -reach) {
+        mask->kind[i] = d > 0 ? TILE_EMPTY : TILE_FULL;
+        stats.tiles_solid++;
+        continue;
+      }
+      uint64_t bits = 0;
+      for (int y = 0; y < EYE_SHAPE_TILE; y++) {
+        float v = mask_coord(ty * EYE_SHAPE_TILE + y);
+        for (int x = 0; x < EYE_SHAPE_TILE; x++) {
+          if (eval_morph(&s, mask_coord(tx * EYE_SHAPE_TILE + x), v) <= 0) {
+            bits |= 1ULL << (y * EYE_SHAPE_TILE + x);
+          }
+        }
+      }
+      mask->kind[i] = !bits ? TILE_EMPTY : (~bits ? TILE_EDGE : TILE_FULL);
+      mask->bits[i] = bits;
+      stats.tiles_edge++;
+    }
+  }
+  stats.rasterizations++;
+}
+
+static const eye_mask_t *mask_lookup(eye_shape_key_t key) {
+  // Settled shapes share one mask whatever the morph says
+  if (key.morph == 0 || key.from == key.to) {
+    key.to = key.from;
+    key.morph = 0;
+  } else if (key.morph >= EYE_SHAPE_MORPH_STEPS) {
+    key.from = key.to;
+    key.morph = 0;
+  }
+
+  eye_mask_t *victim = &masks[0];
+  use_clock++;
+  for (int i = 0; i < EYE_SHAPE_SLOTS; i++) {
+    eye_mask_t *m = &masks[i];
+    if (m->valid && !memcmp(&m->key, &key, sizeof(key))) {
+      m->last_use = use_clock;
+      stats.hits++;
+      return m;
+    }
+    if (!m->valid || (victim->valid && m->last_use < victim->last_use)) {
+      victim = m;
+    }
+  }
+  rasterize(victim, key);
+  victim->key = key;
+  victim->valid = true;
+  victim->last_use = use_clock;
+  return victim;
+}
+
+bool eye_shape_select(eye_shape_t shape, uint32_t duration_ms) {
+  if (shape >= EYE_SHAPE_COUNT) {
+    return false;
+  }
+  // Interrupting a morph: go on from whichever end it was closer to
+  if (shape_from != shape_to && morph_last * 2 >= EYE_SHAPE_MORPH_STEPS) {
+    shape_from = shape_to;
+  }
+  shape_to = shape;
+  morph_duration = duration_ms;
+  morph_pending = true;
+  if (!duration_ms) {
+    shape_from = shape;
+  }
+  return true;
+}
+
+bool eye_shape_current(uint32_t now_ms, eye_shape_key_t *key) {
+  if (morph_pending) {
+    morph_start = now_ms;
+    morph_pending = false;
+  }
+  uint32_t t = now_ms - morph_start;
+  if (shape_from != shape_to && t >= morph_duration) {
+    shape_from = shape_to;
+  }
+  morph_last = shape_from == shape_to
+                   ? 0
+                   : t * EYE_SHAPE_MORPH_STEPS / morph_duration;
+  key->from = shape_from;
+  key->to = shape_to;
+  key->morph = morph_last;
+  return shape_from != EYE_SHAPE_NONE || shape_to != EYE_SHAPE_NONE;
+}
+
+void eye_shape_draw(raster_target_t *t, int x, int y, int w, int h,
+                    eye_shape_key_t key, uint16_t color) {
+  if (w <= 0 || h <= 0 || key.from >= EYE_SHAPE_COUNT ||
+      key.to >= EYE_SHAPE_COUNT) {
+    return;
+  }
+  const eye_mask_t *mask = mask_lookup(key);
+  x -= t->x0;
+  y -= t->y0;
+  int cy0 = y < 0 ? 0 : y;
+  int cy1 = y + h > t->h ? t->h : y + h;
+  int cx0 = x < 0 ? 0 : x;
+  int cx1 = x + w > t->w ? t->w : x + w;
+  if (cx0 >= cx1 || cy0 >= cy1) {
+    return;
+  }
+
+  // Screen columns each tile column covers, nearest neighbour scaling
+  int tile_x[EYE_SHAPE_TILES + 1];
+  for (int i = 0; i <= EYE_SHAPE_TILES; i++) {
+    int sx = x + (i * EYE_SHAPE_TILE * w + EYE_SHAPE_RES - 1) / EYE_SHAPE_RES;
+    tile_x[i] = sx < cx0 ? cx0 : (sx > cx1 ? cx1 : sx);
+  }
+
+  bool styled = color == t->fg && t->gradient;
+  for (int py = cy0; py < cy1; py++) {
+    uint16_t *row = t->buf + py * t->stride;
+    int ry = py - y;
+    int my = ry * EYE_SHAPE_RES / h;
+    const uint8_t *kind = mask->kind + (my / EYE_SHAPE_TILE) * EYE_SHAPE_TILES;
+    const uint64_t *bits = mask->bits + (kind - mask->kind);
+    int shift = (my % EYE_SHAPE_TILE) * EYE_SHAPE_TILE;
+    uint16_t rc = color;
+    if (styled) {
+      rc = t->rows[h > 1 ? ry * (RASTER_GRADIENT_STEPS - 1) / (h - 1) : 0];
+    }
+    for (int tc = 0; tc < EYE_SHAPE_TILES; tc++) {
+      if (kind[tc] == TILE_EMPTY) {
+        continue;
+      }
+      uint8_t line = bits[tc] >> shift;
+      for (int px = tile_x[tc]; px < tile_x[tc + 1]; px++) {
+        int mx = (px - x) * EYE_SHAPE_RES / w;
+        if (kind[tc] == TILE_FULL || (line >> (mx % EYE_SHAPE_TILE)) & 1) {
+          row[px] = rc;
+        }
+      }
+    }
+  }
+}
+
+void eye_shape_get_stats(eye_shape_stats_t *out) { *out = stats; }
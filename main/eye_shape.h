@@ -0,0 +1,76 @@
+#ifndef EYE_SHAPE_H
+#define EYE_SHAPE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "raster.h"
+
+// Eye shapes as small signed distance field programs, evaluated in a
+// -1..1 box (y down) that is stretched over the eye's rectangle. A program
+// is a postfix list: leaves push a distance, combiners pop two. Morphing
+// blends two programs' distances, which keeps the result a valid shape.
+//
+// Programs are rasterized into 1 bpp masks of EYE_SHAPE_RES squared, split
+// into 8x8 tiles. A tile whose centre is far enough from the edge is marked
+// empty or full from that one evaluation; only edge tiles store bits. Masks
+// stay in a small LRU keyed by shape pair and morph step, so they are only
+// rasterized again when the parameters change, not when the eye blinks.
+#define EYE_SHAPE_RES 64
+#define EYE_SHAPE_TILE 8
+#define EYE_SHAPE_TILES (EYE_SHAPE_RES / EYE_SHAPE_TILE) // per side
+#define EYE_SHAPE_SLOTS 4
+#define EYE_SHAPE_MORPH_STEPS 16
+
+typedef enum {
+  EYE_SDF_END,
+  EYE_SDF_CIRCLE,    // cx, cy, r
+  EYE_SDF_BOX,       // cx, cy, half width, half height, corner radius
+  EYE_SDF_SEGMENT,   // ax, ay, bx, by, r: a capsule
+  EYE_SDF_PLANE,     // nx, ny, d: inside where n . p <= d, n normalized
+  EYE_SDF_UNION,     // a or b
+  EYE_SDF_SUBTRACT,  // a but not b
+  EYE_SDF_INTERSECT, // a and b
+} eye_sdf_opcode_t;
+
+typedef struct {
+  uint8_t op;  // eye_sdf_opcode_t
+  int8_t p[5]; // in 1/64 of the half box
+} eye_sdf_op_t;
+
+typedef enum {
+  EYE_SHAPE_NONE, // RoboEyes' own rounded rectangles
+  EYE_SHAPE_HEART,
+  EYE_SHAPE_STAR,
+  EYE_SHAPE_CRESCENT,
+  EYE_SHAPE_CROSS,
+  EYE_SHAPE_COUNT,
+} eye_shape_t;
+
+// Shape drawn this frame: from, blended towards to by morph steps
+typedef struct {
+  uint8_t from; // eye_shape_t
+  uint8_t to;
+  uint8_t morph; // 0..EYE_SHAPE_MORPH_STEPS
+} eye_shape_key_t;
+
+typedef struct {
+  uint32_t rasterizations; // masks built
+  uint32_t hits;           // lookups served from the cache
+  uint32_t tiles_solid;    // tiles settled by their centre alone
+  uint32_t tiles_edge;     // tiles evaluated per pixel
+} eye_shape_stats_t;
+
+// Morph to a shape over duration_ms from the next frame on, 0 to switch at
+// once. False if the shape is unknown.
+bool eye_shape_select(eye_shape_t shape, uint32_t duration_ms);
+// Shape to draw for the frame at now_ms; false while the eyes are plain
+// rounded rectangles. Call from the render task.
+bool eye_shape_current(uint32_t now_ms, eye_shape_key_t *key);
+// Fill the shape stretched over the w x h rectangle at x, y, clipped to the
+// target, with the target's gradient for the main colour
+void eye_shape_draw(raster_target_t *t, int x, int y, int w, int h,
+                    eye_shape_key_t key, uint16_t color);
+void eye_shape_get_stats(eye_shape_stats_t *stats);
+
+#endif // EYE_SHAPE_H
@@ -0,0 +1,36 @@
+#include "eye_snapshot.h"
+
+#include "FluxGarage_RoboEyes.h"
+
+#include "esp_attr.h"
+#include "esp_log.h"
+#include "esp_rom_crc.h"
+#include "esp_sleep.h"
+
+static const char *TAG = "eye_snapshot";
+
+// RTC slow memory survives deep sleep but not a power cycle or a flash
+static RTC_DATA_ATTR RoboEyesSnapshot rtc_snapshot;
+static RTC_DATA_ATTR uint32_t rtc_crc;
+
+static uint32_t snapshot_crc(void) {
+  return esp_rom_crc32_le(0, (const uint8_t *)&rtc_snapshot,
+                          sizeof(rtc_snapshot));
+}
+
+void eye_snapshot_save(void) {
+  RoboEyes_saveState(&rtc_snapshot);
+  rtc_crc = snapshot_crc();
+}
+
+bool eye_snapshot_restore(void) {
+  if (esp_sleep_get_wakeup_cause() == ESP_SLEEP_WAKEUP_UNDEFINED) {
+    return false;
+  }
+  if (rtc_crc != snapshot_crc() || !RoboEyes_restoreState(&rtc_snapshot)) {
+    ESP_LOGW(TAG, "no usable snapshot, starting fresh");
+    return false;
+  }
+  ESP_LOGI(TAG, "restored mood %u", rtc_snapshot.mood);
+  return true;
+}
@@ -0,0 +1,13 @@
+#ifndef EYE_SNAPSHOT_H
+#define EYE_SNAPSHOT_H
+
+#include <stdbool.h>
+
+// The RoboEyes state kept in RTC memory over deep sleep, so a wake comes
+// back to the expression the eyes went to sleep with.
+void eye_snapshot_save(void);
+// After RoboEyes_begin() and the usual setup: take over the saved state if
+// the chip woke from deep sleep with a valid snapshot. False on a cold boot.
+bool eye_snapshot_restore(void);
+
+#endif // EYE_SNAPSHOT_H
@@ -0,0 +1,67 @@
+#include "eye_style.h"
+
+#include <stddef.h>
+
+static raster_target_t *g_target;
+static eye_style_t g_style;
+static bool g_flat;
+
+// RGB565 helpers for the presets, 8-bit channels in
+#define RGB565(r, g, b) ((((r) >> 3) << 11) | (((g) >> 2) << 5) | ((b) >> 3))
+
+void eye_style_init(raster_target_t *target) {
+  g_target = target;
+  eye_style_set(EYE_STYLE_FLAT);
+}
+
+static void eye_style_apply(eye_style_t style) {
+  const uint16_t fg = g_target->fg;
+  raster_style_t s = {.top = fg, .bottom = fg, .glow = fg};
+  switch (style) {
+  case EYE_STYLE_FLAT:
+    break;
+  case EYE_STYLE_GRADIENT:
+    s.top = RGB565(40, 120, 255);
+    s.bottom = RGB565(0, 0, 90);
+    break;
+  case EYE_STYLE_GLOW:
+    s.glow_size = 6;
+    s.glow_level = 10;
+    break;
+  case EYE_STYLE_NEON:
+    s.top = RGB565(120, 220, 255);
+    s.bottom = RGB565(0, 60, 200);
+    s.glow = RGB565(0, 120, 255);
+    s.glow_size = 8;
+    s.glow_level = 9;
+    break;
+  default:
+    break;
+  }
+  raster_set_style(g_target, &s);
+}
+
+bool eye_style_set(eye_style_t style) {
+  if (!g_target || style >= EYE_STYLE_COUNT) {
+    return false;
+  }
+  g_style = style;
+  eye_style_apply(g_flat ? EYE_STYLE_FLAT : style);
+  return true;
+}
+
+void eye_style_force_flat(bool on) {
+  if (on == g_flat) {
+    return;
+  }
+  g_flat = on;
+  if (g_target) {
+    eye_style_apply(on ? EYE_STYLE_FLAT : g_style);
+  }
+}
+
+void eye_style_refresh(void) {
+  if (g_target) {
+    eye_style_apply(g_flat ? EYE_STYLE_FLAT : g_style);
+  }
+}
@@ -0,0 +1,25 @@
+#ifndef EYE_STYLE_H
+#define EYE_STYLE_H
+
+#include <stdbool.h>
+
+#include "raster.h"
+
+typedef enum {
+  EYE_STYLE_FLAT,     // single main colour
+  EYE_STYLE_GRADIENT, // lighter at the top, darker at the bottom
+  EYE_STYLE_GLOW,     // flat with an outer glow
+  EYE_STYLE_NEON,     // gradient and glow
+  EYE_STYLE_COUNT,
+} eye_style_t;
+
+// Target whose main colour shapes get styled; its colours must be set
+void eye_style_init(raster_target_t *target);
+// Precompute the tables for a style; false if it is unknown
+bool eye_style_set(eye_style_t style);
+// Draw flat while on, whatever style is set; the set style comes back after
+void eye_style_force_flat(bool on);
+// Rebuild the style's tables after the target's colours changed
+void eye_style_refresh(void);
+
+#endif // EYE_STYLE_H
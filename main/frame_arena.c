@@ -0,0 +1,81 @@
+#include "frame_arena.h"
+
+// Each allocation is preceded by its size, padded to keep the alignment
+#define HEADER FRAME_ARENA_ALIGN
+
+static size_t align_up(size_t n) {
+  return (n + FRAME_ARENA_ALIGN - 1) & ~(size_t)(FRAME_ARENA_ALIGN - 1);
+}
+
+void frame_arena_init(frame_arena_t *a, void *mem, size_t size) {
+  *a = (frame_arena_t){.base = mem, .size = size};
+}
+
+void frame_arena_begin(frame_arena_t *a) { a->open = true; }
+
+bool frame_arena_end(frame_arena_t *a) {
+  a->open = false;
+  a->frames++;
+  if (a->live) {
+    a->pinned_frames++;
+    return false;
+  }
+  return true;
+}
+
+static void note_use(frame_arena_t *a) {
+  if (a->used > a->high_water) {
+    a->high_water = a->used;
+  }
+}
+
+void *frame_arena_alloc(frame_arena_t *a, size_t size) {
+  if (!a->open) {
+    return NULL;
+  }
+  size_t need = HEADER + align_up(size);
+  if (need > a->size - a->used) {
+    a->overflows++;
+    return NULL;
+  }
+  uint8_t *p = a->base + a->used + HEADER;
+  *(size_t *)(p - HEADER) = size;
+  a->last = a->used;
+  a->used += need;
+  a->live++;
+  a->allocs++;
+  note_use(a);
+  return p;
+}
+
+bool frame_arena_resize(frame_arena_t *a, void *p, size_t size) {
+  size_t at = (uint8_t *)p - HEADER - a->base;
+  if (!a->open || at != a->last || at >= a->used) {
+    return false;
+  }
+  size_t need = HEADER + align_up(size);
+  if (need > a->size - at) {
+    return false;
+  }
+  *(size_t *)((uint8_t *)p - HEADER) = size;
+  a->used = at + need;
+  note_use(a);
+  return true;
+}
+
+bool frame_arena_owns(const frame_arena_t *a, const void *p) {
+  const uint8_t *b = p;
+  return b >= a->base && b < a->base + a->size;
+}
+
+size_t frame_arena_size(const void *p) {
+  return *(const size_t *)((const uint8_t *)p - HEADER);
+}
+
+void frame_arena_free(frame_arena_t *a, void *p) {
+  (void)p; // only counted
+  if (a->live && --a->live == 0) {
+    // Nothing left to keep: start over, mid-frame too
+    a->used = 0;
+  }
+}
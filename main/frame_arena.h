@@ -0,0 +1,45 @@
+#ifndef FRAME_ARENA_H
+#define FRAME_ARENA_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Frame scoped bump allocator. While a frame is open allocations are cut in
+// order from one block; a free only counts, and the whole block is reused
+// from the start once nothing in it is live, at the latest when the frame
+// ends. Something still allocated then pins the arena: it is not reset, so
+// the allocation stays valid, until that is freed. Requests that do not fit
+// return NULL for the caller to take from the heap.
+#define FRAME_ARENA_ALIGN 8
+
+typedef struct {
+  uint8_t *base;
+  size_t size;
+  size_t used;
+  size_t last;   // offset of the newest allocation, for resizing in place
+  uint32_t live; // allocations not freed yet
+  bool open;
+  // Stats
+  size_t high_water; // most bytes in use at once, headers included
+  uint32_t allocs;
+  uint32_t overflows;     // did not fit, left to the heap
+  uint32_t frames;        // frames ended
+  uint32_t pinned_frames; // ended with live allocations, not reset
+} frame_arena_t;
+
+// mem must be FRAME_ARENA_ALIGN aligned
+void frame_arena_init(frame_arena_t *a, void *mem, size_t size);
+void frame_arena_begin(frame_arena_t *a);
+// Close the frame and reset unless pinned; returns false if pinned
+bool frame_arena_end(frame_arena_t *a);
+// NULL outside a frame or if size does not fit
+void *frame_arena_alloc(frame_arena_t *a, size_t size);
+// Grow or shrink p without moving it; only the newest allocation can
+bool frame_arena_resize(frame_arena_t *a, void *p, size_t size);
+bool frame_arena_owns(const frame_arena_t *a, const void *p);
+// Size p was allocated or last resized with
+size_t frame_arena_size(const void *p);
+void frame_arena_free(frame_arena_t *a, void *p);
+
+#endif // FRAME_ARENA_H
@@ -0,0 +1,118 @@
+#include "frame_mem.h"
+#include "frame_arena.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "lvgl/lvgl.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "esp_heap_caps.h"
+
+#define FRAME_MEM_ARENA_SIZE (8 * 1024)
+
+static uint8_t g_mem[FRAME_MEM_ARENA_SIZE]
+    __attribute__((aligned(FRAME_ARENA_ALIGN)));
+static frame_arena_t g_arena = {.base = g_mem, .size = sizeof(g_mem)};
+static TaskHandle_t g_owner; // the render task, the only arena user
+static uint32_t g_heap_allocs;
+
+void frame_mem_begin(void) {
+  g_owner = xTaskGetCurrentTaskHandle();
+  frame_arena_begin(&g_arena);
+}
+
+void frame_mem_end(void) { frame_arena_end(&g_arena); }
+
+void frame_mem_get_stats(frame_mem_stats_t *stats) {
+  multi_heap_info_t info;
+  heap_caps_get_info(&info, MALLOC_CAP_INTERNAL);
+  *stats = (frame_mem_stats_t){
+      .arena_size = g_arena.size,
+      .arena_high_water = g_arena.high_water,
+      .arena_allocs = g_arena.allocs,
+      .heap_allocs = g_heap_allocs,
+      .overflows = g_arena.overflows,
+      .pinned_frames = g_arena.pinned_frames,
+      .heap_free = info.total_free_bytes,
+      .heap_min_free = info.minimum_free_bytes,
+      .heap_largest = info.largest_free_block,
+  };
+}
+
+#if LV_USE_STDLIB_MALLOC == LV_STDLIB_CUSTOM
+// LVGL's core allocator hooks; lv_malloc() and friends call these
+
+static void *arena_alloc(size_t size) {
+  if (xTaskGetCurrentTaskHandle() == g_owner) {
+    void *p = frame_arena_alloc(&g_arena, size);
+    if (p) {
+      return p;
+    }
+  }
+  g_heap_allocs++;
+  return malloc(size);
+}
+
+void lv_mem_init(void) {}
+
+void lv_mem_deinit(void) {}
+
+lv_mem_pool_t lv_mem_add_pool(void *mem, size_t bytes) { return NULL; }
+
+void lv_mem_remove_pool(lv_mem_pool_t pool) {}
+
+void *lv_malloc_core(size_t size) { return arena_alloc(size); }
+
+void *lv_realloc_core(void *p, size_t new_size) {
+  if (!p) {
+    return arena_alloc(new_size);
+  }
+  if (!frame_arena_owns(&g_arena, p)) {
+    return realloc(p, new_size);
+  }
+  if (frame_arena_resize(&g_arena, p, new_size)) {
+    return p;
+  }
+  void *q = arena_alloc(new_size);
+  if (q) {
+    size_t old = frame_arena_size(p);
+    memcpy(q, p, old < new_size ? old : new_size);
+    frame_arena_free(&g_arena, p);
+  }
+  return q;
+}
+
+void lv_free_core(void *p) {
+  if (frame_arena_owns(&g_arena, p)) {
+    frame_arena_free(&g_arena, p);
+  } else {
+    free(p);
+  }
+}
+
+void lv_mem_monitor_core(lv_mem_monitor_t *mon_p) {
+  multi_heap_info_t info;
+  heap_caps_get_info(&info, MALLOC_CAP_INTERNAL);
+  size_t total = info.total_free_bytes + info.total_allocated_bytes;
+  mon_p->total_size = total;
+  mon_p->free_size = info.total_free_bytes;
+  mon_p->free_biggest_size = info.largest_free_block;
+  mon_p->free_cnt = info.free_blocks;
+  mon_p->used_cnt = info.allocated_blocks;
+  mon_p->max_used = total - info.minimum_free_bytes;
+  mon_p->used_pct = total ? 100 - info.total_free_bytes * 100 / total : 0;
+  mon_p->frag_pct =
+      info.total_free_bytes
+          ? 100 - info.largest_free_block * 100 / info.total_free_bytes
+          : 0;
+}
+
+lv_result_t lv_mem_test_core(void) {
+  return heap_caps_check_integrity(MALLOC_CAP_INTERNAL, false)
+             ? LV_RESULT_OK
+             : LV_RESULT_INVALID;
+}
+#endif
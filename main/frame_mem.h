@@ -0,0 +1,26 @@
+#ifndef FRAME_MEM_H
+#define FRAME_MEM_H
+
+#include <stdint.h>
+
+typedef struct {
+  uint32_t arena_size;
+  uint32_t arena_high_water; // bytes, headers included
+  uint32_t arena_allocs;     // LVGL allocations the arena served
+  uint32_t heap_allocs;      // LVGL allocations that went to the heap
+  uint32_t overflows;        // in a frame but did not fit the arena
+  uint32_t pinned_frames;    // frames that ended with arena memory live
+  uint32_t heap_free;        // internal heap, now
+  uint32_t heap_min_free;    // internal heap low-water mark since boot
+  uint32_t heap_largest;     // largest free internal block
+} frame_mem_stats_t;
+
+// LVGL's allocator, with CONFIG_LV_USE_CUSTOM_MALLOC: what the render task
+// allocates between frame_mem_begin() and frame_mem_end() (draw tasks,
+// descriptors, layers) comes from a frame arena, the rest from the heap.
+// With another LVGL allocator these only keep the stats.
+void frame_mem_begin(void);
+void frame_mem_end(void);
+void frame_mem_get_stats(frame_mem_stats_t *stats);
+
+#endif // FRAME_MEM_H
@@ -0,0 +1,80 @@
+#include "glyph_atlas.h"
+#include "font5x7.h"
+
+#include <string.h>
+
+#define GLYPH_COUNT (FONT5X7_LAST - FONT5X7_FIRST + 1)
+
+static uint16_t atlas_small[GLYPH_COUNT][GLYPH_CELL_H(GLYPH_SIZE_SMALL)];
+static uint16_t atlas_large[GLYPH_COUNT][GLYPH_CELL_H(GLYPH_SIZE_LARGE)];
+
+// Spread the low 8 bits of v so each bit covers two
+static uint16_t double_bits(uint16_t v) {
+  uint16_t out = 0;
+  for (int i = 0; i < 8; i++) {
+    out |= ((v >> i) & 1) * (3 << (2 * i));
+  }
+  return out;
+}
+
+void glyph_atlas_init(void) {
+  for (int g = 0; g < GLYPH_COUNT; g++) {
+    for (int row = 0; row < GLYPH_CELL_H(GLYPH_SIZE_SMALL); row++) {
+      uint16_t mask = 0;
+      for (int col = 0; col < FONT5X7_WIDTH; col++) {
+        mask |= ((font5x7[g][col] >> row) & 1) << col;
+      }
+      atlas_small[g][row] = mask;
+      atlas_large[g][row * 2] = double_bits(mask);
+      atlas_large[g][row * 2 + 1] = atlas_large[g][row * 2];
+    }
+  }
+}
+
+size_t glyph_atlas_footprint(glyph_size_t size) {
+  return size == GLYPH_SIZE_SMALL ? sizeof(atlas_small) : sizeof(atlas_large);
+}
+
+int glyph_text_width(const char *text, glyph_size_t size) {
+  return strlen(text) * GLYPH_CELL_W(size);
+}
+
+static const uint16_t *glyph_rows(char c, glyph_size_t size) {
+  if (c < FONT5X7_FIRST || c > FONT5X7_LAST) {
+    c = '?';
+  }
+  int g = c - FONT5X7_FIRST;
+  return size == GLYPH_SIZE_SMALL ? atlas_small[g] : atlas_large[g];
+}
+
+int glyph_draw_run(uint16_t *buf, int stride, int w, int h, int x, int y,
+                   const char *text, glyph_size_t size, uint16_t fg,
+                   uint16_t bg) {
+  const int cw = GLYPH_CELL_W(size);
+  const int ch = GLYPH_CELL_H(size);
+  const uint16_t diff = fg ^ bg;
+
+  int row0 = y < 0 ? -y : 0;
+  int row1 = y + ch > h ? h - y : ch;
+  int drawn = 0;
+
+  for (; *text && x < w; text++, x += cw) {
+    if (x + cw <= 0) {
+      continue;
+    }
+    int col0 = x < 0 ? -x : 0;
+    int col1 = x + cw > w ? w - x : cw;
+    const uint16_t *rows = glyph_rows(*text, size);
+
+    for (int row = row0; row < row1; row++) {
+      uint16_t *dst = buf + (y + row) * stride + x;
+      uint16_t mask = rows[row];
+      for (int col = col0; col < col1; col++) {
+        // branchless select between bg and fg
+        dst[col] = bg ^ (diff & -((mask >> col) & 1));
+      }
+    }
+    drawn++;
+  }
+  return drawn;
+}
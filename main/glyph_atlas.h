@@ -0,0 +1,31 @@
+#ifndef GLYPH_ATLAS_H
+#define GLYPH_ATLAS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Pre-rasterized 1-bpp glyph atlases built from the 5x7 font: one row mask
+// per glyph row, bit n = pixel n from the left, so drawing a glyph run is
+// a mask test per pixel and no font decoding.
+typedef enum {
+  GLYPH_SIZE_SMALL, // 6x8 cells
+  GLYPH_SIZE_LARGE, // 12x16 cells, pixel doubled
+  GLYPH_SIZE_COUNT,
+} glyph_size_t;
+
+#define GLYPH_CELL_W(size) (6 << (size))
+#define GLYPH_CELL_H(size) (8 << (size))
+
+void glyph_atlas_init(void);
+// Bytes of atlas data for the given size
+size_t glyph_atlas_footprint(glyph_size_t size);
+// Width in pixels of text drawn at the given size
+int glyph_text_width(const char *text, glyph_size_t size);
+// Draw text with its top left corner at x, y into an RGB565 buffer of
+// w x h pixels, clipped to it. Every pixel of each cell is written with fg
+// or bg. Returns the number of glyphs drawn.
+int glyph_draw_run(uint16_t *buf, int stride, int w, int h, int x, int y,
+                   const char *text, glyph_size_t size, uint16_t fg,
+                   uint16_t bg);
+
+#endif // GLYPH_ATLAS_H
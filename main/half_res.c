@@ -0,0 +1,26 @@
+#include "half_res.h"
+#include "half_res_state.h"
+
+#include "esp_log.h"
+
+static const char *TAG = "half_res";
+
+static half_res_sm_t g_sm;
+static bool g_forced;
+
+void half_res_init(void) {
+  half_res_config_t cfg = HALF_RES_DEFAULT_CONFIG();
+  half_res_sm_init(&g_sm, &cfg);
+}
+
+bool half_res_frame(int x, int y) {
+  bool was = g_sm.half;
+  bool half = half_res_sm_frame(&g_sm, x, y);
+  if (half != was) {
+    ESP_LOGD(TAG, "%s resolution, %lu of %lu frames at half",
+             half ? "half" : "full", g_sm.half_frames, g_sm.frames);
+  }
+  return half || g_forced;
+}
+
+void half_res_force(bool on) { g_forced = on; }
@@ -0,0 +1,14 @@
+#ifndef HALF_RES_H
+#define HALF_RES_H
+
+#include <stdbool.h>
+
+void half_res_init(void);
+// Render task: whether the frame about to be shown is drawn at half
+// resolution, from the motion of its left eye centred at x, y or because
+// QoS asks for it
+bool half_res_frame(int x, int y);
+// Draw every frame at half resolution while on, whatever the motion
+void half_res_force(bool on);
+
+#endif // HALF_RES_H
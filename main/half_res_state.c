@@ -0,0 +1,43 @@
+#include "half_res_state.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+void half_res_sm_init(half_res_sm_t *sm, const half_res_config_t *cfg) {
+  memset(sm, 0, sizeof(*sm));
+  sm->cfg = *cfg;
+}
+
+bool half_res_sm_frame(half_res_sm_t *sm, int x, int y) {
+  sm->frames++;
+  int motion = 0;
+  if (sm->have_last) {
+    int dx = abs(x - sm->x);
+    int dy = abs(y - sm->y);
+    motion = dx > dy ? dx : dy;
+  }
+  sm->have_last = true;
+  sm->x = x;
+  sm->y = y;
+
+  bool half = sm->half;
+  if (motion >= sm->cfg.enter_px) {
+    half = true;
+    sm->calm = 0;
+  } else if (motion < sm->cfg.settle_px) {
+    if (sm->calm < UINT8_MAX) {
+      sm->calm++;
+    }
+    if (sm->calm >= sm->cfg.settle_frames) {
+      half = false;
+    }
+  } else {
+    sm->calm = 0;
+  }
+  if (half != sm->half) {
+    sm->half = half;
+    sm->switches++;
+  }
+  sm->half_frames += half;
+  return half;
+}
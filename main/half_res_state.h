@@ -0,0 +1,42 @@
+#ifndef HALF_RES_STATE_H
+#define HALF_RES_STATE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Dynamic resolution. While the eyes move tens of pixels a frame (confused
+// flicker, laughing, idle jumps) detail is lost in the motion anyway, so
+// frames are drawn at half resolution. Motion is how far an eye moved since
+// the last frame, along its larger axis: one frame moving enter_px or more
+// switches to half resolution at once, settle_frames in a row under
+// settle_px switch back. Blinks and eyelids keep the eye's centre, sweat and
+// other extras are not counted. Positions come in as parameters so it runs
+// the same against recorded frames.
+typedef struct {
+  uint8_t enter_px;
+  uint8_t settle_px;
+  uint8_t settle_frames;
+} half_res_config_t;
+
+#define HALF_RES_DEFAULT_CONFIG()                                              \
+  {                                                                            \
+    .enter_px = 8, .settle_px = 3, .settle_frames = 8,                         \
+  }
+
+typedef struct {
+  half_res_config_t cfg;
+  bool half;
+  bool have_last;
+  int x, y;     // last frame's eye centre
+  uint8_t calm; // frames in a row under settle_px
+  uint32_t frames;
+  uint32_t half_frames;
+  uint32_t switches;
+} half_res_sm_t;
+
+void half_res_sm_init(half_res_sm_t *sm, const half_res_config_t *cfg);
+// Centre of an eye, the same one each frame, in the frame about to be
+// shown; returns whether to draw it at half resolution
+bool half_res_sm_frame(half_res_sm_t *sm, int x, int y);
+
+#endif // HALF_RES_STATE_H
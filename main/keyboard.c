@@ -0,0 +1,195 @@
+#include "keyboard.h"
+#include "eye_actions.h"
+#include "eye_shape.h"
+#include "eye_style.h"
+#include "keyboard_matrix.h"
+#include "power.h"
+
+#include <stdatomic.h>
+#include <stddef.h>
+
+#include "FluxGarage_RoboEyes.h"
+
+#include "driver/gpio.h"
+#include "soc/gpio_reg.h"
+
+#include "esp_err.h"
+#include "esp_rom_sys.h"
+#include "esp_timer.h"
+
+// Cardputer keyboard wiring
+#define KB_ADDR0 8
+#define KB_ADDR1 9
+#define KB_ADDR2 11
+#define KB_ADDR_MASK ((1UL << KB_ADDR0) | (1UL << KB_ADDR1) | (1UL << KB_ADDR2))
+
+static const uint8_t kb_col_pins[KB_MATRIX_COLS] = {13, 15, 3, 4, 5, 6, 7};
+
+// 5 ms scan x 4 debounce scans = 20 ms worst case to confirm a change
+#define KB_SCAN_PERIOD_US 5000
+
+typedef struct {
+  uint8_t code;
+  eye_action_t press;
+  eye_action_t release;
+} kb_binding_t;
+
+// Arrow keys sit on ; , . / like the Cardputer legends
+static const kb_binding_t kb_bindings[] = {
+    {'1', {EYE_ACTION_MOOD, DEFAULT}, {EYE_ACTION_NONE, 0}},
+    {'2', {EYE_ACTION_MOOD, TIRED}, {EYE_ACTION_NONE, 0}},
+    {'3', {EYE_ACTION_MOOD, ANGRY}, {EYE_ACTION_NONE, 0}},
+    {'4', {EYE_ACTION_MOOD, HAPPY}, {EYE_ACTION_NONE, 0}},
+    {'5', {EYE_ACTION_STYLE, EYE_STYLE_FLAT}, {EYE_ACTION_NONE, 0}},
+    {'6', {EYE_ACTION_STYLE, EYE_STYLE_GRADIENT}, {EYE_ACTION_NONE, 0}},
+    {'7', {EYE_ACTION_STYLE, EYE_STYLE_GLOW}, {EYE_ACTION_NONE, 0}},
+    {'8', {EYE_ACTION_STYLE, EYE_STYLE_NEON}, {EYE_ACTION_NONE, 0}},
+    {'9', {EYE_ACTION_SHAPE, EYE_SHAPE_HEART}, {EYE_ACTION_NONE, 0}},
+    {'0', {EYE_ACTION_SHAPE, EYE_SHAPE_STAR}, {EYE_ACTION_NONE, 0}},
+    {'-', {EYE_ACTION_SHAPE, EYE_SHAPE_CROSS}, {EYE_ACTION_NONE, 0}},
+    {'=', {EYE_ACTION_SHAPE, EYE_SHAPE_NONE}, {EYE_ACTION_NONE, 0}},
+    {';', {EYE_ACTION_POSITION, N}, {EYE_ACTION_NONE, 0}},
+    {'.', {EYE_ACTION_POSITION, S}, {EYE_ACTION_NONE, 0}},
+    {',', {EYE_ACTION_POSITION, W}, {EYE_ACTION_NONE, 0}},
+    {'/', {EYE_ACTION_POSITION, E}, {EYE_ACTION_NONE, 0}},
+    {' ', {EYE_ACTION_POSITION, 0}, {EYE_ACTION_NONE, 0}},
+    {'b', {EYE_ACTION_BLINK, 0}, {EYE_ACTION_NONE, 0}},
+    {'c', {EYE_ACTION_CONFUSED, 0}, {EYE_ACTION_NONE, 0}},
+    {'l', {EYE_ACTION_LAUGH, 0}, {EYE_ACTION_NONE, 0}},
+    {'k', {EYE_ACTION_CLIP, 0}, {EYE_ACTION_NONE, 0}},
+    {'v', {EYE_ACTION_SOUND, 0}, {EYE_ACTION_NONE, 0}},
+    {'i', {EYE_ACTION_IDLE, ON}, {EYE_ACTION_NONE, 0}},
+    {'o', {EYE_ACTION_IDLE, OFF}, {EYE_ACTION_NONE, 0}},
+    // held keys
+    {'s', {EYE_ACTION_SWEAT, ON}, {EYE_ACTION_SWEAT, OFF}},
+    {'u', {EYE_ACTION_CURIOUS, ON}, {EYE_ACTION_CURIOUS, OFF}},
+    {'y', {EYE_ACTION_CYCLOPS, ON}, {EYE_ACTION_CYCLOPS, OFF}},
+    {'z', {EYE_ACTION_CLOSE, 0}, {EYE_ACTION_OPEN, 0}},
+};
+
+static kb_matrix_t g_kb;
+static esp_timer_handle_t g_kb_timer;
+static bool g_kb_idle;
+static keyboard_stats_t g_kb_stats;
+static uint64_t g_kb_latency_sum;
+
+static void kb_select_row(void *ctx, uint8_t row) {
+  uint32_t set = ((row & 1) ? 1UL << KB_ADDR0 : 0) |
+                 ((row & 2) ? 1UL << KB_ADDR1 : 0) |
+                 ((row & 4) ? 1UL << KB_ADDR2 : 0);
+  REG_WRITE(GPIO_OUT_W1TC_REG, KB_ADDR_MASK & ~set);
+  REG_WRITE(GPIO_OUT_W1TS_REG, set);
+  esp_rom_delay_us(1); // let the decoder output and pull-ups settle
+}
+
+static uint8_t kb_read_cols(void *ctx) {
+  uint32_t in = ~REG_READ(GPIO_IN_REG); // keys pull the column low
+  uint8_t cols = 0;
+  for (int i = 0; i < KB_MATRIX_COLS; i++) {
+    cols |= ((in >> kb_col_pins[i]) & 1) << i;
+  }
+  return cols;
+}
+
+static void kb_scan_cb(void *arg) {
+  int64_t start = esp_timer_get_time();
+  unsigned head = atomic_load(&g_kb.head);
+  kb_matrix_scan(&g_kb, (uint32_t)start);
+  uint32_t spent = esp_timer_get_time() - start;
+  if (atomic_load(&g_kb.head) != head) {
+    power_notify_input();
+  }
+  if (spent > g_kb_stats.scan_max_us) {
+    g_kb_stats.scan_max_us = spent;
+  }
+}
+
+void keyboard_init(void) {
+  gpio_config_t addr_config = {
+      .pin_bit_mask = KB_ADDR_MASK,
+      .mode = GPIO_MODE_OUTPUT,
+      .pull_up_en = GPIO_PULLUP_DISABLE,
+      .pull_down_en = GPIO_PULLDOWN_DISABLE,
+      .intr_type = GPIO_INTR_DISABLE,
+  };
+  ESP_ERROR_CHECK(gpio_config(&addr_config));
+
+  gpio_config_t col_config = {
+      .pin_bit_mask = 0,
+      .mode = GPIO_MODE_INPUT,
+      .pull_up_en = GPIO_PULLUP_ENABLE,
+      .pull_down_en = GPIO_PULLDOWN_DISABLE,
+      .intr_type = GPIO_INTR_DISABLE,
+  };
+  for (int i = 0; i < KB_MATRIX_COLS; i++) {
+    col_config.pin_bit_mask |= 1ULL << kb_col_pins[i];
+  }
+  ESP_ERROR_CHECK(gpio_config(&col_config));
+
+  const kb_gpio_ops_t ops = {.select_row = kb_select_row,
+                             .read_cols = kb_read_cols};
+  kb_matrix_init(&g_kb, &ops);
+
+  const esp_timer_create_args_t scan_args = {.callback = &kb_scan_cb,
+                                             .name = "kb_scan"};
+  ESP_ERROR_CHECK(esp_timer_create(&scan_args, &g_kb_timer));
+  ESP_ERROR_CHECK(esp_timer_start_periodic(g_kb_timer, KB_SCAN_PERIOD_US));
+}
+
+void keyboard_set_idle(bool idle) {
+  if (idle == g_kb_idle) {
+    return;
+  }
+  g_kb_idle = idle;
+  if (idle) {
+    ESP_ERROR_CHECK(esp_timer_stop(g_kb_timer));
+  } else {
+    ESP_ERROR_CHECK(esp_timer_start_periodic(g_kb_timer, KB_SCAN_PERIOD_US));
+  }
+}
+
+bool keyboard_probe(void) {
+  if (!g_kb_idle) {
+    return false;
+  }
+  for (uint8_t row = 0; row < KB_MATRIX_ROWS; row++) {
+    kb_select_row(NULL, row);
+    if (kb_read_cols(NULL)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+static const kb_binding_t *kb_find_binding(uint8_t code) {
+  for (size_t i = 0; i < sizeof(kb_bindings) / sizeof(kb_bindings[0]); i++) {
+    if (kb_bindings[i].code == code) {
+      return &kb_bindings[i];
+    }
+  }
+  return NULL;
+}
+
+void keyboard_dispatch(void) {
+  kb_event_t event;
+  while (kb_matrix_pop(&g_kb, &event)) {
+    const kb_binding_t *binding = kb_find_binding(event.code);
+    if (binding) {
+      eye_action_apply(event.pressed ? &binding->press : &binding->release);
+    }
+
+    uint32_t latency = (uint32_t)esp_timer_get_time() - event.time_us;
+    if (latency > g_kb_stats.latency_max_us) {
+      g_kb_stats.latency_max_us = latency;
+    }
+    g_kb_latency_sum += latency;
+    g_kb_stats.events++;
+  }
+}
+
+void keyboard_get_stats(keyboard_stats_t *stats) {
+  *stats = g_kb_stats;
+  stats->dropped = g_kb.dropped;
+  stats->latency_avg_us =
+      g_kb_stats.events ? g_kb_latency_sum / g_kb_stats.events : 0;
+}
@@ -0,0 +1,27 @@
+#ifndef KEYBOARD_H
+#define KEYBOARD_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef struct {
+  uint32_t events;         // key events applied so far
+  uint32_t dropped;        // events lost to a full queue
+  uint32_t latency_max_us; // worst confirmed-change to applied time
+  uint32_t latency_avg_us;
+  uint32_t scan_max_us; // worst time spent in one matrix scan
+} keyboard_stats_t;
+
+// Configure the matrix GPIOs and start the periodic scanner
+void keyboard_init(void);
+// Drain pending key events and apply their bindings; call from the task
+// that drives RoboEyes_update()
+void keyboard_dispatch(void);
+// Stop the periodic scan while idle so the chip can light sleep between
+// frames, and resume it after
+void keyboard_set_idle(bool idle);
+// While idle: whether any key is down, read once without debouncing
+bool keyboard_probe(void);
+void keyboard_get_stats(keyboard_stats_t *stats);
+
+#endif // KEYBOARD_H
@@ -0,0 +1,92 @@
+#include "keyboard_matrix.h"
+
+#include <string.h>
+
+// Unshifted key legends, in logical layout order
+static const uint8_t kb_keymap[KB_LAYOUT_ROWS][KB_LAYOUT_COLS] = {
+    {'`', '1', '2', '3', '4', '5', '6', '7', '8', '9', '0', '-', '=', '\b'},
+    {'\t', 'q', 'w', 'e', 'r', 't', 'y', 'u', 'i', 'o', 'p', '[', ']', '\\'},
+    {KB_KEY_FN, KB_KEY_SHIFT, 'a', 's', 'd', 'f', 'g', 'h', 'j', 'k', 'l', ';',
+     '\'', '\n'},
+    {KB_KEY_CTRL, KB_KEY_OPT, KB_KEY_ALT, 'z', 'x', 'c', 'v', 'b', 'n', 'm',
+     ',', '.', '/', ' '},
+};
+
+// Matrix bit -> logical key. Decoder rows 0-3 and 4-7 share columns: the
+// upper half takes the even layout columns, the lower half the odd ones.
+static uint8_t kb_matrix_to_key(unsigned bit) {
+  unsigned row = bit / KB_MATRIX_COLS;
+  unsigned col = bit % KB_MATRIX_COLS;
+  unsigned x = (row > 3) ? col * 2 : col * 2 + 1;
+  unsigned y = 3 - (row & 3);
+  return y * KB_LAYOUT_COLS + x;
+}
+
+uint8_t kb_key_code(uint8_t key) {
+  if (key >= KB_KEY_COUNT) {
+    return 0;
+  }
+  return kb_keymap[key / KB_LAYOUT_COLS][key % KB_LAYOUT_COLS];
+}
+
+void kb_matrix_init(kb_matrix_t *kb, const kb_gpio_ops_t *ops) {
+  memset(kb, 0, sizeof(*kb));
+  kb->ops = *ops;
+  kb->cnt0 = ~0ULL;
+  kb->cnt1 = ~0ULL;
+  atomic_init(&kb->head, 0);
+  atomic_init(&kb->tail, 0);
+}
+
+static void kb_push(kb_matrix_t *kb, const kb_event_t *event) {
+  unsigned head = atomic_load_explicit(&kb->head, memory_order_relaxed);
+  unsigned tail = atomic_load_explicit(&kb->tail, memory_order_acquire);
+  if (head - tail >= KB_EVENT_QUEUE_LEN) {
+    kb->dropped++;
+    return;
+  }
+  kb->queue[head & (KB_EVENT_QUEUE_LEN - 1)] = *event;
+  atomic_store_explicit(&kb->head, head + 1, memory_order_release);
+}
+
+bool kb_matrix_pop(kb_matrix_t *kb, kb_event_t *event) {
+  unsigned tail = atomic_load_explicit(&kb->tail, memory_order_relaxed);
+  unsigned head = atomic_load_explicit(&kb->head, memory_order_acquire);
+  if (tail == head) {
+    return false;
+  }
+  *event = kb->queue[tail & (KB_EVENT_QUEUE_LEN - 1)];
+  atomic_store_explicit(&kb->tail, tail + 1, memory_order_release);
+  return true;
+}
+
+bool kb_matrix_scan(kb_matrix_t *kb, uint32_t now_us) {
+  uint64_t raw = 0;
+  for (uint8_t row = 0; row < KB_MATRIX_ROWS; row++) {
+    kb->ops.select_row(kb->ops.ctx, row);
+    uint64_t cols = kb->ops.read_cols(kb->ops.ctx) & 0x7f;
+    raw |= cols << (row * KB_MATRIX_COLS);
+  }
+
+  // Two-bit vertical counters: a bit only toggles after it has differed
+  // from the debounced state for 4 consecutive scans, the counters' depth.
+  uint64_t delta = raw ^ kb->state;
+  kb->cnt0 = ~(kb->cnt0 & delta);
+  kb->cnt1 = kb->cnt0 ^ (kb->cnt1 & delta);
+  uint64_t toggled = delta & kb->cnt0 & kb->cnt1;
+  kb->state ^= toggled;
+
+  while (toggled) {
+    unsigned bit = __builtin_ctzll(toggled);
+    toggled &= toggled - 1;
+
+    kb_event_t event = {
+        .key = kb_matrix_to_key(bit),
+        .pressed = (kb->state >> bit) & 1,
+        .time_us = now_us,
+    };
+    event.code = kb_key_code(event.key);
+    kb_push(kb, &event);
+  }
+  return kb->state != 0;
+}
@@ -0,0 +1,62 @@
+#ifndef KEYBOARD_MATRIX_H
+#define KEYBOARD_MATRIX_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+// Cardputer key matrix: 8 rows selected through a 74HC138 (3 address
+// lines) and 7 column inputs. Logically the keys form 4 rows of 14.
+#define KB_MATRIX_ROWS 8
+#define KB_MATRIX_COLS 7
+#define KB_LAYOUT_ROWS 4
+#define KB_LAYOUT_COLS 14
+#define KB_KEY_COUNT (KB_LAYOUT_ROWS * KB_LAYOUT_COLS)
+
+#define KB_EVENT_QUEUE_LEN 16 // must be a power of two
+
+// Codes for keys that have no printable character
+#define KB_KEY_FN 0x80
+#define KB_KEY_SHIFT 0x81
+#define KB_KEY_CTRL 0x82
+#define KB_KEY_OPT 0x83
+#define KB_KEY_ALT 0x84
+
+// Access to the matrix lines. The ESP32 backend lives in keyboard.c; a host
+// build supplies its own functions to simulate key presses.
+typedef struct {
+  void (*select_row)(void *ctx, uint8_t row); // drive the decoder address
+  uint8_t (*read_cols)(void *ctx); // bit n set = key on column n pressed
+  void *ctx;
+} kb_gpio_ops_t;
+
+typedef struct {
+  uint8_t key; // logical index, row * KB_LAYOUT_COLS + column
+  uint8_t code; // character or KB_KEY_* code
+  bool pressed;
+  uint32_t time_us; // scan time that confirmed the change
+} kb_event_t;
+
+typedef struct {
+  kb_gpio_ops_t ops;
+  uint64_t state; // debounced raw matrix, bit = row * KB_MATRIX_COLS + col
+  // A key changes state once it has differed from state for 4 scans in a
+  // row: the depth of these two-bit vertical counters
+  uint64_t cnt0;  // vertical debounce counter, low bit
+  uint64_t cnt1;  // vertical debounce counter, high bit
+  // Single producer (scanner) / single consumer (render task) ring
+  kb_event_t queue[KB_EVENT_QUEUE_LEN];
+  atomic_uint head;
+  atomic_uint tail;
+  uint32_t dropped;
+} kb_matrix_t;
+
+void kb_matrix_init(kb_matrix_t *kb, const kb_gpio_ops_t *ops);
+// Scan all rows once, debounce and queue any confirmed changes.
+// Returns true if at least one key is held down after the scan.
+bool kb_matrix_scan(kb_matrix_t *kb, uint32_t now_us);
+bool kb_matrix_pop(kb_matrix_t *kb, kb_event_t *event);
+
+uint8_t kb_key_code(uint8_t key);
+
+#endif // KEYBOARD_MATRIX_H
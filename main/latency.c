@@ -0,0 +1,188 @@
+#include "latency.h"
+
+#include <stdbool.h>
+#include <string.h>
+
+#include "FluxGarage_RoboEyes.h"
+
+#include "freertos/FreeRTOS.h"
+
+#include "esp_log.h"
+#include "esp_timer.h"
+
+static const char *TAG = "latency";
+
+#define LATENCY_PENDING 16      // commands tracked in flight
+#define LATENCY_BUCKET_US 250   // histogram resolution
+#define LATENCY_BUCKETS 256     // 64 ms range, last bucket collects overflow
+#define LATENCY_LOG_PERIOD_US (10 * 1000 * 1000)
+
+typedef struct {
+  uint32_t seq; // 0 = free slot
+  int64_t issued_us;
+  int64_t applied_us;
+  int64_t frame_us;
+  uint32_t flush_gen; // frame flush that carries the command, 0 = not yet
+} latency_pending_t;
+
+typedef struct {
+  uint32_t buckets[LATENCY_BUCKETS];
+  uint32_t count;
+  uint32_t max_us;
+} latency_hist_t;
+
+static portMUX_TYPE g_lat_lock = portMUX_INITIALIZER_UNLOCKED;
+static latency_pending_t g_pending[LATENCY_PENDING];
+static unsigned g_pending_next;
+static uint32_t g_overwritten;
+static latency_hist_t g_hist[LATENCY_STAGE_COUNT];
+
+// Frame flush generations: bumped when the last band of a frame is queued,
+// copied by the ISR once that band's transfer has completed; all under
+// g_lat_lock so latency_poll() never sees a torn or mismatched completion
+static uint32_t g_flush_gen;
+static bool g_flush_last_inflight;
+static uint32_t g_flush_done_gen;
+static int64_t g_flush_done_us;
+
+static int64_t g_last_log_us;
+
+static void lat_trace(uint8_t stage, uint32_t seq) {
+  int64_t now = esp_timer_get_time();
+
+  portENTER_CRITICAL(&g_lat_lock);
+  if (stage == ROBOEYES_TRACE_COMMAND) {
+    latency_pending_t *p = &g_pending[g_pending_next];
+    g_pending_next = (g_pending_next + 1) % LATENCY_PENDING;
+    if (p->seq) {
+      g_overwritten++;
+    }
+    *p = (latency_pending_t){.seq = seq, .issued_us = now};
+  } else {
+    for (int i = 0; i < LATENCY_PENDING; i++) {
+      latency_pending_t *p = &g_pending[i];
+      if (!p->seq || (int32_t)(p->seq - seq) > 0) {
+        continue;
+      }
+      if (stage == ROBOEYES_TRACE_APPLIED && !p->applied_us) {
+        p->applied_us = now;
+      } else if (stage == ROBOEYES_TRACE_FRAME && p->applied_us &&
+                 !p->frame_us) {
+        p->frame_us = now;
+      }
+    }
+  }
+  portEXIT_CRITICAL(&g_lat_lock);
+}
+
+void latency_init(void) {
+  g_last_log_us = esp_timer_get_time();
+  RoboEyes_setTraceHook(lat_trace);
+}
+
+void latency_flush_begin(void) {
+  portENTER_CRITICAL(&g_lat_lock);
+  g_flush_gen++;
+  for (int i = 0; i < LATENCY_PENDING; i++) {
+    if (g_pending[i].frame_us && !g_pending[i].flush_gen) {
+      g_pending[i].flush_gen = g_flush_gen;
+    }
+  }
+  g_flush_last_inflight = true;
+  portEXIT_CRITICAL(&g_lat_lock);
+}
+
+void latency_flush_done_isr(void) {
+  int64_t now = esp_timer_get_time();
+
+  portENTER_CRITICAL_ISR(&g_lat_lock);
+  if (g_flush_last_inflight) {
+    g_flush_last_inflight = false;
+    g_flush_done_us = now;
+    g_flush_done_gen = g_flush_gen;
+  }
+  portEXIT_CRITICAL_ISR(&g_lat_lock);
+}
+
+static void lat_record(latency_hist_t *h, int64_t from, int64_t to) {
+  uint32_t us = to > from ? (uint32_t)(to - from) : 0;
+  uint32_t bucket = us / LATENCY_BUCKET_US;
+  if (bucket >= LATENCY_BUCKETS) {
+    bucket = LATENCY_BUCKETS - 1;
+  }
+  h->buckets[bucket]++;
+  h->count++;
+  if (us > h->max_us) {
+    h->max_us = us;
+  }
+}
+
+static uint32_t lat_percentile(const latency_hist_t *h, uint32_t permille) {
+  uint32_t target = ((uint64_t)h->count * permille + 999) / 1000;
+  uint32_t seen = 0;
+  for (int i = 0; i < LATENCY_BUCKETS; i++) {
+    seen += h->buckets[i];
+    if (seen >= target) {
+      uint32_t upper = (i + 1) * LATENCY_BUCKET_US;
+      return upper < h->max_us ? upper : h->max_us;
+    }
+  }
+  return h->max_us;
+}
+
+void latency_get_stats(latency_stage_t stage, latency_stats_t *stats) {
+  const latency_hist_t *h = &g_hist[stage];
+  stats->count = h->count;
+  stats->max_us = h->max_us;
+  stats->p50_us = h->count ? lat_percentile(h, 500) : 0;
+  stats->p90_us = h->count ? lat_percentile(h, 900) : 0;
+  stats->p99_us = h->count ? lat_percentile(h, 990) : 0;
+}
+
+void latency_reset(void) {
+  portENTER_CRITICAL(&g_lat_lock);
+  memset(g_hist, 0, sizeof(g_hist));
+  g_overwritten = 0;
+  portEXIT_CRITICAL(&g_lat_lock);
+}
+
+static void lat_log(void) {
+  static const char *names[LATENCY_STAGE_COUNT] = {"applied", "frame",
+                                                   "flush"};
+  for (int i = 0; i < LATENCY_STAGE_COUNT; i++) {
+    latency_stats_t s;
+    latency_get_stats(i, &s);
+    ESP_LOGI(TAG, "%-7s n=%lu p50=%lu p90=%lu p99=%lu max=%lu us", names[i],
+             (unsigned long)s.count, (unsigned long)s.p50_us,
+             (unsigned long)s.p90_us, (unsigned long)s.p99_us,
+             (unsigned long)s.max_us);
+  }
+  if (g_overwritten) {
+    ESP_LOGW(TAG, "%lu commands dropped before completion",
+             (unsigned long)g_overwritten);
+  }
+}
+
+void latency_poll(void) {
+  portENTER_CRITICAL(&g_lat_lock);
+  uint32_t done_gen = g_flush_done_gen;
+  int64_t done_us = g_flush_done_us;
+  for (int i = 0; i < LATENCY_PENDING; i++) {
+    latency_pending_t *p = &g_pending[i];
+    if (!p->seq || !p->flush_gen ||
+        (int32_t)(p->flush_gen - done_gen) > 0) {
+      continue;
+    }
+    lat_record(&g_hist[LATENCY_STAGE_APPLIED], p->issued_us, p->applied_us);
+    lat_record(&g_hist[LATENCY_STAGE_FRAME], p->issued_us, p->frame_us);
+    lat_record(&g_hist[LATENCY_STAGE_FLUSH], p->issued_us, done_us);
+    p->seq = 0;
+  }
+  portEXIT_CRITICAL(&g_lat_lock);
+
+  int64_t now = esp_timer_get_time();
+  if (now - g_last_log_us >= LATENCY_LOG_PERIOD_US) {
+    g_last_log_us = now;
+    lat_log();
+  }
+}
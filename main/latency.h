@@ -0,0 +1,34 @@
+#ifndef LATENCY_H
+#define LATENCY_H
+
+#include <stdint.h>
+
+// Time from a RoboEyes command being issued until it reaches each stage
+typedef enum {
+  LATENCY_STAGE_APPLIED, // frame update picked up the new state
+  LATENCY_STAGE_FRAME,   // the frame reflecting it was drawn
+  LATENCY_STAGE_FLUSH,   // that frame finished transferring to the panel
+  LATENCY_STAGE_COUNT,
+} latency_stage_t;
+
+typedef struct {
+  uint32_t count;
+  uint32_t p50_us;
+  uint32_t p90_us;
+  uint32_t p99_us;
+  uint32_t max_us;
+} latency_stats_t;
+
+// Install the RoboEyes trace hook; call after RoboEyes_init()
+void latency_init(void);
+// Flush path hooks: the last band of a frame is handed to the panel / has
+// been transferred (the latter is safe to call from the transfer ISR)
+void latency_flush_begin(void);
+void latency_flush_done_isr(void);
+// Fold completed commands into the histograms and log them periodically
+void latency_poll(void);
+
+void latency_get_stats(latency_stage_t stage, latency_stats_t *stats);
+void latency_reset(void);
+
+#endif // LATENCY_H
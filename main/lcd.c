@@ -1,4 +1,26 @@
 #include "FluxGarage_RoboEyes.h"
+#include "ambient_state.h"
+#include "audio_out.h"
+#include "battery.h"
+#include "behaviour_runner.h"
+#include "clip_player.h"
+#include "control.h"
+#include "eye_list.h"
+#include "eye_shape.h"
+#include "eye_snapshot.h"
+#include "eye_style.h"
+#include "frame_mem.h"
+#include "half_res.h"
+#include "keyboard.h"
+#include "latency.h"
+#include "mic.h"
+#include "mirror.h"
+#include "power.h"
+#include "qos.h"
+#include "raster.h"
+#include "robo_widget.h"
+#include "scroll_state.h"
+#include "text_overlay.h"
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
@@ -21,17 +43,20 @@
 #include "lvgl/lvgl.h"
 
 static esp_lcd_panel_handle_t g_lcd = NULL;
+static esp_lcd_panel_io_handle_t g_lcd_io = NULL; // for raw panel commands
 static lv_display_t *g_disp = NULL;
 
-// lv_obj_t *label;
-static lv_obj_t *canvas;
-static lv_color_t *canvas_buf;
-
 volatile bool lcd_transfer_in_progress = false;
+static volatile int lcd_pieces; // transfers left of the area being flushed
 static bool on_color_trans_done(esp_lcd_panel_io_handle_t panel_io,
                                 esp_lcd_panel_io_event_data_t *event_data,
                                 void *user_ctx) {
+  if (lcd_pieces > 1) {
+    lcd_pieces--;
+    return false;
+  }
   lcd_transfer_in_progress = false;
+  latency_flush_done_isr();
   if (g_disp) {
     lv_display_flush_ready(g_disp);
   }
@@ -45,125 +70,191 @@ static bool on_color_trans_done(esp_lcd_panel_io_handle_t panel_io,
 
 #define LCD_SCREEN_WIDTH 240
 #define LCD_SCREEN_HEIGHT 135
+#define LCD_BUF_LINES 40 // LVGL draw buffer, full width
+
+// Log every primitive RoboEyes draws; far too slow to leave on
+#define ROBO_TRACE_PRIMITIVES 0
+// Draw frames in fast motion at half resolution, doubling the pixels into
+// each draw area (half_res.h).
+#define ROBO_HALF_RES 1
+// Scan only the band around the eyes, in 8 colours, while they are sleepy
+// (ambient_state.h).
+#define ROBO_AMBIENT 1
+// Slide the eyes sideways with the panel's vertical scroll, redrawing only
+// the columns that wrap in (scroll_state.h).
+#define ROBO_SCROLL 1
+
+// Robo eyes primitives, recorded into display lists and drawn by an LVGL
+// widget (robo_widget.h) for the areas LVGL refreshes
+static raster_target_t robo_raster;
+// Recorded and shown frames, swapped by updateDisplay
+static eye_list_t robo_lists[2];
+static eye_list_t *robo_rec = &robo_lists[0];
+static const eye_list_t *robo_shown = &robo_lists[1];
+static lv_obj_t *robo_widget;
+#if ROBO_HALF_RES
+// Half resolution window of the largest area LVGL draws at once; a partial
+// refresh never covers more pixels than the draw buffer holds
+static uint16_t robo_half_buf[EYE_LIST_HALF_PX(LCD_SCREEN_WIDTH,
+                                               LCD_BUF_LINES)];
+static bool robo_half; // the shown frame is drawn at half resolution
+static int robo_eye_x, robo_eye_y; // left eye centre, recorded frame
+#endif
+
+#if ROBO_AMBIENT
+static ambient_sm_t robo_ambient_sm;
+static bool robo_flushed; // a frame went to the panel this pass
+#endif
+static bool robo_ambient; // draw in the ambient palette
+#if ROBO_SCROLL
+static scroll_sm_t robo_scroll_sm;
+static uint16_t *robo_scroll_park; // DMA capable, half the draw buffer
+static uint16_t robo_shown_style;  // raster style_seq the shown frame used
+#if ROBO_HALF_RES
+static bool robo_shown_half;
+#endif
+#endif
 
-// Robo eyes primitives
-static lv_obj_t *robo_canvas;
-static lv_color_t *robo_buf;
+static lv_color_t robo_color(uint8_t color) {
+  if (!color) {
+    return lv_color_black();
+  }
+  // The 8 colour idle mode keeps only the top bit of each channel
+  return robo_ambient ? lv_color_make(0, 0, 132) : lv_color_make(0, 0, 100);
+}
 
-void robo_canvas_init(void) {
+void robo_screen_init(void) {
   int w = LCD_SCREEN_WIDTH;
   int h = LCD_SCREEN_HEIGHT;
 
-  robo_buf = heap_caps_malloc(w * h * sizeof(lv_color_t),
-                              MALLOC_CAP_INTERNAL | MALLOC_CAP_DMA);
-  assert(robo_buf);
-
-  robo_canvas = lv_canvas_create(lv_scr_act());
-  lv_canvas_set_buffer(robo_canvas, robo_buf, w, h, LV_COLOR_FORMAT_NATIVE);
-
-  lv_obj_center(robo_canvas);
+  // The draw event sets the window to the area being refreshed
+  raster_target_init(&robo_raster, NULL, w, w, h);
+  robo_widget = robo_widget_create(lv_scr_act(), &robo_raster);
+  lv_obj_set_size(robo_widget, w, h);
+  lv_obj_center(robo_widget);
+  raster_set_colors(&robo_raster, lv_color_to_u16(robo_color(0)),
+                    lv_color_to_u16(robo_color(1)));
+  eye_style_init(&robo_raster);
+  eye_list_reset(&robo_lists[0]);
+  eye_list_reset(&robo_lists[1]);
 }
 
-static void clearDisplay(void) {
-  lv_canvas_fill_bg(robo_canvas, lv_color_black(), LV_OPA_COVER);
+// Blank the eyes, e.g. for a clip to play over
+static void robo_clear_screen(void) {
+  eye_list_reset(&robo_lists[0]);
+  eye_list_reset(&robo_lists[1]);
+  lv_obj_invalidate(lv_scr_act());
 }
 
-static void updateDisplay(void) { lv_timer_handler(); }
-
-static void drawRoundedRectangle(int x, int y, int w, int h, int r,
-                                 uint8_t color) {
-  lv_layer_t layer;
-  printf("Rect %d %d %d %d %hhx\n", x, y, w, h, color);
-  lv_canvas_init_layer(robo_canvas, &layer);
+#if ROBO_AMBIENT || ROBO_SCROLL
+static void robo_panel_cmd(void *ctx, uint8_t cmd, const uint8_t *data,
+                           size_t len) {
+  // Queued behind the pixels of the last frame
+  ESP_ERROR_CHECK_WITHOUT_ABORT(
+      esp_lcd_panel_io_tx_param(g_lcd_io, cmd, data, len));
+}
+#endif
 
-  lv_draw_rect_dsc_t dsc;
-  lv_draw_rect_dsc_init(&dsc);
+#if ROBO_AMBIENT
 
-  //dsc.bg_color.blue = color + 100;
-  if (color) {
-      dsc.bg_color.blue = 100;
-      dsc.bg_color.red = 0;
-      dsc.bg_color.green = 0;
-  } else {
-      dsc.bg_color.blue = 0;
-      dsc.bg_color.red = 0;
-      dsc.bg_color.green = 0;
+// Redraw everything in the normal or ambient palette. The ambient one stays
+// flat: gradient and glow levels would band in 8 colours.
+static void robo_set_palette(bool ambient) {
+  robo_ambient = ambient;
+  raster_set_colors(&robo_raster, lv_color_to_u16(robo_color(0)),
+                    lv_color_to_u16(robo_color(1)));
+  if (!ambient) {
+    eye_style_refresh();
   }
-  dsc.bg_opa = LV_OPA_COVER;
-  dsc.radius = r;
+  lv_obj_invalidate(lv_scr_act());
+}
+#endif
 
-  lv_area_t a = {.x1 = x, .y1 = y, .x2 = x + w - 1, .y2 = y + h - 1};
+static void clearDisplay(void) { eye_list_reset(robo_rec); }
+
+static uint32_t robo_frames; // frames RoboEyes has drawn
+static bool robo_clip;       // a clip is playing instead
+
+#if ROBO_SCROLL
+// Show the new frame by scrolling the panel, if it is the last one moved
+// along x and nothing else would move with it. The last frame must be on
+// the panel first; then only the columns that wrapped in are redrawn.
+static bool robo_scroll_show(void) {
+  bool same_style = robo_raster.style_seq == robo_shown_style;
+  robo_shown_style = robo_raster.style_seq;
+#if ROBO_HALF_RES
+  bool same_half = robo_half == robo_shown_half;
+  robo_shown_half = robo_half;
+#endif
+  int dx;
+  lv_area_t text;
+  if (!same_style || robo_ambient || robo_clip || text_overlay_area(&text) ||
+      !eye_list_moved_x(robo_rec, robo_shown, &dx) ||
+      !scroll_sm_pays(&robo_scroll_sm, dx)) {
+    return false;
+  }
+#if ROBO_HALF_RES
+  // Half resolution pixels are pairs: an odd move would split them
+  if (!same_half || (robo_half && (dx & 1))) {
+    return false;
+  }
+#endif
+  // Whatever else is pending goes out first, still in place; lvgl_task's
+  // lv_timer_handler() leaves nothing behind, so this is normally empty
+  lv_refr_now(NULL);
+  scroll_sm_move(&robo_scroll_sm, dx, robo_panel_cmd, NULL);
+  mirror_scroll(dx);
+  robo_widget_move(robo_widget, robo_shown, dx);
+  int x1, x2;
+  scroll_sm_exposed(&robo_scroll_sm, dx, &x1, &x2);
+  lv_area_t strip = {.x1 = x1, .y1 = 0, .x2 = x2, .y2 = LCD_SCREEN_HEIGHT - 1};
+  lv_obj_invalidate_area(lv_scr_act(), &strip);
+  return true;
+}
+#endif
 
-  lv_draw_rect(&layer, &dsc, &a);
+// A frame is recorded: show it. Only the areas it changes are invalidated;
+// lvgl_task's lv_timer_handler() renders and flushes them, with the
+// display's refresh timer made due so the frame goes out in this pass.
+static void updateDisplay(void) {
+  robo_frames++;
+  robo_shown = robo_rec;
+  robo_rec = robo_rec == &robo_lists[0] ? &robo_lists[1] : &robo_lists[0];
+#if ROBO_AMBIENT
+  // The panel's scan band must cover the frame before its pixels land
+  ambient_sm_show(&robo_ambient_sm, robo_shown->x1 - robo_raster.glow_size,
+                  robo_shown->x2 + robo_raster.glow_size, robo_panel_cmd,
+                  NULL);
+#endif
+#if ROBO_HALF_RES
+  robo_half = half_res_frame(robo_eye_x, robo_eye_y);
+  robo_widget_set_half_res(robo_widget, robo_half ? robo_half_buf : NULL,
+                           sizeof(robo_half_buf) / sizeof(robo_half_buf[0]));
+#endif
+#if ROBO_SCROLL
+  if (!robo_scroll_show()) {
+    robo_widget_show(robo_widget, robo_shown);
+  }
+#else
+  robo_widget_show(robo_widget, robo_shown);
+#endif
+  lv_timer_ready(lv_display_get_refr_timer(g_disp));
+}
 
-  lv_canvas_finish_layer(robo_canvas, &layer);
+static void drawRoundedRectangle(int x, int y, int w, int h, int r,
+                                 uint8_t color) {
+#if ROBO_TRACE_PRIMITIVES
+  printf("Rect %d %d %d %d %hhx\n", x, y, w, h, color);
+#endif
+  eye_list_rect(robo_rec, x, y, w, h, r, color);
 }
 
 static void drawTriangle(int x0, int y0, int x1, int y1, int x2, int y2,
                          uint8_t color) {
-#if 1
-  lv_layer_t layer;
-  lv_canvas_init_layer(robo_canvas, &layer);
+#if ROBO_TRACE_PRIMITIVES
   printf("tria %d %d %d %d %d %d %hhx\n", x0, y0, x1, y1, x2, y2, color);
-
-  lv_draw_triangle_dsc_t dsc;
-  lv_draw_triangle_dsc_init(&dsc);
-  if (color) {
-      dsc.color.blue = 100;
-      dsc.color.red = 0;
-      dsc.color.green = 0;
-  } else {
-      dsc.color.blue = 0;
-      dsc.color.red = 0;
-      dsc.color.green = 0;
-  }
-  dsc.opa = LV_OPA_COVER;
-
-  dsc.p[0].x = x0;
-  dsc.p[0].y = y0;
-  dsc.p[1].x = x1;
-  dsc.p[1].y = y1;
-  dsc.p[2].x = x2;
-  dsc.p[2].y = y2;
-  lv_draw_triangle(&layer, &dsc);
-
-  lv_canvas_finish_layer(robo_canvas, &layer);
-
-#else
-  lv_layer_t layer;
-  lv_canvas_init_layer(robo_canvas, &layer);
-  printf("tria %d %d %d %d %d %d %hhx\n", x0, y0, x1, y1, x2, y2, color);
-
-  lv_draw_line_dsc_t dsc;
-  lv_draw_line_dsc_init(&dsc);
-
-  dsc.color.blue = color + 100;
-
-  dsc.width = 10;
-
-  /* Line 1 */
-  dsc.p1.x = x0;
-  dsc.p1.y = y0;
-  dsc.p2.x = x1;
-  dsc.p2.y = y1;
-  lv_draw_line(&layer, &dsc);
-
-  /* Line 2 */
-  dsc.p1.x = x1;
-  dsc.p1.y = y1;
-  dsc.p2.x = x2;
-  dsc.p2.y = y2;
-  lv_draw_line(&layer, &dsc);
-
-  /* Line 3 */
-  dsc.p1.x = x2;
-  dsc.p1.y = y2;
-  dsc.p2.x = x0;
-  dsc.p2.y = y0;
-  lv_draw_line(&layer, &dsc);
-
-  lv_canvas_finish_layer(robo_canvas, &layer);
 #endif
+  eye_list_triangle(robo_rec, x0, y0, x1, y1, x2, y2, color);
 }
 
 static uint32_t millis() {
@@ -173,6 +264,23 @@ static uint32_t millis() {
   // return i += 100;
 }
 
+// Eye bodies: the selected shape, or RoboEyes' rectangle when there is none
+static void drawEye(uint8_t eye, int x, int y, int w, int h, int r,
+                    uint8_t color) {
+#if ROBO_HALF_RES
+  if (eye == 0) {
+    robo_eye_x = x + w / 2;
+    robo_eye_y = y + h / 2;
+  }
+#endif
+  eye_shape_key_t key;
+  if (eye_shape_current(millis(), &key)) {
+    eye_list_shape(robo_rec, x, y, w, h, key, color);
+  } else {
+    eye_list_rect(robo_rec, x, y, w, h, r, color);
+  }
+}
+
 static uint32_t robo_eyes_random(uint32_t limit) {
   // Implementation for generating a random number
   uint32_t r = esp_random();
@@ -192,17 +300,6 @@ esp_lcd_panel_handle_t setup_lcd_spi() {
   esp_lcd_panel_handle_t spi_lcd_handle = NULL;
   esp_lcd_panel_io_handle_t io_handle = NULL;
 
-  gpio_config_t bk_gpio_config = {
-      .pin_bit_mask = 1ULL << LCD_BLK,
-      .mode = GPIO_MODE_OUTPUT,
-      .pull_up_en = GPIO_PULLUP_DISABLE,
-      .pull_down_en = GPIO_PULLDOWN_DISABLE,
-      .intr_type = GPIO_INTR_DISABLE,
-  };
-
-  ESP_ERROR_CHECK(gpio_config(&bk_gpio_config));
-  gpio_set_level(LCD_BLK, 1);
-
   spi_bus_config_t buscfg = {
       .sclk_io_num = LCD_SCLK,
       .mosi_io_num = LCD_MOSI,
@@ -242,10 +339,42 @@ esp_lcd_panel_handle_t setup_lcd_spi() {
   ESP_ERROR_CHECK(esp_lcd_panel_disp_on_off(spi_lcd_handle, true));
   esp_lcd_panel_invert_color(spi_lcd_handle, true);
 
+  g_lcd_io = io_handle;
   return spi_lcd_handle;
 }
 
-static void lcd_init(void) { g_lcd = setup_lcd_spi(); }
+static void lcd_init(void) {
+  g_lcd = setup_lcd_spi();
+#if ROBO_SCROLL
+  scroll_config_t scroll = SCROLL_DEFAULT_CONFIG();
+  scroll_sm_init(&robo_scroll_sm, &scroll);
+  scroll_sm_define(&robo_scroll_sm, robo_panel_cmd, NULL);
+#endif
+}
+
+#if ROBO_SCROLL
+// Send an area to the panel memory columns its screen columns scrolled to
+static void robo_scroll_flush(int x1, int y1, int x2, int y2,
+                              uint16_t *px_map) {
+  int w = x2 - x1;
+  // Packing a split area overwrites it: the mirror sees it first
+  bool split = scroll_sm_splits(&robo_scroll_sm, x1, w);
+  if (split) {
+    mirror_capture(x1, y1, x2, y2, px_map);
+  }
+  scroll_piece_t pieces[2];
+  int n = scroll_sm_pack(&robo_scroll_sm, x1, w, y2 - y1, px_map,
+                         robo_scroll_park, pieces);
+  lcd_pieces = n;
+  for (int i = 0; i < n; i++) {
+    esp_lcd_panel_draw_bitmap(g_lcd, pieces[i].x, y1,
+                              pieces[i].x + pieces[i].w, y2, pieces[i].px);
+  }
+  if (!split) {
+    mirror_capture(x1, y1, x2, y2, px_map);
+  }
+}
+#endif
 
 static void lvgl_flush_cb(lv_display_t *disp, const lv_area_t *area,
                           uint8_t *px_map) {
@@ -254,77 +383,104 @@ static void lvgl_flush_cb(lv_display_t *disp, const lv_area_t *area,
   int x2 = area->x2 + 1;
   int y2 = area->y2 + 1;
 
+  bool last = lv_display_flush_is_last(disp);
+  if (last) {
+    latency_flush_begin();
+  }
+  clip_player_band(area, (uint16_t *)px_map);
+#if ROBO_SCROLL
+  robo_scroll_flush(x1, y1, x2, y2, (uint16_t *)px_map);
+#else
   esp_lcd_panel_draw_bitmap(g_lcd, x1, y1, x2, y2, px_map);
+  // Diff against the mirror's shadow while the transfer runs
+  mirror_capture(x1, y1, x2, y2, (const uint16_t *)px_map);
+#endif
+  if (last) {
+    mirror_frame_done();
+    power_frame_flushed();
+#if ROBO_AMBIENT
+    robo_flushed = true;
+#endif
+  }
 
   // lv_display_flush_ready(disp);
 }
 
-static void lv_tick_task(void *arg) { lv_tick_inc(1); }
-
-void lvgl_task(void *arg) {
-  while (1) {
-    RoboEyes_update();
-
-    lv_timer_handler();
-    vTaskDelay(pdMS_TO_TICKS(10));
+#if ROBO_AMBIENT
+// Between frames: take the panel a step into or out of ambient mode.
+// Entering waits for a frame to be on the panel, in the ambient palette for
+// the last step; leaving can go at once.
+static void robo_ambient_tick(void) {
+  bool slow = power_is_sleepy() && !robo_clip;
+  if (slow && !robo_flushed) {
+    return;
+  }
+  robo_flushed = false;
+  if (ambient_sm_frame(&robo_ambient_sm, slow, robo_panel_cmd, NULL)) {
+    robo_set_palette(ambient_sm_palette(&robo_ambient_sm));
   }
 }
+#endif
 
-void blink_task(void *arg) {
-  // uint32_t counter = 0;
-  // char buffer [10];
-  uint32_t i = 0;
+void lvgl_task(void *arg) {
   while (1) {
-    // snprintf(buffer, sizeof(buffer), "idx %"PRIu32, counter);
-    // lv_label_set_text(label, buffer);
-    //RoboEyes_update();
-    // counter ++;
-
-    switch(i) {
-
-        case 1:
-            RoboEyes_anim_confused();
-        break;
-        case 2:
-            RoboEyes_anim_laugh();
-        break;
-        case 3:
-            RoboEyes_setMood(TIRED);
-        break;
-        case 4:
-            RoboEyes_setMood(ANGRY);
-        break;
-        case 5:
-            RoboEyes_setMood(HAPPY);
-        break;
-        default:
-            RoboEyes_setMood(DEFAULT);
-            i = 0;
+    keyboard_dispatch();
+    control_dispatch();
+    mic_dispatch();
+    power_tick(millis());
+    // Scripted expressions pause while the eyes are sleepy
+    if (!power_is_sleepy()) {
+      behaviour_runner_tick(millis());
     }
-    i ++;
-
-    vTaskDelay(pdMS_TO_TICKS(5000));
+    // A clip replaces the eyes while it plays
+    bool clip = clip_player_tick(millis());
+    if (clip != robo_clip) {
+      robo_clip = clip;
+      robo_clear_screen();
+    }
+#if ROBO_AMBIENT
+    robo_ambient_tick();
+#endif
+    // LVGL's draw tasks and layers for this pass come from the frame arena;
+    // the input and event handlers above allocate from the heap, so nothing
+    // they keep can outlive the frame
+    frame_mem_begin();
+    // RoboEyes_update() only records a frame; lv_timer_handler() renders
+    // and flushes it. The frame time the QoS ladder sees covers both.
+    uint32_t frames = robo_frames;
+    int64_t start = esp_timer_get_time();
+    if (!clip) {
+      // The glow lights pixels around the shapes: culling must keep them
+      RoboEyes_setCullMargin(robo_raster.glow_size);
+      RoboEyes_update();
+    }
+    lv_timer_handler();
+    if (robo_frames != frames) {
+      qos_frame(esp_timer_get_time() - start);
+    }
+    frame_mem_end();
+    latency_poll();
+    power_wait();
   }
 }
 
-static void lvgl_tick_init() {
-  esp_timer_handle_t tick_timer;
-  const esp_timer_create_args_t tick_args = {.callback = &lv_tick_task,
-                                             .name = "lv_tick"};
-  esp_timer_create(&tick_args, &tick_timer);
-  esp_timer_start_periodic(tick_timer, 1000);
-}
 static void lvgl_display_init(void) {
   // static lv_display_t *disp;
   static lv_draw_buf_t draw_buf;
   static void *buf1;
 
-  const uint32_t buf_height = 40;
+  const uint32_t buf_height = LCD_BUF_LINES;
   const uint32_t stride = LCD_SCREEN_WIDTH * 2; // RGB565
   const uint32_t buf_size = stride * buf_height;
 
   buf1 = heap_caps_malloc(buf_size, MALLOC_CAP_DMA | MALLOC_CAP_INTERNAL);
   assert(buf1);
+#if ROBO_SCROLL
+  // The narrower half of an area split by the scroll wrap
+  robo_scroll_park =
+      heap_caps_malloc(buf_size / 2, MALLOC_CAP_DMA | MALLOC_CAP_INTERNAL);
+  assert(robo_scroll_park);
+#endif
 
   lv_draw_buf_init(&draw_buf, LCD_SCREEN_WIDTH, buf_height,
                    LV_COLOR_FORMAT_RGB565, stride, buf1, buf_size);
@@ -340,13 +496,15 @@ static void lvgl_display_init(void) {
 
 void app_main(void) {
   lcd_init(); // Your ST7789 init
+  // Backlight PWM, DFS and light sleep between frames
+  power_init(LCD_BLK, millis());
   lv_init();  // LVGL core
 
   lvgl_display_init(); // Your flush_cb + buffers
 
-  lvgl_tick_init(); // esp_timer (1 ms)
-
-  xTaskCreatePinnedToCore(lvgl_task, "lvgl", 4096, NULL, 5, NULL, 0);
+  // LVGL reads the time when it needs it: a 1 ms tick timer would wake the
+  // chip out of light sleep a thousand times a second
+  lv_tick_set_cb(millis);
 
   // Initialize RoboEyes
   RoboEyes_init(drawRoundedRectangle, // Function to draw rounded rectangles
@@ -356,15 +514,36 @@ void app_main(void) {
                 millis, // Function to get the current time in milliseconds
                 robo_eyes_random // Function to generate random numbers
   );
-  robo_canvas_init();
+  RoboEyes_setEyeHook(drawEye);
+  latency_init();
+  half_res_init();
+#if ROBO_AMBIENT
+  ambient_config_t ambient = AMBIENT_DEFAULT_CONFIG();
+  ambient_sm_init(&robo_ambient_sm, &ambient);
+#endif
+  qos_init();
+  robo_screen_init();
   RoboEyes_begin(LCD_SCREEN_WIDTH, LCD_SCREEN_HEIGHT, 100);
   // Define some automated eyes behaviour
   RoboEyes_setAutoblinker2(ON, 3, 2);
   RoboEyes_setIdleMode2(ON, 2, 2);
+  RoboEyes_setNaturalGaze(ON);
+  // Back from deep sleep: the first frame continues the saved expression
+  // instead of opening the eyes from closed
+  eye_snapshot_restore();
+  keyboard_init();
+  clip_player_init();
+  mic_init();
+  battery_init();
+  audio_out_init();
   // RoboEyes_setCyclops(ON);
-  //  label = lv_label_create(lv_screen_active());
-  //  lv_label_set_text(label, "Hello Cardputer!");
-  //  lv_obj_center(label);
+  text_overlay_init(lv_scr_act(), LCD_SCREEN_WIDTH);
+  mirror_init(LCD_SCREEN_WIDTH, LCD_SCREEN_HEIGHT);
 
-  xTaskCreatePinnedToCore(blink_task, "blink", 4096, NULL, 5, NULL, 0);
+  // Expression changes come from the behaviour script, run from the render
+  // loop on a timer wheel
+  behaviour_runner_init(millis());
+  control_init();
+
+  xTaskCreatePinnedToCore(lvgl_task, "lvgl", 4096, NULL, 5, NULL, 0);
 }
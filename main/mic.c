@@ -0,0 +1,240 @@
+#include "mic.h"
+#include "eye_actions.h"
+#include "power.h"
+#include "vad.h"
+
+#include <assert.h>
+#include <stdatomic.h>
+
+#include "FluxGarage_RoboEyes.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+
+#include "driver/i2s_pdm.h"
+
+#include "esp_err.h"
+#include "esp_idf_version.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+static const char *TAG = "mic";
+
+// Cardputer SPM1423 PDM microphone
+#define MIC_CLK 43
+#define MIC_DIN 46
+
+#define MIC_SAMPLE_RATE 16000
+#define MIC_BLOCK_SAMPLES 256 // 16 ms per DMA buffer / VAD block
+#define MIC_DMA_BUFS 6        // DMA descriptor ring, doubles as our buffer
+#define MIC_BLOCK_US (MIC_BLOCK_SAMPLES * 1000000LL / MIC_SAMPLE_RATE)
+
+// Blocks are analysed in place in the DMA ring: the ISR only queues the
+// buffer address. A block is usable until the DMA wraps round onto it.
+typedef struct {
+  const int16_t *samples;
+  uint32_t seq;
+} mic_block_t;
+
+#define MIC_QUEUE_LEN 8 // power of two, > MIC_DMA_BUFS
+
+static i2s_chan_handle_t g_rx;
+static TaskHandle_t g_mic_task;
+static SemaphoreHandle_t g_rx_lock; // held while a DMA block is being read
+static bool g_lent; // pins lent to the speaker, see mic_stop()
+static bool g_idle; // see mic_set_idle()
+
+static mic_block_t g_queue[MIC_QUEUE_LEN];
+static atomic_uint g_head;
+static atomic_uint g_tail;
+static volatile uint32_t g_dma_seq; // blocks completed by the DMA
+
+static vad_t g_vad;
+static atomic_bool g_listening;
+static bool g_listening_applied;
+
+static mic_stats_t g_stats;
+static uint64_t g_process_sum_us;
+
+static bool mic_on_recv(i2s_chan_handle_t handle, i2s_event_data_t *event,
+                        void *user_ctx) {
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 4, 0)
+  const int16_t *samples = event->dma_buf;
+#else
+  const int16_t *samples = *(int16_t **)event->data;
+#endif
+  uint32_t seq = ++g_dma_seq;
+
+  unsigned head = atomic_load_explicit(&g_head, memory_order_relaxed);
+  unsigned tail = atomic_load_explicit(&g_tail, memory_order_acquire);
+  if (head - tail >= MIC_QUEUE_LEN) {
+    g_stats.overruns++;
+    return false;
+  }
+  g_queue[head & (MIC_QUEUE_LEN - 1)] =
+      (mic_block_t){.samples = samples, .seq = seq};
+  atomic_store_explicit(&g_head, head + 1, memory_order_release);
+
+  BaseType_t woken = pdFALSE;
+  vTaskNotifyGiveFromISR(g_mic_task, &woken);
+  return woken == pdTRUE;
+}
+
+// True once the DMA may have started refilling the block's buffer
+static bool mic_block_stale(const mic_block_t *block) {
+  return g_dma_seq - block->seq >= MIC_DMA_BUFS - 1;
+}
+
+static void mic_task(void *arg) {
+  while (1) {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+    unsigned tail = atomic_load_explicit(&g_tail, memory_order_relaxed);
+    while (tail != atomic_load_explicit(&g_head, memory_order_acquire)) {
+      mic_block_t block = g_queue[tail & (MIC_QUEUE_LEN - 1)];
+      atomic_store_explicit(&g_tail, ++tail, memory_order_release);
+
+      xSemaphoreTake(g_rx_lock, portMAX_DELAY);
+      if (!g_rx || mic_block_stale(&block)) {
+        xSemaphoreGive(g_rx_lock);
+        g_stats.overruns += g_rx != NULL;
+        continue;
+      }
+
+      int64_t start = esp_timer_get_time();
+      bool active = vad_process(&g_vad, block.samples, MIC_BLOCK_SAMPLES);
+      uint32_t spent = esp_timer_get_time() - start;
+
+      if (mic_block_stale(&block)) {
+        g_stats.overruns++; // overwritten while we read it; keep the result
+      }
+      if (active && !atomic_exchange(&g_listening, active)) {
+        power_notify_input();
+      } else {
+        atomic_store(&g_listening, active);
+      }
+      xSemaphoreGive(g_rx_lock);
+
+      g_stats.blocks++;
+      g_process_sum_us += spent;
+      if (spent > g_stats.process_max_us) {
+        g_stats.process_max_us = spent;
+      }
+    }
+  }
+}
+
+static void mic_open(void) {
+  if (g_rx) {
+    return;
+  }
+  i2s_chan_config_t chan_cfg =
+      I2S_CHANNEL_DEFAULT_CONFIG(I2S_NUM_0, I2S_ROLE_MASTER);
+  chan_cfg.dma_desc_num = MIC_DMA_BUFS;
+  chan_cfg.dma_frame_num = MIC_BLOCK_SAMPLES;
+  ESP_ERROR_CHECK(i2s_new_channel(&chan_cfg, NULL, &g_rx));
+
+  i2s_pdm_rx_config_t pdm_cfg = {
+      .clk_cfg = I2S_PDM_RX_CLK_DEFAULT_CONFIG(MIC_SAMPLE_RATE),
+      .slot_cfg = I2S_PDM_RX_SLOT_DEFAULT_CONFIG(I2S_DATA_BIT_WIDTH_16BIT,
+                                                 I2S_SLOT_MODE_MONO),
+      .gpio_cfg =
+          {
+              .clk = MIC_CLK,
+              .din = MIC_DIN,
+              .invert_flags = {.clk_inv = false},
+          },
+  };
+  ESP_ERROR_CHECK(i2s_channel_init_pdm_rx_mode(g_rx, &pdm_cfg));
+
+  i2s_event_callbacks_t cbs = {.on_recv = mic_on_recv};
+  ESP_ERROR_CHECK(i2s_channel_register_event_callback(g_rx, &cbs, NULL));
+  ESP_ERROR_CHECK(i2s_channel_enable(g_rx));
+  ESP_LOGI(TAG, "capturing %d Hz, %d sample blocks", MIC_SAMPLE_RATE,
+           MIC_BLOCK_SAMPLES);
+}
+
+static void mic_close(void) {
+  if (!g_rx) {
+    return;
+  }
+  ESP_ERROR_CHECK(i2s_channel_disable(g_rx));
+  ESP_ERROR_CHECK(i2s_del_channel(g_rx));
+  g_rx = NULL;
+  g_dma_seq += MIC_DMA_BUFS; // anything still queued is gone
+  atomic_store(&g_listening, false);
+}
+
+// Capture runs unless the speaker has the pins or the mic is idle
+static void mic_update(void) {
+  xSemaphoreTake(g_rx_lock, portMAX_DELAY);
+  if (g_lent || g_idle) {
+    mic_close();
+  } else {
+    mic_open();
+  }
+  xSemaphoreGive(g_rx_lock);
+}
+
+void mic_stop(void) {
+  g_lent = true;
+  mic_update();
+}
+
+void mic_start(void) {
+  g_lent = false;
+  mic_update();
+}
+
+void mic_set_idle(bool idle) {
+  g_idle = idle;
+  mic_update();
+}
+
+void mic_init(void) {
+  vad_config_t vad_cfg = VAD_DEFAULT_CONFIG();
+  vad_init(&g_vad, &vad_cfg);
+
+  g_rx_lock = xSemaphoreCreateMutex();
+  assert(g_rx_lock);
+
+  // Rendering is pinned to core 0, keep the analysis off it
+  xTaskCreatePinnedToCore(mic_task, "mic", 3072, NULL, 4, &g_mic_task, 1);
+  mic_start();
+}
+
+void mic_dispatch(void) {
+  bool listening = atomic_load(&g_listening);
+  if (listening == g_listening_applied) {
+    return;
+  }
+  g_listening_applied = listening;
+
+  // Listening: look at the speaker, eyes wide open and attentive
+  static const eye_action_t on[] = {
+      {EYE_ACTION_IDLE, OFF},
+      {EYE_ACTION_POSITION, 0},
+      {EYE_ACTION_CURIOUS, ON},
+      {EYE_ACTION_OPEN, 0},
+  };
+  static const eye_action_t off[] = {
+      {EYE_ACTION_CURIOUS, OFF},
+      {EYE_ACTION_IDLE, ON},
+  };
+  const eye_action_t *actions = listening ? on : off;
+  size_t count = listening ? sizeof(on) / sizeof(on[0])
+                           : sizeof(off) / sizeof(off[0]);
+  for (size_t i = 0; i < count; i++) {
+    eye_action_apply(&actions[i]);
+  }
+}
+
+void mic_get_stats(mic_stats_t *stats) {
+  *stats = g_stats;
+  stats->energy = g_vad.energy;
+  stats->noise_floor = g_vad.floor;
+  stats->listening = atomic_load(&g_listening);
+  uint64_t audio_us = (uint64_t)g_stats.blocks * MIC_BLOCK_US;
+  stats->cpu_permille = audio_us ? g_process_sum_us * 1000 / audio_us : 0;
+}
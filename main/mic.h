@@ -0,0 +1,30 @@
+#ifndef MIC_H
+#define MIC_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef struct {
+  uint32_t blocks;          // processed
+  uint32_t overruns;        // blocks lost or overwritten before processing
+  uint32_t cpu_permille;    // processing time per unit of audio time
+  uint32_t process_max_us;  // worst single block
+  uint32_t energy;          // last block, see vad_t
+  uint32_t noise_floor;
+  bool listening;
+} mic_stats_t;
+
+// Start PDM capture and the analysis task (on the core not rendering)
+void mic_init(void);
+// Release / reacquire the I2S pins; the speaker shares the clock line
+void mic_stop(void);
+void mic_start(void);
+// Stop capture while idle: the I2S driver's power management lock would
+// keep the chip out of light sleep. Whatever the speaker does meanwhile,
+// capture resumes once neither holds it.
+void mic_set_idle(bool idle);
+// Apply listening / not-listening reactions; call from the render task
+void mic_dispatch(void);
+void mic_get_stats(mic_stats_t *stats);
+
+#endif // MIC_H
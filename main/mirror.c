@@ -0,0 +1,247 @@
+#include "mirror.h"
+#include "control.h"
+#include "control_proto.h"
+#include "mirror_codec.h"
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "esp_log.h"
+#include "esp_timer.h"
+
+#include "lvgl/lvgl.h"
+
+static const char *TAG = "mirror";
+
+#define MIRROR_LOG_PERIOD_US (10 * 1000 * 1000)
+
+// Changed columns of a row since it was last sent, x1 < x0 when clean
+typedef struct {
+  int16_t x0;
+  int16_t x1;
+} mirror_span_t;
+
+static const mirror_span_t span_clean = {1, 0};
+
+static int g_width;
+static int g_height;
+// Last flushed content of the panel, kept by the flush path. The mirror
+// task reads it without locking: a row changed mid-encode is also marked
+// dirty again, so any tearing is repaired by the next mirrored frame.
+static uint16_t *g_shadow;
+static mirror_span_t *g_dirty;   // written by the flush path
+static mirror_span_t *g_sending; // snapshot owned by the mirror task
+static portMUX_TYPE g_dirty_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static TaskHandle_t g_task;
+static volatile uint32_t g_period_us; // 0 = off
+static uint16_t g_frame_no;
+static uint8_t g_chunk[CONTROL_MAX_PAYLOAD];
+static mirror_stats_t g_stats;
+static int64_t g_last_log_us;
+
+static void put_u16(uint8_t *p, uint16_t v) {
+  p[0] = v;
+  p[1] = v >> 8;
+}
+
+static void send_chunk(uint8_t flags, int x, int y, int w, int h,
+                       uint32_t cost_us, size_t len) {
+  uint8_t *p = g_chunk;
+  p[0] = CONTROL_REPLY_MIRROR;
+  p[1] = flags;
+  put_u16(p + 2, g_frame_no);
+  put_u16(p + 4, x);
+  put_u16(p + 6, y);
+  put_u16(p + 8, w);
+  put_u16(p + 10, h);
+  put_u16(p + 12, cost_us);
+  put_u16(p + 14, cost_us >> 16);
+  control_send(0, g_chunk, CONTROL_MIRROR_HEADER_SIZE + len);
+  g_stats.chunks++;
+  g_stats.bytes += CONTROL_MIRROR_HEADER_SIZE + len;
+}
+
+static void mirror_send_frame(void) {
+  portENTER_CRITICAL(&g_dirty_lock);
+  memcpy(g_sending, g_dirty, g_height * sizeof(*g_dirty));
+  for (int y = 0; y < g_height; y++) {
+    g_dirty[y] = span_clean;
+  }
+  portEXIT_CRITICAL(&g_dirty_lock);
+
+  uint32_t cost_us = 0;
+  bool sent = false;
+  int y = 0;
+  while (y < g_height) {
+    if (g_sending[y].x1 < g_sending[y].x0) {
+      y++;
+      continue;
+    }
+    // Consecutive dirty rows become one rectangle spanning their union
+    int y0 = y;
+    int x0 = g_sending[y].x0;
+    int x1 = g_sending[y].x1;
+    while (++y < g_height && g_sending[y].x1 >= g_sending[y].x0) {
+      x0 = g_sending[y].x0 < x0 ? g_sending[y].x0 : x0;
+      x1 = g_sending[y].x1 > x1 ? g_sending[y].x1 : x1;
+    }
+
+    int w = x1 - x0 + 1;
+    for (int row = y0; row < y;) {
+      int64_t start = esp_timer_get_time();
+      int rows;
+      size_t n = mirror_encode(g_shadow + row * g_width + x0, g_width, w,
+                               y - row, g_chunk + CONTROL_MIRROR_HEADER_SIZE,
+                               sizeof(g_chunk) - CONTROL_MIRROR_HEADER_SIZE,
+                               &rows);
+      cost_us += esp_timer_get_time() - start;
+      send_chunk(0, x0, row, w, rows, cost_us, n);
+      row += rows;
+      sent = true;
+    }
+  }
+  if (!sent) {
+    return;
+  }
+
+  // An empty chunk closes the frame and carries its total encode cost
+  send_chunk(CONTROL_MIRROR_LAST, 0, 0, 0, 0, cost_us, 0);
+  g_frame_no++;
+  g_stats.frames++;
+  g_stats.encode_us = cost_us;
+  if (cost_us > g_stats.encode_max_us) {
+    g_stats.encode_max_us = cost_us;
+  }
+}
+
+static void mirror_log(void) {
+  int64_t now = esp_timer_get_time();
+  if (now - g_last_log_us < MIRROR_LOG_PERIOD_US || !g_stats.frames) {
+    return;
+  }
+  g_last_log_us = now;
+  ESP_LOGI(TAG, "%lu frames, %lu B/frame, encode %lu us (max %lu), "
+                "capture max %lu us",
+           g_stats.frames, g_stats.bytes / g_stats.frames, g_stats.encode_us,
+           g_stats.encode_max_us, g_stats.capture_max_us);
+}
+
+static void mirror_task(void *arg) {
+  int64_t next_us = 0;
+  while (1) {
+    uint32_t period_us = g_period_us;
+    // Woken at the end of each flushed frame; timing out means the screen
+    // went static, so whatever is still dirty is complete and can go out
+    TickType_t wait = period_us ? pdMS_TO_TICKS(2 * period_us / 1000) + 1
+                                : portMAX_DELAY;
+    bool frame_end = ulTaskNotifyTake(pdTRUE, wait);
+    if (!g_period_us) {
+      continue;
+    }
+    int64_t now = esp_timer_get_time();
+    if (frame_end && now < next_us) {
+      continue; // rate limited, pick up a later frame
+    }
+    next_us = now + g_period_us;
+    mirror_send_frame();
+    mirror_log();
+  }
+}
+
+void mirror_init(int width, int height) {
+  g_width = width;
+  g_height = height;
+}
+
+void mirror_set_rate(uint8_t fps) {
+  if (!fps) {
+    g_period_us = 0;
+    return;
+  }
+  if (!g_shadow) {
+    g_shadow = calloc(g_width * g_height, sizeof(uint16_t));
+    g_dirty = malloc(g_height * sizeof(mirror_span_t));
+    g_sending = malloc(g_height * sizeof(mirror_span_t));
+    if (!g_shadow || !g_dirty || !g_sending) {
+      ESP_LOGE(TAG, "no memory for a %dx%d shadow frame", g_width, g_height);
+      free(g_shadow);
+      free(g_dirty);
+      free(g_sending);
+      g_shadow = NULL;
+      return;
+    }
+    xTaskCreatePinnedToCore(mirror_task, "mirror", 3072, NULL, 2, &g_task, 1);
+  }
+
+  // The host starts from nothing: send the whole panel once it is redrawn
+  portENTER_CRITICAL(&g_dirty_lock);
+  for (int y = 0; y < g_height; y++) {
+    g_dirty[y] = (mirror_span_t){0, g_width - 1};
+  }
+  portEXIT_CRITICAL(&g_dirty_lock);
+  g_period_us = 1000000 / fps;
+  lv_obj_invalidate(lv_scr_act());
+}
+
+// Columns x0..x1 of row y changed since it was last sent
+static void mark_dirty(int y, int x0, int x1) {
+  portENTER_CRITICAL(&g_dirty_lock);
+  mirror_span_t *d = &g_dirty[y];
+  if (d->x1 < d->x0) {
+    d->x0 = x0;
+    d->x1 = x1;
+  } else {
+    d->x0 = x0 < d->x0 ? x0 : d->x0;
+    d->x1 = x1 > d->x1 ? x1 : d->x1;
+  }
+  portEXIT_CRITICAL(&g_dirty_lock);
+}
+
+void mirror_capture(int x1, int y1, int x2, int y2, const uint16_t *px) {
+  if (!g_period_us) {
+    return;
+  }
+  int64_t start = esp_timer_get_time();
+  int w = x2 - x1;
+  for (int y = y1; y < y2; y++) {
+    const uint16_t *row = px + (y - y1) * w;
+    uint16_t *shadow = g_shadow + y * g_width + x1;
+    int a, b;
+    if (!mirror_row_diff(row, shadow, w, &a, &b)) {
+      continue;
+    }
+    memcpy(shadow + a, row + a, (b - a + 1) * sizeof(uint16_t));
+    mark_dirty(y, x1 + a, x1 + b);
+  }
+  uint32_t us = esp_timer_get_time() - start;
+  if (us > g_stats.capture_max_us) {
+    g_stats.capture_max_us = us;
+  }
+}
+
+void mirror_scroll(int dx) {
+  if (!g_period_us) {
+    return;
+  }
+  // Only the wrapped in columns are flushed after a scroll: the rest of
+  // the panel moved without passing through mirror_capture()
+  for (int y = 0; y < g_height; y++) {
+    int a, b;
+    if (mirror_row_scroll(g_shadow + y * g_width, g_width, dx, &a, &b)) {
+      mark_dirty(y, a, b);
+    }
+  }
+}
+
+void mirror_frame_done(void) {
+  if (g_period_us) {
+    xTaskNotifyGive(g_task);
+  }
+}
+
+void mirror_get_stats(mirror_stats_t *stats) { *stats = g_stats; }
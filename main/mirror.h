@@ -0,0 +1,30 @@
+#ifndef MIRROR_H
+#define MIRROR_H
+
+#include <stdint.h>
+
+typedef struct {
+  uint32_t frames;        // mirrored frames sent
+  uint32_t chunks;        // protocol frames they took
+  uint32_t bytes;         // encoded payload bytes sent
+  uint32_t encode_us;     // CPU time encoding the last mirrored frame
+  uint32_t encode_max_us;
+  uint32_t capture_max_us; // worst flush-path cost of diffing one band
+} mirror_stats_t;
+
+// Allocate nothing yet; the shadow frame is created on first enable
+void mirror_init(int width, int height);
+// Mirror at most fps frames per second over the control link, 0 stops.
+// Enabling forces a full refresh so the host starts from a whole frame.
+// Call from the LVGL task.
+void mirror_set_rate(uint8_t fps);
+// Flush path hooks: diff a band that was just handed to the panel against
+// the shadow frame, and the end of a frame
+void mirror_capture(int x1, int y1, int x2, int y2, const uint16_t *px);
+// The panel scrolled the picture dx columns to the right: the shadow frame
+// follows, ahead of the capture of the columns that wrapped in
+void mirror_scroll(int dx);
+void mirror_frame_done(void);
+void mirror_get_stats(mirror_stats_t *stats);
+
+#endif // MIRROR_H
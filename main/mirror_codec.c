@@ -0,0 +1,110 @@
+#include "mirror_codec.h"
+
+#include <stdbool.h>
+#include <string.h>
+
+int mirror_row_diff(const uint16_t *row, const uint16_t *shadow, int w,
+                    int *x0, int *x1) {
+  int l = 0;
+  while (l < w && row[l] == shadow[l]) {
+    l++;
+  }
+  if (l == w) {
+    return 0;
+  }
+  int r = w - 1;
+  while (row[r] == shadow[r]) {
+    r--;
+  }
+  *x0 = l;
+  *x1 = r;
+  return 1;
+}
+
+static void reverse(uint16_t *p, int n) {
+  for (int i = 0, j = n - 1; i < j; i++, j--) {
+    uint16_t t = p[i];
+    p[i] = p[j];
+    p[j] = t;
+  }
+}
+
+int mirror_row_scroll(uint16_t *shadow, int w, int dx, int *x0, int *x1) {
+  int s = (dx % w + w) % w;
+  // Column x takes what column x - dx held
+  int l = 0;
+  while (l < w && shadow[l] == shadow[(l - s + w) % w]) {
+    l++;
+  }
+  if (l == w) {
+    return 0;
+  }
+  int r = w - 1;
+  while (shadow[r] == shadow[(r - s + w) % w]) {
+    r--;
+  }
+  // Rotated in place by three reversals
+  reverse(shadow, w);
+  reverse(shadow, s);
+  reverse(shadow + s, w - s);
+  *x0 = l;
+  *x1 = r;
+  return 1;
+}
+
+static uint8_t *put_run(uint8_t *p, int run) {
+  while (run > 0) {
+    int n = run > MIRROR_MAX_RUN ? MIRROR_MAX_RUN : run;
+    if (n <= 64) {
+      *p++ = n - 1;
+    } else {
+      *p++ = 0x80 | ((n - 1) >> 8);
+      *p++ = (n - 1) & 0xff;
+    }
+    run -= n;
+  }
+  return p;
+}
+
+size_t mirror_encode(const uint16_t *fb, int stride, int w, int h,
+                     uint8_t *out, size_t cap, int *rows) {
+  uint16_t cache[MIRROR_CACHE_SIZE];
+  bool cached[MIRROR_CACHE_SIZE] = {0};
+  uint16_t prev = 0;
+  int run = 0;
+  uint8_t *p = out;
+  size_t row_worst = (size_t)w * MIRROR_WORST_PER_PIXEL;
+
+  int y = 0;
+  for (; y < h; y++) {
+    // A whole row of literals after flushing the pending run must fit
+    size_t run_bytes = 2 * (run / MIRROR_MAX_RUN + 1);
+    if ((size_t)(p - out) + run_bytes + row_worst > cap) {
+      break;
+    }
+    const uint16_t *row = fb + y * stride;
+    for (int x = 0; x < w; x++) {
+      uint16_t c = row[x];
+      if (c == prev) {
+        run++;
+        continue;
+      }
+      p = put_run(p, run);
+      run = 0;
+      unsigned i = MIRROR_CACHE_INDEX(c);
+      if (cached[i] && cache[i] == c) {
+        *p++ = 0x40 | i;
+      } else {
+        cache[i] = c;
+        cached[i] = true;
+        *p++ = 0xff;
+        *p++ = c & 0xff;
+        *p++ = c >> 8;
+      }
+      prev = c;
+    }
+  }
+  p = put_run(p, run);
+  *rows = y;
+  return p - out;
+}
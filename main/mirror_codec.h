@@ -0,0 +1,37 @@
+#ifndef MIRROR_CODEC_H
+#define MIRROR_CODEC_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Run-length / colour-cache coder for RGB565 rectangles, raster order.
+// Each chunk starts with previous colour 0 and an empty cache so it decodes
+// on its own:
+//   00rrrrrr             repeat the previous colour r + 1 times
+//   01iiiiii             colour cache entry i
+//   10rrrrrr rrrrrrrr    repeat the previous colour r + 1 times (long run)
+//   11111111 lo hi       literal colour, also stored in the cache
+#define MIRROR_CACHE_SIZE 64
+#define MIRROR_MAX_RUN 16384
+#define MIRROR_WORST_PER_PIXEL 3
+
+#define MIRROR_CACHE_INDEX(c)                                                  \
+  (((c) ^ ((c) >> 6) ^ ((c) >> 12)) & (MIRROR_CACHE_SIZE - 1))
+
+// Columns x0..x1 (inclusive) of a row that differ from the shadow copy;
+// returns 0 and leaves them untouched if the row is the same
+int mirror_row_diff(const uint16_t *row, const uint16_t *shadow, int w,
+                    int *x0, int *x1);
+
+// Move a row of the shadow copy dx columns to the right, wrapping, as the
+// panel's scroll moves the picture. Like mirror_row_diff(), returns whether
+// any column changed and sets x0..x1 to the ones that did.
+int mirror_row_scroll(uint16_t *shadow, int w, int dx, int *x0, int *x1);
+
+// Encode rows of a w wide rectangle starting at fb (stride in pixels) until
+// all h rows are done or the next row might not fit in cap. Returns the
+// bytes written; *rows is set to the number of rows encoded.
+size_t mirror_encode(const uint16_t *fb, int stride, int w, int h,
+                     uint8_t *out, size_t cap, int *rows);
+
+#endif // MIRROR_CODEC_H
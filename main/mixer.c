@@ -0,0 +1,80 @@
+#include "mixer.h"
+
+#include <string.h>
+
+#define MIXER_ENV_SHIFT 5          // mean |sample| >> 5: ~8000 is full scale
+#define MIXER_ENV_ATTACK_SHIFT 1   // rise quickly with a syllable
+#define MIXER_ENV_RELEASE_SHIFT 3  // fall slower between them
+
+void mixer_init(mixer_t *mixer) { memset(mixer, 0, sizeof(*mixer)); }
+
+int mixer_add(mixer_t *mixer, const int16_t *pcm, uint32_t len,
+              uint16_t gain) {
+  for (int i = 0; i < MIXER_STREAMS; i++) {
+    mixer_stream_t *s = &mixer->streams[i];
+    if (!s->active) {
+      *s = (mixer_stream_t){
+          .pcm = pcm, .len = len, .pos = 0, .gain = gain, .active = true};
+      return i;
+    }
+  }
+  return -1;
+}
+
+bool mixer_active(const mixer_t *mixer) {
+  for (int i = 0; i < MIXER_STREAMS; i++) {
+    if (mixer->streams[i].active) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void mixer_render(mixer_t *mixer, int16_t *out, size_t count) {
+  int32_t acc[count];
+  memset(acc, 0, sizeof(acc));
+
+  for (int i = 0; i < MIXER_STREAMS; i++) {
+    mixer_stream_t *s = &mixer->streams[i];
+    if (!s->active) {
+      continue;
+    }
+    size_t n = s->len - s->pos;
+    if (n > count) {
+      n = count;
+    }
+    const int16_t *src = s->pcm + s->pos;
+    for (size_t j = 0; j < n; j++) {
+      acc[j] += (src[j] * s->gain) >> 8;
+    }
+    s->pos += n;
+    if (s->pos >= s->len) {
+      s->active = false;
+    }
+  }
+
+  uint32_t sum_abs = 0;
+  for (size_t j = 0; j < count; j++) {
+    int32_t v = acc[j];
+    if (v > INT16_MAX) {
+      v = INT16_MAX;
+    } else if (v < INT16_MIN) {
+      v = INT16_MIN;
+    }
+    out[j] = v;
+    sum_abs += v < 0 ? -v : v;
+  }
+
+  uint32_t level = count ? (sum_abs / count) >> MIXER_ENV_SHIFT : 0;
+  if (level > 255) {
+    level = 255;
+  }
+  int env = mixer->envelope;
+  if ((int)level > env) {
+    env += ((int)level - env + 1) >> MIXER_ENV_ATTACK_SHIFT;
+  } else {
+    env -= (env - (int)level + (1 << MIXER_ENV_RELEASE_SHIFT) - 1) >>
+           MIXER_ENV_RELEASE_SHIFT;
+  }
+  mixer->envelope = env;
+}
@@ -0,0 +1,34 @@
+#ifndef MIXER_H
+#define MIXER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define MIXER_STREAMS 4
+#define MIXER_GAIN_UNITY 256 // gains are Q8
+
+typedef struct {
+  const int16_t *pcm;
+  uint32_t len;
+  uint32_t pos;
+  uint16_t gain;
+  bool active;
+} mixer_stream_t;
+
+// Fixed-point mixer for mono 16-bit PCM with an amplitude envelope output
+typedef struct {
+  mixer_stream_t streams[MIXER_STREAMS];
+  uint8_t envelope; // 0..255, follows the mixed output
+} mixer_t;
+
+void mixer_init(mixer_t *mixer);
+// Queue a PCM buffer; it must stay valid until played. Returns the stream
+// slot or -1 when all slots are busy.
+int mixer_add(mixer_t *mixer, const int16_t *pcm, uint32_t len, uint16_t gain);
+bool mixer_active(const mixer_t *mixer);
+// Mix the next count samples into out (silence when idle) and update the
+// envelope from them
+void mixer_render(mixer_t *mixer, int16_t *out, size_t count);
+
+#endif // MIXER_H
@@ -0,0 +1,35 @@
+#ifndef PANEL_GEOMETRY_H
+#define PANEL_GEOMETRY_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Where the screen sits on the ST7789's gate lines. Turned with MADCTL MV,
+// each screen column is one gate line, so the panel's line commands
+// (PTLAR, VSCRDEF, VSCSAD) take screen columns through this.
+typedef struct {
+  uint16_t gate_lines; // of the controller
+  uint16_t first_line; // gate line of screen x 0, unmirrored: the x gap
+  uint16_t width;      // screen columns, one gate line each
+  bool mirrored;       // screen x runs against the gate scan
+} panel_geometry_t;
+
+// The Cardputer's 135 x 240 glass on a 240 x 320 controller, turned with
+// MADCTL MV | MX: screen columns are gate lines, in reverse
+#define PANEL_GEOMETRY_CARDPUTER()                                             \
+  {                                                                            \
+    .gate_lines = 320, .first_line = 40, .width = 240, .mirrored = true,       \
+  }
+
+// Gate line of screen column x
+static inline int panel_line(const panel_geometry_t *g, int x) {
+  int line = g->first_line + x;
+  return g->mirrored ? g->gate_lines - 1 - line : line;
+}
+
+// Lowest gate line of the screen, whichever end of it that is
+static inline int panel_top_line(const panel_geometry_t *g) {
+  return panel_line(g, g->mirrored ? g->width - 1 : 0);
+}
+
+#endif // PANEL_GEOMETRY_H
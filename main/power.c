@@ -0,0 +1,336 @@
+#include "power.h"
+#include "eye_snapshot.h"
+#include "keyboard.h"
+#include "mic.h"
+
+#include "FluxGarage_RoboEyes.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "driver/ledc.h"
+#include "driver/rtc_io.h"
+
+#include "esp_attr.h"
+#include "esp_err.h"
+#include "esp_idf_version.h"
+#include "esp_log.h"
+#include "esp_pm.h"
+#include "esp_sleep.h"
+#include "esp_timer.h"
+
+#include "sdkconfig.h"
+
+static const char *TAG = "power";
+
+#define POWER_LEDC_MODE LEDC_LOW_SPEED_MODE
+#define POWER_LEDC_TIMER LEDC_TIMER_0
+#define POWER_LEDC_CHANNEL LEDC_CHANNEL_0
+#define POWER_LEDC_BITS 10
+#define POWER_LEDC_FREQ_HZ 5000
+#define POWER_WAKE_FADE_MS 60
+#define POWER_ACTIVE_PERIOD_MS 10 // render loop period while awake
+#define POWER_WAKE_GPIO GPIO_NUM_0 // the G0 button, low while pressed
+#define POWER_BATTERY_FPS 30       // frame rate cap on a low battery
+
+static power_sm_t g_sm;
+static power_stats_t g_stats;
+static TaskHandle_t g_render_task;
+static uint8_t g_fps_cap;
+static volatile uint8_t g_battery_req; // battery_level_t, any task
+static battery_level_t g_battery;      // applied by power_tick()
+
+static portMUX_TYPE g_input_lock = portMUX_INITIALIZER_UNLOCKED;
+static bool g_input;       // input since the last power_tick()
+static int64_t g_input_us; // first input since the last power_tick()
+static int64_t g_wake_us;  // 0 = no wake waiting for a frame
+static bool g_deep_wake;   // deep sleep wake still to apply
+static bool g_running;     // render loop started, frames from setup are done
+static int64_t g_sleepy_us;  // when the eyes went sleepy, 0 = not since boot
+static int64_t g_sleepy_lit; // g_light_sleep_us then
+
+// Mood and idle mode from before the eyes went sleepy, put back when they
+// wake. In RTC memory: deep sleep starts from SLEEPY and wakes into it.
+static RTC_DATA_ATTR uint8_t g_awake_mood;
+static RTC_DATA_ATTR bool g_awake_idle;
+
+#if CONFIG_PM_ENABLE
+static esp_pm_lock_handle_t g_frame_lock;
+#endif
+static volatile int64_t g_light_sleep_us; // total, while light sleeping
+
+#if CONFIG_PM_LIGHT_SLEEP_CALLBACKS
+static esp_err_t IRAM_ATTR power_light_sleep_exit(int64_t slept_us,
+                                                  void *arg) {
+  g_light_sleep_us += slept_us;
+  return ESP_OK;
+}
+#endif
+
+// Perceived brightness is roughly quadratic in duty
+static uint32_t backlight_duty(uint8_t level) {
+  return (uint32_t)level * level * ((1 << POWER_LEDC_BITS) - 1) / (255 * 255);
+}
+
+static void backlight_fade(uint8_t level, int fade_ms) {
+  ledc_fade_stop(POWER_LEDC_MODE, POWER_LEDC_CHANNEL);
+  ESP_ERROR_CHECK(ledc_set_fade_with_time(POWER_LEDC_MODE, POWER_LEDC_CHANNEL,
+                                          backlight_duty(level), fade_ms));
+  ESP_ERROR_CHECK(
+      ledc_fade_start(POWER_LEDC_MODE, POWER_LEDC_CHANNEL, LEDC_FADE_NO_WAIT));
+}
+
+static void power_pm_init(void) {
+#if CONFIG_PM_ENABLE
+  esp_pm_config_t pm = {
+      .max_freq_mhz = CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ,
+      .min_freq_mhz = 40,
+#if CONFIG_FREERTOS_USE_TICKLESS_IDLE
+      .light_sleep_enable = true,
+#endif
+  };
+  ESP_ERROR_CHECK(esp_pm_configure(&pm));
+#if CONFIG_PM_LIGHT_SLEEP_CALLBACKS
+  // Light sleep residency, see power_stats_t
+  esp_pm_sleep_cbs_register_config_t cbs = {.exit_cb = power_light_sleep_exit};
+  ESP_ERROR_CHECK(esp_pm_light_sleep_register_cbs(&cbs));
+#endif
+  // Held while the render task works, released while it waits
+  ESP_ERROR_CHECK(
+      esp_pm_lock_create(ESP_PM_CPU_FREQ_MAX, 0, "frame", &g_frame_lock));
+  ESP_ERROR_CHECK(esp_pm_lock_acquire(g_frame_lock));
+#else
+  ESP_LOGW(TAG, "CONFIG_PM_ENABLE is off, no DFS or light sleep");
+#endif
+}
+
+void power_init(int backlight_gpio, uint32_t now_ms) {
+  power_config_t cfg = POWER_DEFAULT_CONFIG();
+  power_sm_init(&g_sm, &cfg, now_ms);
+  // Out of deep sleep the eyes come back sleepy, as they were saved; the
+  // button press that woke the chip applies once they are on screen
+  if (esp_sleep_get_wakeup_cause() == ESP_SLEEP_WAKEUP_EXT0) {
+    g_sm.state = POWER_SLEEPY;
+    g_deep_wake = true;
+    g_stats.deep_wake = true;
+  }
+
+  // The APB clock stops in light sleep; the backlight PWM runs off RC_FAST,
+  // which is kept powered through it
+  ledc_timer_config_t timer = {
+      .speed_mode = POWER_LEDC_MODE,
+      .duty_resolution = POWER_LEDC_BITS,
+      .timer_num = POWER_LEDC_TIMER,
+      .freq_hz = POWER_LEDC_FREQ_HZ,
+      .clk_cfg = LEDC_USE_RC_FAST_CLK,
+  };
+  ESP_ERROR_CHECK(ledc_timer_config(&timer));
+  ESP_ERROR_CHECK(esp_sleep_pd_config(ESP_PD_DOMAIN_RC_FAST, ESP_PD_OPTION_ON));
+  ledc_channel_config_t channel = {
+      .gpio_num = backlight_gpio,
+      .speed_mode = POWER_LEDC_MODE,
+      .channel = POWER_LEDC_CHANNEL,
+      .timer_sel = POWER_LEDC_TIMER,
+      .duty = backlight_duty(power_sm_backlight(&g_sm)),
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 4, 0)
+      .sleep_mode = LEDC_SLEEP_MODE_KEEP_ALIVE,
+#endif
+  };
+  ESP_ERROR_CHECK(ledc_channel_config(&channel));
+  ESP_ERROR_CHECK(ledc_fade_func_install(0));
+
+  power_pm_init();
+}
+
+void power_notify_input(void) {
+  int64_t now = esp_timer_get_time();
+  portENTER_CRITICAL_SAFE(&g_input_lock);
+  if (!g_input) {
+    g_input = true;
+    g_input_us = now;
+  }
+  portEXIT_CRITICAL_SAFE(&g_input_lock);
+  if (g_render_task) {
+    xTaskNotifyGive(g_render_task);
+  }
+}
+
+static void power_apply_fps(void) {
+  uint8_t fps = power_sm_fps(&g_sm);
+  if (g_fps_cap && g_fps_cap < fps) {
+    fps = g_fps_cap;
+  }
+  if (g_battery >= BATTERY_LOW && POWER_BATTERY_FPS < fps) {
+    fps = POWER_BATTERY_FPS;
+  }
+  RoboEyes_setFramerate(fps);
+}
+
+// A low battery keeps the backlight at DIM at most
+static uint8_t power_backlight(void) {
+  uint8_t level = power_sm_backlight(&g_sm);
+  if (g_battery >= BATTERY_LOW && level > g_sm.cfg.dim_level) {
+    level = g_sm.cfg.dim_level;
+  }
+  return level;
+}
+
+// Mood for a battery level change: tired on a low battery
+static uint8_t power_battery_mood(void) {
+  return g_battery >= BATTERY_LOW ? TIRED : DEFAULT;
+}
+
+// Keep the eyes in RTC memory and sleep until the wake button; no return
+static void power_deep_sleep(void) {
+  ESP_LOGI(TAG, "deep sleep, G0 wakes");
+  eye_snapshot_save();
+  ledc_fade_stop(POWER_LEDC_MODE, POWER_LEDC_CHANNEL);
+  ledc_set_duty(POWER_LEDC_MODE, POWER_LEDC_CHANNEL, 0);
+  ledc_update_duty(POWER_LEDC_MODE, POWER_LEDC_CHANNEL);
+  rtc_gpio_pullup_en(POWER_WAKE_GPIO);
+  ESP_ERROR_CHECK(esp_sleep_enable_ext0_wakeup(POWER_WAKE_GPIO, 0));
+  esp_deep_sleep_start();
+}
+
+// Sleepy eyes: tired and still while nobody is around. The keyboard scan
+// and the mic stop meanwhile, leaving the chip free to light sleep between
+// the slow frames.
+static void power_enter_sleepy(void) {
+  g_awake_mood = RoboEyes_getMood();
+  g_awake_idle = RoboEyes_getIdleMode();
+  RoboEyes_setMood(TIRED);
+  RoboEyes_setIdleMode(OFF);
+  keyboard_set_idle(true);
+  mic_set_idle(true);
+  g_sleepy_us = esp_timer_get_time();
+  g_sleepy_lit = g_light_sleep_us;
+}
+
+static void power_leave_sleepy(void) {
+  RoboEyes_setMood(g_awake_mood);
+  RoboEyes_setIdleMode(g_awake_idle);
+  keyboard_set_idle(false);
+  mic_set_idle(false);
+  if (g_sleepy_us) {
+    g_stats.sleepy_ms = (esp_timer_get_time() - g_sleepy_us) / 1000;
+    g_stats.light_sleep_ms = (g_light_sleep_us - g_sleepy_lit) / 1000;
+    g_sleepy_us = 0;
+    ESP_LOGI(TAG, "sleepy for %lu ms, %lu ms of it in light sleep",
+             g_stats.sleepy_ms, g_stats.light_sleep_ms);
+  }
+}
+
+static void power_apply(power_state_t from) {
+  power_state_t to = g_sm.state;
+  if (to == POWER_DEEP_SLEEP) {
+    power_deep_sleep();
+  }
+  if (to == POWER_SLEEPY) {
+    power_enter_sleepy();
+  } else if (from == POWER_SLEEPY) {
+    power_leave_sleepy();
+  }
+  power_apply_fps();
+  backlight_fade(power_backlight(),
+                 to == POWER_ACTIVE ? POWER_WAKE_FADE_MS : g_sm.cfg.fade_ms);
+
+  static const char *names[] = {"active", "dim", "sleepy", "deep sleep"};
+  ESP_LOGI(TAG, "%s, backlight %u", names[to], power_backlight());
+}
+
+static void power_apply_battery(battery_level_t from) {
+  // CRITICAL holds over several readings: a dip or a missing cell never
+  // gets here (battery_state.h)
+  if (g_battery == BATTERY_CRITICAL) {
+    power_deep_sleep();
+  }
+  if ((from >= BATTERY_LOW) != (g_battery >= BATTERY_LOW)) {
+    // Sleepy eyes take it on waking
+    if (g_sm.state == POWER_SLEEPY) {
+      g_awake_mood = power_battery_mood();
+    } else {
+      RoboEyes_setMood(power_battery_mood());
+    }
+  }
+  power_apply_fps();
+  backlight_fade(power_backlight(), g_sm.cfg.fade_ms);
+}
+
+void power_set_battery(battery_level_t level) { g_battery_req = level; }
+
+void power_tick(uint32_t now_ms) {
+  portENTER_CRITICAL(&g_input_lock);
+  bool input = g_input;
+  int64_t input_us = g_input_us;
+  g_input = false;
+  portEXIT_CRITICAL(&g_input_lock);
+  g_running = true;
+  // The keyboard isn't scanned while sleepy: a key held down wakes
+  if (!input && g_sm.state == POWER_SLEEPY && keyboard_probe()) {
+    input = true;
+    input_us = esp_timer_get_time();
+  }
+  if (g_deep_wake && g_stats.boot_us) {
+    g_deep_wake = false;
+    input = true;
+    input_us = esp_timer_get_time();
+  }
+
+  power_state_t from = g_sm.state;
+  if (input && power_sm_activity(&g_sm, now_ms)) {
+    g_wake_us = input_us;
+    g_stats.wakes++;
+  }
+  power_sm_tick(&g_sm, now_ms);
+  if (g_sm.state != from) {
+    power_apply(from);
+  }
+  battery_level_t battery = g_battery_req;
+  if (battery != g_battery) {
+    battery_level_t was = g_battery;
+    g_battery = battery;
+    power_apply_battery(was);
+  }
+  g_stats.state = g_sm.state;
+}
+
+bool power_is_sleepy(void) { return g_sm.state == POWER_SLEEPY; }
+
+void power_set_fps_cap(uint8_t fps) {
+  g_fps_cap = fps;
+  power_apply_fps();
+}
+
+void power_wait(void) {
+  g_render_task = xTaskGetCurrentTaskHandle();
+  uint32_t period_ms = g_sm.state == POWER_SLEEPY
+                           ? 1000 / g_sm.cfg.sleepy_fps
+                           : POWER_ACTIVE_PERIOD_MS;
+#if CONFIG_PM_ENABLE
+  esp_pm_lock_release(g_frame_lock);
+#endif
+  ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(period_ms));
+#if CONFIG_PM_ENABLE
+  esp_pm_lock_acquire(g_frame_lock);
+#endif
+}
+
+void power_frame_flushed(void) {
+  if (!g_stats.boot_us && g_running) {
+    // esp_timer starts early in startup: ROM and bootloader time excluded
+    g_stats.boot_us = esp_timer_get_time();
+    ESP_LOGI(TAG, "first frame %lu us after %s", g_stats.boot_us,
+             g_stats.deep_wake ? "deep sleep" : "a cold boot");
+  }
+  if (!g_wake_us) {
+    return;
+  }
+  g_stats.wake_us = esp_timer_get_time() - g_wake_us;
+  if (g_stats.wake_us > g_stats.wake_max_us) {
+    g_stats.wake_max_us = g_stats.wake_us;
+  }
+  g_wake_us = 0;
+  ESP_LOGI(TAG, "woke to first frame in %lu us", g_stats.wake_us);
+}
+
+void power_get_stats(power_stats_t *stats) { *stats = g_stats; }
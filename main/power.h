@@ -0,0 +1,48 @@
+#ifndef POWER_H
+#define POWER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "battery_state.h"
+#include "power_state.h"
+
+typedef struct {
+  power_state_t state;
+  uint32_t wakes;       // DIM / SLEEPY back to ACTIVE
+  uint32_t wake_us;     // input to the first flushed frame, last wake
+  uint32_t wake_max_us;
+  uint32_t boot_us; // reset to the first flushed frame
+  bool deep_wake;   // this boot came out of deep sleep
+  // Last SLEEPY stretch and the part of it in light sleep; the latter needs
+  // CONFIG_PM_LIGHT_SLEEP_CALLBACKS
+  uint32_t sleepy_ms;
+  uint32_t light_sleep_ms;
+} power_stats_t;
+
+// Take over the backlight with LEDC PWM and, when the build has power
+// management enabled, turn on DFS and automatic light sleep. SLEEPY stops the
+// keyboard scan and the mic so that light sleep can happen between frames;
+// a held key still wakes. Long inactivity ends in deep sleep, saving the eyes
+// with eye_snapshot; the G0 button wakes the chip, which then starts SLEEPY
+// and wakes after its first frame.
+void power_init(int backlight_gpio, uint32_t now_ms);
+// Report user input; safe from any task, wakes a waiting render loop
+void power_notify_input(void);
+// Render task: apply input and inactivity transitions
+void power_tick(uint32_t now_ms);
+bool power_is_sleepy(void);
+// Battery level from the battery monitor; safe from any task, applied by
+// the next power_tick(). LOW means TIRED eyes, the backlight no brighter
+// than DIM and a lower frame rate; CRITICAL goes to deep sleep.
+void power_set_battery(battery_level_t level);
+// Keep the frame rate at or below fps whatever the state, 0 for no cap
+void power_set_fps_cap(uint8_t fps);
+// Render task: block until the next frame is due or input arrives. The CPU
+// runs at full clock only outside of this.
+void power_wait(void);
+// Flush path: the last band of a frame was handed to the panel
+void power_frame_flushed(void);
+void power_get_stats(power_stats_t *stats);
+
+#endif // POWER_H
@@ -0,0 +1,50 @@
+#include "power_state.h"
+
+void power_sm_init(power_sm_t *sm, const power_config_t *cfg, uint32_t now_ms) {
+  sm->cfg = *cfg;
+  sm->state = POWER_ACTIVE;
+  sm->last_activity_ms = now_ms;
+}
+
+bool power_sm_activity(power_sm_t *sm, uint32_t now_ms) {
+  bool woke = sm->state != POWER_ACTIVE;
+  sm->state = POWER_ACTIVE;
+  sm->last_activity_ms = now_ms;
+  return woke;
+}
+
+bool power_sm_tick(power_sm_t *sm, uint32_t now_ms) {
+  // Unsigned difference, correct across the millisecond counter wrapping
+  uint32_t idle = now_ms - sm->last_activity_ms;
+  power_state_t next = POWER_ACTIVE;
+  if (sm->cfg.deep_after_ms && idle >= sm->cfg.deep_after_ms) {
+    next = POWER_DEEP_SLEEP;
+  } else if (idle >= sm->cfg.sleepy_after_ms) {
+    next = POWER_SLEEPY;
+  } else if (idle >= sm->cfg.dim_after_ms) {
+    next = POWER_DIM;
+  }
+  // Only activity brings the state back up
+  if (next <= sm->state) {
+    return false;
+  }
+  sm->state = next;
+  return true;
+}
+
+uint8_t power_sm_backlight(const power_sm_t *sm) {
+  switch (sm->state) {
+  case POWER_DIM:
+    return sm->cfg.dim_level;
+  case POWER_SLEEPY:
+    return sm->cfg.sleepy_level;
+  case POWER_DEEP_SLEEP:
+    return 0;
+  default:
+    return sm->cfg.active_level;
+  }
+}
+
+uint8_t power_sm_fps(const power_sm_t *sm) {
+  return sm->state >= POWER_SLEEPY ? sm->cfg.sleepy_fps : sm->cfg.active_fps;
+}
@@ -0,0 +1,50 @@
+#ifndef POWER_STATE_H
+#define POWER_STATE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Inactivity state machine behind the power manager. Time comes in as a
+// parameter so it runs the same against a simulated clock.
+typedef enum {
+  POWER_ACTIVE,     // full brightness and frame rate
+  POWER_DIM,        // backlight lowered
+  POWER_SLEEPY,     // backlight at minimum, sleepy eyes at a low frame rate
+  POWER_DEEP_SLEEP, // eyes saved to RTC memory, the chip in deep sleep
+} power_state_t;
+
+typedef struct {
+  uint32_t dim_after_ms;    // inactivity before dimming
+  uint32_t sleepy_after_ms; // inactivity before sleepy eyes
+  uint32_t deep_after_ms;   // inactivity before deep sleep, 0 = never
+  uint8_t active_level;     // backlight, 0..255
+  uint8_t dim_level;
+  uint8_t sleepy_level;
+  uint16_t fade_ms; // backlight fade between levels
+  uint8_t active_fps;
+  uint8_t sleepy_fps;
+} power_config_t;
+
+#define POWER_DEFAULT_CONFIG()                                                 \
+  {                                                                            \
+    .dim_after_ms = 30000, .sleepy_after_ms = 120000, .deep_after_ms = 600000, \
+    .active_level = 255, .dim_level = 64, .sleepy_level = 12, .fade_ms = 800,  \
+    .active_fps = 100, .sleepy_fps = 10,                                       \
+  }
+
+typedef struct {
+  power_config_t cfg;
+  power_state_t state;
+  uint32_t last_activity_ms;
+} power_sm_t;
+
+void power_sm_init(power_sm_t *sm, const power_config_t *cfg, uint32_t now_ms);
+// Input happened; returns true if it woke the machine from DIM or SLEEPY
+bool power_sm_activity(power_sm_t *sm, uint32_t now_ms);
+// Advance on inactivity; returns true if the state changed
+bool power_sm_tick(power_sm_t *sm, uint32_t now_ms);
+// Backlight level and frame rate for the current state
+uint8_t power_sm_backlight(const power_sm_t *sm);
+uint8_t power_sm_fps(const power_sm_t *sm);
+
+#endif // POWER_STATE_H
@@ -0,0 +1,44 @@
+#include "qos.h"
+#include "eye_style.h"
+#include "half_res.h"
+#include "power.h"
+
+#include "FluxGarage_RoboEyes.h"
+
+#include "esp_log.h"
+
+static const char *TAG = "qos";
+
+static qos_sm_t g_sm;
+static qos_stats_t g_stats;
+
+void qos_init(void) {
+  qos_config_t cfg = QOS_DEFAULT_CONFIG();
+  qos_sm_init(&g_sm, &cfg);
+}
+
+static void qos_apply(void) {
+  RoboEyes_setLowDetail(qos_sm_has(&g_sm, QOS_STEP_SWEAT));
+  eye_style_force_flat(qos_sm_has(&g_sm, QOS_STEP_FLAT));
+  half_res_force(qos_sm_has(&g_sm, QOS_STEP_HALF_RES));
+  power_set_fps_cap(qos_sm_has(&g_sm, QOS_STEP_FPS) ? g_sm.cfg.low_fps : 0);
+  ESP_LOGI(TAG, "level %u after %lu frames, %lu missed", g_sm.level,
+           g_sm.frames, g_sm.misses);
+}
+
+void qos_frame(uint32_t frame_us) {
+  if (qos_sm_frame(&g_sm, frame_us, RoboEyes_getFrameInterval() * 1000)) {
+    qos_apply();
+  }
+  if (frame_us > g_stats.frame_max_us) {
+    g_stats.frame_max_us = frame_us;
+  }
+}
+
+void qos_get_stats(qos_stats_t *stats) {
+  *stats = g_stats;
+  stats->level = g_sm.level;
+  stats->transitions = g_sm.transitions;
+  stats->frames = g_sm.frames;
+  stats->misses = g_sm.misses;
+}
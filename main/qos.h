@@ -0,0 +1,22 @@
+#ifndef QOS_H
+#define QOS_H
+
+#include <stdint.h>
+
+#include "qos_state.h"
+
+typedef struct {
+  uint8_t level;        // steps taken down the ladder
+  uint32_t transitions; // steps down and back up
+  uint32_t frames;
+  uint32_t misses; // frames over their budget
+  uint32_t frame_max_us;
+} qos_stats_t;
+
+void qos_init(void);
+// Render task: a frame took frame_us from RoboEyes_update() to its last band
+// being flushed; the budget is RoboEyes' frame interval
+void qos_frame(uint32_t frame_us);
+void qos_get_stats(qos_stats_t *stats);
+
+#endif // QOS_H
@@ -0,0 +1,75 @@
+#include "qos_state.h"
+
+#include <string.h>
+
+void qos_sm_init(qos_sm_t *sm, const qos_config_t *cfg) {
+  memset(sm, 0, sizeof(*sm));
+  sm->cfg = *cfg;
+  if (sm->cfg.ladder_len > QOS_STEP_COUNT) {
+    sm->cfg.ladder_len = QOS_STEP_COUNT;
+  }
+}
+
+static void qos_sm_change(qos_sm_t *sm, bool up) {
+  // Climbing back too early is what makes the level oscillate
+  if (!up && sm->last_up && sm->since_change < sm->cfg.up_frames) {
+    if (sm->backoff < QOS_MAX_BACKOFF) {
+      sm->backoff++;
+    }
+  }
+  sm->level += up ? -1 : 1;
+  sm->last_up = up;
+  sm->transitions++;
+  sm->since_change = 0;
+  sm->window_frames = 0;
+  sm->window_misses = 0;
+  sm->headroom_run = 0;
+}
+
+bool qos_sm_frame(qos_sm_t *sm, uint32_t frame_us, uint32_t budget_us) {
+  sm->frames++;
+  sm->since_change++;
+  sm->window_frames++;
+  if (sm->last_up && sm->since_change == sm->cfg.up_frames) {
+    sm->backoff = 0; // the last step up held
+  }
+
+  // Between headroom and a miss is the hysteresis band: it neither steps
+  // down nor counts towards stepping up
+  if (frame_us > budget_us) {
+    sm->misses++;
+    sm->window_misses++;
+    sm->headroom_run = 0;
+  } else if ((uint64_t)frame_us * 100 <= (uint64_t)budget_us * sm->cfg.up_pct) {
+    if (sm->headroom_run < UINT16_MAX) {
+      sm->headroom_run++;
+    }
+  } else {
+    sm->headroom_run = 0;
+  }
+
+  if (sm->window_misses >= sm->cfg.down_misses &&
+      sm->level < sm->cfg.ladder_len) {
+    qos_sm_change(sm, false);
+    return true;
+  }
+  if (sm->window_frames >= sm->cfg.window) {
+    sm->window_frames = 0;
+    sm->window_misses = 0;
+  }
+  if (sm->level > 0 &&
+      sm->headroom_run >= (uint32_t)sm->cfg.up_frames << sm->backoff) {
+    qos_sm_change(sm, true);
+    return true;
+  }
+  return false;
+}
+
+bool qos_sm_has(const qos_sm_t *sm, qos_step_t step) {
+  for (int i = 0; i < sm->level; i++) {
+    if (sm->cfg.ladder[i] == step) {
+      return true;
+    }
+  }
+  return false;
+}
@@ -0,0 +1,62 @@
+#ifndef QOS_STATE_H
+#define QOS_STATE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Frame deadline quality of service. Frames that overrun their budget walk
+// the quality down a ladder of steps; a run of frames with headroom walks it
+// back up. Times come in as parameters so it runs the same against a
+// synthetic load.
+typedef enum {
+  QOS_STEP_SWEAT,    // hide the sweat particles
+  QOS_STEP_FLAT,     // flat eye style, no gradient or glow
+  QOS_STEP_HALF_RES, // draw at half resolution, still or not
+  QOS_STEP_FPS,      // cap the frame rate at low_fps
+  QOS_STEP_COUNT,
+} qos_step_t;
+
+typedef struct {
+  uint8_t ladder[QOS_STEP_COUNT]; // qos_step_t, in the order they are taken
+  uint8_t ladder_len;
+  uint8_t window;      // frames over which misses are counted
+  uint8_t down_misses; // misses within a window that take a step down
+  uint8_t up_pct;      // frames under this % of the budget have headroom
+  uint16_t up_frames;  // headroom frames in a row that take a step up
+  uint8_t low_fps;
+} qos_config_t;
+
+#define QOS_DEFAULT_CONFIG()                                                   \
+  {                                                                            \
+    .ladder = {QOS_STEP_SWEAT, QOS_STEP_FLAT, QOS_STEP_HALF_RES,               \
+               QOS_STEP_FPS},                                                  \
+    .ladder_len = 4,                                                           \
+    .window = 16, .down_misses = 3, .up_pct = 85, .up_frames = 200,            \
+    .low_fps = 40,                                                             \
+  }
+
+// A step down within up_frames of a step up doubles the headroom run needed
+// for the next step up, up to 1 << QOS_MAX_BACKOFF times
+#define QOS_MAX_BACKOFF 2
+
+typedef struct {
+  qos_config_t cfg;
+  uint8_t level; // steps taken, 0 = full quality
+  uint8_t window_frames;
+  uint8_t window_misses;
+  uint16_t headroom_run;
+  uint8_t backoff;
+  bool last_up;          // the last transition was a step up
+  uint32_t since_change; // frames since the last transition
+  uint32_t frames;
+  uint32_t misses;
+  uint32_t transitions;
+} qos_sm_t;
+
+void qos_sm_init(qos_sm_t *sm, const qos_config_t *cfg);
+// A frame took frame_us against budget_us; returns true if the level changed
+bool qos_sm_frame(qos_sm_t *sm, uint32_t frame_us, uint32_t budget_us);
+// Whether a step is taken at the current level
+bool qos_sm_has(const qos_sm_t *sm, qos_step_t step);
+
+#endif // QOS_STATE_H
@@ -0,0 +1,508 @@
+#include "raster.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define RASTER_SUBSAMPLES 4 // per axis
+
+// Corner tables are (radius + glow)^2 bytes, [0][0] being the outermost
+// pixel: coverage levels when glow is 0, else glow distances
+typedef struct {
+  int radius; // 0 = unused
+  int glow;
+  uint32_t last_use;
+  uint8_t *tab;
+  int cap;
+} raster_corner_t;
+
+// Glow colour rows of a shape, see glow_rows()
+typedef struct {
+  int w; // 0 = unused
+  int radius;
+  int glow;
+  uint16_t colors[RASTER_GLOW_MAX + 2]; // the target's glow_colors
+  uint32_t last_use;
+  uint16_t *rows;
+  int cap; // pixels
+  // Pixels to light at each end of a row, in whole blocks: the middle of
+  // the rows level with the shape is left to its fill
+  uint16_t ends[RASTER_MAX_RADIUS + RASTER_GLOW_MAX + 1];
+} raster_glow_t;
+
+static raster_corner_t corners[RASTER_CORNER_SLOTS];
+static raster_glow_t glows[RASTER_GLOW_SLOTS];
+static uint32_t use_clock;
+static raster_stats_t stats;
+
+// Blend two RGB565 colours with a 0..32 weight for a, all channels at once
+static uint16_t blend565(uint16_t a, uint16_t b, unsigned w) {
+  uint32_t pa = (a | ((uint32_t)a << 16)) & 0x07e0f81f;
+  uint32_t pb = (b | ((uint32_t)b << 16)) & 0x07e0f81f;
+  uint32_t p = (pb + (((pa - pb) * w) >> 5)) & 0x07e0f81f;
+  return p | (p >> 16);
+}
+
+static unsigned level_weight(unsigned level) {
+  return (level * 32 + (RASTER_LEVELS - 1) / 2) / (RASTER_LEVELS - 1);
+}
+
+// Coverage of the top left quarter of a circle of radius r centred on the
+// corner of pixel (r, r), 4x4 samples per pixel, in 1/8 pixel units
+static void build_corner(uint8_t *cov, int r) {
+  const int s = 2 * RASTER_SUBSAMPLES;
+  const int32_t rr = (int32_t)(s * r) * (s * r);
+  for (int y = 0; y < r; y++) {
+    for (int x = 0; x < r; x++) {
+      int hits = 0;
+      for (int j = 0; j < RASTER_SUBSAMPLES; j++) {
+        int32_t dy = s * r - (s * y + 2 * j + 1);
+        for (int i = 0; i < RASTER_SUBSAMPLES; i++) {
+          int32_t dx = s * r - (s * x + 2 * i + 1);
+          hits += dx * dx + dy * dy <= rr;
+        }
+      }
+      const int n = RASTER_SUBSAMPLES * RASTER_SUBSAMPLES;
+      cov[y * r + x] = (hits * (RASTER_LEVELS - 1) + n / 2) / n;
+    }
+  }
+}
+
+// Distance in whole pixels from each pixel centre in the corner of a glow of
+// size g around radius r to the shape, 0 inside it, g + 1 beyond the glow
+static void build_glow(uint8_t *dist, int r, int g) {
+  const int n = r + g;
+  for (int y = 0; y < n; y++) {
+    for (int x = 0; x < n; x++) {
+      float dx = n - (x + 0.5f);
+      float dy = n - (y + 0.5f);
+      float d = sqrtf(dx * dx + dy * dy) - r;
+      int k = d <= 0 ? 0 : (int)ceilf(d);
+      dist[y * n + x] = k > g ? g + 1 : k;
+    }
+  }
+}
+
+static const uint8_t *corner_table(int r, int glow) {
+  raster_corner_t *victim = &corners[0];
+  use_clock++;
+  for (int i = 0; i < RASTER_CORNER_SLOTS; i++) {
+    raster_corner_t *c = &corners[i];
+    if (c->radius == r && c->glow == glow) {
+      c->last_use = use_clock;
+      stats.table_hits++;
+      return c->tab;
+    }
+    if (c->last_use < victim->last_use) {
+      victim = c;
+    }
+  }
+
+  int n = r + glow;
+  if (victim->cap < n * n) {
+    uint8_t *tab = realloc(victim->tab, n * n);
+    if (!tab) {
+      return NULL;
+    }
+    victim->tab = tab;
+    victim->cap = n * n;
+  }
+  if (glow) {
+    build_glow(victim->tab, r, glow);
+  } else {
+    build_corner(victim->tab, r);
+  }
+  victim->radius = r;
+  victim->glow = glow;
+  victim->last_use = use_clock;
+  stats.table_builds++;
+  return victim->tab;
+}
+
+void raster_target_init(raster_target_t *t, uint16_t *buf, int stride, int w,
+                        int h) {
+  raster_set_window(t, buf, stride, 0, 0, w, h);
+  raster_set_colors(t, 0x0000, 0xffff);
+}
+
+void raster_set_window(raster_target_t *t, uint16_t *buf, int stride, int x0,
+                       int y0, int w, int h) {
+  t->buf = buf;
+  t->stride = stride;
+  t->x0 = x0;
+  t->y0 = y0;
+  t->w = w;
+  t->h = h;
+}
+
+void raster_set_colors(raster_target_t *t, uint16_t bg, uint16_t fg) {
+  t->bg = bg;
+  t->fg = fg;
+  for (int i = 0; i < RASTER_LEVELS; i++) {
+    t->ramp[i] = blend565(fg, bg, level_weight(i));
+  }
+  raster_style_t flat = {.top = fg, .bottom = fg};
+  raster_set_style(t, &flat);
+}
+
+// Colour of the glow by distance from the shape. Inside it and past the
+// glow it is the background, which lights nothing: the glow loops need no
+// test for either.
+static void glow_colors(raster_target_t *t) {
+  for (int k = 0; k < RASTER_GLOW_MAX + 2; k++) {
+    bool lit = k > 0 && k <= t->glow_size;
+    t->glow_colors[k] = lit ? t->glow_ramp[t->falloff[k]] : t->bg;
+  }
+}
+
+void raster_set_style(raster_target_t *t, const raster_style_t *style) {
+  t->gradient = style->top != style->bottom || style->top != t->fg;
+  for (int i = 0; i < RASTER_GRADIENT_STEPS; i++) {
+    t->rows[i] = blend565(style->bottom, style->top,
+                          (i * 32 + RASTER_GRADIENT_STEPS / 2) /
+                              (RASTER_GRADIENT_STEPS - 1));
+  }
+
+  int g = style->glow_size < RASTER_GLOW_MAX ? style->glow_size
+                                             : RASTER_GLOW_MAX;
+  // Quadratic falloff from glow_level next to the shape to 0 past g
+  for (int k = 0; k <= g + 1; k++) {
+    int f = g + 1 - (k ? k : 1);
+    t->falloff[k] = (style->glow_level * f * f + (g + 1) * (g + 1) / 2) /
+                    ((g + 1) * (g + 1));
+  }
+  // The outermost distances can round down to no light at all: the glow
+  // ends at the last lit one, all that drawing and culling need to cover
+  while (g > 0 && !t->falloff[g]) {
+    g--;
+  }
+  t->glow_size = g;
+  for (int i = 0; i < RASTER_LEVELS; i++) {
+    t->glow_ramp[i] = blend565(style->glow, t->bg, level_weight(i));
+  }
+  glow_colors(t);
+  t->style_seq++;
+}
+
+static void fill_span(uint16_t *row, int x0, int x1, uint16_t color) {
+  for (int x = x0; x < x1; x++) {
+    row[x] = color;
+  }
+}
+
+// Paint color over *px with coverage level
+static void cover(const raster_target_t *t, uint16_t *px, unsigned level,
+                  uint16_t color) {
+  if (level == RASTER_LEVELS - 1) {
+    *px = color;
+  } else if (!level || *px == color) {
+    return;
+  } else if (color == t->fg && *px == t->bg) {
+    *px = t->ramp[level];
+  } else if (color == t->bg && *px == t->fg) {
+    *px = t->ramp[RASTER_LEVELS - 1 - level];
+  } else {
+    *px = blend565(color, *px, level_weight(level));
+  }
+}
+
+// Light the background pixels of px[0..len) with colors[0..len), len a
+// multiple of RASTER_GLOW_BLOCK. A mask select rather than a branch per
+// pixel, in whole blocks, so it vectorizes without a scalar tail.
+static inline void glow_blocks(uint16_t *restrict px,
+                               const uint16_t *restrict colors, int len,
+                               uint16_t bg) {
+  for (int x = 0; x < len; x += RASTER_GLOW_BLOCK) {
+    for (int i = x; i < x + RASTER_GLOW_BLOCK; i++) {
+      uint16_t m = -(uint16_t)(px[i] == bg);
+      px[i] = (colors[i] & m) | (px[i] & ~m);
+    }
+  }
+}
+
+// glow_blocks() over row[x0..x1) clipped to the target, colors[i] for
+// pixel x0 + i
+static void glow_clipped(const raster_target_t *t, uint16_t *row, int x0,
+                         int x1, const uint16_t *colors) {
+  int a = x0 < 0 ? 0 : x0;
+  int b = x1 > t->w ? t->w : x1;
+  for (int x = a; x < b; x++) {
+    if (row[x] == t->bg) {
+      row[x] = colors[x - x0];
+    }
+  }
+}
+
+// Row stride of the glow colour rows of a shape w wide: the glow box,
+// padded with unlit pixels to whole blocks
+static int glow_stride(int w, int g) {
+  return (w + 2 * g + RASTER_GLOW_BLOCK - 1) & -RASTER_GLOW_BLOCK;
+}
+
+// Colour rows of the glow box of a shape w wide: the r + g corner rows from
+// the top, the bottom ones being the same, then the one beside the straight
+// sides. Unlit pixels, the shape's inside included, are the background.
+static const raster_glow_t *glow_rows(const raster_target_t *t, int w,
+                                      int r) {
+  const int g = t->glow_size;
+  raster_glow_t *victim = &glows[0];
+  use_clock++;
+  for (int i = 0; i < RASTER_GLOW_SLOTS; i++) {
+    raster_glow_t *e = &glows[i];
+    if (e->w == w && e->radius == r && e->glow == g &&
+        !memcmp(e->colors, t->glow_colors, sizeof(e->colors))) {
+      e->last_use = use_clock;
+      return e;
+    }
+    if (e->last_use < victim->last_use) {
+      victim = e;
+    }
+  }
+
+  const int n = r + g;
+  const int gw = w + 2 * g;
+  const int stride = glow_stride(w, g);
+  const uint8_t *dist = corner_table(r, g);
+  if (!dist) {
+    return NULL;
+  }
+  if (victim->cap < (n + 1) * stride) {
+    uint16_t *rows = realloc(victim->rows, (n + 1) * stride * sizeof(*rows));
+    if (!rows) {
+      return NULL;
+    }
+    victim->rows = rows;
+    victim->cap = (n + 1) * stride;
+  }
+  for (int cr = 0; cr <= n; cr++) {
+    uint16_t *line = victim->rows + cr * stride;
+    // Above the shape's straight top the level goes by the row alone
+    uint16_t mid = cr < g ? t->glow_colors[g - cr] : t->bg;
+    for (int i = 0; i < gw; i++) {
+      line[i] = mid;
+    }
+    for (int i = gw; i < stride; i++) {
+      line[i] = t->bg;
+    }
+    if (cr == n) {
+      // Beside the straight sides, the distance is the span position
+      for (int k = 1; k <= g; k++) {
+        line[g - k] = line[gw - g - 1 + k] = t->glow_colors[k];
+      }
+    } else {
+      const uint8_t *d = dist + cr * n;
+      for (int i = 0; i < n; i++) {
+        line[i] = line[gw - 1 - i] = t->glow_colors[d[i]];
+      }
+    }
+    int lit = n;
+    while (lit > 0 && line[lit - 1] == t->bg) {
+      lit--;
+    }
+    lit = (lit + RASTER_GLOW_BLOCK - 1) & -RASTER_GLOW_BLOCK;
+    victim->ends[cr] = cr < g || 2 * lit >= gw ? stride : lit;
+  }
+  victim->w = w;
+  victim->radius = r;
+  victim->glow = g;
+  memcpy(victim->colors, t->glow_colors, sizeof(victim->colors));
+  victim->last_use = use_clock;
+  return victim;
+}
+
+static void draw_glow(const raster_target_t *t, int x, int y, int w, int h,
+                      int r) {
+  const int g = t->glow_size;
+  const int n = r + g; // corner size of the glow box
+  const raster_glow_t *e = glow_rows(t, w, r);
+  if (!e) {
+    return;
+  }
+
+  const int gx = x - g;
+  const int gw = w + 2 * g;
+  const int gh = h + 2 * g;
+  const int stride = glow_stride(w, g);
+  const bool inside = gx >= 0 && gx + stride <= t->w;
+  int y0 = y - g < 0 ? 0 : y - g;
+  int y1 = y + h + g > t->h ? t->h : y + h + g;
+  for (int py = y0; py < y1; py++) {
+    uint16_t *row = t->buf + py * t->stride;
+    int ry = py - (y - g);
+    int cr = ry < n ? ry : (ry >= gh - n ? gh - 1 - ry : n);
+    const uint16_t *colors = e->rows + cr * stride;
+    // A whole row, or else a run at each end
+    int end = e->ends[cr];
+    int right = end == stride ? stride : gw - end;
+    int len = end == stride ? 0 : end;
+    if (!inside) {
+      glow_clipped(t, row, gx, gx + end, colors);
+      glow_clipped(t, row, gx + right, gx + right + len, colors + right);
+      continue;
+    }
+    glow_blocks(row + gx, colors, end, t->bg);
+    glow_blocks(row + gx + right, colors + right, len, t->bg);
+  }
+}
+
+void raster_round_rect(raster_target_t *t, int x, int y, int w, int h, int r,
+                       uint16_t color) {
+  if (w <= 0 || h <= 0) {
+    return;
+  }
+  x -= t->x0;
+  y -= t->y0;
+  int shorter = w < h ? w : h;
+  r = r < shorter / 2 ? r : shorter / 2;
+  r = r < RASTER_MAX_RADIUS ? r : RASTER_MAX_RADIUS;
+  bool styled = color == t->fg;
+  if (styled && t->glow_size) {
+    draw_glow(t, x, y, w, h, r);
+  }
+  const uint8_t *cov = r > 0 ? corner_table(r, 0) : NULL;
+  if (!cov) {
+    r = 0; // out of memory: square corners rather than nothing
+  }
+
+  int cx0 = x < 0 ? 0 : x;
+  int cx1 = x + w > t->w ? t->w : x + w;
+  int cy0 = y < 0 ? 0 : y;
+  int cy1 = y + h > t->h ? t->h : y + h;
+  if (cx0 >= cx1 || cy0 >= cy1) {
+    return;
+  }
+
+  for (int py = cy0; py < cy1; py++) {
+    uint16_t *row = t->buf + py * t->stride;
+    int ry = py - y;
+    uint16_t rc = color;
+    if (styled && t->gradient) {
+      rc = t->rows[h > 1 ? ry * (RASTER_GRADIENT_STEPS - 1) / (h - 1) : 0];
+    }
+    int cr = ry < r ? ry : (ry >= h - r ? h - 1 - ry : -1);
+    if (cr < 0) {
+      fill_span(row, cx0, cx1, rc);
+      continue;
+    }
+
+    // Corner row: coverage runs from the outer edge inwards on both sides
+    const uint8_t *c = cov + cr * r;
+    for (int i = 0; i < r; i++) {
+      int lx = x + i;
+      int rx = x + w - 1 - i;
+      if (lx >= cx0 && lx < cx1) {
+        cover(t, &row[lx], c[i], rc);
+      }
+      if (rx >= cx0 && rx < cx1) {
+        cover(t, &row[rx], c[i], rc);
+      }
+    }
+    int s0 = x + r > cx0 ? x + r : cx0;
+    int s1 = x + w - r < cx1 ? x + w - r : cx1;
+    fill_span(row, s0, s1, rc);
+  }
+}
+
+void raster_triangle(raster_target_t *t, int x0, int y0, int x1, int y1,
+                     int x2, int y2, uint16_t color) {
+  x0 -= t->x0, x1 -= t->x0, x2 -= t->x0;
+  y0 -= t->y0, y1 -= t->y0, y2 -= t->y0;
+  int area = (x1 - x0) * (y2 - y0) - (x2 - x0) * (y1 - y0);
+  if (!area) {
+    return;
+  }
+  if (area < 0) {
+    int tx = x1, ty = y1;
+    x1 = x2, y1 = y2;
+    x2 = tx, y2 = ty;
+  }
+
+  int bx0 = x0 < x1 ? (x0 < x2 ? x0 : x2) : (x1 < x2 ? x1 : x2);
+  int bx1 = x0 > x1 ? (x0 > x2 ? x0 : x2) : (x1 > x2 ? x1 : x2);
+  int by0 = y0 < y1 ? (y0 < y2 ? y0 : y2) : (y1 < y2 ? y1 : y2);
+  int by1 = y0 > y1 ? (y0 > y2 ? y0 : y2) : (y1 > y2 ? y1 : y2);
+  bx0 = bx0 < 0 ? 0 : bx0;
+  by0 = by0 < 0 ? 0 : by0;
+  bx1 = bx1 >= t->w ? t->w - 1 : bx1;
+  by1 = by1 >= t->h ? t->h - 1 : by1;
+
+  // Edge functions, all >= 0 inside; stepped one pixel at a time
+  for (int py = by0; py <= by1; py++) {
+    uint16_t *row = t->buf + py * t->stride;
+    int e0 = (x1 - x0) * (py - y0) - (y1 - y0) * (bx0 - x0);
+    int e1 = (x2 - x1) * (py - y1) - (y2 - y1) * (bx0 - x1);
+    int e2 = (x0 - x2) * (py - y2) - (y0 - y2) * (bx0 - x2);
+    for (int px = bx0; px <= bx1; px++) {
+      if ((e0 | e1 | e2) >= 0) {
+        row[px] = color;
+      }
+      e0 -= y1 - y0;
+      e1 -= y2 - y1;
+      e2 -= y0 - y2;
+    }
+  }
+}
+
+void raster_fill(raster_target_t *t, uint16_t color) {
+  for (int py = 0; py < t->h; py++) {
+    fill_span(t->buf + py * t->stride, 0, t->w, color);
+  }
+}
+
+void raster_copy_half(raster_target_t *half, const raster_target_t *full) {
+  uint16_t *buf = half->buf;
+  int stride = half->stride;
+  int x0 = half->x0, y0 = half->y0, w = half->w, h = half->h;
+  *half = *full;
+  raster_set_window(half, buf, stride, x0, y0, w, h);
+  // Gradient rows go by the shape's height, so only the glow depends on
+  // the pixel size: a half pixel step is two full ones
+  const int g = full->glow_size;
+  half->glow_size = (g + 1) / 2;
+  for (int k = 0; k <= half->glow_size + 1; k++) {
+    half->falloff[k] = full->falloff[2 * k < g + 1 ? 2 * k : g + 1];
+  }
+  glow_colors(half);
+}
+
+// Stores two pixels at a time into the draw buffer
+typedef uint32_t __attribute__((may_alias)) raster_pair_t;
+
+static void upscale_row(uint16_t *d, const uint16_t *s, int x0, int w) {
+  uint16_t *end = d + w;
+  if (x0 & 1) {
+    // Starts on the right half of a source pixel
+    *d++ = *s++;
+  }
+  if ((uintptr_t)d & 2) {
+    for (; d + 1 < end; d += 2) {
+      d[0] = d[1] = *s++;
+    }
+  } else {
+    for (; d + 1 < end; d += 2) {
+      *(raster_pair_t *)d = *s++ * 0x10001u;
+    }
+  }
+  if (d < end) {
+    *d = *s;
+  }
+}
+
+void raster_upscale2x(raster_target_t *dst, const raster_target_t *half) {
+  const int sx = (dst->x0 >> 1) - half->x0;
+  const uint16_t *last = NULL;
+  for (int py = 0; py < dst->h; py++) {
+    int y = dst->y0 + py;
+    uint16_t *row = dst->buf + py * dst->stride;
+    if (y & 1 && last) {
+      // Second row of a source row: the one above already has it doubled
+      memcpy(row, last, dst->w * sizeof(*row));
+    } else {
+      upscale_row(row, half->buf + ((y >> 1) - half->y0) * half->stride + sx,
+                  dst->x0, dst->w);
+    }
+    last = row;
+  }
+}
+
+void raster_get_stats(raster_stats_t *out) { *out = stats; }
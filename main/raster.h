@@ -0,0 +1,95 @@
+#ifndef RASTER_H
+#define RASTER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Software rasterizer for the two-colour eyes into an RGB565 buffer. Rounded
+// corners are anti-aliased from cached quarter-circle coverage tables (one
+// per radius, 16 levels); an edge pixel blended between the palette's two
+// colours is a table lookup, anything else falls back to a packed blend.
+//
+// Main colour shapes can be styled: a vertical gradient looked up per row,
+// and an outer glow whose level comes from a falloff table indexed by
+// distance, straight from the span position on the sides and from a cached
+// per-radius distance table in the corners. The colours of a shape's glow
+// box rows are cached too, so drawing it is a masked copy of the lit blocks
+// of each row. Glow only lights background.
+#define RASTER_LEVELS 16
+#define RASTER_MAX_RADIUS 96 // larger radii are drawn with this one
+// Corner tables kept, least recently used go. A blink sweeps the radius
+// through 0..8, with and without glow: fewer slots would rebuild every one.
+#define RASTER_CORNER_SLOTS 24
+// Glow colour rows kept; both eyes usually share one
+#define RASTER_GLOW_SLOTS 2
+#define RASTER_GLOW_BLOCK 8 // pixels, glow rows are padded to whole blocks
+#define RASTER_GRADIENT_STEPS 32
+#define RASTER_GLOW_MAX 15 // pixels
+
+typedef struct {
+  uint16_t top;    // main colour gradient, top == bottom for a flat fill
+  uint16_t bottom;
+  uint16_t glow;
+  uint8_t glow_size;  // pixels, 0 = no glow
+  uint8_t glow_level; // intensity next to the shape, 0..RASTER_LEVELS-1
+} raster_style_t;
+
+typedef struct {
+  uint16_t *buf;
+  int stride; // pixels
+  int x0;     // screen position of buf[0], see raster_set_window()
+  int y0;
+  int w;
+  int h;
+  uint16_t bg;
+  uint16_t fg;
+  uint16_t ramp[RASTER_LEVELS]; // bg .. fg
+  // Style tables, see raster_set_style()
+  bool gradient;
+  uint16_t rows[RASTER_GRADIENT_STEPS];
+  uint8_t glow_size; // lit pixels, can be fewer than the style's
+  uint8_t falloff[RASTER_GLOW_MAX + 2]; // level by distance, 0 = inside
+  uint16_t glow_ramp[RASTER_LEVELS];    // bg .. glow
+  uint16_t glow_colors[RASTER_GLOW_MAX + 2]; // by distance, bg if unlit
+  uint16_t style_seq;                   // bumped when colours or style change
+} raster_target_t;
+
+typedef struct {
+  uint32_t table_builds; // coverage tables computed
+  uint32_t table_hits;   // draws that found theirs cached
+} raster_stats_t;
+
+void raster_target_init(raster_target_t *t, uint16_t *buf, int stride, int w,
+                        int h);
+// Point the target at a w x h window of the screen whose top left pixel is
+// x0, y0, keeping colours and style. Shapes keep screen coordinates and are
+// clipped to the window, so a frame drawn band by band matches one drawn
+// whole.
+void raster_set_window(raster_target_t *t, uint16_t *buf, int stride, int x0,
+                       int y0, int w, int h);
+// Set the background / main colour pair and rebuild the blend ramp. Resets
+// the style to a flat fill without glow.
+void raster_set_colors(raster_target_t *t, uint16_t bg, uint16_t fg);
+// Precompute the gradient rows and glow falloff for main colour shapes
+void raster_set_style(raster_target_t *t, const raster_style_t *style);
+// Fill a w x h rectangle at x, y with corners of radius r, clipped to the
+// target. r is limited to half the shorter side like LVGL's rect. Shapes in
+// the main colour get the current style.
+void raster_round_rect(raster_target_t *t, int x, int y, int w, int h, int r,
+                       uint16_t color);
+// Fill a triangle, aliased: pixels whose centre lies inside or on an edge.
+// Degenerate triangles draw nothing. Never styled.
+void raster_triangle(raster_target_t *t, int x0, int y0, int x1, int y1,
+                     int x2, int y2, uint16_t color);
+// Fill the whole target
+void raster_fill(raster_target_t *t, uint16_t color);
+// Give half the colours and style of full for drawing the same shapes at
+// half resolution: the glow is halved with them. half's window is left
+// alone.
+void raster_copy_half(raster_target_t *half, const raster_target_t *full);
+// Double the pixels of half, drawn at half resolution, into dst's window:
+// dst's pixel x, y is half's x / 2, y / 2, which its window must cover
+void raster_upscale2x(raster_target_t *dst, const raster_target_t *half);
+void raster_get_stats(raster_stats_t *stats);
+
+#endif // RASTER_H
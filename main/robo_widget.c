@@ -0,0 +1,130 @@
+#include "robo_widget.h"
+
+// The draw event writes into the layer's buffer and needs its internals
+#include "lvgl/lvgl_private.h"
+
+typedef struct {
+  lv_obj_t obj;
+  raster_target_t *raster;
+  const eye_list_t *list;
+  lv_area_t dirty; // what the shown list covers on screen
+  uint16_t *half;  // scratch while drawing at half resolution
+  int half_px;
+} robo_widget_t;
+
+static void robo_widget_event(const lv_obj_class_t *class_p, lv_event_t *e);
+
+static const lv_obj_class_t robo_widget_class = {
+    .base_class = &lv_obj_class,
+    .event_cb = robo_widget_event,
+    .width_def = LV_PCT(100),
+    .height_def = LV_PCT(100),
+    .instance_size = sizeof(robo_widget_t),
+    .name = "robo_eyes",
+};
+
+static const eye_list_t empty_list = {.x1 = 0, .y1 = 0, .x2 = -1, .y2 = -1};
+
+lv_obj_t *robo_widget_create(lv_obj_t *parent, raster_target_t *raster) {
+  lv_obj_t *obj = lv_obj_class_create_obj(&robo_widget_class, parent);
+  lv_obj_class_init_obj(obj);
+  robo_widget_t *w = (robo_widget_t *)obj;
+  w->raster = raster;
+  w->list = &empty_list;
+  w->dirty = (lv_area_t){.x1 = 0, .y1 = 0, .x2 = -1, .y2 = -1};
+  w->half = NULL;
+  // The eyes paint every pixel of the object themselves: no theme styles,
+  // and nothing to click or scroll
+  lv_obj_remove_style_all(obj);
+  lv_obj_remove_flag(obj, LV_OBJ_FLAG_CLICKABLE | LV_OBJ_FLAG_SCROLLABLE);
+  return obj;
+}
+
+void robo_widget_show(lv_obj_t *obj, const eye_list_t *list) {
+  robo_widget_t *w = (robo_widget_t *)obj;
+  lv_area_t last = w->dirty;
+  w->list = list;
+  w->dirty = (lv_area_t){.x1 = 0, .y1 = 0, .x2 = -1, .y2 = -1};
+  if (list->x2 >= list->x1) {
+    int g = w->raster->glow_size;
+    w->dirty = (lv_area_t){.x1 = obj->coords.x1 + list->x1 - g,
+                           .y1 = obj->coords.y1 + list->y1 - g,
+                           .x2 = obj->coords.x1 + list->x2 + g,
+                           .y2 = obj->coords.y1 + list->y2 + g};
+    if (w->half) {
+      // Halved edges round outwards, a shape kept one pixel wide by up to
+      // two screen pixels: whole pixel pairs, two further at the far end
+      w->dirty.x1 &= ~1;
+      w->dirty.y1 &= ~1;
+      w->dirty.x2 = (w->dirty.x2 + 2) | 1;
+      w->dirty.y2 = (w->dirty.y2 + 2) | 1;
+    }
+    lv_obj_invalidate_area(obj, &w->dirty);
+  }
+  if (last.x2 >= last.x1) {
+    lv_obj_invalidate_area(obj, &last);
+  }
+}
+
+void robo_widget_move(lv_obj_t *obj, const eye_list_t *list, int dx) {
+  robo_widget_t *w = (robo_widget_t *)obj;
+  w->list = list;
+  if (w->dirty.x2 >= w->dirty.x1) {
+    w->dirty.x1 += dx;
+    w->dirty.x2 += dx;
+  }
+}
+
+void robo_widget_set_half_res(lv_obj_t *obj, uint16_t *scratch,
+                              int scratch_px) {
+  // Takes effect with the next list shown, which redraws all the eyes
+  robo_widget_t *w = (robo_widget_t *)obj;
+  w->half = scratch;
+  w->half_px = scratch_px;
+}
+
+static void robo_widget_draw(robo_widget_t *w, lv_layer_t *layer) {
+  lv_obj_t *obj = &w->obj;
+  lv_area_t clip;
+  if (layer->color_format != LV_COLOR_FORMAT_RGB565 ||
+      !lv_area_intersect(&clip, &layer->_clip_area, &obj->coords)) {
+    return;
+  }
+  // Pixels go straight into the layer, so what LVGL has queued for it so
+  // far (objects under the eyes) must land first
+  while (layer->draw_task_head) {
+    lv_draw_dispatch_wait_for_request();
+    lv_draw_dispatch();
+  }
+  lv_draw_buf_t *buf = layer->draw_buf;
+  uint16_t *px = lv_draw_buf_goto_xy(buf, clip.x1 - layer->buf_area.x1,
+                                     clip.y1 - layer->buf_area.y1);
+  raster_set_window(w->raster, px, buf->header.stride / sizeof(uint16_t),
+                    clip.x1 - obj->coords.x1, clip.y1 - obj->coords.y1,
+                    lv_area_get_width(&clip), lv_area_get_height(&clip));
+  if (w->half) {
+    eye_list_render_half(w->list, w->raster, w->half, w->half_px);
+  } else {
+    eye_list_render(w->list, w->raster);
+  }
+}
+
+static void robo_widget_event(const lv_obj_class_t *class_p, lv_event_t *e) {
+  if (lv_obj_event_base(&robo_widget_class, e) != LV_RESULT_OK) {
+    return;
+  }
+  robo_widget_t *w = (robo_widget_t *)lv_event_get_current_target(e);
+  switch (lv_event_get_code(e)) {
+  case LV_EVENT_COVER_CHECK:
+    // Opaque everywhere: LVGL can skip drawing what lies beneath
+    if (lv_area_is_in(lv_event_get_cover_area(e), &w->obj.coords, 0)) {
+      lv_event_set_cover_res(e, LV_COVER_RES_COVER);
+    }
+    break;
+  case LV_EVENT_DRAW_MAIN:
+    robo_widget_draw(w, lv_event_get_layer(e));
+    break;
+  default:
+    break;
+  }
+}
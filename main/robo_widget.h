@@ -0,0 +1,25 @@
+#ifndef ROBO_WIDGET_H
+#define ROBO_WIDGET_H
+
+#include "eye_list.h"
+#include "lvgl/lvgl.h"
+#include "raster.h"
+
+// The eyes as an LVGL object. Its draw event rasterizes the shown display
+// list for whatever area LVGL is refreshing, so labels and menus created
+// after it are drawn over the eyes and only the invalidated regions are
+// redrawn. Eye coordinates are relative to the object.
+lv_obj_t *robo_widget_create(lv_obj_t *parent, raster_target_t *raster);
+// Draw list from the next refresh on; invalidates what the last and this
+// list cover, glow included. The list must stay unchanged until replaced.
+void robo_widget_show(lv_obj_t *obj, const eye_list_t *list);
+// Take list, the shown one moved dx along x, without redrawing: the caller
+// has already moved the picture on the panel
+void robo_widget_move(lv_obj_t *obj, const eye_list_t *list, int dx);
+// Draw at half resolution from the next refresh on, doubling the pixels:
+// scratch holds the half resolution window of one draw area (see
+// eye_list_render_half()). NULL goes back to full resolution.
+void robo_widget_set_half_res(lv_obj_t *obj, uint16_t *scratch,
+                              int scratch_px);
+
+#endif // ROBO_WIDGET_H
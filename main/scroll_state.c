@@ -0,0 +1,99 @@
+#include "scroll_state.h"
+
+#include <string.h>
+
+void scroll_sm_init(scroll_sm_t *sm, const scroll_config_t *cfg) {
+  memset(sm, 0, sizeof(*sm));
+  sm->cfg = *cfg;
+}
+
+static void put16(uint8_t *p, int v) {
+  p[0] = v >> 8;
+  p[1] = v & 0xff;
+}
+
+// Scroll start address showing memory column offset at screen column 0
+static void send_start(const scroll_sm_t *sm, scroll_cmd_t cmd, void *ctx) {
+  const panel_geometry_t *panel = &sm->cfg.panel;
+  // Reversed, the lines scan from the far end of the screen: the start
+  // line moves the other way
+  int lines = panel->mirrored ? (panel->width - sm->offset) % panel->width
+                              : sm->offset;
+  uint8_t start[2];
+  put16(start, panel_top_line(panel) + lines);
+  cmd(ctx, ST7789_VSCSAD, start, sizeof(start));
+}
+
+void scroll_sm_define(scroll_sm_t *sm, scroll_cmd_t cmd, void *ctx) {
+  const panel_geometry_t *panel = &sm->cfg.panel;
+  int top = panel_top_line(panel);
+  uint8_t def[6];
+  put16(def, top);
+  put16(def + 2, panel->width);
+  put16(def + 4, panel->gate_lines - top - panel->width);
+  cmd(ctx, ST7789_VSCRDEF, def, sizeof(def));
+  sm->offset = 0;
+  send_start(sm, cmd, ctx);
+}
+
+bool scroll_sm_pays(const scroll_sm_t *sm, int dx) {
+  return dx && dx <= sm->cfg.max_shift && -dx <= sm->cfg.max_shift;
+}
+
+bool scroll_sm_move(scroll_sm_t *sm, int dx, scroll_cmd_t cmd, void *ctx) {
+  int w = sm->cfg.panel.width;
+  if (!scroll_sm_pays(sm, dx)) {
+    return false;
+  }
+  // Screen column x now shows what column x - dx did
+  sm->offset = ((sm->offset - dx) % w + w) % w;
+  send_start(sm, cmd, ctx);
+  sm->scrolls++;
+  return true;
+}
+
+void scroll_sm_exposed(const scroll_sm_t *sm, int dx, int *x1, int *x2) {
+  if (dx > 0) {
+    *x1 = 0;
+    *x2 = dx - 1;
+  } else {
+    *x1 = sm->cfg.panel.width + dx;
+    *x2 = sm->cfg.panel.width - 1;
+  }
+}
+
+bool scroll_sm_splits(const scroll_sm_t *sm, int x, int w) {
+  const int width = sm->cfg.panel.width;
+  return (x + sm->offset) % width + w > width;
+}
+
+int scroll_sm_pack(scroll_sm_t *sm, int x, int w, int h, uint16_t *px,
+                   uint16_t *park, scroll_piece_t pieces[2]) {
+  const int width = sm->cfg.panel.width;
+  int mx = (x + sm->offset) % width;
+  if (mx + w <= width) {
+    pieces[0] = (scroll_piece_t){.x = mx, .w = w, .px = px};
+    return 1;
+  }
+  // Left of the wrap to the end of memory, the rest from its start
+  int wl = width - mx;
+  int wr = w - wl;
+  bool park_left = wl <= wr;
+  int ws = park_left ? wl : wr;
+  int wb = w - ws;
+  int s0 = park_left ? 0 : wl; // first column of each part in a row
+  int b0 = park_left ? wl : 0;
+  for (int r = 0; r < h; r++) {
+    memcpy(park + r * ws, px + r * w + s0, ws * sizeof(*px));
+  }
+  // Each row moves down to where it is packed, never past a later one
+  for (int r = 0; r < h; r++) {
+    memmove(px + r * wb, px + r * w + b0, wb * sizeof(*px));
+  }
+  scroll_piece_t left = {.x = mx, .w = wl, .px = park_left ? park : px};
+  scroll_piece_t right = {.x = 0, .w = wr, .px = park_left ? px : park};
+  pieces[0] = left;
+  pieces[1] = right;
+  sm->split_flushes++;
+  return 2;
+}
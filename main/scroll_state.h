@@ -0,0 +1,71 @@
+#ifndef SCROLL_STATE_H
+#define SCROLL_STATE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "panel_geometry.h"
+
+// ST7789 vertical scroll as a horizontal shift. With the panel turned by
+// MADCTL MV, the scroll area's lines are screen columns: moving the scroll
+// start address (VSCSAD) slides the whole picture sideways without sending
+// a pixel, wrapping the columns pushed off one edge in at the other. When
+// the eyes only move along x, the frame becomes a scroll plus a redraw of
+// the columns that wrapped in.
+//
+// From then on screen column x lives in panel memory column
+// (x + offset) % width, so every area flushed goes to its memory columns,
+// as two transfers when it straddles the wrap. Commands come in as
+// parameters so it runs the same against a mock panel.
+#define ST7789_VSCRDEF 0x33
+#define ST7789_VSCSAD 0x37
+
+typedef struct {
+  panel_geometry_t panel; // its screen columns are the scroll area
+  uint8_t max_shift;      // larger moves are redrawn
+} scroll_config_t;
+
+#define SCROLL_DEFAULT_CONFIG()                                                \
+  {                                                                            \
+    .panel = PANEL_GEOMETRY_CARDPUTER(), .max_shift = 64,                      \
+  }
+
+typedef void (*scroll_cmd_t)(void *ctx, uint8_t cmd, const uint8_t *data,
+                             size_t len);
+
+typedef struct {
+  scroll_config_t cfg;
+  int offset; // memory column of screen column 0
+  uint32_t scrolls;
+  uint32_t split_flushes; // areas sent as two transfers
+} scroll_sm_t;
+
+// One transfer of a flushed area: w memory columns from x, pixels packed
+typedef struct {
+  int x;
+  int w;
+  uint16_t *px;
+} scroll_piece_t;
+
+void scroll_sm_init(scroll_sm_t *sm, const scroll_config_t *cfg);
+// Define the scroll area as the screen's columns and reset the offset
+void scroll_sm_define(scroll_sm_t *sm, scroll_cmd_t cmd, void *ctx);
+// Whether a move of dx columns is worth a scroll rather than a redraw
+bool scroll_sm_pays(const scroll_sm_t *sm, int dx);
+// The picture moves dx columns to the right. Returns true if it was
+// scrolled: the caller then redraws the |dx| columns at the edge it moved
+// away from, see scroll_sm_exposed(). False if it does not pay off.
+bool scroll_sm_move(scroll_sm_t *sm, int dx, scroll_cmd_t cmd, void *ctx);
+// Screen columns x1..x2 that wrapped in after a move of dx
+void scroll_sm_exposed(const scroll_sm_t *sm, int dx, int *x1, int *x2);
+// Whether screen columns x..x+w-1 straddle the wrap in panel memory
+bool scroll_sm_splits(const scroll_sm_t *sm, int x, int w);
+// Where the w x h pixels of screen columns x..x+w-1 go in panel memory.
+// Returns 1 piece, px itself, or 2 when the area straddles the wrap: the
+// narrower one is copied to park (w / 2 * h pixels), the other is packed
+// in place, overwriting px.
+int scroll_sm_pack(scroll_sm_t *sm, int x, int w, int h, uint16_t *px,
+                   uint16_t *park, scroll_piece_t pieces[2]);
+
+#endif // SCROLL_STATE_H
@@ -0,0 +1,79 @@
+#include "text_overlay.h"
+
+#include <assert.h>
+#include <string.h>
+
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+static const char *TAG = "text_overlay";
+
+static lv_obj_t *g_text_canvas;
+static uint16_t *g_band;
+static int g_band_w;
+static char g_text[TEXT_OVERLAY_MAX_LEN + 1];
+static glyph_size_t g_size;
+static text_overlay_stats_t g_stats;
+
+void text_overlay_init(lv_obj_t *parent, int width) {
+  glyph_atlas_init();
+
+  g_band_w = width;
+  size_t band_size = width * TEXT_OVERLAY_HEIGHT * sizeof(uint16_t);
+  g_band = heap_caps_malloc(band_size, MALLOC_CAP_INTERNAL);
+  assert(g_band);
+
+  // A canvas of its own: text changes invalidate just this band, and LVGL
+  // composes it over the eyes like any other widget
+  g_text_canvas = lv_canvas_create(parent);
+  lv_canvas_set_buffer(g_text_canvas, g_band, width, TEXT_OVERLAY_HEIGHT,
+                       LV_COLOR_FORMAT_RGB565);
+  lv_obj_align(g_text_canvas, LV_ALIGN_BOTTOM_MID, 0, 0);
+  lv_obj_add_flag(g_text_canvas, LV_OBJ_FLAG_HIDDEN);
+
+  g_stats.footprint = glyph_atlas_footprint(GLYPH_SIZE_SMALL) +
+                      glyph_atlas_footprint(GLYPH_SIZE_LARGE) + band_size;
+  ESP_LOGI(TAG, "atlas %u + %u bytes, band %u bytes",
+           (unsigned)glyph_atlas_footprint(GLYPH_SIZE_SMALL),
+           (unsigned)glyph_atlas_footprint(GLYPH_SIZE_LARGE),
+           (unsigned)band_size);
+}
+
+void text_overlay_set(const char *text, glyph_size_t size) {
+  if (size == g_size && strncmp(text, g_text, TEXT_OVERLAY_MAX_LEN) == 0) {
+    return;
+  }
+  strncpy(g_text, text, TEXT_OVERLAY_MAX_LEN);
+  g_size = size;
+
+  if (!g_text[0]) {
+    lv_obj_add_flag(g_text_canvas, LV_OBJ_FLAG_HIDDEN);
+    return;
+  }
+
+  int64_t start = esp_timer_get_time();
+  uint16_t fg = lv_color_to_u16(lv_color_white());
+  uint16_t bg = lv_color_to_u16(lv_color_black());
+  memset(g_band, 0, g_band_w * TEXT_OVERLAY_HEIGHT * sizeof(uint16_t));
+  int x = (g_band_w - glyph_text_width(g_text, size)) / 2;
+  int y = (TEXT_OVERLAY_HEIGHT - GLYPH_CELL_H(size)) / 2;
+  g_stats.glyphs = glyph_draw_run(g_band, g_band_w, g_band_w,
+                                  TEXT_OVERLAY_HEIGHT, x, y, g_text, size, fg,
+                                  bg);
+  g_stats.render_us = esp_timer_get_time() - start;
+  g_stats.renders++;
+
+  lv_obj_remove_flag(g_text_canvas, LV_OBJ_FLAG_HIDDEN);
+  lv_obj_invalidate(g_text_canvas);
+}
+
+bool text_overlay_area(lv_area_t *area) {
+  if (!g_text_canvas || lv_obj_has_flag(g_text_canvas, LV_OBJ_FLAG_HIDDEN)) {
+    return false;
+  }
+  lv_obj_get_coords(g_text_canvas, area);
+  return true;
+}
+
+void text_overlay_get_stats(text_overlay_stats_t *stats) { *stats = g_stats; }
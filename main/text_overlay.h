@@ -0,0 +1,31 @@
+#ifndef TEXT_OVERLAY_H
+#define TEXT_OVERLAY_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "glyph_atlas.h"
+#include "lvgl/lvgl.h"
+
+#define TEXT_OVERLAY_HEIGHT 16 // one line of GLYPH_SIZE_LARGE
+#define TEXT_OVERLAY_MAX_LEN 40
+
+typedef struct {
+  uint32_t renders;     // band re-rasterizations
+  uint32_t glyphs;      // drawn by the last render
+  uint32_t render_us;   // time of the last render
+  uint32_t footprint;   // atlas plus band buffer bytes
+} text_overlay_stats_t;
+
+// Reserve a band of the given width at the bottom of parent. The overlay
+// stays hidden until text is set.
+void text_overlay_init(lv_obj_t *parent, int width);
+// Show a line of text centred in the band; an empty string hides it. Only
+// re-rasterizes and invalidates the band when text or size change. Call
+// from the LVGL task.
+void text_overlay_set(const char *text, glyph_size_t size);
+// Screen area the overlay covers while shown; false when hidden
+bool text_overlay_area(lv_area_t *area);
+void text_overlay_get_stats(text_overlay_stats_t *stats);
+
+#endif // TEXT_OVERLAY_H
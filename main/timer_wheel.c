@@ -0,0 +1,75 @@
+#include "timer_wheel.h"
+
+#include <stddef.h>
+#include <string.h>
+
+void tw_init(tw_wheel_t *wheel, uint32_t now_ms) {
+  memset(wheel, 0, sizeof(*wheel));
+  wheel->tick_ms = now_ms;
+}
+
+void tw_cancel(tw_wheel_t *wheel, tw_timer_t *timer) {
+  if (!timer->armed) {
+    return;
+  }
+  tw_timer_t **link = &wheel->slots[timer->expires & (TW_SLOTS - 1)];
+  while (*link && *link != timer) {
+    link = &(*link)->next;
+  }
+  if (*link) {
+    *link = timer->next;
+  }
+  timer->armed = false;
+}
+
+void tw_schedule(tw_wheel_t *wheel, tw_timer_t *timer, uint32_t expires_ms,
+                 tw_callback_t callback, void *arg) {
+  tw_cancel(wheel, timer);
+
+  // Round up, and never into a slot that has already been processed
+  int32_t delay = (int32_t)(expires_ms - wheel->tick_ms);
+  uint32_t expires = wheel->tick + 1;
+  if (delay > 0) {
+    expires = wheel->tick + (delay + TW_TICK_MS - 1) / TW_TICK_MS;
+  }
+
+  timer->expires = expires;
+  timer->callback = callback;
+  timer->arg = arg;
+  timer->armed = true;
+
+  tw_timer_t **slot = &wheel->slots[expires & (TW_SLOTS - 1)];
+  timer->next = *slot;
+  *slot = timer;
+}
+
+void tw_advance(tw_wheel_t *wheel, uint32_t now_ms) {
+  int32_t elapsed = (int32_t)(now_ms - wheel->tick_ms);
+  if (elapsed < TW_TICK_MS) {
+    return;
+  }
+  uint32_t steps = elapsed / TW_TICK_MS;
+  uint32_t target = wheel->tick + steps;
+  wheel->tick_ms += steps * TW_TICK_MS;
+  if (steps > TW_SLOTS) {
+    steps = TW_SLOTS; // a full turn visits every slot once
+  }
+
+  uint32_t start = wheel->tick;
+  for (uint32_t s = 1; s <= steps; s++) {
+    // Timers re-armed from a callback land after the slot being processed
+    wheel->tick = start + s;
+    tw_timer_t **link = &wheel->slots[wheel->tick & (TW_SLOTS - 1)];
+    while (*link) {
+      tw_timer_t *timer = *link;
+      if ((int32_t)(timer->expires - target) > 0) {
+        link = &timer->next; // due on a later turn of the wheel
+        continue;
+      }
+      *link = timer->next;
+      timer->armed = false;
+      timer->callback(timer->arg);
+    }
+  }
+  wheel->tick = target;
+}
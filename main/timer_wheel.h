@@ -0,0 +1,39 @@
+#ifndef TIMER_WHEEL_H
+#define TIMER_WHEEL_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Hashed timer wheel driven by whoever owns the clock: the render loop on
+// the device, a virtual clock on a host build. Timers are caller-owned
+// nodes, so arming one never allocates.
+#define TW_SLOTS 64 // power of two
+#define TW_TICK_MS 10
+
+typedef void (*tw_callback_t)(void *arg);
+
+typedef struct tw_timer {
+  struct tw_timer *next;
+  uint32_t expires; // in wheel ticks
+  tw_callback_t callback;
+  void *arg;
+  bool armed;
+} tw_timer_t;
+
+// Ticks count from tw_init() rather than from a zero millisecond time, so
+// times compare by difference and the millisecond counter may wrap
+typedef struct {
+  tw_timer_t *slots[TW_SLOTS];
+  uint32_t tick;    // last tick processed
+  uint32_t tick_ms; // when it started
+} tw_wheel_t;
+
+void tw_init(tw_wheel_t *wheel, uint32_t now_ms);
+// (Re)arm timer to fire once at or after expires_ms
+void tw_schedule(tw_wheel_t *wheel, tw_timer_t *timer, uint32_t expires_ms,
+                 tw_callback_t callback, void *arg);
+void tw_cancel(tw_wheel_t *wheel, tw_timer_t *timer);
+// Fire every timer due at now_ms. Callbacks may re-arm timers.
+void tw_advance(tw_wheel_t *wheel, uint32_t now_ms);
+
+#endif // TIMER_WHEEL_H
@@ -0,0 +1,77 @@
+#include "vad.h"
+
+#include <string.h>
+
+#define VAD_DC_POLE_Q15 32604 // 0.995, ~13 Hz corner at 16 kHz
+#define VAD_FLOOR_RISE_SHIFT 7 // slow rise towards louder backgrounds
+#define VAD_FLOOR_FALL_SHIFT 2 // fast fall when it gets quieter
+#define VAD_FLOOR_HOLD_SHIFT 11 // crawl up during speech: a new steady
+                                // background can't hold it on for good
+
+void vad_init(vad_t *vad, const vad_config_t *cfg) {
+  memset(vad, 0, sizeof(*vad));
+  vad->cfg = *cfg;
+  vad->floor = cfg->min_energy;
+}
+
+static uint32_t vad_block_energy(vad_t *vad, const int16_t *samples,
+                                 size_t count) {
+  int32_t x_prev = vad->dc_x;
+  int32_t y = vad->dc_y;
+  uint64_t sum = 0;
+  for (size_t i = 0; i < count; i++) {
+    int32_t x = samples[i];
+    y = x - x_prev + (int32_t)(((int64_t)y * VAD_DC_POLE_Q15) >> 15);
+    x_prev = x;
+    // The filter's output spans 17 bits: square in 64, whatever the input
+    uint64_t mag = y < 0 ? -y : y;
+    sum += mag * mag;
+  }
+  vad->dc_x = x_prev;
+  vad->dc_y = y;
+  return count ? sum / count : 0;
+}
+
+bool vad_process(vad_t *vad, const int16_t *samples, size_t count) {
+  uint32_t e = vad_block_energy(vad, samples, count);
+  vad->energy = e;
+  // The first block is the room: starting from the gate instead, a
+  // background over on_ratio of it would count as speech from the start
+  if (!vad->seeded) {
+    vad->seeded = true;
+    vad->floor = e > vad->cfg.min_energy ? e : vad->cfg.min_energy;
+  }
+
+  uint64_t on = (uint64_t)vad->floor * vad->cfg.on_ratio_q4 >> 4;
+  uint64_t off = (uint64_t)vad->floor * vad->cfg.off_ratio_q4 >> 4;
+  bool loud = e > on && e > vad->cfg.min_energy;
+  bool quiet = e <= off || e <= vad->cfg.min_energy;
+
+  if (!vad->active) {
+    vad->run = loud ? vad->run + 1 : 0;
+    if (vad->run >= vad->cfg.attack_blocks) {
+      vad->active = true;
+      vad->run = 0;
+    }
+  } else {
+    vad->run = quiet ? vad->run + 1 : 0;
+    if (vad->run >= vad->cfg.hangover_blocks) {
+      vad->active = false;
+      vad->run = 0;
+    }
+  }
+
+  // Track the background outside speech; during it the floor only crawls
+  // up, so talking hardly raises it
+  if (e < vad->floor) {
+    vad->floor -= (vad->floor - e) >> VAD_FLOOR_FALL_SHIFT;
+  } else if (!vad->active && !loud) {
+    vad->floor += ((e - vad->floor) >> VAD_FLOOR_RISE_SHIFT) + 1;
+  } else if (vad->active) {
+    vad->floor += (e - vad->floor) >> VAD_FLOOR_HOLD_SHIFT;
+  }
+  if (vad->floor < 1) {
+    vad->floor = 1;
+  }
+  return vad->active;
+}
@@ -0,0 +1,38 @@
+#ifndef VAD_H
+#define VAD_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Fixed-point energy voice activity detector for 16-bit PCM blocks
+typedef struct {
+  uint8_t on_ratio_q4;  // speech when energy > floor * ratio / 16
+  uint8_t off_ratio_q4; // keep speech while energy > floor * ratio / 16
+  uint8_t attack_blocks;   // loud blocks in a row needed to start
+  uint16_t hangover_blocks; // quiet blocks in a row needed to stop
+  uint32_t min_energy;      // absolute gate, mean square units
+} vad_config_t;
+
+#define VAD_DEFAULT_CONFIG()                                                   \
+  {                                                                            \
+    .on_ratio_q4 = 64, .off_ratio_q4 = 32, .attack_blocks = 2,                 \
+    .hangover_blocks = 20, .min_energy = 4000,                                 \
+  }
+
+typedef struct {
+  vad_config_t cfg;
+  int32_t dc_x; // high-pass filter state
+  int32_t dc_y;
+  uint32_t energy; // last block, mean square after DC removal
+  uint32_t floor;  // tracked background noise energy
+  uint16_t run;    // consecutive blocks agreeing with a state change
+  bool active;
+  bool seeded; // floor taken from the first block
+} vad_t;
+
+void vad_init(vad_t *vad, const vad_config_t *cfg);
+// Process one block and return whether speech is present
+bool vad_process(vad_t *vad, const int16_t *samples, size_t count);
+
+#endif // VAD_H
@@ -0,0 +1,195 @@
+// Clip decoding as the player does it: a clip laid out as
+// tools/clip_encode.py writes it goes into a file, which is read back
+// through a clip_read_fn in the reader task's 2 KB chunks and decoded into
+// the 40 line bands LVGL flushes. A sparse clip, a ball bouncing over a
+// still background, and a full screen one that changes every pixel every
+// frame, in microseconds per frame and MB/s of coded data in and of pixels
+// out. The decoded frames must match the ones encoded.
+#include "clip_codec.h"
+#include "host_test.h"
+#include "mirror_codec.h"
+
+#include <string.h>
+
+#define CLIP_W 240
+#define CLIP_H 135
+#define FRAMES 120
+#define FRAME_MS 40
+#define IO_CHUNK 2048  // main/clip_player.c's CLIP_IO_CHUNK
+#define BAND_LINES 40  // main/lcd.c's LCD_BUF_LINES
+#define BALL 20
+#define ROUNDS 5
+
+typedef struct {
+  const char *name;
+  void (*draw)(int f, uint16_t *px);
+} clip_kind_t;
+
+static uint16_t frames[FRAMES][CLIP_W * CLIP_H];
+static uint16_t screen[CLIP_W * CLIP_H];
+static uint16_t band[CLIP_W * BAND_LINES];
+static uint8_t coded[CLIP_W * CLIP_H * MIRROR_WORST_PER_PIXEL + 16];
+static size_t decoded; // pixels in the frames' rectangles
+
+static uint16_t rgb565(int r, int g, int b) {
+  return (r >> 3) << 11 | (g >> 2) << 5 | b >> 3;
+}
+
+// A dark gradient, and a ball that rests a while every 30 frames
+static void draw_sparse(int f, uint16_t *px) {
+  int t = f % 30 < 8 ? f - f % 30 : f;
+  int bx = t * 7 % (2 * (CLIP_W - BALL));
+  int by = t * 5 % (2 * (CLIP_H - BALL));
+  bx = bx < CLIP_W - BALL ? bx : 2 * (CLIP_W - BALL) - bx;
+  by = by < CLIP_H - BALL ? by : 2 * (CLIP_H - BALL) - by;
+  for (int y = 0; y < CLIP_H; y++) {
+    for (int x = 0; x < CLIP_W; x++) {
+      int dx = x - bx - BALL / 2, dy = y - by - BALL / 2;
+      bool ball = dx * dx + dy * dy <= BALL * BALL / 4;
+      px[y * CLIP_W + x] = ball ? rgb565(255, 200, 40) : rgb565(0, 0, y);
+    }
+  }
+}
+
+// Diagonal bands of a 24 colour palette, moving a step every frame
+static void draw_full(int f, uint16_t *px) {
+  for (int y = 0; y < CLIP_H; y++) {
+    for (int x = 0; x < CLIP_W; x++) {
+      int i = ((x + 2 * y) / 6 + f) % 24;
+      px[y * CLIP_W + x] = rgb565(i * 10, 255 - i * 10, (i * 37) & 0xff);
+    }
+  }
+}
+
+static void put_u16(FILE *f, unsigned v) {
+  fputc(v & 0xff, f);
+  fputc(v >> 8, f);
+}
+
+// Bounding box of the pixels that differ, as clip_encode.py's changed_rect
+static bool changed_rect(const uint16_t *prev, const uint16_t *cur,
+                         int r[4]) {
+  int x0 = CLIP_W, y0 = CLIP_H, x1 = -1, y1 = -1;
+  for (int y = 0; y < CLIP_H; y++) {
+    for (int x = 0; x < CLIP_W; x++) {
+      if (prev[y * CLIP_W + x] != cur[y * CLIP_W + x]) {
+        x0 = x < x0 ? x : x0;
+        x1 = x > x1 ? x : x1;
+        y0 = y < y0 ? y : y0;
+        y1 = y;
+      }
+    }
+  }
+  r[0] = x0, r[1] = y0, r[2] = x1 - x0 + 1, r[3] = y1 - y0 + 1;
+  return x1 >= 0;
+}
+
+// clip_encode.py's encode(): the first frame whole, then what changed
+static size_t write_clip(FILE *f) {
+  fputc(CLIP_MAGIC0, f);
+  fputc(CLIP_MAGIC1, f);
+  fputc(CLIP_VERSION, f);
+  fputc(0, f);
+  put_u16(f, CLIP_W);
+  put_u16(f, CLIP_H);
+  put_u16(f, FRAMES);
+  put_u16(f, FRAME_MS);
+  for (int i = 0; i < FRAMES; i++) {
+    int r[4] = {0, 0, CLIP_W, CLIP_H};
+    size_t size = 0;
+    if (i && !changed_rect(frames[i - 1], frames[i], r)) {
+      r[2] = r[3] = 0;
+    } else {
+      int rows;
+      size = mirror_encode(&frames[i][r[1] * CLIP_W + r[0]], CLIP_W, r[2],
+                           r[3], coded, sizeof(coded), &rows);
+      CHECK_EQ(rows, r[3]);
+      decoded += r[2] * r[3];
+    }
+    for (int k = 0; k < 4; k++) {
+      put_u16(f, r[k]);
+    }
+    put_u16(f, size & 0xffff);
+    put_u16(f, size >> 16);
+    fwrite(coded, 1, size, f);
+  }
+  fflush(f);
+  return ftell(f);
+}
+
+// The reader task's side: the file in chunks
+static const uint8_t *read_chunk(void *ctx, size_t *len) {
+  static uint8_t buf[IO_CHUNK];
+  *len = fread(buf, 1, sizeof(buf), ctx);
+  return *len ? buf : NULL;
+}
+
+// clip_player's frame loop, the flush path decoding each frame's rectangle
+// into bands; with check, each band lands on the screen, which must then
+// hold the source frame
+static void play(FILE *f, bool check) {
+  rewind(f);
+  clip_stream_t s;
+  clip_stream_init(&s, read_chunk, f);
+  uint8_t raw[CLIP_HEADER_SIZE];
+  clip_header_t header;
+  CHECK(clip_stream_bytes(&s, raw, sizeof(raw)));
+  CHECK(clip_parse_header(raw, &header));
+  for (int i = 0; i < header.frames; i++) {
+    clip_frame_t frame;
+    CHECK(clip_stream_bytes(&s, raw, CLIP_FRAME_HEADER_SIZE));
+    CHECK(clip_parse_frame(raw, &header, &frame));
+    uint32_t start = s.consumed;
+    clip_decode_begin(&s);
+    for (int y = 0; y < frame.h; y += BAND_LINES) {
+      int h = frame.h - y < BAND_LINES ? frame.h - y : BAND_LINES;
+      for (int row = 0; row < h; row++) {
+        CHECK(clip_decode_pixels(&s, band + row * frame.w, frame.w));
+      }
+      for (int row = 0; check && row < h; row++) {
+        memcpy(&screen[(frame.y + y + row) * CLIP_W + frame.x],
+               band + row * frame.w, frame.w * sizeof(band[0]));
+      }
+    }
+    CHECK_EQ(s.consumed - start, frame.size);
+    if (check) {
+      CHECK(!memcmp(screen, frames[i], sizeof(screen)));
+    }
+  }
+  size_t len;
+  CHECK(!read_chunk(f, &len));
+}
+
+int main(void) {
+  static const clip_kind_t kinds[] = {
+      {"sparse", draw_sparse},
+      {"full", draw_full},
+  };
+  for (size_t k = 0; k < sizeof(kinds) / sizeof(kinds[0]); k++) {
+    for (int i = 0; i < FRAMES; i++) {
+      kinds[k].draw(i, frames[i]);
+    }
+    decoded = 0;
+    FILE *f = tmpfile();
+    CHECK(f);
+    size_t size = write_clip(f);
+    memset(screen, 0, sizeof(screen));
+    play(f, true);
+
+    double best = 0;
+    for (int round = 0; round < ROUNDS; round++) {
+      double start = host_now_s();
+      play(f, false);
+      double s = host_now_s() - start;
+      best = !round || s < best ? s : best;
+    }
+    double raw = (double)FRAMES * CLIP_W * CLIP_H * sizeof(uint16_t);
+    double out = decoded * sizeof(uint16_t);
+    printf("%-6s %d frames, %6zu bytes (%4.1f%% of raw): %7.1f us/frame, "
+           "%5.1f MB/s in, %6.1f MB/s out\n",
+           kinds[k].name, FRAMES, size, 100 * size / raw,
+           best / FRAMES * 1e6, size / best / 1e6, out / best / 1e6);
+    fclose(f);
+  }
+  return 0;
+}
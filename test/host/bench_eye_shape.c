@@ -0,0 +1,107 @@
+// SDF eye shape cost: a draw that finds its mask in the cache against the
+// cold path, where every draw of a morph rasterizes a new mask, with the
+// rounded rect RoboEyes draws otherwise for scale. The counters check that
+// the cache is really hit, or really missed, and that a blink, which only
+// changes the eye's height, never rasterizes again.
+#include "eye_shape.h"
+#include "host_test.h"
+#include "raster.h"
+
+#define SCREEN_W 240
+#define SCREEN_H 135
+#define EYE 36
+#define FG 0x000c
+
+static uint16_t fb[SCREEN_W * SCREEN_H];
+static raster_target_t target;
+static int draws;
+
+typedef void (*draw_fn)(int i);
+
+// Settled heart, a mask the cache holds
+static void draw_hit(int i) {
+  eye_shape_key_t key = {EYE_SHAPE_HEART, EYE_SHAPE_HEART, 0};
+  eye_shape_draw(&target, 8 + i % 160, 8 + i % 80, EYE, EYE, key, FG);
+}
+
+// Every step of every morph in turn: far more masks than the cache's slots,
+// so each draw misses
+static void draw_cold(int i) {
+  int steps = EYE_SHAPE_MORPH_STEPS - 1;
+  int pair = i / steps % (EYE_SHAPE_COUNT - 1);
+  eye_shape_key_t key = {pair + 1, (pair + 1) % (EYE_SHAPE_COUNT - 1) + 1,
+                         i % steps + 1};
+  eye_shape_draw(&target, 8 + i % 160, 8 + i % 80, EYE, EYE, key, FG);
+}
+
+static void draw_rect(int i) {
+  raster_round_rect(&target, 8 + i % 160, 8 + i % 80, EYE, EYE, 8, FG);
+}
+
+// Microseconds per eye, the best of 5 rounds of at least min_iter draws
+static double time_eyes(draw_fn draw, int min_iter) {
+  double best = 0;
+  for (int round = 0; round < 5; round++) {
+    int n = 0;
+    double start = host_now_s(), elapsed;
+    do {
+      for (int i = 0; i < 64; i++, n++) {
+        draw(n);
+      }
+      elapsed = host_now_s() - start;
+    } while (elapsed < 0.1 && n < min_iter);
+    double us = elapsed / n * 1e6;
+    best = !round || us < best ? us : best;
+    draws += n;
+  }
+  return best;
+}
+
+// A blink squeezes the same shape to a line and back: all cache hits
+static void check_blink(void) {
+  eye_shape_key_t key = {EYE_SHAPE_STAR, EYE_SHAPE_STAR, 0};
+  eye_shape_draw(&target, 40, 40, EYE, EYE, key, FG);
+  eye_shape_stats_t before, after;
+  eye_shape_get_stats(&before);
+  for (int h = EYE; h >= 1; h--) {
+    eye_shape_draw(&target, 40, 40 + (EYE - h) / 2, EYE, h, key, FG);
+  }
+  for (int h = 1; h <= EYE; h++) {
+    eye_shape_draw(&target, 40, 40 + (EYE - h) / 2, EYE, h, key, FG);
+  }
+  eye_shape_get_stats(&after);
+  CHECK_EQ(after.rasterizations, before.rasterizations);
+  CHECK_EQ(after.hits - before.hits, 2u * EYE);
+}
+
+int main(void) {
+  raster_target_init(&target, fb, SCREEN_W, SCREEN_W, SCREEN_H);
+  raster_set_colors(&target, 0x0000, FG);
+  check_blink();
+
+  eye_shape_stats_t s0, s1, s2;
+  eye_shape_get_stats(&s0);
+  draws = 0;
+  double hit = time_eyes(draw_hit, 20000);
+  eye_shape_get_stats(&s1);
+  CHECK_EQ(s1.rasterizations, s0.rasterizations + 1); // the first draw
+  CHECK_EQ(s1.hits - s0.hits, (uint32_t)draws - 1);
+
+  draws = 0;
+  double cold = time_eyes(draw_cold, 2000);
+  eye_shape_get_stats(&s2);
+  CHECK_EQ(s2.rasterizations - s1.rasterizations, (uint32_t)draws);
+  CHECK_EQ(s2.hits, s1.hits);
+
+  double rect = time_eyes(draw_rect, 20000);
+  uint32_t solid = s2.tiles_solid - s1.tiles_solid;
+  uint32_t edge = s2.tiles_edge - s1.tiles_edge;
+  printf("%dx%d eye, us per eye\n", EYE, EYE);
+  printf("cache hit %6.2f  cold %7.2f  rounded rect %6.2f\n", hit, cold,
+         rect);
+  printf("cold masks: %.0f%% of tiles settled by their centre\n",
+         100.0 * solid / (solid + edge));
+  // A mask costs far more than drawing one; the cache is what pays
+  CHECK(hit * 10 < cold);
+  return 0;
+}
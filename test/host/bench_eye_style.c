@@ -0,0 +1,114 @@
+// Frame time of each eye style against the flat fill, which the styled
+// paths must stay within 20% of. RoboEyes frames through the moods are
+// recorded once into display lists, then rendered the way main/lcd.c does,
+// whole screen, in every style.
+#include "FluxGarage_RoboEyes.h"
+#include "eye_list.h"
+#include "eye_style.h"
+#include "host_test.h"
+#include "raster.h"
+
+#define SCREEN_W 240
+#define SCREEN_H 135
+#define FRAMES 600
+#define FRAME_MS 20
+#define LIMIT 1.20
+#define ROUNDS 60
+#define BATCHES 3
+
+static uint16_t fb[SCREEN_W * SCREEN_H];
+static eye_list_t lists[FRAMES];
+static int recorded;
+static uint32_t now;
+static uint64_t rng;
+
+static eye_list_t *rec(void) { return &lists[recorded]; }
+
+static void rect(int x, int y, int w, int h, int r, uint8_t color) {
+  eye_list_rect(rec(), x, y, w, h, r, color);
+}
+
+static void triangle(int x0, int y0, int x1, int y1, int x2, int y2,
+                     uint8_t color) {
+  eye_list_triangle(rec(), x0, y0, x1, y1, x2, y2, color);
+}
+
+static void clear(void) { eye_list_reset(rec()); }
+
+static void update(void) {
+  if (recorded < FRAMES - 1) {
+    recorded++;
+  }
+}
+
+static uint32_t millis(void) { return now; }
+
+static uint32_t random_below(uint32_t limit) {
+  rng = rng * 6364136223846793005ull + 1442695040888963407ull;
+  return limit ? (uint32_t)(rng >> 33) % limit : 0;
+}
+
+static void record(void) {
+  RoboEyes_init(rect, triangle, clear, update, millis, random_below);
+  RoboEyes_begin(SCREEN_W, SCREEN_H, 50);
+  RoboEyes_setAutoblinker2(true, 1, 1);
+  RoboEyes_setIdleMode2(true, 1, 1);
+  for (int f = 0; recorded < FRAMES - 1; f++) {
+    now += FRAME_MS;
+    if (f % 100 == 0) {
+      RoboEyes_setMood(f / 100 % 4);
+    }
+    RoboEyes_update();
+  }
+}
+
+// Microseconds per frame over every recorded frame
+static double frame_us(raster_target_t *t) {
+  double start = host_now_s();
+  for (int i = 0; i < 2; i++) {
+    for (int f = 0; f < recorded; f++) {
+      eye_list_render(&lists[f], t);
+    }
+  }
+  return (host_now_s() - start) / (2 * recorded) * 1e6;
+}
+
+int main(void) {
+  static const char *names[EYE_STYLE_COUNT] = {"flat", "gradient", "glow",
+                                               "neon"};
+  record();
+
+  raster_target_t t;
+  raster_target_init(&t, fb, SCREEN_W, SCREEN_W, SCREEN_H);
+  raster_set_colors(&t, 0x0000, 0x000c);
+  eye_style_init(&t);
+
+  // Styles take turns and each keeps its best round, so a busy host slows
+  // them all alike. A host stalled for a whole batch only makes the styled
+  // paths look slower, so a few more batches are run before giving up.
+  double best[EYE_STYLE_COUNT];
+  bool within = false;
+  for (int batch = 0; batch < BATCHES && !within; batch++) {
+    for (int round = 0; round < ROUNDS; round++) {
+      for (int s = 0; s < EYE_STYLE_COUNT; s++) {
+        eye_style_set(s);
+        double us = frame_us(&t);
+        best[s] = (!batch && !round) || us < best[s] ? us : best[s];
+      }
+    }
+    within = true;
+    for (int s = 0; s < EYE_STYLE_COUNT; s++) {
+      within = within && best[s] <= best[EYE_STYLE_FLAT] * LIMIT;
+    }
+  }
+
+  printf("%d frames, whole screen each\n", recorded);
+  for (int s = 0; s < EYE_STYLE_COUNT; s++) {
+    printf("%-8s %6.2f us/frame  %+5.1f%%\n", names[s], best[s],
+           (best[s] / best[EYE_STYLE_FLAT] - 1) * 100);
+  }
+  for (int s = 0; s < EYE_STYLE_COUNT; s++) {
+    CHECK(best[s] <= best[EYE_STYLE_FLAT] * LIMIT);
+  }
+  return 0;
+}
@@ -0,0 +1,81 @@
+// Glyph atlas throughput in glyphs per second and memory per font size,
+// against drawing straight from the 5x7 font's column bytes. The atlas
+// output is checked against that direct decode first.
+#include "font5x7.h"
+#include "glyph_atlas.h"
+#include "host_test.h"
+
+#include <stdbool.h>
+#include <string.h>
+
+#define BAND_W 240
+#define BAND_H 16
+#define FG 0xffff
+#define BG 0x0010
+
+static uint16_t band[BAND_H * BAND_W];
+static uint16_t ref[BAND_H * BAND_W];
+
+// What the atlas replaces: font bits looked up per pixel, scaled on the fly
+static void direct_draw(uint16_t *buf, int x, const char *text,
+                        glyph_size_t size) {
+  int scale = 1 << size;
+  for (; *text; text++, x += GLYPH_CELL_W(size)) {
+    char c = *text;
+    if (c < FONT5X7_FIRST || c > FONT5X7_LAST) {
+      c = '?';
+    }
+    const uint8_t *cols = font5x7[c - FONT5X7_FIRST];
+    for (int row = 0; row < GLYPH_CELL_H(size); row++) {
+      for (int col = 0; col < GLYPH_CELL_W(size); col++) {
+        int fc = col / scale, fr = row / scale;
+        bool on = fc < FONT5X7_WIDTH && (cols[fc] >> fr) & 1;
+        buf[row * BAND_W + x + col] = on ? FG : BG;
+      }
+    }
+  }
+}
+
+int main(void) {
+  glyph_atlas_init();
+  static const char text[] = "12:34 battery 87% Hello!";
+
+  size_t font = sizeof(font5x7);
+  printf("5x7 font source: %zu bytes\n", font);
+  for (glyph_size_t size = 0; size < GLYPH_SIZE_COUNT; size++) {
+    int cells = BAND_W / GLYPH_CELL_W(size);
+    char run[64];
+    snprintf(run, sizeof(run), "%.*s", cells, text);
+    int glyphs = strlen(run);
+
+    memset(band, 0, sizeof(band));
+    memset(ref, 0, sizeof(ref));
+    CHECK_EQ(glyph_draw_run(band, BAND_W, BAND_W, BAND_H, 0, 0, run, size, FG,
+                            BG),
+             glyphs);
+    direct_draw(ref, 0, run, size);
+    for (int row = 0; row < GLYPH_CELL_H(size); row++) {
+      CHECK(!memcmp(band + row * BAND_W, ref + row * BAND_W,
+                    glyphs * GLYPH_CELL_W(size) * sizeof(uint16_t)));
+    }
+
+    int rounds = 200000 >> size;
+    double t0 = host_now_s();
+    for (int i = 0; i < rounds; i++) {
+      glyph_draw_run(band, BAND_W, BAND_W, BAND_H, i & 1, 0, run, size, FG,
+                     BG);
+    }
+    double atlas = rounds * glyphs / (host_now_s() - t0);
+    t0 = host_now_s();
+    for (int i = 0; i < rounds; i++) {
+      direct_draw(ref, i & 1, run, size);
+    }
+    double direct = rounds * glyphs / (host_now_s() - t0);
+    printf("%2dx%-2d cells: atlas %5zu bytes, %6.2f Mglyphs/s "
+           "(%4.1fx the direct decode, %.2f Mglyphs/s)\n",
+           GLYPH_CELL_W(size), GLYPH_CELL_H(size),
+           glyph_atlas_footprint(size), atlas / 1e6, atlas / direct,
+           direct / 1e6);
+  }
+  return 0;
+}
@@ -0,0 +1,231 @@
+// Half resolution against full: RoboEyes frames idle, confused and laughing
+// are recorded once into display lists with the left eye's centre, and
+// half_res_state picks the frames drawn at half resolution, as main/lcd.c
+// does. Those frames are rendered both ways over the areas the eye widget
+// redraws, in the flat and glow styles; half resolution must cost at most
+// 75% of full. A half resolution frame drawn whole or in LVGL's 40 line
+// bands gives the same pixels.
+#include "FluxGarage_RoboEyes.h"
+#include "eye_list.h"
+#include "eye_style.h"
+#include "half_res_state.h"
+#include "host_test.h"
+#include "raster.h"
+
+#include <string.h>
+
+#define SCREEN_W 240
+#define SCREEN_H 135
+#define BAND_LINES 40 // main/lcd.c's LCD_BUF_LINES
+#define SEGMENT_FRAMES 500
+#define FRAME_MS 20
+#define ROUNDS 20
+#define LIMIT 0.75
+
+enum { SEG_IDLE, SEG_CONFUSED, SEG_LAUGH, SEG_COUNT };
+
+static const char *seg_names[SEG_COUNT] = {"idle", "confused", "laugh"};
+
+static uint16_t fb[SCREEN_W * SCREEN_H];
+static uint16_t band[SCREEN_W * BAND_LINES];
+static uint16_t whole_scratch[EYE_LIST_HALF_PX(SCREEN_W, SCREEN_H)];
+static uint16_t band_scratch[EYE_LIST_HALF_PX(SCREEN_W, BAND_LINES)];
+static eye_list_t lists[SEG_COUNT * SEGMENT_FRAMES];
+static bool half[SEG_COUNT * SEGMENT_FRAMES];
+static int recorded;
+static int eye_x, eye_y;
+static uint32_t now;
+static uint64_t rng;
+
+static eye_list_t *rec(void) { return &lists[recorded]; }
+
+static void rect(int x, int y, int w, int h, int r, uint8_t color) {
+  eye_list_rect(rec(), x, y, w, h, r, color);
+}
+
+// lcd.c's drawEye: the left eye's centre is the motion half_res_state sees
+static void eye(uint8_t e, int x, int y, int w, int h, int r,
+                uint8_t color) {
+  if (e == 0) {
+    eye_x = x + w / 2;
+    eye_y = y + h / 2;
+  }
+  eye_list_rect(rec(), x, y, w, h, r, color);
+}
+
+static void triangle(int x0, int y0, int x1, int y1, int x2, int y2,
+                     uint8_t color) {
+  eye_list_triangle(rec(), x0, y0, x1, y1, x2, y2, color);
+}
+
+static void clear(void) { eye_list_reset(rec()); }
+
+static void update(void) {}
+
+static uint32_t millis(void) { return now; }
+
+static uint32_t random_below(uint32_t limit) {
+  rng = rng * 6364136223846793005ull + 1442695040888963407ull;
+  return limit ? (uint32_t)(rng >> 33) % limit : 0;
+}
+
+// Each segment's share of frames drawn at half resolution
+static void record(double share[SEG_COUNT]) {
+  half_res_config_t cfg = HALF_RES_DEFAULT_CONFIG();
+  half_res_sm_t sm;
+  half_res_sm_init(&sm, &cfg);
+  RoboEyes_init(rect, triangle, clear, update, millis, random_below);
+  RoboEyes_setEyeHook(eye);
+  RoboEyes_begin(SCREEN_W, SCREEN_H, 1000 / FRAME_MS);
+  RoboEyes_setAutoblinker2(true, 3, 2);
+  RoboEyes_setIdleMode2(true, 2, 2);
+  rng = 1;
+  for (int s = 0; s < SEG_COUNT; s++) {
+    int halves = 0;
+    for (int f = 0; f < SEGMENT_FRAMES; f++, recorded++) {
+      now += FRAME_MS;
+      if (f % 50 == 0 && s == SEG_CONFUSED) {
+        RoboEyes_anim_confused();
+      } else if (f % 50 == 0 && s == SEG_LAUGH) {
+        RoboEyes_anim_laugh();
+      }
+      RoboEyes_update();
+      half[recorded] = half_res_sm_frame(&sm, eye_x, eye_y);
+      halves += half[recorded];
+    }
+    share[s] = (double)halves / SEGMENT_FRAMES;
+  }
+}
+
+// A frame drawn at half resolution in whole screen bands
+static void render_bands(raster_target_t *t, const eye_list_t *list,
+                         uint16_t *out) {
+  for (int y = 0; y < SCREEN_H; y += BAND_LINES) {
+    int h = SCREEN_H - y < BAND_LINES ? SCREEN_H - y : BAND_LINES;
+    raster_set_window(t, band, SCREEN_W, 0, y, SCREEN_W, h);
+    eye_list_render_half(list, t, band_scratch,
+                         sizeof(band_scratch) / sizeof(band_scratch[0]));
+    memcpy(&out[y * SCREEN_W], band, h * SCREEN_W * sizeof(band[0]));
+  }
+}
+
+// Frames whose half resolution bands differ from the whole frame
+static int check_bands(raster_target_t *t) {
+  static uint16_t banded[SCREEN_W * SCREEN_H];
+  int diffs = 0;
+  for (int f = 0; f < recorded; f++) {
+    if (!half[f]) {
+      continue;
+    }
+    raster_set_window(t, fb, SCREEN_W, 0, 0, SCREEN_W, SCREEN_H);
+    eye_list_render_half(&lists[f], t, whole_scratch,
+                         sizeof(whole_scratch) / sizeof(whole_scratch[0]));
+    render_bands(t, &lists[f], banded);
+    diffs += memcmp(fb, banded, sizeof(fb)) != 0;
+  }
+  return diffs;
+}
+
+// What lcd.c redraws for frame f: robo_widget_show() invalidates the eyes'
+// box and the last frame's, glow included, which LVGL joins when they
+// overlap and draws in chunks of its draw buffer's size
+typedef struct {
+  int x1, y1, x2, y2;
+} area_t;
+
+static area_t eyes_area(const raster_target_t *t, const eye_list_t *list) {
+  int g = t->glow_size;
+  area_t a = {list->x1 - g, list->y1 - g, list->x2 + g, list->y2 + g};
+  a.x1 = a.x1 < 0 ? 0 : a.x1;
+  a.y1 = a.y1 < 0 ? 0 : a.y1;
+  a.x2 = a.x2 >= SCREEN_W ? SCREEN_W - 1 : a.x2;
+  a.y2 = a.y2 >= SCREEN_H ? SCREEN_H - 1 : a.y2;
+  return a;
+}
+
+static void render_area(raster_target_t *t, const eye_list_t *list,
+                        bool half_res, area_t a) {
+  if (a.x2 < a.x1 || a.y2 < a.y1) {
+    return;
+  }
+  int w = a.x2 - a.x1 + 1;
+  int rows = SCREEN_W * BAND_LINES / w;
+  for (int y = a.y1; y <= a.y2; y += rows) {
+    int h = a.y2 - y + 1 < rows ? a.y2 - y + 1 : rows;
+    raster_set_window(t, band, w, a.x1, y, w, h);
+    if (half_res) {
+      eye_list_render_half(list, t, band_scratch,
+                           sizeof(band_scratch) / sizeof(band_scratch[0]));
+    } else {
+      eye_list_render(list, t);
+    }
+  }
+}
+
+static void render_frame(raster_target_t *t, int f, bool half_res) {
+  area_t now_a = eyes_area(t, &lists[f]);
+  area_t last = eyes_area(t, &lists[f ? f - 1 : f]);
+  if (last.x1 <= now_a.x2 && now_a.x1 <= last.x2 && last.y1 <= now_a.y2 &&
+      now_a.y1 <= last.y2) {
+    area_t join = {
+        now_a.x1 < last.x1 ? now_a.x1 : last.x1,
+        now_a.y1 < last.y1 ? now_a.y1 : last.y1,
+        now_a.x2 > last.x2 ? now_a.x2 : last.x2,
+        now_a.y2 > last.y2 ? now_a.y2 : last.y2,
+    };
+    render_area(t, &lists[f], half_res, join);
+  } else {
+    render_area(t, &lists[f], half_res, now_a);
+    render_area(t, &lists[f], half_res, last);
+  }
+}
+
+// Microseconds per frame over the half resolution frames
+static double frame_us(raster_target_t *t, bool half_res) {
+  int n = 0;
+  double start = host_now_s();
+  for (int f = 0; f < recorded; f++) {
+    if (half[f]) {
+      render_frame(t, f, half_res);
+      n++;
+    }
+  }
+  return (host_now_s() - start) / n * 1e6;
+}
+
+int main(void) {
+  double share[SEG_COUNT];
+  record(share);
+  for (int s = 0; s < SEG_COUNT; s++) {
+    printf("%-8s %3.0f%% of frames at half resolution\n", seg_names[s],
+           share[s] * 100);
+  }
+  // The motion, not the frame count, switches: idle jumps only sometimes
+  CHECK(share[SEG_CONFUSED] > 0.5);
+  CHECK(share[SEG_LAUGH] > share[SEG_IDLE]);
+  CHECK(share[SEG_IDLE] < 0.2);
+
+  raster_target_t t;
+  raster_target_init(&t, fb, SCREEN_W, SCREEN_W, SCREEN_H);
+  raster_set_colors(&t, 0x0000, 0x000c);
+  eye_style_init(&t);
+
+  static const eye_style_t styles[] = {EYE_STYLE_FLAT, EYE_STYLE_GLOW};
+  for (int i = 0; i < 2; i++) {
+    eye_style_set(styles[i]);
+    CHECK_EQ(check_bands(&t), 0);
+    // Full and half take turns and each keeps its best round
+    double full_us = 0, half_us = 0;
+    for (int round = 0; round < ROUNDS; round++) {
+      double us = frame_us(&t, false);
+      full_us = !round || us < full_us ? us : full_us;
+      us = frame_us(&t, true);
+      half_us = !round || us < half_us ? us : half_us;
+    }
+    printf("%s: full %6.2f us/frame, half %6.2f us/frame, %3.0f%% saved\n",
+           styles[i] == EYE_STYLE_FLAT ? "flat" : "glow", full_us, half_us,
+           100 - 100 * half_us / full_us);
+    CHECK(half_us <= full_us * LIMIT);
+  }
+  return 0;
+}
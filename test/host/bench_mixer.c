@@ -0,0 +1,91 @@
+// Mixer and envelope throughput in output samples per second, mixing 1 to
+// MIXER_STREAMS copies of WAV input in the playback task's 256 sample
+// blocks. Takes a 16 kHz WAV file, else synthesizes 4 s of syllables; also
+// checks the envelope follows them and falls back to zero.
+#include "host_test.h"
+#include "mixer.h"
+#include "wav.h"
+
+#include <math.h>
+
+#define RATE 16000
+#define BLOCK 256
+
+static int16_t *synth(size_t *count) {
+  size_t n = 4 * RATE;
+  int16_t *s = malloc(n * sizeof(*s));
+  for (size_t i = 0; i < n; i++) {
+    double t = (double)i / RATE;
+    // 3 syllables a second, then a second of silence
+    double env = t < 3 ? fmax(0, sin(2 * M_PI * 1.5 * t)) : 0;
+    s[i] = (int16_t)(9000 * env * sin(2 * M_PI * 180 * t) *
+                     (0.7 + 0.3 * sin(2 * M_PI * 720 * t)));
+  }
+  *count = n;
+  return s;
+}
+
+static void check_envelope(const int16_t *pcm, size_t n) {
+  mixer_t m;
+  mixer_init(&m);
+  CHECK(mixer_add(&m, pcm, n, MIXER_GAIN_UNITY) == 0);
+  int16_t out[BLOCK];
+  uint8_t peak = 0, trough = 255;
+  size_t blocks = 0;
+  while (mixer_active(&m)) {
+    mixer_render(&m, out, BLOCK);
+    double t = (double)(blocks++ * BLOCK) / RATE;
+    if (t > 0.5 && t < 2.5) {
+      peak = m.envelope > peak ? m.envelope : peak;
+      // Between syllables, where sin(3 pi t) <= 0
+      if (fmod(t, 2.0 / 3) > 0.45 && fmod(t, 2.0 / 3) < 0.6) {
+        trough = m.envelope < trough ? m.envelope : trough;
+      }
+    }
+  }
+  printf("envelope: syllable peaks %u, gaps %u\n", peak, trough);
+  CHECK(peak > 100);
+  CHECK(trough < peak / 4);
+  CHECK_EQ(m.envelope, 0);
+  // Past the end everything is silence
+  mixer_render(&m, out, BLOCK);
+  for (int i = 0; i < BLOCK; i++) {
+    CHECK_EQ(out[i], 0);
+  }
+}
+
+int main(int argc, char **argv) {
+  size_t n;
+  uint32_t rate = RATE;
+  int16_t *pcm = argc > 1 ? wav_read(argv[1], &n, &rate) : synth(&n);
+  if (!pcm) {
+    fprintf(stderr, "%s: not a 16-bit PCM WAV file\n", argv[1]);
+    return 1;
+  }
+  if (argc == 1) {
+    check_envelope(pcm, n);
+  }
+
+  int16_t out[BLOCK];
+  for (int streams = 1; streams <= MIXER_STREAMS; streams++) {
+    mixer_t m;
+    size_t samples = 0;
+    double t0 = host_now_s();
+    for (int round = 0; round < 50; round++) {
+      mixer_init(&m);
+      for (int i = 0; i < streams; i++) {
+        mixer_add(&m, pcm + i * 37, n - i * 37, MIXER_GAIN_UNITY / streams);
+      }
+      while (mixer_active(&m)) {
+        mixer_render(&m, out, BLOCK);
+        samples += BLOCK;
+      }
+    }
+    double secs = host_now_s() - t0;
+    printf("%d stream%s: %6.1f Msamples/s out, %5.0fx real time at %u Hz\n",
+           streams, streams > 1 ? "s" : " ", samples / secs / 1e6,
+           samples / (double)rate / secs, rate);
+  }
+  free(pcm);
+  return 0;
+}
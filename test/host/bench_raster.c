@@ -0,0 +1,188 @@
+// Eye rectangle cost: the anti-aliased corners from cached coverage tables
+// against the aliased rounded rect, a per-pixel analytic AA reference and,
+// when components/lvgl is checked out, LVGL's own anti-aliased rect drawn
+// by its software renderer into a canvas. The table corners are checked
+// against the analytic reference first.
+#include "host_test.h"
+#include "raster.h"
+
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+
+#ifndef BENCH_LVGL
+#define BENCH_LVGL 0
+#endif
+#if BENCH_LVGL
+#include "lvgl.h"
+#endif
+
+#define SCREEN_W 240
+#define SCREEN_H 135
+#define EYE 36
+#define BG 0x0000
+#define FG 0x000c // lcd.c's main colour, blue 100
+
+static uint16_t fb[SCREEN_W * SCREEN_H];
+
+// Exact area of the circle of radius r centred on (cx, cy) inside the pixel
+// at (px, py), integrated over 64x64 samples: the generic AA cost
+static double coverage(double cx, double cy, double r, int px, int py) {
+  int hits = 0;
+  for (int j = 0; j < 64; j++) {
+    for (int i = 0; i < 64; i++) {
+      double dx = px + (i + 0.5) / 64 - cx;
+      double dy = py + (j + 0.5) / 64 - cy;
+      hits += dx * dx + dy * dy <= r * r;
+    }
+  }
+  return hits / 4096.0;
+}
+
+// Per-pixel AA rounded rect, the corner coverage computed for every pixel
+static void analytic_rect(uint16_t *buf, int x, int y, int w, int h, int r) {
+  for (int py = y; py < y + h; py++) {
+    for (int px = x; px < x + w; px++) {
+      double cx = px < x + r ? x + r : (px >= x + w - r ? x + w - r : -1);
+      double cy = py < y + r ? y + r : (py >= y + h - r ? y + h - r : -1);
+      uint16_t *d = &buf[py * SCREEN_W + px];
+      if (cx < 0 || cy < 0) {
+        *d = FG;
+        continue;
+      }
+      // Blue channel only: enough for the two eye colours
+      double c = coverage(cx, cy, r, px, py);
+      *d = (uint16_t)lround(c * FG);
+    }
+  }
+}
+
+// Aliased rounded rect: pixels whose centre is inside
+static void aliased_rect(uint16_t *buf, int x, int y, int w, int h, int r) {
+  for (int py = y; py < y + h; py++) {
+    for (int px = x; px < x + w; px++) {
+      int cx = px < x + r ? x + r : (px >= x + w - r ? x + w - r : -1);
+      int cy = py < y + r ? y + r : (py >= y + h - r ? y + h - r : -1);
+      if (cx >= 0 && cy >= 0) {
+        int dx = 2 * (px - cx) + 1, dy = 2 * (py - cy) + 1;
+        if (dx * dx + dy * dy > 4 * r * r) {
+          continue;
+        }
+      }
+      buf[py * SCREEN_W + px] = FG;
+    }
+  }
+}
+
+static void check_corners(raster_target_t *t) {
+  static uint16_t ref[SCREEN_W * SCREEN_H];
+  for (int r = 2; r <= EYE / 2; r += 2) {
+    memset(fb, 0, sizeof(fb));
+    memset(ref, 0, sizeof(ref));
+    raster_round_rect(t, 10, 10, EYE, EYE, r, FG);
+    analytic_rect(ref, 10, 10, EYE, EYE, r);
+    int worst = 0;
+    for (int i = 0; i < SCREEN_W * SCREEN_H; i++) {
+      int d = abs((fb[i] & 0x1f) - (ref[i] & 0x1f));
+      worst = d > worst ? d : worst;
+    }
+    // 4x4 samples in 16 levels, shown in a 12 step channel
+    CHECK(worst <= 2);
+  }
+}
+
+typedef void (*draw_fn)(int x, int y);
+
+static raster_target_t target;
+static int radius = 8;
+
+static void draw_table(int x, int y) {
+  raster_round_rect(&target, x, y, EYE, EYE, radius, FG);
+}
+
+static void draw_aliased(int x, int y) {
+  aliased_rect(fb, x, y, EYE, EYE, radius);
+}
+
+static void draw_analytic(int x, int y) {
+  analytic_rect(fb, x, y, EYE, EYE, radius);
+}
+
+// Microseconds per eye, over half a second or min_iter draws
+static double time_eyes(draw_fn draw, int min_iter) {
+  int n = 0;
+  double start = host_now_s(), elapsed;
+  do {
+    for (int i = 0; i < 64; i++, n++) {
+      draw(8 + n % 160, 8 + n % 80);
+    }
+    elapsed = host_now_s() - start;
+  } while (elapsed < 0.5 && n < min_iter);
+  return elapsed / n * 1e6;
+}
+
+#if BENCH_LVGL
+static lv_obj_t *canvas;
+
+static void flush(lv_display_t *disp, const lv_area_t *area, uint8_t *px) {
+  (void)area, (void)px;
+  lv_display_flush_ready(disp);
+}
+
+static void draw_lvgl(int x, int y) {
+  lv_layer_t layer;
+  lv_canvas_init_layer(canvas, &layer);
+  lv_draw_rect_dsc_t dsc;
+  lv_draw_rect_dsc_init(&dsc);
+  dsc.bg_color = lv_color_make(0, 0, 100);
+  dsc.bg_opa = LV_OPA_COVER;
+  dsc.radius = radius;
+  lv_area_t a = {.x1 = x, .y1 = y, .x2 = x + EYE - 1, .y2 = y + EYE - 1};
+  lv_draw_rect(&layer, &dsc, &a);
+  lv_canvas_finish_layer(canvas, &layer);
+}
+
+static void lvgl_init(void) {
+  static uint16_t line[SCREEN_W * 10];
+  lv_init();
+  lv_display_t *disp = lv_display_create(SCREEN_W, SCREEN_H);
+  lv_display_set_flush_cb(disp, flush);
+  lv_display_set_buffers(disp, line, NULL, sizeof(line),
+                         LV_DISPLAY_RENDER_MODE_PARTIAL);
+  lv_display_set_antialiasing(disp, true);
+  canvas = lv_canvas_create(lv_screen_active());
+  lv_canvas_set_buffer(canvas, fb, SCREEN_W, SCREEN_H,
+                       LV_COLOR_FORMAT_RGB565);
+}
+#endif
+
+int main(void) {
+  raster_target_init(&target, fb, SCREEN_W, SCREEN_W, SCREEN_H);
+  raster_set_colors(&target, BG, FG);
+  check_corners(&target);
+
+  printf("%dx%d eye, us per eye\n", EYE, EYE);
+  printf("radius  tables  aliased  analytic%s\n",
+         BENCH_LVGL ? "  lvgl AA" : "");
+  for (radius = 4; radius <= 16; radius *= 2) {
+    double table = time_eyes(draw_table, 20000);
+    double aliased = time_eyes(draw_aliased, 20000);
+    double analytic = time_eyes(draw_analytic, 200);
+    printf("%6d  %6.2f  %7.2f  %8.1f", radius, table, aliased, analytic);
+#if BENCH_LVGL
+    static bool lvgl_ready;
+    if (!lvgl_ready) {
+      lvgl_init();
+      lvgl_ready = true;
+    }
+    printf("  %7.2f", time_eyes(draw_lvgl, 2000));
+#endif
+    printf("\n");
+    CHECK(table < analytic);
+  }
+  raster_stats_t stats;
+  raster_get_stats(&stats);
+  printf("%u coverage tables built, %u draws found theirs cached\n",
+         stats.table_builds, stats.table_hits);
+  return 0;
+}
@@ -0,0 +1,117 @@
+// RoboEyes with its Kconfig features in and out. Built twice from this file:
+// bench_roboeyes_full with the host defaults, every feature in, and
+// bench_roboeyes_minimal with every feature out and the screen size and
+// colours fixed. Each prints the code and state its RoboEyes object takes
+// and the nanoseconds a frame takes through mood changes, animations and
+// blinks; the minimal build's code must come out smaller than the full
+// one's, or the definitions did not reach RoboEyes.
+#include "FluxGarage_RoboEyes.h"
+#include "host_test.h"
+
+#include <elf.h>
+#include <string.h>
+
+#define SCREEN_W 240
+#define SCREEN_H 135
+#define FRAMES 20000
+#define FRAME_MS 20
+#define ROUNDS 5
+
+static uint32_t now;
+static uint64_t rng;
+static volatile uint32_t shapes;
+
+static void rect(int x, int y, int w, int h, int r, uint8_t color) {
+  shapes += x + y + w + h + r + color;
+}
+
+static void triangle(int x0, int y0, int x1, int y1, int x2, int y2,
+                     uint8_t color) {
+  shapes += x0 + y0 + x1 + y1 + x2 + y2 + color;
+}
+
+static void clear(void) {}
+
+static void update(void) {}
+
+static uint32_t millis(void) { return now; }
+
+static uint32_t random_below(uint32_t limit) {
+  rng = rng * 6364136223846793005ull + 1442695040888963407ull;
+  return limit ? (uint32_t)(rng >> 33) % limit : 0;
+}
+
+// Bytes of code and of writable state in an object file
+static void object_size(const char *path, long *text, long *state) {
+  FILE *f = fopen(path, "rb");
+  CHECK(f);
+  fseek(f, 0, SEEK_END);
+  long len = ftell(f);
+  rewind(f);
+  uint8_t *obj = malloc(len);
+  CHECK(obj && fread(obj, 1, len, f) == (size_t)len);
+  fclose(f);
+  const Elf64_Ehdr *eh = (const Elf64_Ehdr *)obj;
+  CHECK(!memcmp(eh->e_ident, ELFMAG, SELFMAG));
+  CHECK_EQ(eh->e_ident[EI_CLASS], ELFCLASS64);
+  *text = *state = 0;
+  for (int i = 0; i < eh->e_shnum; i++) {
+    const Elf64_Shdr *sh =
+        (const Elf64_Shdr *)(obj + eh->e_shoff + i * eh->e_shentsize);
+    if (!(sh->sh_flags & SHF_ALLOC)) {
+      continue;
+    }
+    if (sh->sh_flags & SHF_EXECINSTR) {
+      *text += sh->sh_size;
+    } else if (sh->sh_flags & SHF_WRITE) {
+      *state += sh->sh_size;
+    }
+  }
+  free(obj);
+}
+
+static double frame_ns(void) {
+  RoboEyes_init(rect, triangle, clear, update, millis, random_below);
+  RoboEyes_begin(SCREEN_W, SCREEN_H, 1000 / FRAME_MS);
+  RoboEyes_setAutoblinker2(true, 3, 2);
+  RoboEyes_setIdleMode2(true, 2, 2);
+  RoboEyes_setCuriosity(true);
+  RoboEyes_setNaturalGaze(true);
+  rng = 1;
+  double start = host_now_s();
+  for (int f = 0; f < FRAMES; f++) {
+    // RoboEyes' timers outlive a round: the clock goes on
+    now += FRAME_MS;
+    if (f % 500 == 0) {
+      RoboEyes_setMood(f / 500 % 4);
+      RoboEyes_setSweat(f / 500 % 3 == 1);
+    }
+    if (f % 500 == 250) {
+      if (f / 500 % 2) {
+        RoboEyes_anim_laugh();
+      } else {
+        RoboEyes_anim_confused();
+      }
+    }
+    RoboEyes_update();
+  }
+  return (host_now_s() - start) / FRAMES * 1e9;
+}
+
+int main(void) {
+  long text, state;
+  object_size(ROBOEYES_OBJECT, &text, &state);
+  double best = 0;
+  for (int round = 0; round < ROUNDS; round++) {
+    double ns = frame_ns();
+    best = !round || ns < best ? ns : best;
+  }
+  printf("%-7s text %5ld bytes, state %4ld bytes, %6.1f ns/frame\n",
+         ROBOEYES_BUILD, text, state, best);
+#ifdef ROBOEYES_FULL_OBJECT
+  long full_text, full_state;
+  object_size(ROBOEYES_FULL_OBJECT, &full_text, &full_state);
+  CHECK(text < full_text);
+#endif
+  return 0;
+}
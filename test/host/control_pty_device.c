@@ -0,0 +1,67 @@
+// Stand-in for the device end of the control link: serves the protocol of
+// main/control_proto.c on stdin/stdout, which test_control_pty.py points at
+// a pty to drive tools/cardputer_ctl.py against it. Batches are acked like
+// control.c does, with every command counted as applied; the loop ends when
+// the host side closes.
+#include "control_proto.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#define RX_SIZE (2 * (CONTROL_MAX_PAYLOAD + CONTROL_OVERHEAD))
+
+static int send_reply(uint8_t seq, const uint8_t *payload, uint16_t len) {
+  uint8_t frame[CONTROL_MAX_PAYLOAD + CONTROL_OVERHEAD];
+  size_t n = control_encode(frame, sizeof(frame), seq, payload, len);
+  return n && write(STDOUT_FILENO, frame, n) == (ssize_t)n ? 0 : -1;
+}
+
+static int handle_frame(const control_frame_t *frame) {
+  uint8_t ack[3] = {CONTROL_REPLY_ACK, CONTROL_STATUS_BAD_BATCH, 0};
+  if (control_batch_valid(frame)) {
+    size_t pos = 0;
+    control_cmd_t cmd;
+    ack[1] = CONTROL_STATUS_OK;
+    while (control_next_cmd(frame, &pos, &cmd)) {
+      ack[2]++;
+    }
+  }
+  return send_reply(frame->seq, ack, sizeof(ack));
+}
+
+int main(void) {
+  static uint8_t rx[RX_SIZE];
+  size_t len = 0;
+  unsigned frames = 0, skipped = 0;
+  while (1) {
+    ssize_t n = read(STDIN_FILENO, rx + len, sizeof(rx) - len);
+    if (n <= 0) {
+      break;
+    }
+    len += n;
+
+    size_t off = 0;
+    while (off < len) {
+      control_frame_t frame;
+      size_t consumed;
+      control_parse_t r = control_parse(rx + off, len - off, &frame, &consumed);
+      if (r == CONTROL_PARSE_NEED_MORE) {
+        break;
+      }
+      if (r == CONTROL_PARSE_FRAME) {
+        if (handle_frame(&frame)) {
+          return 1;
+        }
+        frames++;
+      } else {
+        skipped++;
+      }
+      off += consumed;
+    }
+    memmove(rx, rx + off, len - off);
+    len -= off;
+  }
+  fprintf(stderr, "device: %u frames, %u skips\n", frames, skipped);
+  return 0;
+}
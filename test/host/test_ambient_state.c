@@ -0,0 +1,285 @@
+// ST7789 ambient mode against a mock panel: frame memory, the scan band
+// set by PTLAR, partial mode (PTLON, NORON) and idle mode (IDMON, IDMOFF),
+// which keeps the top bit of each channel. After every command and every
+// frame, each eye pixel in memory must be lit on the glass. Entering must
+// go palette, PTLAR, PTLON, IDMON and leaving IDMOFF, NORON, palette; a
+// RoboEyes run of sleepy and active spells with idle jumps must never show
+// a dark eye, and the two mis-orderings lcd.c could make, the normal
+// palette back before IDMOFF and the band moved after the frame lands, must.
+#include "FluxGarage_RoboEyes.h"
+#include "ambient_state.h"
+#include "eye_list.h"
+#include "eye_style.h"
+#include "host_test.h"
+#include "raster.h"
+
+#include <string.h>
+
+#define SCREEN_W 240
+#define SCREEN_H 135
+#define FRAMES 40000
+#define FRAME_MS 20
+#define SPELL_FRAMES 700
+#define BLUE 0x000c    // lcd.c's robo_color(1), normal palette
+#define AMBIENT 0x0010 // and in the ambient palette, top bit of blue set
+
+typedef enum {
+  ORDER_RIGHT,
+  ORDER_PALETTE_FIRST, // the normal palette drawn before IDMOFF
+  ORDER_BAND_LATE,     // the band moved after the frame lands
+} order_t;
+
+static uint16_t gram[SCREEN_W * SCREEN_H];
+static struct {
+  bool partial, idle;
+  int start, end; // PTLAR gate lines
+} panel;
+static uint8_t log_cmds[16];
+static int log_len;
+static int glitches, errors;
+
+static eye_list_t list;
+static raster_target_t target;
+static uint32_t now;
+static uint64_t rng;
+
+// What idle mode shows of a colour
+static uint16_t eight_colours(uint16_t c) {
+  return (c & 0x8000 ? 0xf800 : 0) | (c & 0x0400 ? 0x07e0 : 0) |
+         (c & 0x0010 ? 0x001f : 0);
+}
+
+// MADCTL MV | MX: screen column x is gate line 319 - (40 + x)
+static bool scanned(int x) {
+  int line = 319 - (40 + x);
+  return !panel.partial || (line >= panel.start && line <= panel.end);
+}
+
+// Every lit pixel in memory is lit on the glass. In idle mode only the
+// eye bodies count: glow and gradient edges may drop in 8 colours.
+static void check_glass(void) {
+  for (int x = 0; x < SCREEN_W; x++) {
+    for (int y = 0; y < SCREEN_H; y++) {
+      uint16_t c = gram[y * SCREEN_W + x];
+      uint16_t shown = scanned(x) ? (panel.idle ? eight_colours(c) : c) : 0;
+      if (c && !shown && (!panel.idle || c == BLUE || c == AMBIENT)) {
+        glitches++;
+        return;
+      }
+    }
+  }
+}
+
+static void panel_cmd(void *ctx, uint8_t cmd, const uint8_t *data,
+                      size_t len) {
+  (void)ctx;
+  if (log_len < (int)sizeof(log_cmds)) {
+    log_cmds[log_len++] = cmd;
+  }
+  switch (cmd) {
+  case ST7789_PTLAR:
+    if (len != 4) {
+      errors++;
+      return;
+    }
+    panel.start = data[0] << 8 | data[1];
+    panel.end = data[2] << 8 | data[3];
+    // Inside the glass: the 40 line gap either side
+    errors += panel.start > panel.end || panel.start < 40 || panel.end > 279;
+    break;
+  case ST7789_PTLON:
+    panel.partial = true;
+    break;
+  case ST7789_NORON:
+    panel.partial = false;
+    break;
+  case ST7789_IDMON:
+    panel.idle = true;
+    break;
+  case ST7789_IDMOFF:
+    panel.idle = false;
+    break;
+  default:
+    errors++;
+    break;
+  }
+  errors += cmd != ST7789_PTLAR && len;
+  check_glass();
+}
+
+static void reset_panel(void) {
+  memset(&panel, 0, sizeof(panel));
+  memset(gram, 0, sizeof(gram));
+  log_len = 0;
+  glitches = 0;
+  errors = 0;
+}
+
+static bool logged(const uint8_t *cmds, int n) {
+  return log_len == n && !memcmp(log_cmds, cmds, n);
+}
+
+// The steps one at a time, on a frame covering columns 100..120
+static void test_sequence(void) {
+  ambient_config_t cfg = AMBIENT_DEFAULT_CONFIG();
+  ambient_sm_t sm;
+  ambient_sm_init(&sm, &cfg);
+  reset_panel();
+
+  // Nothing shown yet: nothing to scan, no entry
+  CHECK(!ambient_sm_frame(&sm, true, panel_cmd, NULL));
+  ambient_sm_show(&sm, 100, 120, panel_cmd, NULL);
+  CHECK(!ambient_sm_frame(&sm, false, panel_cmd, NULL));
+  CHECK_EQ(log_len, 0);
+
+  // The palette first, with no command
+  CHECK(ambient_sm_frame(&sm, true, panel_cmd, NULL));
+  CHECK(ambient_sm_palette(&sm));
+  CHECK_EQ(log_len, 0);
+  // The frame in ambient colours is on the panel: band, partial, idle
+  ambient_sm_show(&sm, 100, 120, panel_cmd, NULL);
+  CHECK(!ambient_sm_frame(&sm, true, panel_cmd, NULL));
+  static const uint8_t enter[] = {ST7789_PTLAR, ST7789_PTLON, ST7789_IDMON};
+  CHECK(logged(enter, sizeof(enter)));
+  // Columns 76..144 with the margin, reversed onto the gate lines
+  CHECK_EQ(panel.start, 319 - 40 - 144);
+  CHECK_EQ(panel.end, 319 - 40 - 76);
+  CHECK_EQ(sm.entries, 1u);
+
+  // Inside the band: no move; past it: one PTLAR over both frames
+  log_len = 0;
+  ambient_sm_show(&sm, 110, 130, panel_cmd, NULL);
+  CHECK_EQ(log_len, 0);
+  ambient_sm_show(&sm, 160, 180, panel_cmd, NULL);
+  static const uint8_t move[] = {ST7789_PTLAR};
+  CHECK(logged(move, sizeof(move)));
+  CHECK_EQ(panel.start, 319 - 40 - (180 + 24));
+  CHECK_EQ(panel.end, 319 - 40 - (110 - 24));
+  CHECK_EQ(sm.band_moves, 1u);
+
+  // Leaving: idle mode off first, then the full scan, then the palette
+  log_len = 0;
+  CHECK(ambient_sm_frame(&sm, false, panel_cmd, NULL));
+  static const uint8_t leave[] = {ST7789_IDMOFF, ST7789_NORON};
+  CHECK(logged(leave, sizeof(leave)));
+  CHECK(!ambient_sm_palette(&sm));
+  CHECK(!panel.partial && !panel.idle);
+
+  // Awake again before the ambient frame landed: back out, no command
+  ambient_sm_show(&sm, 100, 120, panel_cmd, NULL);
+  log_len = 0;
+  CHECK(ambient_sm_frame(&sm, true, panel_cmd, NULL));
+  CHECK(ambient_sm_frame(&sm, false, panel_cmd, NULL));
+  CHECK(!ambient_sm_palette(&sm));
+  CHECK_EQ(log_len, 0);
+  CHECK_EQ(errors, 0);
+}
+
+static void rect(int x, int y, int w, int h, int r, uint8_t color) {
+  eye_list_rect(&list, x, y, w, h, r, color);
+}
+
+static void triangle(int x0, int y0, int x1, int y1, int x2, int y2,
+                     uint8_t color) {
+  eye_list_triangle(&list, x0, y0, x1, y1, x2, y2, color);
+}
+
+static void clear(void) { eye_list_reset(&list); }
+
+static void update(void) {}
+
+static uint32_t millis(void) { return now; }
+
+static uint32_t random_below(uint32_t limit) {
+  rng = rng * 6364136223846793005ull + 1442695040888963407ull;
+  return limit ? (uint32_t)(rng >> 33) % limit : 0;
+}
+
+// lcd.c's robo_set_palette()
+static void set_palette(bool ambient) {
+  raster_set_colors(&target, 0x0000, ambient ? AMBIENT : BLUE);
+  if (!ambient) {
+    eye_style_refresh();
+  }
+}
+
+// Sleepy and active spells in the glow style, whose eye bodies are the
+// blue that idle mode drops; returns the glitches
+static int run(order_t order) {
+  reset_panel();
+  raster_target_init(&target, gram, SCREEN_W, SCREEN_W, SCREEN_H);
+  eye_style_init(&target);
+  eye_style_set(EYE_STYLE_GLOW);
+  set_palette(false);
+  RoboEyes_init(rect, triangle, clear, update, millis, random_below);
+  RoboEyes_begin(SCREEN_W, SCREEN_H, 1000 / FRAME_MS);
+  RoboEyes_setAutoblinker2(true, 3, 2);
+  RoboEyes_setIdleMode2(true, 2, 2);
+  // RoboEyes' timers outlive a run: the clock goes on
+  rng = 7;
+  ambient_config_t cfg = AMBIENT_DEFAULT_CONFIG();
+  ambient_sm_t sm;
+  ambient_sm_init(&sm, &cfg);
+  long idle_frames = 0, idle_lines = 0;
+
+  for (int f = 0; f < FRAMES; f++) {
+    now += FRAME_MS;
+    int spell = f / SPELL_FRAMES;
+    bool slow = spell % 3 && f % SPELL_FRAMES > spell % 50;
+    if (f % SPELL_FRAMES == 0) {
+      RoboEyes_setMood(spell % 4 == 1 ? TIRED : DEFAULT);
+    }
+    // Between frames, the last one on the panel
+    bool palette_drawn = false;
+    if (order == ORDER_PALETTE_FIRST && sm.phase == AMBIENT_ON && !slow) {
+      set_palette(false);
+      eye_list_render(&list, &target);
+      check_glass();
+      palette_drawn = true;
+    }
+    if (ambient_sm_frame(&sm, slow, panel_cmd, NULL) && !palette_drawn) {
+      set_palette(ambient_sm_palette(&sm));
+    }
+
+    RoboEyes_update();
+    // lcd.c's updateDisplay(): the frame's columns, glow included
+    int g = target.glow_size;
+    if (order != ORDER_BAND_LATE) {
+      ambient_sm_show(&sm, list.x1 - g, list.x2 + g, panel_cmd, NULL);
+    }
+    eye_list_render(&list, &target);
+    check_glass();
+    if (order == ORDER_BAND_LATE) {
+      ambient_sm_show(&sm, list.x1 - g, list.x2 + g, panel_cmd, NULL);
+    }
+    idle_frames += panel.idle;
+    idle_lines += panel.idle ? panel.end - panel.start + 1 : 0;
+  }
+
+  if (order == ORDER_RIGHT) {
+    printf("%d frames: %u entries, %u band moves, %ld in idle mode "
+           "scanning %ld of %d lines on average\n",
+           FRAMES, sm.entries, sm.band_moves, idle_frames,
+           idle_frames ? idle_lines / idle_frames : 0, SCREEN_W);
+    CHECK(sm.entries >= 10);
+    CHECK(sm.band_moves > 0);
+    CHECK(idle_lines < idle_frames * SCREEN_W);
+    // The run ends in an active spell: panel back to normal
+    CHECK(!panel.partial && !panel.idle);
+  }
+  CHECK_EQ(errors, 0);
+  return glitches;
+}
+
+int main(void) {
+  test_sequence();
+  CHECK_EQ(run(ORDER_RIGHT), 0);
+  int palette_first = run(ORDER_PALETTE_FIRST);
+  int band_late = run(ORDER_BAND_LATE);
+  printf("glitches: palette before IDMOFF %d, band after the frame %d\n",
+         palette_first, band_late);
+  CHECK(palette_first > 0);
+  CHECK(band_late > 0);
+  puts("ambient_state: ok");
+  return 0;
+}
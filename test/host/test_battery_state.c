@@ -0,0 +1,251 @@
+// Battery levels from voltage traces, one reading per 10 s burst as
+// battery.c takes them: a discharge with load dips, a boot that starts in
+// an inrush dip, single deep dips on a good cell, the Cardputer on USB with
+// no cell and one put in later, and a charge. With files as arguments (one
+// reading per line, or battery.c's debug log) it prints the level changes.
+#include "battery_state.h"
+#include "host_test.h"
+
+#include <string.h>
+
+#define PERIOD_S 10 // battery.c's BATTERY_PERIOD_MS
+#define MAX_READINGS 4096
+
+static const char *names[] = {"ok", "low", "critical"};
+
+typedef struct {
+  uint16_t mv[MAX_READINGS];
+  int count;
+} trace_t;
+
+typedef struct {
+  int at;                // reading index
+  battery_level_t level; // level entered
+} change_t;
+
+static uint32_t lcg = 2024;
+static int noise(int amp) {
+  lcg = lcg * 1103515245 + 12345;
+  return (int)((lcg >> 16) % (2 * amp + 1)) - amp;
+}
+
+static void add(trace_t *t, int mv) {
+  if (t->count < MAX_READINGS) {
+    t->mv[t->count++] = mv < 0 ? 0 : (uint16_t)mv;
+  }
+}
+
+// Resting voltage falling linearly from from_mv to to_mv, with ADC noise
+// and the backlight and speaker pulling some bursts down
+static void ramp(trace_t *t, int n, int from_mv, int to_mv) {
+  for (int i = 0; i < n; i++) {
+    int mv = from_mv + (to_mv - from_mv) * i / n + noise(30);
+    if (i % 7 == 3) {
+      mv -= 180;
+    }
+    if (i % 23 == 11) {
+      mv -= 260;
+    }
+    add(t, mv);
+  }
+}
+
+// Run a trace; returns the number of level changes, written to out[]
+static int run(const trace_t *t, battery_sm_t *sm, change_t *out, int cap) {
+  battery_config_t cfg = BATTERY_DEFAULT_CONFIG();
+  battery_sm_init(sm, &cfg);
+  int n = 0;
+  for (int i = 0; i < t->count; i++) {
+    if (battery_sm_reading(sm, t->mv[i]) && n < cap) {
+      out[n].at = i;
+      out[n].level = sm->level;
+      n++;
+    }
+  }
+  return n;
+}
+
+// Index of the first reading from which the resting voltage stays below mv
+static int rests_below(int n, int from_mv, int to_mv, int mv) {
+  return (from_mv - mv) * n / (from_mv - to_mv);
+}
+
+// The whole discharge changes level exactly twice, each after the resting
+// voltage has crossed the threshold, and confirmed over several readings
+static void test_discharge(void) {
+  static trace_t t;
+  t.count = 0;
+  ramp(&t, 1100, 4150, 3300);
+  battery_sm_t sm;
+  change_t c[8];
+  int n = run(&t, &sm, c, 8);
+  for (int i = 0; i < n; i++) {
+    printf("discharge: %s at reading %d, %d min\n", names[c[i].level],
+           c[i].at, c[i].at * PERIOD_S / 60);
+  }
+  CHECK_EQ(n, 2);
+  CHECK_EQ(c[0].level, BATTERY_LOW);
+  CHECK_EQ(c[1].level, BATTERY_CRITICAL);
+  CHECK(sm.present);
+  // The filter runs behind the load dips; it trips a little early, never
+  // before the resting voltage is within 60 mV of the threshold
+  CHECK(c[0].at >= rests_below(1100, 4150, 3300, 3550 + 60));
+  CHECK(c[1].at >= rests_below(1100, 4150, 3300, 3350 + 60));
+  CHECK(c[1].at < 1100);
+}
+
+// Booting in an inrush dip: the first reading primes the filter low, but
+// the readings after it disagree, so the level stays
+static void test_boot_dip(void) {
+  static trace_t t;
+  t.count = 0;
+  add(&t, 2900);
+  ramp(&t, 60, 3800, 3790);
+  battery_sm_t sm;
+  change_t c[4];
+  CHECK_EQ(run(&t, &sm, c, 4), 0);
+  // Left the dip behind; the load dips keep it under the resting voltage
+  CHECK(battery_sm_mv(&sm) > 3600);
+}
+
+// A good cell with single deep dips, and two in a row: no level change.
+// Three critical readings in a row do go CRITICAL, on the third.
+static void test_single_dips(void) {
+  static trace_t t;
+  t.count = 0;
+  for (int i = 0; i < 200; i++) {
+    add(&t, 3700 + noise(20));
+    if (i % 40 == 20) {
+      add(&t, 3000);
+    }
+    if (i == 150) {
+      add(&t, 3100);
+      add(&t, 3050);
+    }
+  }
+  battery_sm_t sm;
+  change_t c[4];
+  CHECK_EQ(run(&t, &sm, c, 4), 0);
+
+  // A cell that really is flat: critical from the first reading
+  t.count = 0;
+  for (int i = 0; i < 10; i++) {
+    add(&t, 3200 + noise(20));
+  }
+  battery_config_t cfg = BATTERY_DEFAULT_CONFIG();
+  CHECK_EQ(run(&t, &sm, c, 4), 1);
+  CHECK_EQ(c[0].level, BATTERY_CRITICAL);
+  CHECK_EQ(c[0].at, cfg.confirm - 1);
+}
+
+// On USB with no cell the divider floats near 0 V: no battery, level OK.
+// A cell put in is measured from its own first reading; a flat one is
+// swapped in, goes LOW and CRITICAL as the filter follows it, and pulling
+// it goes back to OK at once.
+static void test_no_battery(void) {
+  static trace_t t;
+  t.count = 0;
+  for (int i = 0; i < 100; i++) {
+    add(&t, 150 + noise(150));
+  }
+  int inserted = t.count;
+  ramp(&t, 100, 3950, 3940);
+  int flat = t.count;
+  for (int i = 0; i < 20; i++) {
+    add(&t, 3200 + noise(20));
+  }
+  int pulled = t.count;
+  for (int i = 0; i < 10; i++) {
+    add(&t, 80 + noise(80));
+  }
+
+  battery_config_t cfg = BATTERY_DEFAULT_CONFIG();
+  battery_sm_t sm;
+  battery_sm_init(&sm, &cfg);
+  int changes = 0;
+  for (int i = 0; i < t.count; i++) {
+    bool changed = battery_sm_reading(&sm, t.mv[i]);
+    changes += changed;
+    if (i < inserted) {
+      CHECK(!sm.present);
+      CHECK_EQ(sm.level, BATTERY_OK);
+      CHECK_EQ(battery_sm_percent(&sm), 0);
+    } else if (i < flat) {
+      CHECK(sm.present);
+      CHECK_EQ(sm.level, BATTERY_OK);
+      CHECK(battery_sm_percent(&sm) > 40);
+    } else if (i == pulled - 1) {
+      CHECK_EQ(sm.level, BATTERY_CRITICAL);
+    } else if (i == pulled) {
+      CHECK(changed);
+      CHECK(!sm.present);
+      CHECK_EQ(sm.level, BATTERY_OK);
+    }
+  }
+  CHECK_EQ(changes, 3);
+  CHECK_EQ(sm.readings, (uint32_t)t.count);
+}
+
+// Charging from LOW: back to OK once, above the threshold plus recover_mv
+static void test_charge(void) {
+  static trace_t t;
+  t.count = 0;
+  ramp(&t, 400, 3450, 4100);
+  battery_sm_t sm;
+  change_t c[8];
+  int n = run(&t, &sm, c, 8);
+  for (int i = 0; i < n; i++) {
+    printf("charge: %s at reading %d\n", names[c[i].level], c[i].at);
+  }
+  CHECK_EQ(n, 2);
+  CHECK_EQ(c[0].level, BATTERY_LOW);
+  CHECK_EQ(c[1].level, BATTERY_OK);
+  CHECK(c[1].at >= rests_below(400, 3450, 4100, 3550 + 100));
+}
+
+// One reading per line: a number, or battery.c's "reading <mV> mV" log
+static bool load(const char *path, trace_t *t) {
+  FILE *f = fopen(path, "r");
+  if (!f) {
+    return false;
+  }
+  char line[256];
+  t->count = 0;
+  while (fgets(line, sizeof(line), f)) {
+    const char *p = strstr(line, "reading ");
+    int mv;
+    if (sscanf(p ? p + 8 : line, "%d", &mv) == 1) {
+      add(t, mv);
+    }
+  }
+  fclose(f);
+  return true;
+}
+
+int main(int argc, char **argv) {
+  if (argc > 1) {
+    static trace_t t;
+    for (int i = 1; i < argc; i++) {
+      if (!load(argv[i], &t)) {
+        fprintf(stderr, "%s: cannot read\n", argv[i]);
+        return 1;
+      }
+      battery_sm_t sm;
+      change_t c[64];
+      int n = run(&t, &sm, c, 64);
+      printf("%s: %d readings, %d level changes\n", argv[i], t.count, n);
+      for (int k = 0; k < n && k < 64; k++) {
+        printf("  %-8s at reading %5d, %6d s\n", names[c[k].level], c[k].at,
+               c[k].at * PERIOD_S);
+      }
+    }
+    return 0;
+  }
+  test_discharge();
+  test_boot_dip();
+  test_single_dips();
+  test_no_battery();
+  test_charge();
+  puts("battery_state: ok");
+  return 0;
+}
@@ -0,0 +1,221 @@
+// Behaviour scripts against a virtual clock, with RoboEyes and
+// eye_action_apply() stubbed to log what the script asks for: the default
+// script plays blink_task's old cycle at its pace, its loop lands back on
+// the first instruction, counted loops, random branches and actions run as
+// written, and malformed scripts are rejected
+#include "FluxGarage_RoboEyes.h"
+#include "behaviour.h"
+#include "eye_actions.h"
+#include "host_test.h"
+
+#include <string.h>
+
+#define FRAME_MS 16
+#define MAX_EVENTS 64
+
+typedef enum {
+  EV_MOOD,
+  EV_CONFUSED,
+  EV_LAUGH,
+  EV_BLINK,
+  EV_POSITION,
+  EV_ACTION,
+} event_kind_t;
+
+typedef struct {
+  uint32_t at;
+  event_kind_t kind;
+  uint8_t arg;
+} event_t;
+
+static event_t events[MAX_EVENTS];
+static int n_events;
+static uint32_t now;
+static uint32_t coin;
+
+static void log_event(event_kind_t kind, uint8_t arg) {
+  if (n_events < MAX_EVENTS) {
+    events[n_events++] = (event_t){now, kind, arg};
+  }
+}
+
+void RoboEyes_setMood(uint8_t mood) { log_event(EV_MOOD, mood); }
+void RoboEyes_anim_confused() { log_event(EV_CONFUSED, 0); }
+void RoboEyes_anim_laugh() { log_event(EV_LAUGH, 0); }
+void RoboEyes_blink() { log_event(EV_BLINK, 0); }
+void RoboEyes_setPosition(uint8_t position) {
+  log_event(EV_POSITION, position);
+}
+void eye_action_apply(const eye_action_t *action) {
+  log_event(EV_ACTION, action->type << 4 | action->arg);
+}
+
+static uint32_t fixed_random(uint32_t limit) { return coin % limit; }
+
+// blink_task's loop: mood DEFAULT, then every 5 s confused, laugh, TIRED,
+// ANGRY, HAPPY, and round again
+static const event_t blink_task_cycle[] = {
+    {0, EV_MOOD, DEFAULT}, {0, EV_CONFUSED, 0}, {0, EV_LAUGH, 0},
+    {0, EV_MOOD, TIRED},   {0, EV_MOOD, ANGRY}, {0, EV_MOOD, HAPPY},
+};
+#define CYCLE (sizeof(blink_task_cycle) / sizeof(blink_task_cycle[0]))
+
+// The render loop ticking the player every frame for three cycles
+static void test_default_cycle(uint32_t start) {
+  CHECK(behaviour_validate(behaviour_default_script,
+                           behaviour_default_script_size));
+  behaviour_player_t player;
+  n_events = 0;
+  now = start;
+  behaviour_player_init(&player, now);
+  behaviour_play(&player, behaviour_default_script, fixed_random);
+  while (n_events < (int)(3 * CYCLE)) {
+    behaviour_tick(&player, now);
+    now += FRAME_MS;
+  }
+  CHECK(now - start < 3 * CYCLE * 5100);
+  for (int i = 0; i < n_events; i++) {
+    CHECK_EQ(events[i].kind, blink_task_cycle[i % CYCLE].kind);
+    CHECK_EQ(events[i].arg, blink_task_cycle[i % CYCLE].arg);
+    // Like vTaskDelay() after each step: 5 s from the frame that ran it,
+    // on the first frame and wheel tick after
+    uint32_t gap = events[i].at - (i ? events[i - 1].at : start);
+    CHECK(gap >= (i ? 5000u : 0u));
+    CHECK(gap < (i ? 5000u : 0u) + FRAME_MS + TW_TICK_MS);
+  }
+  // One run per step, every step a wait: nothing spins
+  CHECK_EQ(player.runs, (uint32_t)n_events);
+}
+
+// The LOOP's offset takes it back to the first instruction: the run after
+// the sixth wait replays the first one exactly
+static void test_loop_offset(void) {
+  behaviour_vm_t vm;
+  behaviour_start(&vm, behaviour_default_script, fixed_random);
+  n_events = 0;
+  for (size_t i = 0; i < CYCLE; i++) {
+    CHECK_EQ(behaviour_run(&vm), 5000);
+  }
+  CHECK_EQ(vm.pc, vm.len - 4); // on the LOOP
+  uint32_t before = vm.instructions;
+  CHECK_EQ(behaviour_run(&vm), 5000);
+  CHECK_EQ(vm.instructions - before, 3); // LOOP, MOOD, WAIT
+  CHECK_EQ(vm.pc, 2 + 3);                // past the first MOOD and WAIT
+  CHECK_EQ(n_events, (int)CYCLE + 1);
+  CHECK_EQ(events[CYCLE].kind, EV_MOOD);
+  CHECK_EQ(events[CYCLE].arg, DEFAULT);
+}
+
+// A counted loop around a random branch and an action, then the end
+static void test_ops(void) {
+  static const uint8_t script[] = {
+      BS_HEADER(22),
+      BS_ACTION(EYE_ACTION_SWEAT, ON), // 0
+      BS_RANDOM(128, 2),               // 3: skip the blink if taken
+      BS_CLIP(BEHAVIOUR_CLIP_BLINK),   // 7
+      BS_LOOK(255, 0),                 // 9
+      BS_WAIT(100),                    // 12
+      BS_LOOP(3, -19),                 // 15: back to 0, three times
+      BS_MOOD(HAPPY),                  // 19
+      BS_END,                          // 21
+  };
+  CHECK(behaviour_validate(script, sizeof(script)));
+  behaviour_vm_t vm;
+  behaviour_start(&vm, script, fixed_random);
+  n_events = 0;
+  for (int i = 0; i < 3; i++) {
+    coin = i == 1 ? 0 : 200; // taken the second time round only
+    CHECK_EQ(behaviour_run(&vm), 100);
+  }
+  CHECK_EQ(behaviour_run(&vm), BEHAVIOUR_DONE);
+  CHECK_EQ(behaviour_run(&vm), BEHAVIOUR_DONE);
+  static const event_t want[] = {
+      {0, EV_ACTION, EYE_ACTION_SWEAT << 4 | ON},
+      {0, EV_BLINK, 0},
+      {0, EV_POSITION, NE},
+      {0, EV_ACTION, EYE_ACTION_SWEAT << 4 | ON},
+      {0, EV_POSITION, NE},
+      {0, EV_ACTION, EYE_ACTION_SWEAT << 4 | ON},
+      {0, EV_BLINK, 0},
+      {0, EV_POSITION, NE},
+      {0, EV_MOOD, HAPPY},
+  };
+  CHECK_EQ(n_events, (int)(sizeof(want) / sizeof(want[0])));
+  for (int i = 0; i < n_events; i++) {
+    CHECK_EQ(events[i].kind, want[i].kind);
+    CHECK_EQ(events[i].arg, want[i].arg);
+  }
+}
+
+// A script without a wait yields after the step budget instead of hanging
+// the render loop
+static void test_budget(void) {
+  static const uint8_t script[] = {
+      BS_HEADER(6),
+      BS_MOOD(TIRED),
+      BS_LOOP(0, -6),
+  };
+  behaviour_vm_t vm;
+  behaviour_start(&vm, script, fixed_random);
+  CHECK_EQ(behaviour_run(&vm), 0);
+  CHECK_EQ(vm.instructions, BEHAVIOUR_STEP_BUDGET);
+}
+
+static bool valid(const uint8_t *script, size_t len) {
+  return behaviour_validate(script, len);
+}
+
+static void test_malformed(void) {
+  uint8_t s[BEHAVIOUR_MAX_SIZE + 1];
+  size_t len = behaviour_default_script_size;
+  memcpy(s, behaviour_default_script, len);
+  CHECK(valid(s, len));
+
+  CHECK(!valid(s, BEHAVIOUR_HEADER_SIZE - 1)); // short of a header
+  CHECK(!valid(s, len - 1)); // shorter than its header says
+  s[0] = 'X';
+  CHECK(!valid(s, len)); // magic
+  s[0] = BEHAVIOUR_MAGIC0;
+  s[2] = BEHAVIOUR_VERSION + 1;
+  CHECK(!valid(s, len)); // version
+  s[2] = BEHAVIOUR_VERSION;
+  s[BEHAVIOUR_HEADER_SIZE + 2] = 0x7f;
+  CHECK(!valid(s, len)); // unknown opcode
+  s[BEHAVIOUR_HEADER_SIZE + 2] = BEHAVIOUR_OP_WAIT;
+
+  // Jumps off the code or into the middle of an instruction
+  static const int16_t offsets[] = {-35, -33, -1, 0, 1};
+  for (size_t i = 0; i < sizeof(offsets) / sizeof(offsets[0]); i++) {
+    s[len - 2] = offsets[i] & 0xff;
+    s[len - 1] = (offsets[i] >> 8) & 0xff;
+    CHECK(!valid(s, len));
+  }
+  s[len - 2] = (uint8_t)-34;
+  s[len - 1] = 0xff;
+  CHECK(valid(s, len));
+
+  // An instruction cut off by the end of the script
+  static const uint8_t cut[] = {BS_HEADER(2), BS_WAIT(1000)};
+  CHECK(!valid(cut, sizeof(cut) - 1));
+  static const uint8_t cut_fixed[] = {BS_HEADER(3), BS_WAIT(1000)};
+  CHECK(valid(cut_fixed, sizeof(cut_fixed)));
+
+  // Too big for the runner's buffer, even with a matching header
+  memset(s, BEHAVIOUR_OP_END, sizeof(s));
+  uint8_t head[] = {BS_HEADER(BEHAVIOUR_MAX_SIZE + 1 -
+                              BEHAVIOUR_HEADER_SIZE)};
+  memcpy(s, head, sizeof(head));
+  CHECK(!valid(s, sizeof(s)));
+}
+
+int main(void) {
+  // From boot, and straddling the millisecond counter wrapping
+  test_default_cycle(0);
+  test_default_cycle(UINT32_MAX - 20000);
+  test_loop_offset();
+  test_ops();
+  test_budget();
+  test_malformed();
+  puts("behaviour: ok");
+  return 0;
+}
@@ -0,0 +1,101 @@
+#!/usr/bin/env python3
+"""Drive tools/cardputer_ctl.py over a pty against control_pty_device, the
+host build of the device's protocol code, and report commands per second.
+
+    test_control_pty.py DEVICE_EXE [SECONDS]
+"""
+
+import fcntl
+import os
+import select
+import struct
+import subprocess
+import sys
+import termios
+import tty
+
+sys.path.insert(0, os.path.join(os.path.dirname(__file__), "..", "..",
+                                "tools"))
+import cardputer_ctl as ctl  # noqa: E402
+
+
+class PtyPort:
+    """The part of pyserial's Serial that the Client uses, on a pty master."""
+
+    def __init__(self, fd, timeout=1.0):
+        self.fd = fd
+        self.timeout = timeout
+
+    @property
+    def in_waiting(self):
+        buf = fcntl.ioctl(self.fd, termios.FIONREAD, b"\0\0\0\0")
+        return struct.unpack("i", buf)[0]
+
+    def read(self, n):
+        ready, _, _ = select.select([self.fd], [], [], self.timeout)
+        return os.read(self.fd, n) if ready else b""
+
+    def write(self, data):
+        view = memoryview(data)
+        while view:
+            view = view[os.write(self.fd, view):]
+
+    def close(self):
+        os.close(self.fd)
+
+
+def main(argv):
+    exe = argv[1]
+    seconds = float(argv[2]) if len(argv) > 2 else 1.0
+    master, slave = os.openpty()
+    tty.setraw(slave)
+    device = subprocess.Popen([exe], stdin=slave, stdout=slave)
+    os.close(slave)
+    client = ctl.Client(PtyPort(master))
+    failures = 0
+
+    def check(cond, what):
+        nonlocal failures
+        if not cond:
+            print("FAIL: %s" % what)
+            failures += 1
+
+    try:
+        status, applied, _ = client.batch([ctl.command(ctl.CMD_PING)])
+        check((status, applied) == (0, 1), "ping acked")
+
+        cmds = [ctl.command(ctl.CMD_MOOD, [1]),
+                ctl.command(ctl.CMD_LOOK, struct.pack("<hh", 120, 60)),
+                ctl.command(ctl.CMD_TEXT, b"\0hello")]
+        status, applied, _ = client.batch(cmds)
+        check((status, applied) == (0, 3), "mixed batch applied")
+
+        # a wrong argument size rejects the whole batch
+        status, applied, _ = client.batch([ctl.command(ctl.CMD_MOOD)])
+        check((status, applied) == (1, 0), "bad batch nak'ed")
+
+        # garbage and a corrupted frame in front of a good one are skipped
+        bad = bytearray(ctl.encode_frame(7, ctl.command(ctl.CMD_PING)))
+        bad[-1] ^= 0xFF
+        client.port.write(b"\x00\xa5junk" + bytes(bad))
+        status, applied, _ = client.batch([ctl.command(ctl.CMD_PING)])
+        check((status, applied) == (0, 1), "resync after garbage")
+
+        # the ack counts applied commands in a byte
+        batch = [ctl.command(ctl.CMD_PING)] * 255
+        status, applied, _ = client.batch(batch)
+        check((status, applied) == (0, len(batch)), "largest countable batch")
+
+        for size in (1, 8, 64):
+            rate = ctl.bench(client, seconds / 3, size)
+            print("batches of %2d: %8.0f commands/s" % (size, rate))
+            check(rate > 0, "bench made progress")
+    finally:
+        client.close()
+        device.wait(timeout=5)
+    check(device.returncode == 0, "device exited cleanly")
+    return 1 if failures else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv))
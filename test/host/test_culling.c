@@ -0,0 +1,154 @@
+// RoboEyes' culling stage must not change a pixel: a scripted run through
+// moods, flicker, sweat, cyclops, laugh and off-screen gazes is drawn the
+// way main/lcd.c does (display list, software rasterizer) with culling off
+// in a child process and on here, in every eye style, and the frames are
+// compared by hash.
+#include "FluxGarage_RoboEyes.h"
+#include "eye_list.h"
+#include "eye_style.h"
+#include "host_test.h"
+#include "raster.h"
+
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#define SCREEN_W 240
+#define SCREEN_H 135
+#define FRAMES 6000
+#define FRAME_MS 20
+
+static uint16_t fb[SCREEN_W * SCREEN_H];
+static raster_target_t target;
+static eye_list_t list;
+static uint64_t hashes[FRAMES];
+static int frame;
+static uint32_t now;
+static uint64_t rng;
+
+static void rect(int x, int y, int w, int h, int r, uint8_t color) {
+  eye_list_rect(&list, x, y, w, h, r, color);
+}
+
+static void eye(uint8_t e, int x, int y, int w, int h, int r,
+                uint8_t color) {
+  (void)e;
+  eye_list_rect(&list, x, y, w, h, r, color);
+}
+
+static void triangle(int x0, int y0, int x1, int y1, int x2, int y2,
+                     uint8_t color) {
+  eye_list_triangle(&list, x0, y0, x1, y1, x2, y2, color);
+}
+
+static void clear(void) { eye_list_reset(&list); }
+
+static void update(void) {
+  eye_list_render(&list, &target);
+  uint64_t h = 1469598103934665603ull;
+  for (int i = 0; i < SCREEN_W * SCREEN_H; i++) {
+    h = (h ^ fb[i]) * 1099511628211ull;
+  }
+  if (frame < FRAMES) {
+    hashes[frame] = h;
+  }
+}
+
+static uint32_t millis(void) { return now; }
+
+static uint32_t random_below(uint32_t limit) {
+  rng = rng * 6364136223846793005ull + 1442695040888963407ull;
+  return limit ? (uint32_t)(rng >> 33) % limit : 0;
+}
+
+// The same script for both runs; every 300 frames a new combination
+static void run(eye_style_t style, bool cull, RoboEyesCullStats *stats) {
+  raster_target_init(&target, fb, SCREEN_W, SCREEN_W, SCREEN_H);
+  raster_set_colors(&target, 0x0000, 0x000c);
+  eye_style_init(&target);
+  eye_style_set(style);
+  RoboEyes_init(rect, triangle, clear, update, millis, random_below);
+  RoboEyes_setEyeHook(eye);
+  RoboEyes_setCulling(cull);
+  RoboEyes_setCullMargin(target.glow_size);
+  RoboEyes_resetCullStats();
+  RoboEyes_begin(SCREEN_W, SCREEN_H, 50);
+  RoboEyes_setAutoblinker2(true, 1, 1);
+  RoboEyes_setIdleMode2(true, 1, 1);
+  for (frame = 0; frame < FRAMES; frame++) {
+    now += FRAME_MS;
+    if (frame % 300 == 0) {
+      int k = frame / 300 % 12;
+      RoboEyes_setMood(k % 4);
+      RoboEyes_setSweat(k & 1);
+      RoboEyes_setCyclops(k / 4 == 1);
+      RoboEyes_setCuriosity(k & 2);
+      RoboEyes_setHFlicker2(k == 5, 20);
+      RoboEyes_setVFlicker2(k == 7, 30);
+      if (k == 3) {
+        RoboEyes_anim_confused();
+      }
+      if (k == 9) {
+        RoboEyes_anim_laugh();
+      }
+      RoboEyes_setPosition(k % 9);
+      RoboEyes_setSpacebetween(k == 11 ? -20 : 10);
+      if (k == 10) {
+        RoboEyes_lookAt(-40, SCREEN_H + 40); // pushes the eyes against the edge
+      }
+    }
+    RoboEyes_update();
+  }
+  RoboEyes_getCullStats(stats);
+}
+
+static void check_style(eye_style_t style) {
+  RoboEyesCullStats stats;
+  int fds[2];
+  CHECK(pipe(fds) == 0);
+  pid_t pid = fork();
+  CHECK(pid >= 0);
+  if (pid == 0) {
+    close(fds[0]);
+    run(style, false, &stats);
+    ssize_t n = write(fds[1], hashes, sizeof(hashes));
+    _exit(n == (ssize_t)sizeof(hashes) ? 0 : 1);
+  }
+  close(fds[1]);
+  static uint64_t reference[FRAMES];
+  size_t got = 0;
+  ssize_t n;
+  while (got < sizeof(reference) &&
+         (n = read(fds[0], (char *)reference + got,
+                   sizeof(reference) - got)) > 0) {
+    got += n;
+  }
+  close(fds[0]);
+  int status;
+  waitpid(pid, &status, 0);
+  CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+  CHECK_EQ(got, sizeof(reference));
+
+  run(style, true, &stats);
+  int first = -1, differ = 0;
+  for (int f = 0; f < FRAMES; f++) {
+    if (hashes[f] != reference[f]) {
+      differ++;
+      first = first < 0 ? f : first;
+    }
+  }
+  printf("style %d: %u primitives, %u culled, %u clipped, %u px saved; "
+         "%d frames differ (first %d)\n",
+         style, stats.submitted, stats.culled, stats.clipped,
+         stats.pixelsSaved, differ, first);
+  CHECK_EQ(differ, 0);
+  CHECK(stats.culled > 0);
+  CHECK(stats.clipped > 0);
+}
+
+int main(void) {
+  for (int s = 0; s < EYE_STYLE_COUNT; s++) {
+    check_style(s);
+  }
+  return 0;
+}
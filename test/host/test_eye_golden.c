@@ -0,0 +1,136 @@
+// Golden images of the eye renderer: a scripted RoboEyes run through moods,
+// shapes and their morphs, flicker and laugh, drawn the way main/lcd.c does
+// (display list, software rasterizer). Every frame is drawn whole and again
+// band by band, as LVGL hands out its 40 line draw buffer, which must give
+// the same pixels; the whole frames of each eye style hash to a committed
+// value. A change that moves a pixel on purpose updates the table below
+// with the digests this test prints.
+#include "FluxGarage_RoboEyes.h"
+#include "eye_list.h"
+#include "eye_shape.h"
+#include "eye_style.h"
+#include "host_test.h"
+#include "raster.h"
+
+#include <inttypes.h>
+#include <string.h>
+
+#define SCREEN_W 240
+#define SCREEN_H 135
+#define BAND_LINES 40 // main/lcd.c's LCD_BUF_LINES
+#define FRAMES 3000
+#define FRAME_MS 20
+
+static const uint64_t golden[EYE_STYLE_COUNT] = {
+    0xdb10bdb34bfdae39ull, // flat
+    0x68d1b7db4a17a74full, // gradient
+    0x2070d940061f97eaull, // glow
+    0x7f8a6676a4c7f782ull, // neon
+};
+
+static uint16_t fb[SCREEN_W * SCREEN_H];
+static uint16_t band[SCREEN_W * BAND_LINES];
+static raster_target_t target;
+static eye_list_t list;
+static uint64_t digest;
+static int frame, band_diffs;
+static uint32_t now;
+static uint64_t rng;
+
+static void rect(int x, int y, int w, int h, int r, uint8_t color) {
+  eye_list_rect(&list, x, y, w, h, r, color);
+}
+
+// lcd.c's drawEye: the selected shape, else RoboEyes' rectangle
+static void eye(uint8_t e, int x, int y, int w, int h, int r,
+                uint8_t color) {
+  (void)e;
+  eye_shape_key_t key;
+  if (eye_shape_current(now, &key)) {
+    eye_list_shape(&list, x, y, w, h, key, color);
+  } else {
+    eye_list_rect(&list, x, y, w, h, r, color);
+  }
+}
+
+static void triangle(int x0, int y0, int x1, int y1, int x2, int y2,
+                     uint8_t color) {
+  eye_list_triangle(&list, x0, y0, x1, y1, x2, y2, color);
+}
+
+static void clear(void) { eye_list_reset(&list); }
+
+static void update(void) {
+  raster_set_window(&target, fb, SCREEN_W, 0, 0, SCREEN_W, SCREEN_H);
+  eye_list_render(&list, &target);
+  for (int i = 0; i < SCREEN_W * SCREEN_H; i++) {
+    digest = (digest ^ fb[i]) * 1099511628211ull;
+  }
+
+  for (int y = 0; y < SCREEN_H; y += BAND_LINES) {
+    int h = SCREEN_H - y < BAND_LINES ? SCREEN_H - y : BAND_LINES;
+    memset(band, 0xa5, sizeof(band));
+    raster_set_window(&target, band, SCREEN_W, 0, y, SCREEN_W, h);
+    eye_list_render(&list, &target);
+    if (memcmp(band, &fb[y * SCREEN_W], h * SCREEN_W * sizeof(fb[0]))) {
+      band_diffs++;
+    }
+  }
+}
+
+static uint32_t millis(void) { return now; }
+
+static uint32_t random_below(uint32_t limit) {
+  rng = rng * 6364136223846793005ull + 1442695040888963407ull;
+  return limit ? (uint32_t)(rng >> 33) % limit : 0;
+}
+
+// Every 250 frames a new combination; shapes morph in over 400 ms
+static uint64_t run(eye_style_t style) {
+  raster_target_init(&target, fb, SCREEN_W, SCREEN_W, SCREEN_H);
+  raster_set_colors(&target, 0x0000, 0x000c);
+  eye_style_init(&target);
+  eye_style_set(style);
+  eye_shape_select(EYE_SHAPE_NONE, 0);
+  RoboEyes_init(rect, triangle, clear, update, millis, random_below);
+  RoboEyes_setEyeHook(eye);
+  RoboEyes_setCullMargin(target.glow_size);
+  RoboEyes_begin(SCREEN_W, SCREEN_H, 50);
+  RoboEyes_setAutoblinker2(true, 1, 1);
+  RoboEyes_setIdleMode2(true, 1, 1);
+  now = 0;
+  rng = 1;
+  digest = 1469598103934665603ull;
+  band_diffs = 0;
+  for (frame = 0; frame < FRAMES; frame++) {
+    now += FRAME_MS;
+    if (frame % 250 == 0) {
+      int k = frame / 250;
+      RoboEyes_setMood(k % 4);
+      RoboEyes_setCyclops(k == 4);
+      RoboEyes_setHFlicker2(k == 5, 20);
+      RoboEyes_setSweat(k == 6);
+      eye_shape_select(k % EYE_SHAPE_COUNT, k & 1 ? 400 : 0);
+      if (k == 9) {
+        RoboEyes_anim_laugh();
+      }
+      RoboEyes_setPosition(k % 9);
+    }
+    RoboEyes_update();
+  }
+  return digest;
+}
+
+int main(void) {
+  bool ok = true;
+  for (int s = 0; s < EYE_STYLE_COUNT; s++) {
+    uint64_t d = run(s);
+    printf("style %d: digest 0x%016" PRIx64 "ull, %d bands differ\n", s, d,
+           band_diffs);
+    CHECK_EQ(band_diffs, 0);
+    ok = ok && d == golden[s];
+  }
+  CHECK(ok);
+  puts("eye_golden: ok");
+  return 0;
+}
@@ -0,0 +1,143 @@
+// RoboEyes state snapshots, as eye_snapshot.c keeps them over deep sleep:
+// a run in each mood is saved after a number of frames, a fresh RoboEyes
+// set up the way main/lcd.c does it restores the snapshot on a clock
+// started over, and its next frame's display list must match, byte for
+// byte, the one the first run draws next. RoboEyes keeps its state in
+// statics that outlive init and begin, so a run in between in other
+// moods, places and timings stands in for the reset. A snapshot for
+// another screen or version is refused and changes nothing.
+#include "FluxGarage_RoboEyes.h"
+#include "eye_list.h"
+#include "host_test.h"
+
+#include <string.h>
+
+#define SCREEN_W 240
+#define SCREEN_H 135
+#define FRAME_MS 10 // lcd.c runs RoboEyes at 100 fps
+#define WAKE_MS 1234 // millis() after the wake, well short of the saving
+
+static eye_list_t list;
+static uint32_t now;
+static uint64_t rng;
+
+static void rect(int x, int y, int w, int h, int r, uint8_t color) {
+  eye_list_rect(&list, x, y, w, h, r, color);
+}
+
+static void triangle(int x0, int y0, int x1, int y1, int x2, int y2,
+                     uint8_t color) {
+  eye_list_triangle(&list, x0, y0, x1, y1, x2, y2, color);
+}
+
+static void clear(void) { eye_list_reset(&list); }
+
+static void update(void) {}
+
+static uint32_t millis(void) { return now; }
+
+static uint32_t random_below(uint32_t limit) {
+  rng = rng * 6364136223846793005ull + 1442695040888963407ull;
+  return limit ? (uint32_t)(rng >> 33) % limit : 0;
+}
+
+// app_main()'s RoboEyes setup, before eye_snapshot_restore()
+static void setup(uint32_t start) {
+  now = start;
+  RoboEyes_init(rect, triangle, clear, update, millis, random_below);
+  RoboEyes_begin(SCREEN_W, SCREEN_H, 100);
+  RoboEyes_setAutoblinker2(ON, 3, 2);
+  RoboEyes_setIdleMode2(ON, 2, 2);
+  RoboEyes_setNaturalGaze(ON);
+}
+
+// The frame drawn at the next frame time, its list zeroed first so
+// unused entries and padding compare too
+static void next_frame(eye_list_t *out) {
+  memset(&list, 0, sizeof(list));
+  now += FRAME_MS;
+  RoboEyes_update();
+  *out = list;
+}
+
+// Something else entirely, so nothing the restore misses is left over
+static void scramble(uint8_t mood, uint32_t start) {
+  setup(start + 50000);
+  rng = ~(uint64_t)start;
+  RoboEyes_setMood((mood + 1) % 4);
+  RoboEyes_setCuriosity(ON);
+  RoboEyes_setPosition(SE);
+  RoboEyes_setAutoblinker2(ON, 1, 0);
+  RoboEyes_setIdleMode2(ON, 1, 0);
+  for (int f = 0; f < 97; f++) {
+    now += FRAME_MS;
+    RoboEyes_update();
+  }
+  RoboEyes_setCuriosity(OFF);
+}
+
+// Save after frames frames in mood; returns whether the frame after the
+// restore matches
+static bool same_after_restore(uint8_t mood, int frames, uint32_t start) {
+  setup(start);
+  rng = mood * 1000 + frames;
+  RoboEyes_setMood(mood);
+  for (int f = 0; f < frames; f++) {
+    now += FRAME_MS;
+    RoboEyes_update();
+  }
+  RoboEyesSnapshot snap;
+  RoboEyes_saveState(&snap);
+  uint64_t saved_rng = rng;
+  eye_list_t want;
+  next_frame(&want);
+  scramble(mood, start);
+
+  setup(WAKE_MS);
+  rng = saved_rng;
+  CHECK(RoboEyes_restoreState(&snap));
+  eye_list_t got;
+  next_frame(&got);
+  return !memcmp(&want, &got, sizeof(want));
+}
+
+// A snapshot from another screen size or version is refused untouched
+static void test_refused(void) {
+  setup(1000);
+  RoboEyes_setMood(ANGRY);
+  RoboEyesSnapshot snap;
+  RoboEyes_saveState(&snap);
+
+  scramble(HAPPY, 1000);
+  setup(WAKE_MS);
+  uint8_t mood = RoboEyes_getMood();
+  RoboEyesSnapshot bad = snap;
+  bad.screenWidth = SCREEN_W / 2;
+  CHECK(!RoboEyes_restoreState(&bad));
+  bad = snap;
+  bad.version = ROBOEYES_SNAPSHOT_VERSION + 1;
+  CHECK(!RoboEyes_restoreState(&bad));
+  CHECK_EQ(RoboEyes_getMood(), mood);
+  CHECK(RoboEyes_restoreState(&snap));
+  CHECK_EQ(RoboEyes_getMood(), ANGRY);
+}
+
+int main(void) {
+  // Early, mid blink or idle move, and well settled; RoboEyes' timers
+  // outlive a run, so each one starts later on the clock
+  static const int frames[] = {1, 7, 25, 60, 140, 333, 500, 777, 1200, 2000};
+  uint32_t start = 100000;
+  int cases = 0, differ = 0;
+  for (uint8_t mood = DEFAULT; mood <= HAPPY; mood++) {
+    for (size_t i = 0; i < sizeof(frames) / sizeof(frames[0]); i++) {
+      differ += !same_after_restore(mood, frames[i], start);
+      cases++;
+      start += 100000;
+    }
+  }
+  printf("%d snapshots, %d next frames differ\n", cases, differ);
+  CHECK_EQ(differ, 0);
+  test_refused();
+  puts("eye_snapshot: ok");
+  return 0;
+}
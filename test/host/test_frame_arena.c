@@ -0,0 +1,332 @@
+// Frame arena: allocations cut in order and aligned, the block reused once
+// nothing in it is live, mid-frame or at the end, an allocation kept past
+// its frame pinning the arena and staying intact, requests that do not fit
+// going to the heap as frame_mem.c sends them, resizing in place and the
+// stats. Then a soak of random LVGL-like traffic, every live allocation
+// checked against its fill pattern.
+#include "frame_arena.h"
+#include "host_test.h"
+
+#include <stdint.h>
+#include <string.h>
+
+#define ARENA_SIZE 1024
+#define HEADER FRAME_ARENA_ALIGN
+#define SOAK_FRAMES 20000
+#define SOAK_LIVE 32
+
+static uint8_t mem[ARENA_SIZE] __attribute__((aligned(FRAME_ARENA_ALIGN)));
+static frame_arena_t arena;
+static uint32_t heap_allocs;
+static uint64_t rng = 1;
+
+static uint32_t random_below(uint32_t limit) {
+  rng = rng * 6364136223846793005ull + 1442695040888963407ull;
+  return (uint32_t)(rng >> 33) % limit;
+}
+
+// frame_mem.c's allocator: the arena while a frame is open, else the heap
+static void *mem_alloc(size_t size) {
+  void *p = frame_arena_alloc(&arena, size);
+  if (p) {
+    return p;
+  }
+  heap_allocs++;
+  return malloc(size);
+}
+
+static void *mem_realloc(void *p, size_t size) {
+  if (!p) {
+    return mem_alloc(size);
+  }
+  if (!frame_arena_owns(&arena, p)) {
+    return realloc(p, size);
+  }
+  if (frame_arena_resize(&arena, p, size)) {
+    return p;
+  }
+  void *q = mem_alloc(size);
+  if (q) {
+    size_t old = frame_arena_size(p);
+    memcpy(q, p, old < size ? old : size);
+    frame_arena_free(&arena, p);
+  }
+  return q;
+}
+
+static void mem_free(void *p) {
+  if (frame_arena_owns(&arena, p)) {
+    frame_arena_free(&arena, p);
+  } else {
+    free(p);
+  }
+}
+
+static void setup(void) {
+  frame_arena_init(&arena, mem, sizeof(mem));
+  heap_allocs = 0;
+}
+
+static bool aligned(const void *p) {
+  return (uintptr_t)p % FRAME_ARENA_ALIGN == 0;
+}
+
+// Cut in order behind a header, aligned; nothing outside a frame
+static void test_order(void) {
+  setup();
+  CHECK(!frame_arena_alloc(&arena, 16));
+  frame_arena_begin(&arena);
+  uint8_t *a = frame_arena_alloc(&arena, 10);
+  uint8_t *b = frame_arena_alloc(&arena, 1);
+  uint8_t *c = frame_arena_alloc(&arena, 0);
+  CHECK(a == mem + HEADER);
+  CHECK(b == a + 16 + HEADER);
+  CHECK(c == b + 8 + HEADER);
+  CHECK(aligned(a) && aligned(b) && aligned(c));
+  CHECK_EQ(frame_arena_size(a), 10);
+  CHECK_EQ(frame_arena_size(b), 1);
+  CHECK_EQ(arena.live, 3);
+  frame_arena_free(&arena, a);
+  frame_arena_free(&arena, b);
+  frame_arena_free(&arena, c);
+  CHECK(frame_arena_end(&arena));
+  CHECK(!frame_arena_alloc(&arena, 16));
+}
+
+// The last free resets the arena, mid-frame too; until then nothing moves
+static void test_reset(void) {
+  setup();
+  frame_arena_begin(&arena);
+  uint8_t *a = frame_arena_alloc(&arena, 100);
+  uint8_t *b = frame_arena_alloc(&arena, 100);
+  size_t used = arena.used;
+  frame_arena_free(&arena, a);
+  CHECK_EQ(arena.used, used);
+  uint8_t *c = frame_arena_alloc(&arena, 8);
+  CHECK(c > b);
+  frame_arena_free(&arena, b);
+  CHECK_EQ(arena.used, used + HEADER + 8);
+  frame_arena_free(&arena, c);
+  CHECK_EQ(arena.used, 0);
+  CHECK(frame_arena_alloc(&arena, 8) == a);
+  frame_arena_free(&arena, a);
+  CHECK(frame_arena_end(&arena));
+  CHECK_EQ(arena.pinned_frames, 0);
+}
+
+// An allocation still live when its frame ends pins the arena: it is not
+// reset, later frames allocate behind it, and its bytes stay put until it
+// is freed, which resets the arena outside a frame too
+static void test_pinned(void) {
+  setup();
+  frame_arena_begin(&arena);
+  uint8_t *kept = frame_arena_alloc(&arena, 64);
+  memset(kept, 0xa5, 64);
+  uint8_t *tmp = frame_arena_alloc(&arena, 64);
+  frame_arena_free(&arena, tmp);
+  CHECK(!frame_arena_end(&arena));
+  CHECK_EQ(arena.pinned_frames, 1);
+  CHECK(arena.used > 0);
+
+  for (int f = 0; f < 3; f++) {
+    frame_arena_begin(&arena);
+    uint8_t *p = frame_arena_alloc(&arena, 64);
+    CHECK(p >= kept + 64);
+    memset(p, 0x5a, 64);
+    frame_arena_free(&arena, p);
+    CHECK(!frame_arena_end(&arena));
+  }
+  CHECK_EQ(arena.pinned_frames, 4);
+  for (int i = 0; i < 64; i++) {
+    CHECK_EQ(kept[i], 0xa5);
+  }
+  frame_arena_free(&arena, kept);
+  CHECK_EQ(arena.used, 0);
+  frame_arena_begin(&arena);
+  CHECK(frame_arena_alloc(&arena, 64) == kept);
+}
+
+// What does not fit, or comes outside a frame, goes to the heap; the arena
+// keeps serving what still fits and never hands out memory past its end
+static void test_overflow(void) {
+  setup();
+  uint8_t *early = mem_alloc(16);
+  CHECK(!frame_arena_owns(&arena, early));
+  CHECK_EQ(arena.overflows, 0); // outside a frame is not an overflow
+
+  frame_arena_begin(&arena);
+  uint8_t *big = mem_alloc(ARENA_SIZE);
+  CHECK(!frame_arena_owns(&arena, big));
+  CHECK_EQ(arena.overflows, 1);
+  uint8_t *fill = mem_alloc(ARENA_SIZE - 2 * HEADER - 8);
+  CHECK(frame_arena_owns(&arena, fill));
+  uint8_t *last = mem_alloc(8);
+  CHECK(frame_arena_owns(&arena, last));
+  CHECK(last + 8 == mem + ARENA_SIZE);
+  CHECK_EQ(arena.used, ARENA_SIZE);
+  uint8_t *spill = mem_alloc(1);
+  CHECK(!frame_arena_owns(&arena, spill));
+  CHECK_EQ(arena.overflows, 2);
+  CHECK_EQ(heap_allocs, 3);
+
+  // Growing past the end moves the allocation to the heap, contents kept
+  memset(last, 0x3c, 8);
+  uint8_t *moved = mem_realloc(last, 32);
+  CHECK(!frame_arena_owns(&arena, moved));
+  for (int i = 0; i < 8; i++) {
+    CHECK_EQ(moved[i], 0x3c);
+  }
+  CHECK_EQ(arena.live, 1);
+
+  mem_free(early);
+  mem_free(big);
+  mem_free(spill);
+  mem_free(moved);
+  mem_free(fill);
+  CHECK_EQ(arena.used, 0);
+  CHECK(frame_arena_end(&arena));
+}
+
+// Only the newest allocation resizes, in place, within the arena
+static void test_resize(void) {
+  setup();
+  frame_arena_begin(&arena);
+  uint8_t *a = frame_arena_alloc(&arena, 16);
+  uint8_t *b = frame_arena_alloc(&arena, 16);
+  CHECK(!frame_arena_resize(&arena, a, 32));
+  CHECK(frame_arena_resize(&arena, b, 100));
+  CHECK_EQ(frame_arena_size(b), 100);
+  CHECK_EQ(arena.used, (size_t)(b - mem) + 104);
+  CHECK(frame_arena_resize(&arena, b, 4));
+  CHECK_EQ(arena.used, (size_t)(b - mem) + 8);
+  CHECK(!frame_arena_resize(&arena, b, ARENA_SIZE));
+  CHECK_EQ(frame_arena_size(b), 4);
+  uint8_t *c = frame_arena_alloc(&arena, 8);
+  CHECK(c == b + 8 + HEADER);
+  frame_arena_free(&arena, a);
+  frame_arena_free(&arena, b);
+  frame_arena_free(&arena, c);
+  CHECK(frame_arena_end(&arena));
+  CHECK(!frame_arena_resize(&arena, c, 8)); // frame closed
+}
+
+// High water is the most in use at once, headers and resizes included,
+// across frames; the counters add up
+static void test_stats(void) {
+  setup();
+  for (int f = 0; f < 3; f++) {
+    frame_arena_begin(&arena);
+    void *a = frame_arena_alloc(&arena, 40 * (f + 1));
+    void *b = frame_arena_alloc(&arena, 8);
+    frame_arena_free(&arena, a);
+    frame_arena_free(&arena, b);
+    frame_arena_end(&arena);
+  }
+  CHECK_EQ(arena.high_water, HEADER + 120 + HEADER + 8);
+  frame_arena_begin(&arena);
+  void *a = frame_arena_alloc(&arena, 8);
+  CHECK(frame_arena_resize(&arena, a, 200));
+  frame_arena_free(&arena, a);
+  frame_arena_end(&arena);
+  CHECK_EQ(arena.high_water, HEADER + 200);
+  CHECK(!frame_arena_alloc(&arena, ARENA_SIZE)); // outside a frame
+  CHECK_EQ(arena.allocs, 7);
+  CHECK_EQ(arena.frames, 4);
+  CHECK_EQ(arena.overflows, 0);
+  CHECK_EQ(arena.pinned_frames, 0);
+}
+
+// Random frames of allocations, resizes and frees through frame_mem.c's
+// allocator, a few kept across frames; each live block carries its own
+// byte, checked on every resize and free. No block may overlap another.
+typedef struct {
+  uint8_t *p;
+  size_t size;
+  uint8_t fill;
+} block_t;
+
+static block_t live[SOAK_LIVE];
+static int n_live;
+
+static void check_block(const block_t *b) {
+  for (size_t i = 0; i < b->size; i++) {
+    CHECK_EQ(b->p[i], b->fill);
+  }
+}
+
+static void drop(int i) {
+  check_block(&live[i]);
+  mem_free(live[i].p);
+  live[i] = live[--n_live];
+}
+
+static void test_soak(void) {
+  setup();
+  n_live = 0;
+  uint8_t fill = 0;
+  for (int f = 0; f < SOAK_FRAMES; f++) {
+    frame_arena_begin(&arena);
+    int ops = 1 + random_below(40);
+    for (int op = 0; op < ops; op++) {
+      uint32_t what = random_below(10);
+      if (what < 5 && n_live < SOAK_LIVE) {
+        block_t *b = &live[n_live++];
+        b->size = 1 + random_below(random_below(8) ? 64 : 600);
+        b->p = mem_alloc(b->size);
+        b->fill = ++fill;
+        memset(b->p, b->fill, b->size);
+      } else if (what < 7 && n_live) {
+        block_t *b = &live[random_below(n_live)];
+        check_block(b);
+        size_t size = 1 + random_below(200);
+        uint8_t *p = mem_realloc(b->p, size);
+        if (size > b->size) {
+          memset(p + b->size, b->fill, size - b->size);
+        }
+        b->p = p;
+        b->size = size;
+      } else if (n_live) {
+        drop(random_below(n_live));
+      }
+    }
+    // Most frames free everything; some keep a block or two going
+    int keep = random_below(16) ? 0 : 1 + random_below(2);
+    while (n_live > keep) {
+      drop(random_below(n_live));
+    }
+    bool pinned = false;
+    for (int i = 0; i < n_live; i++) {
+      pinned |= frame_arena_owns(&arena, live[i].p);
+      for (int j = 0; j < i; j++) {
+        CHECK(live[i].p + live[i].size <= live[j].p ||
+              live[j].p + live[j].size <= live[i].p);
+      }
+    }
+    // Pinned exactly when a kept block is in the arena
+    CHECK_EQ(frame_arena_end(&arena), !pinned);
+  }
+  while (n_live) {
+    drop(0);
+  }
+  CHECK_EQ(arena.live, 0);
+  CHECK_EQ(arena.used, 0);
+  printf("%d frames: %u arena allocations, %u to the heap, %u pinned "
+         "frames, high water %zu of %d bytes\n",
+         SOAK_FRAMES, arena.allocs, heap_allocs, arena.pinned_frames,
+         arena.high_water, ARENA_SIZE);
+  CHECK(arena.pinned_frames > 0);
+  CHECK(arena.overflows > 0);
+  CHECK(arena.high_water <= ARENA_SIZE);
+}
+
+int main(void) {
+  test_order();
+  test_reset();
+  test_pinned();
+  test_overflow();
+  test_resize();
+  test_stats();
+  test_soak();
+  puts("frame_arena: ok");
+  return 0;
+}
@@ -0,0 +1,189 @@
+// The natural gaze engine keeps the left eye inside
+// RoboEyes_getScreenConstraint_X/Y: on every frame of a long run of idle
+// hops, lookAt targets far off screen, positions and eye sizes that move
+// the constraint, with natural gaze on and off. Saccades must move
+// monotonically from start to target without overshoot, and micro-saccades
+// must stay within the noise table's two pixels of the fixation point.
+#include "FluxGarage_RoboEyes.h"
+#include "host_test.h"
+
+#define SCREEN_W 240
+#define SCREEN_H 135
+#define FRAMES 60000
+#define FPS 200
+#define FRAME_MS (1000 / FPS)
+#define EYE_SIZE 36 // the Kconfig defaults
+#define EYE_SPACE 10
+
+static uint32_t now;
+static uint64_t rng;
+static int frames; // drawn, counted by the update hook
+
+static void rect(int x, int y, int w, int h, int r, uint8_t color) {
+  (void)x, (void)y, (void)w, (void)h, (void)r, (void)color;
+}
+
+static void triangle(int x0, int y0, int x1, int y1, int x2, int y2,
+                     uint8_t color) {
+  (void)x0, (void)y0, (void)x1, (void)y1, (void)x2, (void)y2, (void)color;
+}
+
+static void clear(void) {}
+
+static void update(void) { frames++; }
+
+static uint32_t millis(void) { return now; }
+
+static uint32_t random_below(uint32_t limit) {
+  rng = rng * 6364136223846793005ull + 1442695040888963407ull;
+  return limit ? (uint32_t)(rng >> 33) % limit : 0;
+}
+
+// The eye geometry outlives RoboEyes_begin(): put back the default sizes
+static void begin(bool natural) {
+  now = 0;
+  rng = 7;
+  frames = 0;
+  RoboEyes_init(rect, triangle, clear, update, millis, random_below);
+  RoboEyes_setWidth(EYE_SIZE, EYE_SIZE);
+  RoboEyes_setHeight(EYE_SIZE, EYE_SIZE);
+  RoboEyes_setSpacebetween(EYE_SPACE);
+  RoboEyes_setCyclops(false);
+  RoboEyes_setCuriosity(false);
+  RoboEyes_setAutoblinker(false);
+  RoboEyes_setIdleMode(false);
+  RoboEyes_begin(SCREEN_W, SCREEN_H, FPS);
+  RoboEyes_setNaturalGaze(natural);
+}
+
+static void step(void) {
+  now += FRAME_MS;
+  RoboEyes_update();
+}
+
+static bool inside(void) {
+  int x, y;
+  RoboEyes_getGaze(&x, &y);
+  int cx = RoboEyes_getScreenConstraint_X();
+  int cy = RoboEyes_getScreenConstraint_Y();
+  return x >= 0 && y >= 0 && x <= (cx > 0 ? cx : 0) &&
+         y <= (cy > 0 ? cy : 0);
+}
+
+// Where lookAt(x, y) fixates the left eye, clamped like gazeTo()
+static void fixation(int x, int y, int *fx, int *fy) {
+  int cx = RoboEyes_getScreenConstraint_X();
+  int cy = RoboEyes_getScreenConstraint_Y();
+  *fx = x - (SCREEN_W - cx) / 2;
+  *fy = y - (SCREEN_H - cy) / 2;
+  *fx = *fx < 0 ? 0 : (*fx > cx ? cx : *fx);
+  *fy = *fy < 0 ? 0 : (*fy > cy ? cy : *fy);
+}
+
+// Idle hops, far targets, positions, cyclops and resized eyes
+static void test_bounds(bool natural) {
+  begin(natural);
+  RoboEyes_setAutoblinker2(true, 1, 1);
+  RoboEyes_setIdleMode2(true, 1, 1);
+  int outside = 0;
+  for (int f = 0; f < FRAMES; f++) {
+    if (f % 97 == 0) {
+      switch (random_below(6)) {
+      case 0:
+        RoboEyes_lookAt((int)random_below(4 * SCREEN_W) - 2 * SCREEN_W,
+                        (int)random_below(4 * SCREEN_H) - 2 * SCREEN_H);
+        break;
+      case 1:
+        RoboEyes_setPosition(random_below(9));
+        break;
+      case 2:
+        RoboEyes_setCyclops(random_below(2));
+        break;
+      case 3:
+        RoboEyes_setWidth(20 + random_below(90), 20 + random_below(90));
+        break;
+      case 4:
+        RoboEyes_setSpacebetween((int)random_below(60) - 20);
+        break;
+      default:
+        RoboEyes_setCuriosity(random_below(2));
+        break;
+      }
+    }
+    step();
+    outside += !inside();
+  }
+  printf("natural gaze %d: %d frames, %d outside\n", natural, frames,
+         outside);
+  CHECK_EQ(outside, 0);
+}
+
+// One saccade: each axis moves only towards the target and never past it,
+// and it lands within the longest saccade plus a frame
+static void saccade_to(int x, int y) {
+  int sx, sy, tx, ty;
+  RoboEyes_getGaze(&sx, &sy);
+  fixation(x, y, &tx, &ty);
+  RoboEyes_lookAt(x, y);
+  int px = sx, py = sy;
+  uint32_t start = now;
+  for (int f = 0; f < 100; f++) {
+    step();
+    int gx, gy;
+    RoboEyes_getGaze(&gx, &gy);
+    CHECK((gx - px) * (tx - sx) >= 0 && (gy - py) * (ty - sy) >= 0);
+    CHECK((gx - tx) * (sx - tx) >= 0 && (gy - ty) * (sy - ty) >= 0);
+    px = gx, py = gy;
+    if (gx == tx && gy == ty) {
+      CHECK(now - start <= 160 + FRAME_MS);
+      return;
+    }
+  }
+  CHECK(!"saccade did not land");
+}
+
+static void test_saccades(void) {
+  begin(true);
+  for (int i = 0; i < 200; i++) {
+    saccade_to((int)random_below(2 * SCREEN_W) - SCREEN_W / 2,
+               (int)random_below(2 * SCREEN_H) - SCREEN_H / 2);
+    // Let the first micro-saccade timer run out between jumps
+    for (int f = 0; f < 200 / FRAME_MS; f++) {
+      step();
+    }
+  }
+}
+
+// While fixating, the gaze jitters by the noise table's offsets, -2..1
+// pixels, at most once per 250 ms
+static void test_micro_saccades(void) {
+  begin(true);
+  saccade_to(SCREEN_W / 2, SCREEN_H / 2);
+  int tx, ty;
+  RoboEyes_getGaze(&tx, &ty);
+  int moves = 0, lx = tx, ly = ty;
+  uint32_t last = now;
+  for (int f = 0; f < 20000 / FRAME_MS; f++) {
+    step();
+    int gx, gy;
+    RoboEyes_getGaze(&gx, &gy);
+    CHECK(gx - tx >= -2 && gx - tx <= 1 && gy - ty >= -2 && gy - ty <= 1);
+    if (gx != lx || gy != ly) {
+      CHECK(now - last >= 250);
+      last = now;
+      moves++;
+    }
+    lx = gx, ly = gy;
+  }
+  printf("%d micro-saccades in 20 s\n", moves);
+  CHECK(moves >= 20);
+}
+
+int main(void) {
+  test_bounds(true);
+  test_bounds(false);
+  test_saccades();
+  test_micro_saccades();
+  puts("gaze: ok");
+  return 0;
+}
@@ -0,0 +1,153 @@
+// Key matrix scanning against simulated GPIO: key mapping, debounce and the
+// event queue
+#include "host_test.h"
+#include "keyboard_matrix.h"
+
+#include <string.h>
+
+#define DEBOUNCE 4 // scans of the two-bit vertical counter
+
+typedef struct {
+  uint8_t row;      // decoder address driven last
+  uint64_t pressed; // bit = row * KB_MATRIX_COLS + col
+} sim_t;
+
+static void sim_select(void *ctx, uint8_t row) { ((sim_t *)ctx)->row = row; }
+
+static uint8_t sim_read(void *ctx) {
+  sim_t *sim = ctx;
+  return (sim->pressed >> (sim->row * KB_MATRIX_COLS)) & 0x7f;
+}
+
+static sim_t sim;
+static kb_matrix_t kb;
+static uint32_t now_us;
+
+static void setup(void) {
+  memset(&sim, 0, sizeof(sim));
+  kb_gpio_ops_t ops = {.select_row = sim_select, .read_cols = sim_read,
+                       .ctx = &sim};
+  kb_matrix_init(&kb, &ops);
+  now_us = 0;
+}
+
+static bool scan(int n) {
+  bool held = false;
+  for (int i = 0; i < n; i++) {
+    now_us += 5000;
+    held = kb_matrix_scan(&kb, now_us);
+  }
+  return held;
+}
+
+static int pending(void) {
+  return atomic_load(&kb.head) - atomic_load(&kb.tail);
+}
+
+// Every matrix position is its own logical key, confirmed after exactly
+// DEBOUNCE scans, pressed and then released
+static void test_every_key(void) {
+  bool seen[KB_KEY_COUNT] = {false};
+  for (int bit = 0; bit < KB_MATRIX_ROWS * KB_MATRIX_COLS; bit++) {
+    setup();
+    sim.pressed = 1ULL << bit;
+    CHECK(!scan(DEBOUNCE - 1));
+    CHECK_EQ(pending(), 0);
+    CHECK(scan(1));
+    kb_event_t e;
+    CHECK(kb_matrix_pop(&kb, &e));
+    CHECK(e.pressed);
+    CHECK_EQ(e.time_us, now_us);
+    CHECK(e.key < KB_KEY_COUNT);
+    CHECK(!seen[e.key]);
+    seen[e.key] = true;
+    CHECK_EQ(e.code, kb_key_code(e.key));
+    uint8_t key = e.key;
+
+    sim.pressed = 0;
+    CHECK(scan(DEBOUNCE - 1));
+    CHECK(!scan(1));
+    CHECK(kb_matrix_pop(&kb, &e));
+    CHECK(!e.pressed);
+    CHECK_EQ(e.key, key);
+    CHECK(!kb_matrix_pop(&kb, &e));
+  }
+}
+
+// A few legends at known places in the layout
+static void test_layout(void) {
+  CHECK_EQ(kb_key_code(0), '`');
+  CHECK_EQ(kb_key_code(KB_LAYOUT_COLS + 1), 'q');
+  CHECK_EQ(kb_key_code(2 * KB_LAYOUT_COLS), KB_KEY_FN);
+  CHECK_EQ(kb_key_code(KB_KEY_COUNT - 1), ' ');
+  CHECK_EQ(kb_key_code(KB_KEY_COUNT), 0);
+}
+
+// Contact bounce shorter than the debounce depth never makes an event,
+// and restarts the count
+static void test_bounce(void) {
+  setup();
+  for (int i = 0; i < 20; i++) {
+    sim.pressed = i & 1 ? 0 : 1;
+    scan(1 + i % (DEBOUNCE - 1));
+  }
+  CHECK_EQ(pending(), 0);
+
+  setup();
+  sim.pressed = 1;
+  scan(DEBOUNCE - 1);
+  sim.pressed = 0;
+  scan(1);
+  sim.pressed = 1;
+  scan(DEBOUNCE - 1);
+  CHECK_EQ(pending(), 0);
+  scan(1);
+  CHECK_EQ(pending(), 1);
+}
+
+// Keys on the same row and on the shared columns of the two decoder halves
+// come out together
+static void test_chord(void) {
+  setup();
+  sim.pressed = (1ULL << 0) | (1ULL << 6) | (1ULL << (4 * KB_MATRIX_COLS));
+  scan(DEBOUNCE);
+  CHECK_EQ(pending(), 3);
+  kb_event_t e;
+  uint8_t keys[3];
+  for (int i = 0; i < 3; i++) {
+    CHECK(kb_matrix_pop(&kb, &e));
+    CHECK(e.pressed);
+    keys[i] = e.key;
+  }
+  CHECK(keys[0] != keys[1] && keys[1] != keys[2] && keys[0] != keys[2]);
+}
+
+// A full queue drops new events and counts them, keeping the oldest
+static void test_overflow(void) {
+  setup();
+  sim.pressed = (1ULL << 24) - 1;
+  scan(DEBOUNCE);
+  CHECK_EQ(pending(), KB_EVENT_QUEUE_LEN);
+  CHECK_EQ(kb.dropped, 24 - KB_EVENT_QUEUE_LEN);
+  kb_event_t e;
+  int n = 0;
+  while (kb_matrix_pop(&kb, &e)) {
+    CHECK(e.pressed);
+    n++;
+  }
+  CHECK_EQ(n, KB_EVENT_QUEUE_LEN);
+  // Room again once consumed
+  sim.pressed = 0;
+  scan(DEBOUNCE);
+  CHECK_EQ(pending(), KB_EVENT_QUEUE_LEN);
+}
+
+int main(void) {
+  test_every_key();
+  test_layout();
+  test_bounce();
+  test_chord();
+  test_overflow();
+  puts("keyboard_matrix: ok");
+  return 0;
+}
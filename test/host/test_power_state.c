@@ -0,0 +1,108 @@
+// Power manager inactivity state machine against a simulated clock: the
+// thresholds, what activity wakes, backlight and frame rate per state and
+// the millisecond counter wrapping
+#include "host_test.h"
+#include "power_state.h"
+
+static power_sm_t sm;
+
+static void setup(uint32_t now_ms, uint32_t deep_after_ms) {
+  power_config_t cfg = POWER_DEFAULT_CONFIG();
+  cfg.deep_after_ms = deep_after_ms;
+  power_sm_init(&sm, &cfg, now_ms);
+}
+
+// Each state starts exactly on its threshold, with its backlight and rate
+static void test_timeline(void) {
+  setup(1000, 600000);
+  CHECK_EQ(sm.state, POWER_ACTIVE);
+  CHECK_EQ(power_sm_backlight(&sm), sm.cfg.active_level);
+  CHECK_EQ(power_sm_fps(&sm), sm.cfg.active_fps);
+
+  CHECK(!power_sm_tick(&sm, 1000 + sm.cfg.dim_after_ms - 1));
+  CHECK_EQ(sm.state, POWER_ACTIVE);
+  CHECK(power_sm_tick(&sm, 1000 + sm.cfg.dim_after_ms));
+  CHECK_EQ(sm.state, POWER_DIM);
+  CHECK_EQ(power_sm_backlight(&sm), sm.cfg.dim_level);
+  CHECK_EQ(power_sm_fps(&sm), sm.cfg.active_fps);
+  CHECK(!power_sm_tick(&sm, 1000 + sm.cfg.dim_after_ms + 1));
+
+  CHECK(!power_sm_tick(&sm, 1000 + sm.cfg.sleepy_after_ms - 1));
+  CHECK(power_sm_tick(&sm, 1000 + sm.cfg.sleepy_after_ms));
+  CHECK_EQ(sm.state, POWER_SLEEPY);
+  CHECK_EQ(power_sm_backlight(&sm), sm.cfg.sleepy_level);
+  CHECK_EQ(power_sm_fps(&sm), sm.cfg.sleepy_fps);
+
+  CHECK(!power_sm_tick(&sm, 1000 + sm.cfg.deep_after_ms - 1));
+  CHECK(power_sm_tick(&sm, 1000 + sm.cfg.deep_after_ms));
+  CHECK_EQ(sm.state, POWER_DEEP_SLEEP);
+  CHECK_EQ(power_sm_backlight(&sm), 0);
+  CHECK(!power_sm_tick(&sm, 1000 + 2 * sm.cfg.deep_after_ms));
+}
+
+// A tick late enough goes straight to the deepest state it has reached
+static void test_skip(void) {
+  setup(0, 600000);
+  CHECK(power_sm_tick(&sm, sm.cfg.sleepy_after_ms + 5));
+  CHECK_EQ(sm.state, POWER_SLEEPY);
+  setup(0, 600000);
+  CHECK(power_sm_tick(&sm, sm.cfg.deep_after_ms));
+  CHECK_EQ(sm.state, POWER_DEEP_SLEEP);
+}
+
+// Activity reports a wake only out of DIM or SLEEPY, and restarts the
+// inactivity count either way
+static void test_activity(void) {
+  setup(0, 600000);
+  CHECK(!power_sm_activity(&sm, 100));
+  CHECK(!power_sm_tick(&sm, 100 + sm.cfg.dim_after_ms - 1));
+  CHECK(power_sm_tick(&sm, 100 + sm.cfg.dim_after_ms));
+
+  uint32_t now = 100 + sm.cfg.dim_after_ms + 50;
+  CHECK(power_sm_activity(&sm, now));
+  CHECK_EQ(sm.state, POWER_ACTIVE);
+  CHECK_EQ(power_sm_backlight(&sm), sm.cfg.active_level);
+  CHECK(!power_sm_tick(&sm, now + sm.cfg.dim_after_ms - 1));
+
+  CHECK(power_sm_tick(&sm, now + sm.cfg.sleepy_after_ms));
+  CHECK_EQ(sm.state, POWER_SLEEPY);
+  now += sm.cfg.sleepy_after_ms + 10;
+  CHECK(power_sm_activity(&sm, now));
+  CHECK_EQ(sm.state, POWER_ACTIVE);
+  CHECK_EQ(power_sm_fps(&sm), sm.cfg.active_fps);
+  CHECK(power_sm_tick(&sm, now + sm.cfg.dim_after_ms));
+  CHECK_EQ(sm.state, POWER_DIM);
+}
+
+// Without a deep sleep timeout the eyes stay sleepy
+static void test_no_deep_sleep(void) {
+  setup(0, 0);
+  CHECK(power_sm_tick(&sm, sm.cfg.sleepy_after_ms));
+  CHECK(!power_sm_tick(&sm, UINT32_MAX / 2));
+  CHECK_EQ(sm.state, POWER_SLEEPY);
+}
+
+// The inactivity time is an unsigned difference: the same across the
+// millisecond counter wrapping after 49.7 days
+static void test_wrap(void) {
+  uint32_t start = UINT32_MAX - 10000;
+  setup(start, 600000);
+  CHECK(!power_sm_tick(&sm, start + sm.cfg.dim_after_ms - 1));
+  CHECK_EQ(sm.state, POWER_ACTIVE);
+  CHECK(power_sm_tick(&sm, start + sm.cfg.dim_after_ms));
+  CHECK_EQ(sm.state, POWER_DIM);
+  CHECK(power_sm_tick(&sm, start + sm.cfg.sleepy_after_ms));
+  CHECK_EQ(sm.state, POWER_SLEEPY);
+  CHECK(power_sm_activity(&sm, start + sm.cfg.sleepy_after_ms + 1));
+  CHECK_EQ(sm.state, POWER_ACTIVE);
+}
+
+int main(void) {
+  test_timeline();
+  test_skip();
+  test_activity();
+  test_no_deep_sleep();
+  test_wrap();
+  puts("power_state: ok");
+  return 0;
+}
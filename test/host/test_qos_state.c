@@ -0,0 +1,162 @@
+// QoS ladder under synthetic load: a frame cost model whose parts go away
+// as the ladder's steps are taken, plus preemption by other work that comes
+// in bursts. The ladder must step down while the load lasts, cut the misses
+// compared with no QoS, climb all the way back once the load is gone, and
+// not flap when the load hovers around the budget: past the backoff, a step
+// up is tried at most once per up_frames << QOS_MAX_BACKOFF frames.
+#include "host_test.h"
+#include "qos_state.h"
+
+#define FAST_FPS 100
+#define RUN_MS 60000
+#define BURST_START_MS 15000
+#define BURST_END_MS 35000
+
+typedef uint32_t (*load_fn)(uint32_t t_ms);
+
+typedef struct {
+  uint32_t frames;
+  uint32_t misses;
+  uint32_t burst_misses_late; // misses in the second half of the burst
+  uint32_t transitions;
+  uint8_t max_level;
+  uint8_t end_level;
+  int32_t recovered_ms; // back at level 0 after the burst, -1 if not
+} qos_run_t;
+
+static uint64_t rng;
+
+static uint32_t random_below(uint32_t limit) {
+  rng = rng * 6364136223846793005ull + 1442695040888963407ull;
+  return (uint32_t)(rng >> 33) % limit;
+}
+
+// Microseconds: the flat full resolution render, sweat particles, the
+// styled paths, then the preemption, jittered by -20..+20%
+static uint32_t frame_cost(const qos_sm_t *sm, uint32_t load_us) {
+  uint32_t us = 5200;
+  us += qos_sm_has(sm, QOS_STEP_SWEAT) ? 0 : 400;
+  us += qos_sm_has(sm, QOS_STEP_FLAT) ? 0 : 2600;
+  if (qos_sm_has(sm, QOS_STEP_HALF_RES)) {
+    us /= 2;
+  }
+  return us + load_us * (80 + random_below(41)) / 100;
+}
+
+static qos_run_t run(load_fn load, bool qos) {
+  qos_config_t cfg = QOS_DEFAULT_CONFIG();
+  qos_sm_t sm;
+  qos_sm_init(&sm, &cfg);
+  rng = 1;
+  qos_run_t r = {.recovered_ms = -1};
+  for (uint32_t t = 0; t < RUN_MS;) {
+    int fps = qos_sm_has(&sm, QOS_STEP_FPS) ? cfg.low_fps : FAST_FPS;
+    uint32_t budget = 1000000 / fps;
+    uint32_t us = frame_cost(&sm, load(t));
+    r.frames++;
+    if (us > budget) {
+      r.misses++;
+      r.burst_misses_late +=
+          t >= (BURST_START_MS + BURST_END_MS) / 2 && t < BURST_END_MS;
+    }
+    if (qos) {
+      qos_sm_frame(&sm, us, budget);
+    }
+    r.max_level = sm.level > r.max_level ? sm.level : r.max_level;
+    if (t >= BURST_END_MS) {
+      if (sm.level) {
+        r.recovered_ms = -1;
+      } else if (r.recovered_ms < 0) {
+        r.recovered_ms = t - BURST_END_MS;
+      }
+    }
+    t += 1000 / fps;
+  }
+  r.transitions = sm.transitions;
+  r.end_level = sm.level;
+  return r;
+}
+
+static void print_run(const char *name, const qos_run_t *r) {
+  printf("%-7s %5u frames %5u missed (%4.1f%%), %u late in the burst, "
+         "%u transitions, level max %u end %u, back at 0 after %d ms\n",
+         name, r->frames, r->misses, 100.0 * r->misses / r->frames,
+         r->burst_misses_late, r->transitions, r->max_level, r->end_level,
+         r->recovered_ms);
+}
+
+static bool in_burst(uint32_t t) {
+  return t >= BURST_START_MS && t < BURST_END_MS;
+}
+
+// Nothing else running: full quality throughout
+static uint32_t idle_load(uint32_t t) {
+  (void)t;
+  return 300;
+}
+
+// Audio and serial traffic: dropping the style is enough
+static uint32_t burst_load(uint32_t t) { return in_burst(t) ? 3500 : 300; }
+
+// Far more than the full frame budget: only the lower frame rate helps
+static uint32_t heavy_load(uint32_t t) { return in_burst(t) ? 9000 : 300; }
+
+// Hovering around the budget for the whole run, each few frames different
+static uint32_t edge_load(uint32_t t) { return 1500 + (t / 37 % 5) * 250; }
+
+// The longest climb back to full quality: a wait at the full backoff at
+// the low frame rate, then a plain headroom run per step
+static int32_t max_recovery_ms(void) {
+  qos_config_t cfg = QOS_DEFAULT_CONFIG();
+  return (cfg.up_frames << QOS_MAX_BACKOFF) * 1000 / cfg.low_fps +
+         cfg.ladder_len * cfg.up_frames * 1000 / FAST_FPS;
+}
+
+static void test_idle(void) {
+  qos_run_t r = run(idle_load, true);
+  print_run("idle", &r);
+  CHECK_EQ(r.misses, 0u);
+  CHECK_EQ(r.transitions, 0u);
+}
+
+static void test_burst(void) {
+  qos_run_t off = run(burst_load, false);
+  qos_run_t on = run(burst_load, true);
+  print_run("burst", &on);
+  CHECK(on.max_level >= 2 && on.max_level < QOS_STEP_COUNT);
+  CHECK(on.misses * 10 < off.misses);
+  CHECK_EQ(on.burst_misses_late, 0u);
+  CHECK_EQ(on.end_level, 0);
+  CHECK(on.recovered_ms > 0 && on.recovered_ms <= max_recovery_ms());
+  CHECK(on.transitions <= 2u * on.max_level + 2);
+}
+
+static void test_heavy(void) {
+  qos_run_t off = run(heavy_load, false);
+  qos_run_t on = run(heavy_load, true);
+  print_run("heavy", &on);
+  CHECK_EQ(on.max_level, (uint8_t)QOS_STEP_COUNT);
+  CHECK(on.misses * 10 < off.misses);
+  CHECK_EQ(on.end_level, 0);
+  CHECK(on.recovered_ms > 0 && on.recovered_ms <= max_recovery_ms());
+}
+
+// The backoff keeps a load on the edge from walking the ladder up and down:
+// after the first failed tries, one step up and back per backed off run
+static void test_edge(void) {
+  qos_config_t cfg = QOS_DEFAULT_CONFIG();
+  qos_run_t on = run(edge_load, true);
+  print_run("edge", &on);
+  CHECK(on.transitions <=
+        4 + 2 * on.frames / (cfg.up_frames << QOS_MAX_BACKOFF));
+  CHECK(on.misses * 100 < on.frames);
+}
+
+int main(void) {
+  test_idle();
+  test_burst();
+  test_heavy();
+  test_edge();
+  puts("qos_state: ok");
+  return 0;
+}
@@ -0,0 +1,409 @@
+// The panel scroll as a horizontal shift, against a mock ST7789: panel
+// memory by gate line, the VSCRDEF scroll area and VSCSAD start line, and
+// what the glass shows. Eye frames moving along x are scrolled and only the
+// wrapped in columns redrawn, the way main/lcd.c does it, with flushed
+// areas packed by scroll_sm_pack() and split at the wrap. After every
+// frame the glass, and the screen mirror's copy as the host receives it,
+// must equal a full render of the frame, at full and half resolution, with
+// the screen mirrored on the gate lines or not. Without mirror_scroll() the
+// mirror falls behind.
+#include "eye_list.h"
+#include "host_test.h"
+#include "mirror_codec.h"
+#include "raster.h"
+#include "scroll_state.h"
+
+#include <string.h>
+
+#define SCREEN_W 240
+#define SCREEN_H 135
+#define BAND_LINES 40 // main/lcd.c's LCD_BUF_LINES
+#define FRAMES 3000
+
+typedef struct {
+  int x1, y1, x2, y2;
+} area_t;
+
+static const area_t no_area = {0, 0, -1, -1};
+
+// Panel memory, one row of pixels per gate line, and the scroll registers
+static uint16_t gram[320][SCREEN_H];
+static struct {
+  int top, lines, bottom; // VSCRDEF
+  int start;              // VSCSAD
+} scroll;
+static panel_geometry_t panel;
+static int commands;
+
+// The mirror: lcd.c's shadow frame and dirty rows, and the host's copy
+static uint16_t shadow[SCREEN_W * SCREEN_H];
+static uint16_t host[SCREEN_W * SCREEN_H];
+static struct {
+  int x0, x1;
+} dirty[SCREEN_H];
+static bool mirror_hook;
+
+static scroll_sm_t sm;
+static raster_target_t target;
+static bool half;
+static uint16_t band[SCREEN_W * BAND_LINES];
+static uint16_t park[SCREEN_W * BAND_LINES / 2];
+static uint16_t half_band[EYE_LIST_HALF_PX(SCREEN_W, BAND_LINES)];
+static uint16_t half_full[EYE_LIST_HALF_PX(SCREEN_W, SCREEN_H)];
+static uint16_t full[SCREEN_W * SCREEN_H];
+static area_t pending[8];
+static int pending_count;
+static uint64_t rng;
+
+static uint32_t random_below(uint32_t limit) {
+  rng = rng * 6364136223846793005ull + 1442695040888963407ull;
+  return (uint32_t)(rng >> 33) % limit;
+}
+
+static int get16(const uint8_t *p) { return p[0] << 8 | p[1]; }
+
+static void panel_cmd(void *ctx, uint8_t cmd, const uint8_t *data,
+                      size_t len) {
+  (void)ctx;
+  commands++;
+  if (cmd == ST7789_VSCRDEF && len == 6) {
+    scroll.top = get16(data);
+    scroll.lines = get16(data + 2);
+    scroll.bottom = get16(data + 4);
+    CHECK_EQ(scroll.top + scroll.lines + scroll.bottom, 320);
+  } else if (cmd == ST7789_VSCSAD && len == 2) {
+    scroll.start = get16(data);
+    CHECK(scroll.start >= scroll.top);
+    CHECK(scroll.start < scroll.top + scroll.lines);
+  } else {
+    CHECK(!"unknown panel command");
+  }
+}
+
+// Memory column x of the panel, written through the MADCTL MV mapping
+static int memory_line(int x) {
+  int line = 40 + x;
+  return panel.mirrored ? 319 - line : line;
+}
+
+static void draw_bitmap(int x1, int y1, int x2, int y2, const uint16_t *px) {
+  CHECK(x1 >= 0 && x2 <= SCREEN_W && x1 < x2);
+  for (int y = y1; y < y2; y++) {
+    for (int x = x1; x < x2; x++) {
+      gram[memory_line(x)][y] = px[(y - y1) * (x2 - x1) + x - x1];
+    }
+  }
+}
+
+// What the glass shows at screen column x: its gate line scans the memory
+// line the scroll start moves it to
+static uint16_t glass(int x, int y) {
+  int g = memory_line(x);
+  if (g >= scroll.top && g < scroll.top + scroll.lines) {
+    g = scroll.top + (g - scroll.top + scroll.start - scroll.top) %
+                         scroll.lines;
+  }
+  return gram[g][y];
+}
+
+// main/mirror.c's mirror_capture() and mirror_scroll()
+static void mirror_mark(int y, int x0, int x1) {
+  if (dirty[y].x1 < dirty[y].x0) {
+    dirty[y].x0 = x0;
+    dirty[y].x1 = x1;
+  } else {
+    dirty[y].x0 = x0 < dirty[y].x0 ? x0 : dirty[y].x0;
+    dirty[y].x1 = x1 > dirty[y].x1 ? x1 : dirty[y].x1;
+  }
+}
+
+static void mirror_capture(int x1, int y1, int x2, int y2,
+                           const uint16_t *px) {
+  int w = x2 - x1;
+  for (int y = y1; y < y2; y++) {
+    uint16_t *s = &shadow[y * SCREEN_W + x1];
+    int a, b;
+    if (mirror_row_diff(px + (y - y1) * w, s, w, &a, &b)) {
+      memcpy(s + a, px + (y - y1) * w + a, (b - a + 1) * sizeof(*s));
+      mirror_mark(y, x1 + a, x1 + b);
+    }
+  }
+}
+
+static void mirror_scroll(int dx) {
+  for (int y = 0; y < SCREEN_H; y++) {
+    int a, b;
+    if (mirror_row_scroll(&shadow[y * SCREEN_W], SCREEN_W, dx, &a, &b)) {
+      mirror_mark(y, a, b);
+    }
+  }
+}
+
+// The mirror task sends the dirty spans
+static void mirror_send(void) {
+  for (int y = 0; y < SCREEN_H; y++) {
+    if (dirty[y].x1 >= dirty[y].x0) {
+      memcpy(&host[y * SCREEN_W + dirty[y].x0],
+             &shadow[y * SCREEN_W + dirty[y].x0],
+             (dirty[y].x1 - dirty[y].x0 + 1) * sizeof(host[0]));
+    }
+    dirty[y].x0 = 1;
+    dirty[y].x1 = 0;
+  }
+}
+
+// lcd.c's robo_scroll_flush(): a split area is captured before packing
+// overwrites it
+static void flush(int x1, int y1, int x2, int y2, uint16_t *px) {
+  bool split = scroll_sm_splits(&sm, x1, x2 - x1);
+  if (split) {
+    mirror_capture(x1, y1, x2, y2, px);
+  }
+  scroll_piece_t pieces[2];
+  int n = scroll_sm_pack(&sm, x1, x2 - x1, y2 - y1, px, park, pieces);
+  CHECK_EQ(n, split ? 2 : 1);
+  for (int i = 0; i < n; i++) {
+    draw_bitmap(pieces[i].x, y1, pieces[i].x + pieces[i].w, y2, pieces[i].px);
+  }
+  if (!split) {
+    mirror_capture(x1, y1, x2, y2, px);
+  }
+}
+
+static void render(const eye_list_t *list, raster_target_t *t,
+                   uint16_t *scratch, int scratch_px) {
+  if (half) {
+    eye_list_render_half(list, t, scratch, scratch_px);
+  } else {
+    eye_list_render(list, t);
+  }
+}
+
+// LVGL drawing an invalidated area in draw buffer sized pieces
+static void refresh_area(const eye_list_t *list, area_t a) {
+  a.x1 = a.x1 < 0 ? 0 : a.x1;
+  a.y1 = a.y1 < 0 ? 0 : a.y1;
+  a.x2 = a.x2 >= SCREEN_W ? SCREEN_W - 1 : a.x2;
+  a.y2 = a.y2 >= SCREEN_H ? SCREEN_H - 1 : a.y2;
+  if (a.x2 < a.x1 || a.y2 < a.y1) {
+    return;
+  }
+  int w = a.x2 - a.x1 + 1;
+  int rows = SCREEN_W * BAND_LINES / w;
+  for (int y = a.y1; y <= a.y2; y += rows) {
+    int h = a.y2 - y + 1 < rows ? a.y2 - y + 1 : rows;
+    raster_set_window(&target, band, w, a.x1, y, w, h);
+    render(list, &target, half_band,
+           sizeof(half_band) / sizeof(half_band[0]));
+    flush(a.x1, y, a.x2 + 1, y + h, band);
+  }
+}
+
+static void invalidate(area_t a) {
+  if (a.x2 >= a.x1) {
+    pending[pending_count++] = a;
+  }
+}
+
+static void refresh(const eye_list_t *list) {
+  for (int i = 0; i < pending_count; i++) {
+    refresh_area(list, pending[i]);
+  }
+  pending_count = 0;
+  mirror_send();
+}
+
+// robo_widget_show()'s dirty area, padded at half resolution
+static area_t eyes_area(const eye_list_t *list) {
+  if (list->x2 < list->x1) {
+    return no_area;
+  }
+  int g = target.glow_size;
+  area_t a = {list->x1 - g, list->y1 - g, list->x2 + g, list->y2 + g};
+  if (half) {
+    a = (area_t){a.x1 & ~1, a.y1 & ~1, (a.x2 + 2) | 1, (a.y2 + 2) | 1};
+  }
+  return a;
+}
+
+// Two eyes, and an eyelid on the left one when they are half shut
+static void eyes(eye_list_t *list, int x, int y, int h) {
+  eye_list_reset(list);
+  eye_list_rect(list, x, y, 60, h, 12, 1);
+  eye_list_rect(list, x + 90, y, 60, h, 12, 1);
+  if (h < 30) {
+    eye_list_triangle(list, x, y, x + 60, y, x, y + 10, 0);
+  }
+}
+
+// Frames of random moves, mostly along x; returns the frames whose mirror
+// copy differed from the full render
+static int run(bool mirrored, bool half_res, bool hook) {
+  half = half_res;
+  mirror_hook = hook;
+  scroll_config_t cfg = SCROLL_DEFAULT_CONFIG();
+  cfg.panel.mirrored = mirrored;
+  panel = cfg.panel;
+  scroll_sm_init(&sm, &cfg);
+  scroll_sm_define(&sm, panel_cmd, NULL);
+  CHECK_EQ(scroll.lines, SCREEN_W);
+  CHECK_EQ(scroll.top, 40);
+  memset(gram, 0, sizeof(gram));
+  memset(shadow, 0, sizeof(shadow));
+  memset(host, 0, sizeof(host));
+  mirror_send();
+  raster_target_init(&target, band, SCREEN_W, SCREEN_W, BAND_LINES);
+  raster_set_colors(&target, 0x0000, 0x001f);
+  rng = 1;
+
+  static eye_list_t lists[2];
+  eye_list_t *rec = &lists[0];
+  const eye_list_t *shown = &lists[1];
+  eye_list_reset(&lists[0]);
+  eye_list_reset(&lists[1]);
+  invalidate((area_t){0, 0, SCREEN_W - 1, SCREEN_H - 1});
+  area_t drawn = no_area; // what the shown frame covers on the glass
+  int x = 40, y = 40, h = 50, scrolls = 0, behind = 0;
+  for (int f = 0; f < FRAMES; f++) {
+    int r = random_below(10);
+    if (r < 6) {
+      x += (int)random_below(41) - 20;
+    } else if (r < 7) {
+      y += (int)random_below(11) - 5;
+    } else if (r < 8) {
+      h = h == 50 ? 20 : 50;
+    } else if (r < 9) {
+      x = (int)random_below(240) - 40; // a jump, maybe past the edge
+    }
+    x = x < -80 ? -80 : (x > 200 ? 200 : x);
+    eyes(rec, x, y, h);
+    shown = rec;
+    rec = rec == &lists[0] ? &lists[1] : &lists[0];
+
+    // lcd.c's robo_scroll_show(): rec is the frame on the glass
+    int dx;
+    if (eye_list_moved_x(rec, shown, &dx) && scroll_sm_pays(&sm, dx) &&
+        !(half && (dx & 1))) {
+      refresh(rec); // whatever else is pending goes out first
+      CHECK(scroll_sm_move(&sm, dx, panel_cmd, NULL));
+      if (mirror_hook) {
+        mirror_scroll(dx);
+      }
+      drawn.x1 += dx;
+      drawn.x2 += dx;
+      int x1, x2;
+      scroll_sm_exposed(&sm, dx, &x1, &x2);
+      CHECK_EQ(x2 - x1 + 1, dx > 0 ? dx : -dx);
+      invalidate((area_t){x1, 0, x2, SCREEN_H - 1});
+      refresh(shown);
+      scrolls++;
+    } else {
+      // robo_widget_show(): the new frame's box and the last one's
+      area_t last = drawn;
+      drawn = eyes_area(shown);
+      invalidate(drawn);
+      invalidate(last);
+      // LVGL sometimes lets a pass go by
+      if (random_below(3)) {
+        continue;
+      }
+      refresh(shown);
+    }
+
+    raster_set_window(&target, full, SCREEN_W, 0, 0, SCREEN_W, SCREEN_H);
+    render(shown, &target, half_full,
+           sizeof(half_full) / sizeof(half_full[0]));
+    raster_set_window(&target, band, SCREEN_W, 0, 0, SCREEN_W, BAND_LINES);
+    for (int py = 0; py < SCREEN_H; py++) {
+      for (int px = 0; px < SCREEN_W; px++) {
+        CHECK_EQ(glass(px, py), full[py * SCREEN_W + px]);
+      }
+    }
+    behind += memcmp(host, full, sizeof(full)) != 0;
+  }
+  printf("mirrored %d, half %d, hook %d: %d scrolls, %u split flushes, "
+         "mirror behind in %d frames\n",
+         mirrored, half_res, hook, scrolls, sm.split_flushes, behind);
+  CHECK(scrolls > FRAMES / 10);
+  CHECK(sm.split_flushes > 0);
+  return behind;
+}
+
+static void test_moved_x(void) {
+  static eye_list_t a, b;
+  eyes(&a, 40, 40, 20);
+  eyes(&b, 33, 40, 20);
+  int dx;
+  CHECK(eye_list_moved_x(&a, &b, &dx));
+  CHECK_EQ(dx, -7);
+  // The eyelid's corners move along with the eyes
+  eyes(&b, 40, 40, 20);
+  b.prims[2].v[2] += 1;
+  CHECK(!eye_list_moved_x(&a, &b, &dx));
+  eyes(&b, 45, 41, 20);
+  CHECK(!eye_list_moved_x(&a, &b, &dx));
+  eyes(&b, 45, 40, 50);
+  CHECK(!eye_list_moved_x(&a, &b, &dx));
+  eyes(&b, 45, 40, 20);
+  b.prims[1].color = 0;
+  CHECK(!eye_list_moved_x(&a, &b, &dx));
+  eye_list_reset(&a);
+  eye_list_reset(&b);
+  CHECK(!eye_list_moved_x(&a, &b, &dx));
+}
+
+// Areas straddling the wrap: each piece holds its memory columns' pixels,
+// the narrower one parked, whichever side it is on
+static void test_pack(void) {
+  scroll_config_t cfg = SCROLL_DEFAULT_CONFIG();
+  scroll_sm_init(&sm, &cfg);
+  scroll_sm_define(&sm, panel_cmd, NULL);
+  CHECK(scroll_sm_move(&sm, -50, panel_cmd, NULL));
+  CHECK(!scroll_sm_move(&sm, cfg.max_shift + 1, panel_cmd, NULL));
+  CHECK(!scroll_sm_move(&sm, 0, panel_cmd, NULL));
+  // Screen column x is memory column (x + 50) % 240
+  static const int areas[][2] = {{180, 30}, {150, 60}, {185, 10}, {0, 190}};
+  uint32_t splits = 0;
+  for (int i = 0; i < 4; i++) {
+    int x = areas[i][0], w = areas[i][1], h = 3;
+    static uint16_t px[SCREEN_W * 3];
+    for (int k = 0; k < w * h; k++) {
+      px[k] = (uint16_t)((k / w) << 8 | (x + k % w));
+    }
+    bool split = scroll_sm_splits(&sm, x, w);
+    CHECK_EQ(split, (x + 50) % SCREEN_W + w > SCREEN_W);
+    splits += split;
+    scroll_piece_t pieces[2];
+    int n = scroll_sm_pack(&sm, x, w, h, px, park, pieces);
+    CHECK_EQ(n, split ? 2 : 1);
+    int total = 0;
+    for (int p = 0; p < n; p++) {
+      const scroll_piece_t *pc = &pieces[p];
+      CHECK(pc->x >= 0 && pc->x + pc->w <= SCREEN_W);
+      CHECK(pc->px == px || pc->w <= w / 2);
+      for (int r = 0; r < h; r++) {
+        for (int c = 0; c < pc->w; c++) {
+          int screen_x = (pc->x + c - 50 + SCREEN_W) % SCREEN_W;
+          CHECK_EQ(pc->px[r * pc->w + c], r << 8 | screen_x);
+        }
+      }
+      total += pc->w;
+    }
+    CHECK_EQ(total, w);
+  }
+  CHECK_EQ(sm.split_flushes, splits);
+  CHECK(splits >= 2);
+}
+
+int main(void) {
+  test_moved_x();
+  test_pack();
+  for (int mirrored = 0; mirrored < 2; mirrored++) {
+    for (int half_res = 0; half_res < 2; half_res++) {
+      CHECK_EQ(run(mirrored, half_res, true), 0);
+    }
+  }
+  CHECK(run(true, false, false) > 0);
+  puts("scroll_state: ok");
+  return 0;
+}
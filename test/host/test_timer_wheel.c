@@ -0,0 +1,139 @@
+// Hashed timer wheel against a virtual clock: each timer fires on the
+// first advance at or past its time and not before, timers more than a turn
+// of the wheel out wait their turn, cancel and re-arm from a callback work,
+// a late advance fires everything due, and all of it across the
+// millisecond counter wrapping
+#include "host_test.h"
+#include "timer_wheel.h"
+
+#define TIMERS 8
+
+static tw_wheel_t wheel;
+static tw_timer_t timers[TIMERS];
+static uint32_t due[TIMERS];
+static uint32_t fired_at[TIMERS];
+static int fired[TIMERS];
+static uint32_t now;
+
+static void on_fire(void *arg) {
+  int i = (int)(intptr_t)arg;
+  fired[i]++;
+  fired_at[i] = now;
+}
+
+static void arm(int i, uint32_t at) {
+  due[i] = at;
+  fired[i] = 0;
+  tw_schedule(&wheel, &timers[i], at, on_fire, (void *)(intptr_t)i);
+}
+
+// Advance 1 ms at a time to end: each armed timer fires once, in the tick
+// that reaches its time
+static void run_to(uint32_t end) {
+  while (now != end) {
+    now++;
+    tw_advance(&wheel, now);
+  }
+}
+
+static void check_fired(int i) {
+  CHECK_EQ(fired[i], 1);
+  CHECK((int32_t)(fired_at[i] - due[i]) >= 0);
+  CHECK((int32_t)(fired_at[i] - due[i]) < TW_TICK_MS);
+}
+
+// Timers a tick, a few ticks and several turns of the wheel out, from a
+// start time, all fire on time
+static void test_due(uint32_t start) {
+  now = start;
+  tw_init(&wheel, now);
+  static const uint32_t after[TIMERS] = {1,   9,   10,  11,
+                                         640, 641, 999, 5 * 640 + 3};
+  for (int i = 0; i < TIMERS; i++) {
+    arm(i, start + after[i]);
+  }
+  run_to(start + 5 * 640 + 3 + TW_TICK_MS);
+  for (int i = 0; i < TIMERS; i++) {
+    check_fired(i);
+  }
+}
+
+// A timer due now or in the past fires on the next tick
+static void test_past(uint32_t start) {
+  now = start;
+  tw_init(&wheel, now);
+  arm(0, now - 50);
+  arm(1, now);
+  tw_advance(&wheel, now);
+  CHECK_EQ(fired[0] + fired[1], 0);
+  run_to(now + TW_TICK_MS);
+  CHECK_EQ(fired[0], 1);
+  CHECK_EQ(fired[1], 1);
+}
+
+// A cancelled timer never fires; one armed again moves
+static void test_cancel(uint32_t start) {
+  now = start;
+  tw_init(&wheel, now);
+  arm(0, now + 100);
+  arm(1, now + 100);
+  arm(2, now + 100);
+  tw_cancel(&wheel, &timers[1]);
+  arm(2, now + 300);
+  run_to(start + 400);
+  check_fired(0);
+  CHECK_EQ(fired[1], 0);
+  check_fired(2);
+}
+
+// The render loop stalls: one late advance fires everything due by then,
+// and nothing due later, whole turns of the wheel late
+static void test_late(uint32_t start) {
+  now = start;
+  tw_init(&wheel, now);
+  arm(0, now + 30);
+  arm(1, now + 700);
+  arm(2, now + 2000);
+  now += 1500;
+  tw_advance(&wheel, now);
+  CHECK_EQ(fired[0], 1);
+  CHECK_EQ(fired[1], 1);
+  CHECK_EQ(fired[2], 0);
+  run_to(start + 2000 + TW_TICK_MS);
+  check_fired(2);
+}
+
+// A callback arming its own timer, as the behaviour runner does, every
+// 25 ms: no firing is lost or doubled
+static int periodic;
+
+static void on_periodic(void *arg) {
+  (void)arg;
+  periodic++;
+  tw_schedule(&wheel, &timers[0], now + 25, on_periodic, NULL);
+}
+
+static void test_rearm(uint32_t start) {
+  now = start;
+  tw_init(&wheel, now);
+  periodic = 0;
+  tw_schedule(&wheel, &timers[0], now + 25, on_periodic, NULL);
+  run_to(start + 25 * 100);
+  // Each re-arm is 25 ms after the tick that fired it, rounded up a tick
+  CHECK(periodic >= 2500 / 30 && periodic <= 100);
+}
+
+int main(void) {
+  // From boot, and straddling the millisecond counter wrapping
+  static const uint32_t starts[] = {0, 12345, UINT32_MAX - 1000,
+                                    UINT32_MAX - 4};
+  for (size_t i = 0; i < sizeof(starts) / sizeof(starts[0]); i++) {
+    test_due(starts[i]);
+    test_past(starts[i]);
+    test_cancel(starts[i]);
+    test_late(starts[i]);
+    test_rearm(starts[i]);
+  }
+  puts("timer_wheel: ok");
+  return 0;
+}
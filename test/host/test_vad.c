@@ -0,0 +1,187 @@
+// Voice activity detection over WAV input, as the microphone feeds it:
+// 256 sample blocks at 16 kHz. With files as arguments it prints where it
+// hears speech; without, it checks a synthesized trace with known speech
+// and reports the speed.
+#include "host_test.h"
+#include "vad.h"
+#include "wav.h"
+
+#include <math.h>
+#include <string.h>
+
+#define RATE 16000
+#define BLOCK 256
+#define BLOCK_MS (BLOCK * 1000 / RATE)
+
+typedef struct {
+  int start_ms, end_ms;
+} segment_t;
+
+// Speech-like bursts: a 140 Hz voice with formant partials, syllables at
+// 4 Hz, over low noise and mains hum
+static const segment_t speech[] = {{2000, 3500}, {5000, 5600}, {7000, 8800}};
+#define SPEECH_COUNT (sizeof(speech) / sizeof(speech[0]))
+#define TRACE_MS 11000
+
+static uint32_t lcg = 12345;
+static int noise(int amp) {
+  lcg = lcg * 1103515245 + 12345;
+  return (int)((lcg >> 16) % (2 * amp + 1)) - amp;
+}
+
+static int16_t *synth(size_t *count) {
+  size_t n = (size_t)TRACE_MS * RATE / 1000;
+  int16_t *s = malloc(n * sizeof(*s));
+  for (size_t i = 0; i < n; i++) {
+    double t = (double)i / RATE;
+    int ms = (int)(i * 1000 / RATE);
+    double v = noise(150) + 80 * sin(2 * M_PI * 50 * t);
+    for (size_t k = 0; k < SPEECH_COUNT; k++) {
+      if (ms >= speech[k].start_ms && ms < speech[k].end_ms) {
+        double env = 0.55 + 0.45 * sin(2 * M_PI * 4 * t);
+        double voice = 0;
+        for (int h = 1; h <= 12; h++) {
+          double formant = h == 4 || h == 9 ? 1.0 : 0.35;
+          voice += formant / h * sin(2 * M_PI * 140 * h * t);
+        }
+        v += 5000 * env * voice;
+      }
+    }
+    s[i] = v > 32767 ? 32767 : v < -32768 ? -32768 : (int16_t)v;
+  }
+  *count = n;
+  return s;
+}
+
+// Run the detector; returns the number of speech segments it found, written
+// to found[]
+static int detect(const int16_t *s, size_t count, segment_t *found, int cap) {
+  vad_t vad;
+  vad_config_t cfg = VAD_DEFAULT_CONFIG();
+  vad_init(&vad, &cfg);
+  int n = 0;
+  bool was = false;
+  for (size_t i = 0; i + BLOCK <= count; i += BLOCK) {
+    bool on = vad_process(&vad, s + i, BLOCK);
+    int ms = (int)((i + BLOCK) * 1000 / RATE);
+    if (on && !was && n < cap) {
+      found[n].start_ms = ms;
+      found[n].end_ms = -1;
+      n++;
+    } else if (!on && was && n <= cap) {
+      found[n - 1].end_ms = ms;
+    }
+    was = on;
+  }
+  return n;
+}
+
+static void test_trace(void) {
+  size_t n;
+  int16_t *s = synth(&n);
+  CHECK(!wav_write("vad_trace.wav", s, n, RATE));
+  free(s);
+  uint32_t rate;
+  s = wav_read("vad_trace.wav", &n, &rate);
+  CHECK(s);
+  CHECK_EQ(rate, RATE);
+
+  segment_t found[8];
+  int count = detect(s, n, found, 8);
+  for (int i = 0; i < count; i++) {
+    printf("speech %5d .. %5d ms\n", found[i].start_ms, found[i].end_ms);
+  }
+  CHECK_EQ(count, SPEECH_COUNT);
+  vad_config_t cfg = VAD_DEFAULT_CONFIG();
+  int hang_ms = cfg.hangover_blocks * BLOCK_MS;
+  for (size_t k = 0; k < SPEECH_COUNT; k++) {
+    // Heard within attack_blocks and a block of slack, held through the
+    // syllable dips, let go after the hangover
+    CHECK(found[k].start_ms >= speech[k].start_ms);
+    CHECK(found[k].start_ms <=
+          speech[k].start_ms + (cfg.attack_blocks + 1) * BLOCK_MS);
+    CHECK(found[k].end_ms >= speech[k].end_ms + hang_ms - BLOCK_MS);
+    CHECK(found[k].end_ms <= speech[k].end_ms + hang_ms + 2 * BLOCK_MS);
+  }
+
+  double t0 = host_now_s();
+  int rounds = 20;
+  for (int r = 0; r < rounds; r++) {
+    detect(s, n, found, 8);
+  }
+  double secs = host_now_s() - t0;
+  printf("%.1f Msamples/s, %.0fx real time\n", rounds * n / secs / 1e6,
+         rounds * n / (double)RATE / secs);
+  free(s);
+}
+
+// Full scale edges drive the DC blocker to its largest output: the block
+// energy must match a wide reference rather than wrap
+static void test_full_scale(void) {
+  int16_t s[BLOCK];
+  for (int i = 0; i < BLOCK; i++) {
+    s[i] = i & 32 ? -32768 : 32767;
+  }
+  vad_t vad;
+  vad_config_t cfg = VAD_DEFAULT_CONFIG();
+  vad_init(&vad, &cfg);
+  int64_t x_prev = 0, y = 0;
+  for (int b = 0; b < 4; b++) {
+    __int128 sum = 0;
+    for (int i = 0; i < BLOCK; i++) {
+      y = s[i] - x_prev + ((y * 32604) >> 15);
+      x_prev = s[i];
+      sum += (__int128)y * y;
+    }
+    vad_process(&vad, s, BLOCK);
+    CHECK_EQ(vad.energy, (uint64_t)(sum / BLOCK));
+  }
+}
+
+// A fan starting up: louder steady noise reads as speech at first, then
+// becomes the new background
+static void test_background_step(void) {
+  size_t n = 40 * RATE;
+  int16_t *s = malloc(n * sizeof(*s));
+  for (size_t i = 0; i < n; i++) {
+    s[i] = noise(i < 2 * RATE ? 150 : 700);
+  }
+  segment_t found[4];
+  int count = detect(s, n, found, 4);
+  CHECK_EQ(count, 1);
+  printf("background step at 2000 ms: on %d .. %d ms\n", found[0].start_ms,
+         found[0].end_ms);
+  CHECK(found[0].end_ms > 0 && found[0].end_ms < 30000);
+  free(s);
+}
+
+int main(int argc, char **argv) {
+  if (argc > 1) {
+    for (int i = 1; i < argc; i++) {
+      size_t n;
+      uint32_t rate;
+      int16_t *s = wav_read(argv[i], &n, &rate);
+      if (!s) {
+        fprintf(stderr, "%s: not a 16-bit PCM WAV file\n", argv[i]);
+        return 1;
+      }
+      if (rate != RATE) {
+        printf("%s: %u Hz, the device captures at %d\n", argv[i], rate,
+               RATE);
+      }
+      segment_t found[64];
+      int count = detect(s, n, found, 64);
+      printf("%s: %d speech segments\n", argv[i], count);
+      for (int k = 0; k < count && k < 64; k++) {
+        printf("  %6d .. %6d ms\n", found[k].start_ms, found[k].end_ms);
+      }
+      free(s);
+    }
+    return 0;
+  }
+  test_trace();
+  test_full_scale();
+  test_background_step();
+  puts("vad: ok");
+  return 0;
+}
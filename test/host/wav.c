@@ -0,0 +1,96 @@
+#include "wav.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static uint32_t le32(const uint8_t *p) {
+  return p[0] | p[1] << 8 | p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+static uint16_t le16(const uint8_t *p) { return p[0] | p[1] << 8; }
+
+int16_t *wav_read(const char *path, size_t *count, uint32_t *rate) {
+  FILE *f = fopen(path, "rb");
+  if (!f) {
+    return NULL;
+  }
+  uint8_t riff[12];
+  int16_t *out = NULL;
+  uint16_t channels = 0, bits = 0, format = 0;
+  if (fread(riff, 1, 12, f) != 12 || memcmp(riff, "RIFF", 4) ||
+      memcmp(riff + 8, "WAVE", 4)) {
+    goto done;
+  }
+  // Chunks in any order; data must come after fmt
+  uint8_t head[8];
+  while (fread(head, 1, 8, f) == 8) {
+    uint32_t size = le32(head + 4);
+    if (!memcmp(head, "fmt ", 4) && size >= 16) {
+      uint8_t fmt[16];
+      if (fread(fmt, 1, 16, f) != 16) {
+        goto done;
+      }
+      format = le16(fmt);
+      channels = le16(fmt + 2);
+      *rate = le32(fmt + 4);
+      bits = le16(fmt + 14);
+      fseek(f, size - 16 + (size & 1), SEEK_CUR);
+    } else if (!memcmp(head, "data", 4)) {
+      if (format != 1 || bits != 16 || !channels) {
+        goto done;
+      }
+      size_t frames = size / (2 * channels);
+      int16_t *raw = malloc(frames * channels * 2 + 1);
+      out = malloc(frames * 2 + 1);
+      frames = fread(raw, 2 * channels, frames, f);
+      for (size_t i = 0; i < frames; i++) {
+        int32_t sum = 0;
+        for (int c = 0; c < channels; c++) {
+          sum += (int16_t)le16((const uint8_t *)&raw[i * channels + c]);
+        }
+        out[i] = sum / channels;
+      }
+      free(raw);
+      *count = frames;
+      goto done;
+    } else {
+      fseek(f, size + (size & 1), SEEK_CUR);
+    }
+  }
+done:
+  fclose(f);
+  return out;
+}
+
+static void put32(uint8_t *p, uint32_t v) {
+  p[0] = v;
+  p[1] = v >> 8;
+  p[2] = v >> 16;
+  p[3] = v >> 24;
+}
+
+int wav_write(const char *path, const int16_t *samples, size_t count,
+              uint32_t rate) {
+  FILE *f = fopen(path, "wb");
+  if (!f) {
+    return -1;
+  }
+  uint8_t h[44];
+  memcpy(h, "RIFF", 4);
+  put32(h + 4, 36 + count * 2);
+  memcpy(h + 8, "WAVEfmt ", 8);
+  put32(h + 16, 16);
+  put32(h + 20, 1 | 1 << 16); // PCM, mono
+  put32(h + 24, rate);
+  put32(h + 28, rate * 2);
+  put32(h + 32, 2 | 16 << 16); // block align, bits
+  memcpy(h + 36, "data", 4);
+  put32(h + 40, count * 2);
+  fwrite(h, 1, sizeof(h), f);
+  for (size_t i = 0; i < count; i++) {
+    uint8_t s[2] = {samples[i] & 0xff, (uint16_t)samples[i] >> 8};
+    fwrite(s, 1, 2, f);
+  }
+  return fclose(f) ? -1 : 0;
+}
@@ -0,0 +1,16 @@
+#ifndef WAV_H
+#define WAV_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// 16-bit PCM WAV files for the host tests and benchmarks
+//
+// Read a file, averaging its channels to mono. Returns the samples
+// (free() them) and their count and rate, or NULL if it is not 16-bit PCM.
+int16_t *wav_read(const char *path, size_t *count, uint32_t *rate);
+// Write mono samples; returns 0 on success
+int wav_write(const char *path, const int16_t *samples, size_t count,
+              uint32_t rate);
+
+#endif // WAV_H
@@ -0,0 +1,423 @@
+#!/usr/bin/env python3
+"""Host client for the cardputer_assistant serial control protocol.
+
+Frames are 0xA5 0x5A len(u16) seq payload crc16, see main/control_proto.h.
+A payload is a batch of commands that the device applies between two
+rendered frames. Requires pyserial.
+
+    cardputer_ctl.py /dev/ttyACM0 mood happy
+    cardputer_ctl.py /dev/ttyACM0 text "hello"
+    cardputer_ctl.py /dev/ttyACM0 latency
+    cardputer_ctl.py /dev/ttyACM0 qos
+    cardputer_ctl.py /dev/ttyACM0 mem
+    cardputer_ctl.py /dev/ttyACM0 mic
+    cardputer_ctl.py /dev/ttyACM0 clip think
+    cardputer_ctl.py /dev/ttyACM0 say hello
+    cardputer_ctl.py /dev/ttyACM0 bench --seconds 5 --batch 8
+    cardputer_ctl.py /dev/ttyACM0 mirror --fps 10 --out screen.ppm
+"""
+
+import argparse
+import struct
+import sys
+import time
+
+SOF = b"\xa5\x5a"
+MAX_PAYLOAD = 1280
+
+CMD_PING = 0x00
+CMD_MOOD = 0x01
+CMD_POSITION = 0x02
+CMD_ACTION = 0x03
+CMD_SIZE = 0x04
+CMD_RADIUS = 0x05
+CMD_SPACE = 0x06
+CMD_FRAMERATE = 0x07
+CMD_AUTOBLINK = 0x08
+CMD_IDLE = 0x09
+CMD_HFLICKER = 0x0A
+CMD_VFLICKER = 0x0B
+CMD_MODULATION = 0x0C
+CMD_TEXT = 0x0D
+CMD_SCRIPT = 0x0E
+CMD_GET_LATENCY = 0x0F
+CMD_MIRROR = 0x10
+CMD_LOOK = 0x11
+CMD_GET_QOS = 0x12
+CMD_CLIP = 0x13
+CMD_GET_MEM = 0x14
+CMD_GET_MIC = 0x15
+CMD_SAY = 0x16
+
+REPLY_ACK = 0x80
+REPLY_LATENCY = 0x81
+REPLY_MIRROR = 0x82
+REPLY_QOS = 0x83
+REPLY_MEM = 0x84
+REPLY_MIC = 0x85
+
+MIRROR_HEADER = struct.Struct("<BBHHHHHI")
+MIRROR_LAST = 0x01
+MIRROR_CACHE_SIZE = 64
+
+MOODS = {"default": 0, "tired": 1, "angry": 2, "happy": 3}
+POSITIONS = {"center": 0, "n": 1, "ne": 2, "e": 3, "se": 4,
+             "s": 5, "sw": 6, "w": 7, "nw": 8}
+LATENCY_STAGES = ("applied", "frame", "flush")
+MEM_FIELDS = ("arena_size", "arena_high_water", "arena_allocs", "heap_allocs",
+              "overflows", "pinned_frames", "heap_free", "heap_min_free",
+              "heap_largest")
+MIC_FIELDS = ("blocks", "overruns", "cpu_permille", "process_max_us",
+              "energy", "noise_floor", "listening")
+
+
+def crc16(data, crc=0xFFFF):
+    """CRC-16/CCITT-FALSE."""
+    for byte in data:
+        crc ^= byte << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1021 if crc & 0x8000 else crc << 1) & 0xFFFF
+    return crc
+
+
+def encode_frame(seq, payload):
+    if len(payload) > MAX_PAYLOAD:
+        raise ValueError("payload too large")
+    body = struct.pack("<HB", len(payload), seq & 0xFF) + payload
+    return SOF + body + struct.pack("<H", crc16(body))
+
+
+def command(op, args=b""):
+    return struct.pack("<BH", op, len(args)) + bytes(args)
+
+
+class FrameDecoder:
+    """Incremental decoder; feed() returns the complete (seq, payload)s."""
+
+    def __init__(self):
+        self.buf = bytearray()
+        self.dropped = 0
+
+    def feed(self, data):
+        self.buf += data
+        frames = []
+        while True:
+            start = self.buf.find(SOF)
+            if start < 0:
+                # keep a trailing 0xA5, it may start the next frame
+                keep = 1 if self.buf[-1:] == SOF[:1] else 0
+                self.dropped += len(self.buf) - keep
+                del self.buf[:len(self.buf) - keep]
+                return frames
+            self.dropped += start
+            del self.buf[:start]
+            if len(self.buf) < 5:
+                return frames
+            length, seq = struct.unpack_from("<HB", self.buf, 2)
+            if length > MAX_PAYLOAD:
+                del self.buf[:1]
+                continue
+            total = length + 7
+            if len(self.buf) < total:
+                return frames
+            body = bytes(self.buf[2:5 + length])
+            (crc,) = struct.unpack_from("<H", self.buf, 5 + length)
+            if crc != crc16(body):
+                del self.buf[:1]
+                continue
+            frames.append((seq, body[3:]))
+            del self.buf[:total]
+
+
+def mirror_decode(data, count):
+    """Decode count RGB565 pixels coded as in main/mirror_codec.h."""
+    cache = [0] * MIRROR_CACHE_SIZE
+    prev = 0
+    out = []
+    i = 0
+    while len(out) < count:
+        b = data[i]
+        i += 1
+        if b < 0x40:
+            out += [prev] * (b + 1)
+        elif b < 0x80:
+            prev = cache[b & 0x3F]
+            out.append(prev)
+        elif b < 0xC0:
+            out += [prev] * ((((b & 0x3F) << 8) | data[i]) + 1)
+            i += 1
+        elif b == 0xFF:
+            prev = data[i] | (data[i + 1] << 8)
+            i += 2
+            cache[(prev ^ (prev >> 6) ^ (prev >> 12)) & 0x3F] = prev
+            out.append(prev)
+        else:
+            raise ValueError("bad mirror token 0x%02x" % b)
+    if len(out) != count:
+        raise ValueError("mirror run overflows its rectangle")
+    return out
+
+
+class MirrorDecoder:
+    """Rebuilds the panel from mirror chunks; feed() returns per frame
+    (frame_no, payload bytes, device encode us) once a frame is complete."""
+
+    def __init__(self, width=240, height=135):
+        self.width = width
+        self.height = height
+        self.pixels = [0] * (width * height)
+        self.frame_bytes = 0
+
+    def feed(self, payload):
+        kind, flags, frame, x, y, w, h, cost = MIRROR_HEADER.unpack_from(
+            payload)
+        if kind != REPLY_MIRROR:
+            raise ValueError("not a mirror chunk")
+        self.frame_bytes += len(payload)
+        if w and h:
+            if x + w > self.width or y + h > self.height:
+                raise ValueError("mirror rectangle outside the panel")
+            px = mirror_decode(payload[MIRROR_HEADER.size:], w * h)
+            for row in range(h):
+                start = (y + row) * self.width + x
+                self.pixels[start:start + w] = px[row * w:(row + 1) * w]
+        if not flags & MIRROR_LAST:
+            return None
+        done = (frame, self.frame_bytes, cost)
+        self.frame_bytes = 0
+        return done
+
+    def ppm(self):
+        rgb = bytearray()
+        for c in self.pixels:
+            rgb += bytes(((c >> 11) << 3, ((c >> 5) & 0x3F) << 2,
+                          (c & 0x1F) << 3))
+        return b"P6 %d %d 255\n" % (self.width, self.height) + bytes(rgb)
+
+
+class Client:
+    def __init__(self, port, baudrate=115200, timeout=1.0):
+        """port is a device path, or an open port object with pyserial's
+        read(), write(), in_waiting and close()."""
+        if isinstance(port, str):
+            import serial  # pyserial
+
+            port = serial.Serial(port, baudrate, timeout=timeout)
+        self.port = port
+        self.decoder = FrameDecoder()
+        self.seq = 0
+        self.pending = []
+
+    def close(self):
+        self.port.close()
+
+    def send(self, commands):
+        """Send a batch without waiting; returns its sequence number."""
+        self.seq = (self.seq + 1) & 0xFF
+        self.port.write(encode_frame(self.seq, b"".join(commands)))
+        return self.seq
+
+    def wait_reply(self, seq, timeout=1.0):
+        deadline = time.monotonic() + timeout
+        while time.monotonic() < deadline:
+            for frame in self.pending:
+                if frame[0] == seq and frame[1][:1] != bytes([REPLY_MIRROR]):
+                    self.pending.remove(frame)
+                    return frame[1]
+            data = self.port.read(self.port.in_waiting or 1)
+            self.pending += self.decoder.feed(data)
+        raise TimeoutError("no reply to batch %d" % seq)
+
+    def batch(self, commands, timeout=1.0):
+        """Send a batch and return (status, applied, extra payload)."""
+        reply = self.wait_reply(self.send(commands), timeout)
+        if not reply or reply[0] != REPLY_ACK:
+            raise IOError("unexpected reply %r" % reply)
+        return reply[1], reply[2], reply[3:]
+
+    def mirror_chunks(self, timeout=0.1):
+        """Mirror chunks received so far, dropping other stray frames."""
+        data = self.port.read(self.port.in_waiting or 1)
+        self.pending += self.decoder.feed(data)
+        chunks = [p for _, p in self.pending if p[:1] == bytes([REPLY_MIRROR])]
+        self.pending = [f for f in self.pending
+                        if f[1][:1] != bytes([REPLY_MIRROR])]
+        return chunks
+
+    def latency(self):
+        _, _, extra = self.batch([command(CMD_GET_LATENCY)])
+        if not extra or extra[0] != REPLY_LATENCY:
+            raise IOError("no latency data in reply")
+        stats = {}
+        for i, name in enumerate(LATENCY_STAGES):
+            count, p50, p90, p99, worst = struct.unpack_from(
+                "<5I", extra, 1 + i * 20)
+            stats[name] = dict(count=count, p50=p50, p90=p90, p99=p99,
+                               max=worst)
+        return stats
+
+    def qos(self):
+        _, _, extra = self.batch([command(CMD_GET_QOS)])
+        if not extra or extra[0] != REPLY_QOS:
+            raise IOError("no qos data in reply")
+        level, transitions, frames, misses, worst = struct.unpack_from(
+            "<B4I", extra, 1)
+        return dict(level=level, transitions=transitions, frames=frames,
+                    misses=misses, max=worst)
+
+    def mem(self):
+        _, _, extra = self.batch([command(CMD_GET_MEM)])
+        if not extra or extra[0] != REPLY_MEM:
+            raise IOError("no memory data in reply")
+        return dict(zip(MEM_FIELDS, struct.unpack_from("<9I", extra, 1)))
+
+    def mic(self):
+        _, _, extra = self.batch([command(CMD_GET_MIC)])
+        if not extra or extra[0] != REPLY_MIC:
+            raise IOError("no microphone data in reply")
+        return dict(zip(MIC_FIELDS, struct.unpack_from("<6IB", extra, 1)))
+
+
+def bench(client, seconds, batch_size):
+    """Round trip ping batches; returns commands per second."""
+    cmds = [command(CMD_PING)] * batch_size
+    done = 0
+    end = time.monotonic() + seconds
+    start = time.monotonic()
+    while time.monotonic() < end:
+        status, applied, _ = client.batch(cmds)
+        if status != 0:
+            raise IOError("batch failed with status %d" % status)
+        done += applied
+    return done / (time.monotonic() - start)
+
+
+def mirror(client, fps, seconds, out=None):
+    """Stream the screen, reporting bandwidth and device cost per frame."""
+    decoder = MirrorDecoder()
+    client.batch([command(CMD_MIRROR, [fps])])
+    frames = 0
+    total = 0
+    start = time.monotonic()
+    try:
+        while time.monotonic() - start < seconds:
+            for chunk in client.mirror_chunks():
+                done = decoder.feed(chunk)
+                if not done:
+                    continue
+                frames += 1
+                total += done[1]
+                print("frame %5d: %6d bytes, encode %5d us" % done)
+                if out:
+                    with open(out, "wb") as f:
+                        f.write(decoder.ppm())
+    finally:
+        client.batch([command(CMD_MIRROR, [0])], timeout=2.0)
+    elapsed = time.monotonic() - start
+    if frames:
+        print("%d frames, %.0f bytes/frame, %.1f kB/s" % (
+            frames, total / frames, total / elapsed / 1000))
+
+
+def main(argv=None):
+    parser = argparse.ArgumentParser(description=__doc__.split("\n")[0])
+    parser.add_argument("port")
+    sub = parser.add_subparsers(dest="cmd", required=True)
+    sub.add_parser("ping")
+    p = sub.add_parser("mood")
+    p.add_argument("mood", choices=MOODS)
+    p = sub.add_parser("position")
+    p.add_argument("position", choices=POSITIONS)
+    p = sub.add_parser("look")
+    p.add_argument("x", type=int)
+    p.add_argument("y", type=int)
+    p = sub.add_parser("clip", help="play clips/NAME.clp from the SD card")
+    p.add_argument("name", nargs="?", default="", help="omit to stop")
+    p = sub.add_parser("say", help="play sounds/NAME.wav from the SD card")
+    p.add_argument("name")
+    p = sub.add_parser("text")
+    p.add_argument("text")
+    p.add_argument("--large", action="store_true")
+    p = sub.add_parser("script")
+    p.add_argument("file", type=argparse.FileType("rb"))
+    sub.add_parser("latency")
+    sub.add_parser("qos")
+    sub.add_parser("mem")
+    sub.add_parser("mic")
+    p = sub.add_parser("bench")
+    p.add_argument("--seconds", type=float, default=5.0)
+    p.add_argument("--batch", type=int, default=8)
+    p = sub.add_parser("mirror")
+    p.add_argument("--fps", type=int, default=10)
+    p.add_argument("--seconds", type=float, default=10.0)
+    p.add_argument("--out", help="PPM file rewritten with every frame")
+    args = parser.parse_args(argv)
+
+    client = Client(args.port)
+    try:
+        if args.cmd == "latency":
+            for name, s in client.latency().items():
+                print("%-7s n=%d p50=%d p90=%d p99=%d max=%d us" % (
+                    name, s["count"], s["p50"], s["p90"], s["p99"],
+                    s["max"]))
+            return 0
+        if args.cmd == "qos":
+            s = client.qos()
+            print("level %d, %d transitions, %d/%d frames missed, max %d us"
+                  % (s["level"], s["transitions"], s["misses"], s["frames"],
+                     s["max"]))
+            return 0
+        if args.cmd == "mem":
+            s = client.mem()
+            frag = 100 - 100 * s["heap_largest"] // max(s["heap_free"], 1)
+            print("arena %d/%d bytes peak, %d allocations, %d to the heap, "
+                  "%d overflows, %d pinned frames"
+                  % (s["arena_high_water"], s["arena_size"], s["arena_allocs"],
+                     s["heap_allocs"], s["overflows"], s["pinned_frames"]))
+            print("internal heap %d free, %d at worst, largest block %d "
+                  "(%d%% fragmented)"
+                  % (s["heap_free"], s["heap_min_free"], s["heap_largest"],
+                     frag))
+            return 0
+        if args.cmd == "mic":
+            s = client.mic()
+            print("%s, energy %d over a floor of %d"
+                  % ("listening" if s["listening"] else "quiet", s["energy"],
+                     s["noise_floor"]))
+            print("%d blocks, %d overruns, %.1f%% CPU, worst block %d us"
+                  % (s["blocks"], s["overruns"], s["cpu_permille"] / 10,
+                     s["process_max_us"]))
+            return 0
+        if args.cmd == "bench":
+            rate = bench(client, args.seconds, args.batch)
+            print("%.0f commands/s (batches of %d)" % (rate, args.batch))
+            return 0
+        if args.cmd == "mirror":
+            mirror(client, args.fps, args.seconds, args.out)
+            return 0
+        if args.cmd == "ping":
+            cmds = [command(CMD_PING)]
+        elif args.cmd == "mood":
+            cmds = [command(CMD_MOOD, [MOODS[args.mood]])]
+        elif args.cmd == "position":
+            cmds = [command(CMD_POSITION, [POSITIONS[args.position]])]
+        elif args.cmd == "look":
+            cmds = [command(CMD_LOOK, struct.pack("<hh", args.x, args.y))]
+        elif args.cmd == "clip":
+            cmds = [command(CMD_CLIP, args.name.encode())]
+        elif args.cmd == "say":
+            cmds = [command(CMD_SAY, args.name.encode())]
+        elif args.cmd == "text":
+            cmds = [command(CMD_TEXT, bytes([1 if args.large else 0]) +
+                            args.text.encode("ascii"))]
+        else:
+            cmds = [command(CMD_SCRIPT, args.file.read())]
+        status, applied, _ = client.batch(cmds)
+        print("status %d, %d applied" % (status, applied))
+        return status
+    finally:
+        client.close()
+
+
+if __name__ == "__main__":
+    sys.exit(main())
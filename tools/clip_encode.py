@@ -0,0 +1,209 @@
+#!/usr/bin/env python3
+"""Encode PPM frames into a clip for the microSD card player.
+
+Each frame after the first only carries the rectangle that changed since
+the one before it, coded as in main/mirror_codec.h; see main/clip_codec.h
+for the file layout. Copy the result to clips/<name>.clp on the card.
+
+    clip_encode.py -o spinner.clp --frame-ms 40 --loop frames/*.ppm
+    clip_encode.py -o spinner.clp --check frames/*.ppm
+"""
+
+import argparse
+import struct
+import sys
+
+CLIP_MAGIC = b"RC"
+CLIP_VERSION = 1
+CLIP_FLAG_LOOP = 0x01
+CLIP_HEADER = struct.Struct("<2sBBHHHH")
+FRAME_HEADER = struct.Struct("<HHHHI")
+
+MIRROR_CACHE_SIZE = 64
+MIRROR_MAX_RUN = 16384
+
+
+def cache_index(c):
+    return (c ^ (c >> 6) ^ (c >> 12)) & (MIRROR_CACHE_SIZE - 1)
+
+
+def read_ppm(path):
+    """(width, height, RGB565 pixels) of a binary PPM."""
+    with open(path, "rb") as f:
+        data = f.read()
+    fields = []
+    pos = 0
+    while len(fields) < 4:
+        while data[pos:pos + 1].isspace():
+            pos += 1
+        if data[pos:pos + 1] == b"#":
+            pos = data.index(b"\n", pos)
+            continue
+        end = pos
+        while not data[end:end + 1].isspace():
+            end += 1
+        fields.append(data[pos:end])
+        pos = end
+    if fields[0] != b"P6" or fields[3] != b"255":
+        raise ValueError("%s: only 8-bit binary PPM is supported" % path)
+    w, h = int(fields[1]), int(fields[2])
+    rgb = data[pos + 1:pos + 1 + w * h * 3]
+    if len(rgb) != w * h * 3:
+        raise ValueError("%s: truncated" % path)
+    px = [((rgb[i] >> 3) << 11) | ((rgb[i + 1] >> 2) << 5) | (rgb[i + 2] >> 3)
+          for i in range(0, len(rgb), 3)]
+    return w, h, px
+
+
+def put_run(out, run):
+    while run > 0:
+        n = min(run, MIRROR_MAX_RUN)
+        if n <= 64:
+            out.append(n - 1)
+        else:
+            out += bytes((0x80 | ((n - 1) >> 8), (n - 1) & 0xFF))
+        run -= n
+
+
+def encode_rect(px, stride, x, y, w, h):
+    """The same code main/mirror_codec.c produces for a rectangle."""
+    cache = [None] * MIRROR_CACHE_SIZE
+    prev = 0
+    run = 0
+    out = bytearray()
+    for row in range(y, y + h):
+        for c in px[row * stride + x:row * stride + x + w]:
+            if c == prev:
+                run += 1
+                continue
+            put_run(out, run)
+            run = 0
+            i = cache_index(c)
+            if cache[i] == c:
+                out.append(0x40 | i)
+            else:
+                cache[i] = c
+                out += bytes((0xFF, c & 0xFF, c >> 8))
+            prev = c
+    put_run(out, run)
+    return bytes(out)
+
+
+def changed_rect(prev, cur, w, h):
+    """Bounding box (x, y, w, h) of the pixels that differ, or None."""
+    rows = [r for r in range(h)
+            if prev[r * w:(r + 1) * w] != cur[r * w:(r + 1) * w]]
+    if not rows:
+        return None
+    x0, x1 = w, -1
+    for r in rows:
+        base = r * w
+        for x in range(w):
+            if prev[base + x] != cur[base + x]:
+                x0 = min(x0, x)
+                break
+        for x in range(w - 1, -1, -1):
+            if prev[base + x] != cur[base + x]:
+                x1 = max(x1, x)
+                break
+    return x0, rows[0], x1 - x0 + 1, rows[-1] - rows[0] + 1
+
+
+def encode(frames, w, h, frame_ms, loop):
+    flags = CLIP_FLAG_LOOP if loop else 0
+    out = bytearray(CLIP_HEADER.pack(CLIP_MAGIC, CLIP_VERSION, flags, w, h,
+                                     len(frames), frame_ms))
+    prev = None
+    for i, px in enumerate(frames):
+        # The first frame draws over the eyes, and again over the last frame
+        # when looping: always send it whole
+        rect = (0, 0, w, h) if i == 0 else changed_rect(prev, px, w, h)
+        if rect:
+            data = encode_rect(px, w, *rect)
+            out += FRAME_HEADER.pack(*rect, len(data)) + data
+        else:
+            out += FRAME_HEADER.pack(0, 0, 0, 0, 0)
+        prev = px
+    return bytes(out)
+
+
+def decode(clip):
+    """Frames of a clip as full RGB565 pixel lists, for checking."""
+    magic, version, _, w, h, count, _ = CLIP_HEADER.unpack_from(clip)
+    if magic != CLIP_MAGIC or version != CLIP_VERSION:
+        raise ValueError("not a clip")
+    pos = CLIP_HEADER.size
+    screen = [0] * (w * h)
+    frames = []
+    for _ in range(count):
+        x, y, fw, fh, size = FRAME_HEADER.unpack_from(clip, pos)
+        pos += FRAME_HEADER.size
+        data = clip[pos:pos + size]
+        pos += size
+        cache = [0] * MIRROR_CACHE_SIZE
+        prev = 0
+        px = []
+        i = 0
+        while len(px) < fw * fh:
+            b = data[i]
+            i += 1
+            if b < 0x40:
+                px += [prev] * (b + 1)
+            elif b < 0x80:
+                prev = cache[b & 0x3F]
+                px.append(prev)
+            elif b < 0xC0:
+                px += [prev] * ((((b & 0x3F) << 8) | data[i]) + 1)
+                i += 1
+            else:
+                prev = data[i] | (data[i + 1] << 8)
+                i += 2
+                cache[cache_index(prev)] = prev
+                px.append(prev)
+        if len(px) != fw * fh or i != size:
+            raise ValueError("frame data does not match its rectangle")
+        for row in range(fh):
+            start = (y + row) * w + x
+            screen[start:start + fw] = px[row * fw:(row + 1) * fw]
+        frames.append(list(screen))
+    return frames
+
+
+def main(argv=None):
+    parser = argparse.ArgumentParser(description=__doc__.split("\n")[0])
+    parser.add_argument("frames", nargs="+", help="PPM files, in order")
+    parser.add_argument("-o", "--out", required=True)
+    parser.add_argument("--frame-ms", type=int, default=40)
+    parser.add_argument("--loop", action="store_true")
+    parser.add_argument("--check", action="store_true",
+                        help="decode the result and compare it")
+    args = parser.parse_args(argv)
+
+    frames = []
+    size = None
+    for path in args.frames:
+        w, h, px = read_ppm(path)
+        if size and size != (w, h):
+            raise SystemExit("%s: frames differ in size" % path)
+        size = (w, h)
+        frames.append(px)
+    w, h = size
+    if w > 240 or h > 135:
+        raise SystemExit("frames are larger than the 240x135 screen")
+
+    clip = encode(frames, w, h, args.frame_ms, args.loop)
+    with open(args.out, "wb") as f:
+        f.write(clip)
+    raw = len(frames) * w * h * 2
+    print("%d frames %dx%d: %d bytes, %.1f%% of raw RGB565" % (
+        len(frames), w, h, len(clip), 100.0 * len(clip) / raw))
+    if args.check:
+        if decode(clip) != frames:
+            print("check failed: decoded frames differ", file=sys.stderr)
+            return 1
+        print("check ok")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())